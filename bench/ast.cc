@@ -0,0 +1,119 @@
+/*
+ *
+ *  Benchmark building and freeing the trees of a batch of formulas:
+ *  arena against a handler allocating one heap object per node.
+ *
+ */
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "lib/ast.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static std::vector<std::string> batch(int count)
+{
+    std::vector<std::string> result;
+
+    for(int i = 0; i < count; ++i)
+        result.push_back("a*x" + std::to_string(i%7) + "**2 + b*sin(y - " + std::to_string(i) + ") / (1 + c*z)");
+
+    return result;
+}
+
+/**
+    The tree users had to write by hand
+*/
+struct HeapNode
+{
+    linlib::OpCode              op;
+    double                      value;
+    std::string                 name;
+    std::unique_ptr<HeapNode>   left;
+    std::unique_ptr<HeapNode>   right;
+};
+
+class HeapBuilder : public linlib::EventHandler
+{
+    std::vector<std::unique_ptr<HeapNode>>  _stack;
+
+    bool push(linlib::OpCode op, std::size_t operands, double value = 0, std::string name = std::string())
+    {
+        std::unique_ptr<HeapNode> node{new HeapNode{ op, value, std::move(name), nullptr, nullptr }};
+
+        if (operands > 0)
+        {
+            node->right = std::move(_stack.back());
+            _stack.pop_back();
+        }
+        if (operands > 1)
+        {
+            node->left = std::move(_stack.back());
+            _stack.pop_back();
+        }
+        _stack.push_back(std::move(node));
+
+        return true;
+    }
+
+    public:
+    std::unique_ptr<HeapNode> finish()
+    {
+        std::unique_ptr<HeapNode> root = std::move(_stack.back());
+        _stack.clear();
+
+        return root;
+    }
+
+    bool number(double value) { return push(linlib::OpCode::CONST, 0, value); }
+    bool call(const char *identifier, std::size_t len) { return push(linlib::OpCode::CALL, 1, 0, std::string(identifier, len)); }
+    bool load(const char *identifier, std::size_t len) { return push(linlib::OpCode::LOAD, 0, 0, std::string(identifier, len)); }
+    bool binary_op(linlib::BinaryOpCode opcode) { return push(linlib::OpCode::ADD, 2); }
+    bool unary_op(linlib::UnaryOpCode opcode) { return push(linlib::OpCode::NEG, 1); }
+};
+
+// ========================================================================
+//  Benchmarks
+// ========================================================================
+static void heap(benchmark::State& state)
+{
+    const std::vector<std::string>  formulas = batch(state.range(0));
+    HeapBuilder                     builder;
+
+    for(auto _ : state)
+    {
+        std::vector<std::unique_ptr<HeapNode>> trees;
+
+        for(const std::string& formula : formulas)
+        {
+            linlib::Parser parser{formula.c_str(), builder};
+            parser.parse();
+            trees.push_back(builder.finish());
+        }
+        benchmark::DoNotOptimize(trees.data());
+    }
+    state.SetItemsProcessed(state.iterations() * formulas.size());
+}
+BENCHMARK(heap)->Range(16, 4096);
+
+static void arena(benchmark::State& state)
+{
+    const std::vector<std::string>  formulas = batch(state.range(0));
+    linlib::AstArena                arena;
+    linlib::AstBuilder              builder{arena};
+    std::vector<linlib::Ast>        trees(formulas.size());
+
+    for(auto _ : state)
+    {
+        for(std::size_t i = 0; i < formulas.size(); ++i)
+            linlib::parse(formulas[i].c_str(), builder, trees[i]);
+
+        benchmark::DoNotOptimize(trees.data());
+        arena.clear();
+    }
+    state.SetItemsProcessed(state.iterations() * formulas.size());
+}
+BENCHMARK(arena)->Range(16, 4096);
@@ -0,0 +1,97 @@
+/*
+ *
+ *  Benchmark the columnar batch evaluator against the row-at-a-time
+ *  interpreter.
+ *
+ */
+#include <random>
+
+#include "benchmark/benchmark.h"
+#include "lib/batch.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static const char*          expression = "x*y + z/x - y*2";
+static const std::size_t    ROWS = 1 << 20;
+
+struct Fixture
+{
+    linlib::Program                     program;
+    std::vector<std::vector<double>>    data;
+    std::vector<const double*>          columns;
+    std::vector<double>                 out;
+
+    Fixture()
+      : out(ROWS)
+    {
+        linlib::compile(expression, program);
+
+        std::mt19937_64 rng;
+        std::uniform_real_distribution<double> dist(1.0, 2.0);
+
+        data.resize(program.variables.size());
+        for(auto& column : data)
+        {
+            for(std::size_t i = 0; i < ROWS; ++i)
+                column.push_back(dist(rng));
+            columns.push_back(column.data());
+        }
+    }
+};
+
+static Fixture& fixture()
+{
+    static Fixture fixture;
+    return fixture;
+}
+
+// ========================================================================
+//  Benchmarks
+// ========================================================================
+static void scalar_rows(benchmark::State& state)
+{
+    Fixture&            f = fixture();
+    linlib::Machine     machine;
+    std::vector<double> row(f.data.size());
+
+    for(auto _ : state)
+    {
+        for(std::size_t i = 0; i < ROWS; ++i)
+        {
+            for(std::size_t j = 0; j < row.size(); ++j)
+                row[j] = f.columns[j][i];
+            f.out[i] = machine.run(f.program, row.data(), nullptr);
+        }
+        benchmark::DoNotOptimize(f.out.data());
+    }
+
+    state.SetItemsProcessed(state.iterations()*ROWS);
+}
+BENCHMARK(scalar_rows);
+
+static void batch(benchmark::State& state)
+{
+    const linlib::Kernels* kernels = linlib::kernels(static_cast<linlib::Isa>(state.range(0)));
+    if (!kernels)
+    {
+        state.SkipWithError("instruction set not supported by the host");
+        return;
+    }
+    state.SetLabel(kernels->name);
+
+    Fixture&                f = fixture();
+    linlib::BatchEvaluator  evaluator{*kernels};
+
+    for(auto _ : state)
+    {
+        evaluator.run(f.program, f.columns.data(), nullptr, f.out.data(), ROWS);
+        benchmark::DoNotOptimize(f.out.data());
+    }
+
+    state.SetItemsProcessed(state.iterations()*ROWS);
+}
+BENCHMARK(batch)->DenseRange(
+    static_cast<int>(linlib::Isa::SCALAR),
+    static_cast<int>(linlib::Isa::AVX512)
+);
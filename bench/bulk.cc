@@ -0,0 +1,84 @@
+/*
+ *
+ *  Benchmark the parallel bulk compiler from one thread to one per
+ *  hardware thread.
+ *
+ */
+#include <algorithm>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "lib/bulk.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static const std::size_t    COUNT = 100000;
+
+/**
+    A catalog of formulas of various sizes.
+*/
+static const std::vector<std::string>& catalog()
+{
+    static const std::vector<std::string> catalog = []{
+        static const char* terms[] = { "x", "y", "rate", "2", "3.5", "1e-3", "sqrt(x)", "log(y+1)" };
+        static const char* ops[] = { " + ", " - ", " * ", " / ", "**" };
+
+        std::mt19937                rng(42);
+        std::vector<std::string>    result;
+
+        for(std::size_t i = 0; i < COUNT; ++i)
+        {
+            std::string expr = terms[rng() % 8];
+            for(int n = rng() % 24; n; --n)
+                expr += std::string(ops[rng() % 5]) + terms[rng() % 8];
+
+            result.push_back(expr);
+        }
+
+        return result;
+    }();
+
+    return catalog;
+}
+
+// ========================================================================
+//  Benchmarks
+// ========================================================================
+static void serial(benchmark::State& state)
+{
+    const auto&     exprs = catalog();
+    std::vector<linlib::Program> programs(exprs.size());
+
+    for(auto _ : state)
+    {
+        for(std::size_t i = 0; i < exprs.size(); ++i)
+            linlib::compile(exprs[i].c_str(), programs[i]);
+        benchmark::DoNotOptimize(programs.data());
+    }
+
+    state.SetItemsProcessed(state.iterations()*COUNT);
+}
+BENCHMARK(serial)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void bulk(benchmark::State& state)
+{
+    const auto&         exprs = catalog();
+    linlib::ThreadPool  pool(state.range(0));
+    std::vector<linlib::Program> programs;
+
+    for(auto _ : state)
+    {
+        linlib::compile(exprs, programs, pool);
+        benchmark::DoNotOptimize(programs.data());
+    }
+
+    state.SetItemsProcessed(state.iterations()*COUNT);
+}
+BENCHMARK(bulk)
+    ->DenseRange(1, std::max(1u, std::thread::hardware_concurrency()))
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,109 @@
+/*
+ *
+ *  Benchmark the end-to-end throughput of the columnar stream pipeline:
+ *  parse, evaluate and write, from and to memory.
+ *
+ */
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "lib/columns.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static const std::size_t ROWS = 1 << 16;
+
+static const std::vector<std::string> report = {
+    "price*qty - discount",
+    "(price*qty - discount) * tax",
+    "(price*qty - discount) * (1 + tax) / qty",
+};
+
+/**
+    Discard the output, as a null device would.
+*/
+struct NullBuffer : std::streambuf
+{
+    std::streamsize xsputn(const char*, std::streamsize count) { return count; }
+    int overflow(int c) { return c; }
+};
+
+static std::string csv_input()
+{
+    std::ostringstream out;
+
+    out << "price,qty,discount,tax\n";
+    for(std::size_t i = 0; i < ROWS; ++i)
+        out << 1.0 + (i % 997) * 0.01 << "," << 1 + i % 13 << "," << (i % 5) * 0.5 << "," << 0.2 << "\n";
+
+    return out.str();
+}
+
+static std::string binary_input()
+{
+    std::istringstream          in(csv_input());
+    std::ostringstream          out;
+    linlib::CsvReader           reader(in);
+    linlib::BinaryColumnWriter  writer(out, reader.names());
+    linlib::Chunk               chunk;
+
+    while(reader.read(chunk))
+        writer.write(chunk);
+    writer.finish();
+
+    return out.str();
+}
+
+static void run(benchmark::State& state, const std::string& data, bool binary)
+{
+    linlib::FusedProgram program;
+    linlib::compile(report, program);
+
+    NullBuffer      null;
+    std::ostream    out(&null);
+
+    for(auto _ : state)
+    {
+        std::istringstream  in(data);
+        std::size_t         rows;
+
+        if (binary)
+        {
+            linlib::BinaryColumnReader reader(in);
+            linlib::BinaryColumnWriter writer(out, { "net", "taxes", "unit" });
+            linlib::evaluate(reader, program, nullptr, writer, rows, state.range(0));
+        }
+        else
+        {
+            linlib::CsvReader reader(in);
+            linlib::CsvWriter writer(out, { "net", "taxes", "unit" });
+            linlib::evaluate(reader, program, nullptr, writer, rows, state.range(0));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * ROWS);
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+// ========================================================================
+//  Benchmarks
+// ========================================================================
+static void csv(benchmark::State& state)
+{
+    static const std::string data = csv_input();
+
+    run(state, data, false);
+}
+BENCHMARK(csv)->Arg(256)->Arg(4096)->UseRealTime();
+
+static void binary(benchmark::State& state)
+{
+    static const std::string data = binary_input();
+
+    run(state, data, true);
+}
+BENCHMARK(binary)->Arg(256)->Arg(4096)->UseRealTime();
@@ -0,0 +1,118 @@
+#if !defined LINLIB_BENCH_CORPUS_H
+#define LINLIB_BENCH_CORPUS_H
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+/**
+    Benchmark inputs: a set of expressions, and their total size.
+*/
+struct Corpus
+{
+    std::vector<std::string>    expressions;
+    std::size_t                 bytes = 0;
+
+    void add(std::string expr)
+    {
+        bytes += expr.size();
+        expressions.push_back(std::move(expr));
+    }
+};
+
+/**
+    Formulas as found in a catalog: a few terms, short literals and
+    identifiers, some function calls.
+*/
+inline Corpus realistic(std::size_t count = 10000)
+{
+    static const char* terms[] = {
+        "x", "y", "rate", "price", "2", "3.5", "0.01", "1e-3", "100",
+        "sqrt(x)", "log(y+1)", "(x - y)", "-z",
+    };
+    static const char* ops[] = { " + ", " - ", " * ", " / ", "**" };
+
+    std::mt19937    rng(42);
+    Corpus          corpus;
+
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        std::string expr = terms[rng() % 13];
+        for(int n = rng() % 12; n; --n)
+            expr += std::string(ops[rng() % 5]) + terms[rng() % 13];
+
+        corpus.add(expr);
+    }
+
+    return corpus;
+}
+
+/**
+    A single expression nested `depth` levels deep: ((((x+1)*2)+1)*2)...
+*/
+inline Corpus deep(std::size_t depth)
+{
+    std::string expr = "x";
+
+    for(std::size_t i = 0; i < depth; ++i)
+        expr = "(" + expr + (i % 2 ? ")*2" : ")+1");
+
+    Corpus corpus;
+    corpus.add(expr);
+
+    return corpus;
+}
+
+/**
+    A single flat sum of `width` terms: x0 + x1*2 + x2*2 + ...
+*/
+inline Corpus wide(std::size_t width)
+{
+    std::string expr = "x0";
+
+    for(std::size_t i = 1; i < width; ++i)
+        expr += " + x" + std::to_string(i) + "*2";
+
+    Corpus corpus;
+    corpus.add(expr);
+
+    return corpus;
+}
+
+/**
+    Expressions made of long tokens: full-precision literals and long
+    identifiers.
+*/
+inline Corpus long_tokens(std::size_t count = 10000)
+{
+    std::mt19937                            rng(42);
+    std::uniform_real_distribution<double>  dist(0, 1000);
+    Corpus                                  corpus;
+    char                                    buffer[64];
+
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        std::snprintf(buffer, sizeof(buffer), "%.17g", dist(rng));
+        corpus.add("portfolio_market_value_adjusted * " + std::string(buffer)
+                   + " - reference_interest_rate_3m / " + std::to_string(rng()));
+    }
+
+    return corpus;
+}
+
+/**
+    Report the throughput of a benchmark processing the whole corpus
+    once per iteration, as bytes/s and expressions/s.
+*/
+inline void report(benchmark::State& state, const Corpus& corpus)
+{
+    state.SetBytesProcessed(state.iterations()*corpus.bytes);
+    state.counters["expressions_per_second"] = benchmark::Counter(
+        static_cast<double>(state.iterations()*corpus.expressions.size()),
+        benchmark::Counter::kIsRate);
+}
+
+#endif
@@ -0,0 +1,99 @@
+/*
+ *
+ *  Benchmark a report of related formulas over the same rows: one batch
+ *  evaluation per formula, against a single fused evaluation.
+ *
+ */
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "lib/batch.h"
+#include "lib/fused.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static const std::size_t ROWS = 1 << 16;
+
+/**
+    `count` formulas over 8 inputs, sharing a few subterms
+*/
+static std::vector<std::string> report(int count)
+{
+    const char* const terms[] = {
+        "(price*qty - discount)", "(price*qty - discount) * tax", "(cost + fees)",
+        "(margin / (cost + fees))", "(qty - returns)",
+    };
+    std::vector<std::string> result;
+
+    for(int i = 0; i < count; ++i)
+        result.push_back(std::string(terms[i%5]) + " * " + std::to_string(i+1) + " - " + terms[(i/5)%5]
+                         + " / (1 + " + terms[(i+2)%5] + ")");
+
+    return result;
+}
+
+struct Data
+{
+    std::vector<std::vector<double>>    values;
+    std::vector<const double*>          columns;
+    std::vector<std::vector<double>>    results;
+    std::vector<double*>                outputs;
+
+    Data(const linlib::SymbolTable& variables, std::size_t count)
+      : values(variables.size(), std::vector<double>(ROWS)),
+        results(count, std::vector<double>(ROWS))
+    {
+        for(std::size_t v = 0; v < values.size(); ++v)
+        {
+            for(std::size_t i = 0; i < ROWS; ++i)
+                values[v][i] = 1.0 + (i*(v+3)) % 101;
+            columns.push_back(values[v].data());
+        }
+        for(auto& result : results)
+            outputs.push_back(result.data());
+    }
+};
+
+// ========================================================================
+//  Benchmarks
+// ========================================================================
+static void separate(benchmark::State& state)
+{
+    const std::vector<std::string>  formulas = report(state.range(0));
+    linlib::FusedProgram            fused;
+    linlib::compile(formulas, fused);
+
+    std::vector<linlib::Program> programs(formulas.size());
+    for(std::size_t k = 0; k < formulas.size(); ++k)
+        linlib::compile(formulas[k].c_str(), programs[k], fused.variables, fused.functions);
+
+    Data                    data(fused.variables, formulas.size());
+    linlib::BatchEvaluator  evaluator;
+
+    for(auto _ : state)
+        for(std::size_t k = 0; k < programs.size(); ++k)
+            evaluator.run(programs[k], data.columns.data(), nullptr, data.outputs[k], ROWS);
+
+    state.SetItemsProcessed(state.iterations() * ROWS);
+}
+BENCHMARK(separate)->Arg(10)->Arg(50)->Arg(200);
+
+static void fused(benchmark::State& state)
+{
+    const std::vector<std::string>  formulas = report(state.range(0));
+    linlib::FusedProgram            fused;
+    linlib::compile(formulas, fused);
+
+    Data                    data(fused.variables, formulas.size());
+    linlib::FusedEvaluator  evaluator;
+
+    for(auto _ : state)
+        evaluator.run(fused, data.columns.data(), nullptr, data.outputs.data(), ROWS);
+
+    state.SetItemsProcessed(state.iterations() * ROWS);
+    state.counters["steps"] = fused.steps.size();
+    state.counters["registers"] = fused.registers;
+}
+BENCHMARK(fused)->Arg(10)->Arg(50)->Arg(200);
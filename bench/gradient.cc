@@ -0,0 +1,96 @@
+/*
+ *
+ *  Benchmark the gradient of a formula of N variables: forward and
+ *  reverse mode against one evaluation, and against central finite
+ *  differences (2N evaluations).
+ *
+ */
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "lib/gradient.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+/**
+    A chain of `n` variables, each one coupled with the next
+*/
+static std::string formula(int n)
+{
+    std::string result = "0";
+
+    for(int i = 0; i < n; ++i)
+        result += " + sin(x" + std::to_string(i) + ") * (x" + std::to_string((i+1)%n) + " - 1)**2";
+
+    return result;
+}
+
+static double fsin(double x) { return std::sin(x); }
+
+// ========================================================================
+//  Benchmarks
+// ========================================================================
+static void evaluate(benchmark::State& state)
+{
+    linlib::Program program;
+    linlib::compile(formula(state.range(0)).c_str(), program);
+
+    const std::vector<double>   vars(program.variables.size(), 0.5);
+    const linlib::Function      fcts[] = { fsin };
+    linlib::Machine             machine;
+
+    for(auto _ : state)
+        benchmark::DoNotOptimize(machine.run(program, vars.data(), fcts));
+}
+BENCHMARK(evaluate)->RangeMultiplier(4)->Range(2, 512);
+
+static void finite_differences(benchmark::State& state)
+{
+    linlib::Program program;
+    linlib::compile(formula(state.range(0)).c_str(), program);
+
+    std::vector<double>         vars(program.variables.size(), 0.5);
+    std::vector<double>         gradient(program.variables.size());
+    const linlib::Function      fcts[] = { fsin };
+    linlib::Machine             machine;
+
+    for(auto _ : state)
+    {
+        for(std::size_t i = 0; i < vars.size(); ++i)
+        {
+            const double x = vars[i];
+
+            vars[i] = x + 1e-6;
+            const double above = machine.run(program, vars.data(), fcts);
+            vars[i] = x - 1e-6;
+            const double below = machine.run(program, vars.data(), fcts);
+            vars[i] = x;
+
+            gradient[i] = (above - below) / 2e-6;
+        }
+        benchmark::DoNotOptimize(gradient.data());
+    }
+}
+BENCHMARK(finite_differences)->RangeMultiplier(4)->Range(2, 512);
+
+static void gradient(benchmark::State& state, linlib::GradientMachine::Mode mode)
+{
+    linlib::GradientProgram program;
+    linlib::compile(formula(state.range(0)).c_str(), program);
+
+    const std::vector<double>           vars(program.variables.size(), 0.5);
+    std::vector<double>                 gradient(program.variables.size());
+    const linlib::DerivableFunction     fcts[] = { *linlib::standard_function("sin") };
+    linlib::GradientMachine             machine;
+
+    for(auto _ : state)
+    {
+        benchmark::DoNotOptimize(machine.run(program, vars.data(), fcts, gradient.data(), mode));
+        benchmark::DoNotOptimize(gradient.data());
+    }
+}
+BENCHMARK_CAPTURE(gradient, forward, linlib::GradientMachine::FORWARD)->RangeMultiplier(4)->Range(2, 512);
+BENCHMARK_CAPTURE(gradient, reverse, linlib::GradientMachine::REVERSE)->RangeMultiplier(4)->Range(2, 512);
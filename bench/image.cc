@@ -0,0 +1,81 @@
+/*
+ *
+ *  Benchmark the startup of a process using a catalog of formulas:
+ *  compiling them all from text, against mapping their image and
+ *  running one of them.
+ *
+ */
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "lib/image.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static std::vector<std::string> catalog(int count)
+{
+    std::vector<std::string> result;
+
+    for(int i = 0; i < count; ++i)
+        result.push_back("a*x**2 + b*y - " + std::to_string(i) + ".5 / (1 + c*z*" + std::to_string(i) + ")");
+
+    return result;
+}
+
+static std::string image_path(int count)
+{
+    return "/tmp/linlib-bench-" + std::to_string(count) + ".bin";
+}
+
+// ========================================================================
+//  Benchmarks
+// ========================================================================
+static void compile_all(benchmark::State& state)
+{
+    const std::vector<std::string>  formulas = catalog(state.range(0));
+    const double                    vars[] = { 1, 2, 3, 4, 5, 6 };
+    linlib::Machine                 machine;
+
+    for(auto _ : state)
+    {
+        std::vector<linlib::Program> programs(formulas.size());
+
+        for(std::size_t i = 0; i < formulas.size(); ++i)
+            linlib::compile(formulas[i].c_str(), programs[i]);
+
+        benchmark::DoNotOptimize(machine.run(programs[formulas.size()/2], vars, nullptr));
+    }
+}
+BENCHMARK(compile_all)->Range(64, 16384);
+
+static void map_image(benchmark::State& state)
+{
+    const std::vector<std::string>  formulas = catalog(state.range(0));
+    const std::string               path = image_path(state.range(0));
+    const double                    vars[] = { 1, 2, 3, 4, 5, 6 };
+    linlib::Machine                 machine;
+    linlib::ImageWriter             writer;
+
+    for(std::size_t i = 0; i < formulas.size(); ++i)
+    {
+        linlib::Program program;
+        linlib::compile(formulas[i].c_str(), program);
+        writer.add("f" + std::to_string(i), program, formulas[i]);
+    }
+    writer.write(path);
+
+    const std::string name = "f" + std::to_string(formulas.size()/2);
+    for(auto _ : state)
+    {
+        linlib::ProgramImage image;
+
+        image.open(path);
+        benchmark::DoNotOptimize(machine.run(image.view(image.find(name)), vars, nullptr));
+    }
+
+    std::remove(path.c_str());
+}
+BENCHMARK(map_image)->Range(64, 16384);
@@ -0,0 +1,94 @@
+/*
+ *
+ *  Benchmark an edit of a long expression: incremental reparse and
+ *  program patching against parsing and compiling from scratch.
+ *
+ */
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "lib/incremental.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+/**
+    A sum of `terms` function calls
+*/
+static std::string formula(int terms)
+{
+    std::string result = "1";
+
+    for(int i = 0; i < terms; ++i)
+        result += " + f(x*" + std::to_string(i) + ")";
+
+    return result;
+}
+
+/**
+    Offset of a digit in the middle of the formula
+*/
+static std::size_t middle(const std::string& text)
+{
+    std::size_t offset = text.size()/2;
+
+    while(text[offset] < '0' || text[offset] > '9')
+        ++offset;
+
+    return offset;
+}
+
+// ========================================================================
+//  Benchmarks
+// ========================================================================
+static void edit(benchmark::State& state)
+{
+    linlib::IncrementalParser   parser(formula(state.range(0)));
+    const std::size_t           offset = middle(parser.text());
+    char                        digit = '0';
+
+    for(auto _ : state)
+    {
+        linlib::IncrementalParser::Change change;
+
+        digit = (digit == '9') ? '0' : digit+1;
+        benchmark::DoNotOptimize(parser.edit(offset, 1, &digit, 1, change));
+    }
+}
+BENCHMARK(edit)->Range(16, 4096);
+
+static void edit_and_patch(benchmark::State& state)
+{
+    linlib::IncrementalParser   parser(formula(state.range(0)));
+    const std::size_t           offset = middle(parser.text());
+    linlib::Program             program;
+    char                        digit = '0';
+
+    linlib::compile(parser.text().c_str(), program);
+
+    for(auto _ : state)
+    {
+        linlib::IncrementalParser::Change change;
+
+        digit = (digit == '9') ? '0' : digit+1;
+        parser.edit(offset, 1, &digit, 1, change);
+        benchmark::DoNotOptimize(linlib::patch(program, parser, change));
+    }
+}
+BENCHMARK(edit_and_patch)->Range(16, 4096);
+
+static void compile(benchmark::State& state)
+{
+    std::string         text = formula(state.range(0));
+    const std::size_t   offset = middle(text);
+    linlib::Program     program;
+    char                digit = '0';
+
+    for(auto _ : state)
+    {
+        digit = (digit == '9') ? '0' : digit+1;
+        text[offset] = digit;
+        benchmark::DoNotOptimize(linlib::compile(text.c_str(), program));
+    }
+}
+BENCHMARK(compile)->Range(16, 4096);
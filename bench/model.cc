@@ -0,0 +1,89 @@
+/*
+ *
+ *  Benchmark the recomputation of a model after a change: every input
+ *  changing, against a single one.
+ *
+ */
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "lib/model.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static const int INPUTS = 100;
+static const int LAYERS = 20;
+
+/**
+    `LAYERS` layers of `width` formulas, each one over 3 neighbouring
+    cells of the layer below. The first layer is over the inputs.
+*/
+static void build(linlib::Model& model, int width)
+{
+    auto cell = [width](int layer, int i) {
+        return (layer < 0) ? "in" + std::to_string(i % INPUTS)
+                           : "c" + std::to_string(layer) + "_" + std::to_string(i % width);
+    };
+
+    for(int i = 0; i < INPUTS; ++i)
+        model.set(cell(-1, i), i);
+
+    for(int layer = 0; layer < LAYERS; ++layer)
+        for(int i = 0; i < width; ++i)
+            model.define(cell(layer, i), cell(layer-1, i) + " * 0.5 + " + cell(layer-1, i+1)
+                                         + " / (1 + " + cell(layer-1, i+2) + " ** 2)");
+
+    model.recompute();
+}
+
+static void tick(benchmark::State& state, bool all, linlib::ThreadPool* pool)
+{
+    linlib::Model   model;
+    double          value = 0;
+    std::size_t     count = 0;
+
+    build(model, state.range(0));
+
+    for(auto _ : state)
+    {
+        value += 1;
+        if (all)
+        {
+            for(int i = 0; i < INPUTS; ++i)
+                model.set("in" + std::to_string(i), value + i);
+        }
+        else
+        {
+            model.set("in0", value);
+        }
+
+        count += pool ? model.recompute(*pool) : model.recompute();
+    }
+
+    state.counters["cells"] = model.size();
+    state.counters["evaluated"] = benchmark::Counter(count, benchmark::Counter::kAvgIterations);
+}
+
+// ========================================================================
+//  Benchmarks
+// ========================================================================
+static void full(benchmark::State& state)
+{
+    tick(state, true, nullptr);
+}
+BENCHMARK(full)->Arg(100)->Arg(1000);
+
+static void full_parallel(benchmark::State& state)
+{
+    linlib::ThreadPool pool;
+
+    tick(state, true, &pool);
+}
+BENCHMARK(full_parallel)->Arg(100)->Arg(1000);
+
+static void incremental(benchmark::State& state)
+{
+    tick(state, false, nullptr);
+}
+BENCHMARK(incremental)->Arg(100)->Arg(1000);
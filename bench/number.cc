@@ -0,0 +1,126 @@
+/*
+ *
+ *  Benchmark the decimal to binary conversion against strtod on
+ *  literal distributions found in real expressions.
+ *
+ */
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "lib/number.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static const std::size_t    COUNT = 1 << 16;
+
+enum Distribution
+{
+    INTEGERS,       // 0, 2, 42, 1000
+    DECIMALS,       // 0.5, 3.14, 12.75
+    SCIENTIFIC,     // 6.022e23, 1.6e-19
+    ROUND_TRIP,     // %.17g of uniformly distributed doubles
+    LONG,           // 30+ significant digits
+};
+
+static const char* names[] = {
+    "integers", "decimals", "scientific", "round-trip", "long",
+};
+
+struct Corpus
+{
+    std::vector<std::string>    literals;
+    std::size_t                 bytes = 0;
+
+    Corpus(Distribution distribution)
+    {
+        std::mt19937_64 rng(distribution);
+        char            buffer[64];
+
+        for(std::size_t i = 0; i < COUNT; ++i)
+        {
+            switch(distribution)
+            {
+                case INTEGERS:
+                    std::snprintf(buffer, sizeof(buffer), "%u", static_cast<unsigned>(rng() % 1000));
+                    break;
+                case DECIMALS:
+                    std::snprintf(buffer, sizeof(buffer), "%.*f",
+                        static_cast<int>(1 + rng() % 3),
+                        std::uniform_real_distribution<double>(0, 100)(rng));
+                    break;
+                case SCIENTIFIC:
+                    std::snprintf(buffer, sizeof(buffer), "%.*e",
+                        static_cast<int>(rng() % 6),
+                        std::uniform_real_distribution<double>(1, 10)(rng)
+                            * std::pow(10.0, static_cast<int>(rng() % 60) - 30));
+                    break;
+                case ROUND_TRIP:
+                    std::snprintf(buffer, sizeof(buffer), "%.17g",
+                        std::uniform_real_distribution<double>(0, 1)(rng));
+                    break;
+                case LONG:
+                    std::snprintf(buffer, sizeof(buffer), "%.40f",
+                        std::uniform_real_distribution<double>(0, 10)(rng));
+                    break;
+            }
+
+            literals.emplace_back(buffer);
+            bytes += literals.back().size();
+        }
+    }
+};
+
+static const Corpus& corpus(int distribution)
+{
+    static const Corpus corpora[] = {
+        Corpus(INTEGERS), Corpus(DECIMALS), Corpus(SCIENTIFIC), Corpus(ROUND_TRIP), Corpus(LONG),
+    };
+
+    return corpora[distribution];
+}
+
+// ========================================================================
+//  Benchmarks
+// ========================================================================
+static void strtod(benchmark::State& state)
+{
+    const Corpus& c = corpus(state.range(0));
+    state.SetLabel(names[state.range(0)]);
+
+    for(auto _ : state)
+    {
+        for(const std::string& literal : c.literals)
+            benchmark::DoNotOptimize(std::strtod(literal.c_str(), nullptr));
+    }
+
+    state.SetItemsProcessed(state.iterations()*COUNT);
+    state.SetBytesProcessed(state.iterations()*c.bytes);
+}
+BENCHMARK(strtod)->DenseRange(INTEGERS, LONG);
+
+static void parse_number(benchmark::State& state)
+{
+    const Corpus& c = corpus(state.range(0));
+    state.SetLabel(names[state.range(0)]);
+
+    for(auto _ : state)
+    {
+        for(const std::string& literal : c.literals)
+        {
+            double value;
+            linlib::parse_number(literal.data(), literal.size(), value);
+            benchmark::DoNotOptimize(value);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations()*COUNT);
+    state.SetBytesProcessed(state.iterations()*c.bytes);
+}
+BENCHMARK(parse_number)->DenseRange(INTEGERS, LONG);
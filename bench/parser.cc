@@ -0,0 +1,180 @@
+/*
+ *
+ *  Benchmark the parser with handlers of increasing cost: a no-op
+ *  handler, an RPN calculator, and the bytecode compiler. The no-op
+ *  and RPN handlers run both through the virtual Parser and the
+ *  statically dispatched BasicParser.
+ *
+ */
+#include <array>
+#include <cmath>
+
+#include "benchmark/benchmark.h"
+#include "bench/corpus.h"
+#include "lib/parser.h"
+#include "lib/program.h"
+
+// ========================================================================
+//  Handlers
+// ========================================================================
+/**
+    Accept everything, do nothing: measures the parser alone.
+*/
+struct NoopHandler
+{
+    bool number(double value) { return true; }
+    bool call(const char *identifier, std::size_t len) { return true; }
+    bool load(const char *identifier, std::size_t len) { return true; }
+    bool binary_op(linlib::BinaryOpCode opcode) { return true; }
+    bool unary_op(linlib::UnaryOpCode opcode) { return true; }
+
+    void bad_token_error(const char* stmt, std::size_t len, unsigned pos) {}
+    void syntax_error(const char* stmt, std::size_t len, unsigned pos) {}
+    void range_error(const char* stmt, std::size_t len, unsigned pos) {}
+    void depth_error(const char* stmt, std::size_t len, unsigned pos) {}
+};
+
+/**
+    Evaluate the expression on the fly. Variables are all 1, functions
+    are all sqrt.
+*/
+struct RpnHandler : public NoopHandler
+{
+    std::array<double, 64>  _stack;
+    double*                 _sp = _stack.data();
+
+    bool push(double v) { *_sp++ = v; return true; }
+    double pop() { return *--_sp; }
+
+    bool number(double value) { return push(value); }
+    bool call(const char *identifier, std::size_t len) { return push(std::sqrt(pop())); }
+    bool load(const char *identifier, std::size_t len) { return push(1.0); }
+
+    bool unary_op(linlib::UnaryOpCode opcode)
+    {
+        return push(-pop());
+    }
+
+    bool binary_op(linlib::BinaryOpCode opcode)
+    {
+        double b = pop(),
+               a = pop();
+
+        switch(opcode)
+        {
+            case linlib::BinaryOpCode::ADD:
+                return push(a+b);
+            case linlib::BinaryOpCode::SUB:
+                return push(a-b);
+            case linlib::BinaryOpCode::MUL:
+                return push(a*b);
+            case linlib::BinaryOpCode::DIV:
+                return push(a/b);
+            case linlib::BinaryOpCode::POW:
+                return push(std::pow(a,b));
+        };
+
+        return false;
+    }
+};
+
+/**
+    Put a handler behind the virtual EventHandler interface.
+*/
+template<class Handler>
+struct Virtual : public linlib::EventHandler
+{
+    Handler     handler;
+
+    bool number(double value) { return handler.number(value); }
+    bool call(const char *identifier, std::size_t len) { return handler.call(identifier, len); }
+    bool load(const char *identifier, std::size_t len) { return handler.load(identifier, len); }
+    bool binary_op(linlib::BinaryOpCode opcode) { return handler.binary_op(opcode); }
+    bool unary_op(linlib::UnaryOpCode opcode) { return handler.unary_op(opcode); }
+};
+
+// ========================================================================
+//  Benchmarks
+// ========================================================================
+template<class Parser, class Handler>
+static void parse(benchmark::State& state, const Corpus& corpus)
+{
+    for(auto _ : state)
+    {
+        for(const std::string& expr : corpus.expressions)
+        {
+            Handler         handler;
+            Parser          parser{expr.data(), expr.size(), handler};
+
+            if (!parser.parse())
+            {
+                state.SkipWithError("parse error");
+                return;
+            }
+        }
+    }
+
+    report(state, corpus);
+}
+
+/*
+    Virtual dispatch: linlib::Parser and an EventHandler
+*/
+static void parse_noop(benchmark::State& state, const Corpus& corpus)
+{
+    parse<linlib::Parser, Virtual<NoopHandler>>(state, corpus);
+}
+BENCHMARK_CAPTURE(parse_noop, realistic, realistic());
+BENCHMARK_CAPTURE(parse_noop, long_tokens, long_tokens());
+BENCHMARK_CAPTURE(parse_noop, deep/100, deep(100));
+BENCHMARK_CAPTURE(parse_noop, deep/1000, deep(1000));
+BENCHMARK_CAPTURE(parse_noop, wide/100, wide(100));
+BENCHMARK_CAPTURE(parse_noop, wide/10000, wide(10000));
+
+static void parse_rpn(benchmark::State& state, const Corpus& corpus)
+{
+    parse<linlib::Parser, Virtual<RpnHandler>>(state, corpus);
+}
+BENCHMARK_CAPTURE(parse_rpn, realistic, realistic());
+BENCHMARK_CAPTURE(parse_rpn, long_tokens, long_tokens());
+BENCHMARK_CAPTURE(parse_rpn, deep/1000, deep(1000));
+BENCHMARK_CAPTURE(parse_rpn, wide/10000, wide(10000));
+
+/*
+    Static dispatch: linlib::BasicParser with the same handlers
+*/
+static void static_noop(benchmark::State& state, const Corpus& corpus)
+{
+    parse<linlib::BasicParser<NoopHandler>, NoopHandler>(state, corpus);
+}
+BENCHMARK_CAPTURE(static_noop, realistic, realistic());
+BENCHMARK_CAPTURE(static_noop, long_tokens, long_tokens());
+BENCHMARK_CAPTURE(static_noop, deep/100, deep(100));
+BENCHMARK_CAPTURE(static_noop, deep/1000, deep(1000));
+BENCHMARK_CAPTURE(static_noop, wide/100, wide(100));
+BENCHMARK_CAPTURE(static_noop, wide/10000, wide(10000));
+
+static void static_rpn(benchmark::State& state, const Corpus& corpus)
+{
+    parse<linlib::BasicParser<RpnHandler>, RpnHandler>(state, corpus);
+}
+BENCHMARK_CAPTURE(static_rpn, realistic, realistic());
+BENCHMARK_CAPTURE(static_rpn, long_tokens, long_tokens());
+BENCHMARK_CAPTURE(static_rpn, deep/1000, deep(1000));
+BENCHMARK_CAPTURE(static_rpn, wide/10000, wide(10000));
+
+static void compile(benchmark::State& state, const Corpus& corpus)
+{
+    linlib::Program program;
+
+    for(auto _ : state)
+    {
+        for(const std::string& expr : corpus.expressions)
+            benchmark::DoNotOptimize(linlib::compile(expr.c_str(), program));
+    }
+
+    report(state, corpus);
+}
+BENCHMARK_CAPTURE(compile, realistic, realistic());
+BENCHMARK_CAPTURE(compile, deep/1000, deep(1000));
+BENCHMARK_CAPTURE(compile, wide/10000, wide(10000));
@@ -0,0 +1,20 @@
+#!/bin/sh
+#
+# Run the benchmark suite and write one JSON report per benchmark into
+# the given directory (default: bench-<git revision>).
+#
+# Compare two runs with Google Benchmark's tools/compare.py:
+#
+#   compare.py benchmarks bench-OLD/parser.json bench-NEW/parser.json
+#
+set -e
+
+OUT=${1:-bench-$(git rev-parse --short HEAD)}
+BENCHMARKS="tokenizer parser number batch bulk incremental gradient ast image fused model columns strength"
+
+mkdir -p "$OUT"
+for b in $BENCHMARKS; do
+    bazel run -c opt "//bench:$b" -- \
+        --benchmark_out="$(realpath "$OUT")/$b.json" \
+        --benchmark_out_format=json
+done
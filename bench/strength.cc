@@ -0,0 +1,97 @@
+/*
+ *
+ *  Benchmark the strength reduction of powers and divisions by constants,
+ *  for each optimizer mode.
+ *
+ */
+#include <random>
+
+#include "benchmark/benchmark.h"
+#include "lib/batch.h"
+#include "lib/optimizer.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static const char*          expression = "x**3 - y**0.5 + (x*y)**-2 + x/3";
+static const std::size_t    ROWS = 1 << 16;
+
+/**
+    Mode of the optimizer, or NONE to run the program as compiled.
+*/
+static const int NONE = -1;
+
+struct Fixture
+{
+    linlib::Program                     program;
+    std::vector<std::vector<double>>    data;
+    std::vector<const double*>          columns;
+    std::vector<double>                 out;
+
+    Fixture(int mode)
+      : out(ROWS)
+    {
+        linlib::compile(expression, program);
+        if (mode != NONE)
+            linlib::Optimizer{static_cast<linlib::Optimizer::Mode>(mode)}.run(program);
+
+        std::mt19937_64 rng;
+        std::uniform_real_distribution<double> dist(1.0, 2.0);
+
+        data.resize(program.variables.size());
+        for(auto& column : data)
+        {
+            for(std::size_t i = 0; i < ROWS; ++i)
+                column.push_back(dist(rng));
+            columns.push_back(column.data());
+        }
+    }
+};
+
+static const char* label(int mode)
+{
+    static const char* names[] = { "strict", "relaxed", "fast-math" };
+
+    return mode == NONE ? "none" : names[mode];
+}
+
+// ========================================================================
+//  Benchmarks
+// ========================================================================
+static void machine(benchmark::State& state)
+{
+    Fixture             f(static_cast<int>(state.range(0)));
+    linlib::Machine     machine;
+    std::vector<double> row(f.data.size());
+
+    state.SetLabel(label(static_cast<int>(state.range(0))));
+    for(auto _ : state)
+    {
+        for(std::size_t i = 0; i < ROWS; ++i)
+        {
+            for(std::size_t j = 0; j < row.size(); ++j)
+                row[j] = f.columns[j][i];
+            f.out[i] = machine.run(f.program, row.data(), nullptr);
+        }
+        benchmark::DoNotOptimize(f.out.data());
+    }
+
+    state.SetItemsProcessed(state.iterations()*ROWS);
+}
+BENCHMARK(machine)->DenseRange(NONE, linlib::Optimizer::FAST_MATH);
+
+static void batch(benchmark::State& state)
+{
+    Fixture                 f(static_cast<int>(state.range(0)));
+    linlib::BatchEvaluator  evaluator;
+
+    state.SetLabel(label(static_cast<int>(state.range(0))));
+    for(auto _ : state)
+    {
+        evaluator.run(f.program, f.columns.data(), nullptr, f.out.data(), ROWS);
+        benchmark::DoNotOptimize(f.out.data());
+    }
+
+    state.SetItemsProcessed(state.iterations()*ROWS);
+}
+BENCHMARK(batch)->DenseRange(NONE, linlib::Optimizer::FAST_MATH);
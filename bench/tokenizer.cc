@@ -0,0 +1,31 @@
+/*
+ *
+ *  Benchmark the tokenizer alone.
+ *
+ */
+#include "benchmark/benchmark.h"
+#include "bench/corpus.h"
+#include "lib/tokenizer.h"
+
+// ========================================================================
+//  Benchmarks
+// ========================================================================
+static void tokenize(benchmark::State& state, const Corpus& corpus)
+{
+    for(auto _ : state)
+    {
+        for(const std::string& expr : corpus.expressions)
+        {
+            linlib::Tokenizer tokenizer{expr.data(), expr.size()};
+
+            while(auto token = tokenizer.next())
+                benchmark::DoNotOptimize(token);
+        }
+    }
+
+    report(state, corpus);
+}
+BENCHMARK_CAPTURE(tokenize, realistic, realistic());
+BENCHMARK_CAPTURE(tokenize, long_tokens, long_tokens());
+BENCHMARK_CAPTURE(tokenize, deep/1000, deep(1000));
+BENCHMARK_CAPTURE(tokenize, wide/10000, wide(10000));
@@ -0,0 +1,233 @@
+#include <algorithm>
+
+#include "lib/ast.h"
+
+namespace linlib {
+
+//========================================================================
+//  AstArena
+//========================================================================
+const std::size_t AstArena::BLOCK_NODES;
+
+AstArena::AstArena()
+  : _block(0), _begin(0), _used(0), _trees(0)
+{
+    _blocks.push_back({ std::unique_ptr<AstNode[]>(new AstNode[BLOCK_NODES]), BLOCK_NODES });
+}
+
+void AstArena::grow()
+{
+    const std::size_t   size = _used - _begin;
+    const std::size_t   next = _block+1;
+
+    // Reuse the next block if the tree fits in it with some room left
+    if (next == _blocks.size() || _blocks[next].capacity <= size)
+    {
+        const std::size_t capacity = std::max(BLOCK_NODES, 2*size);
+        _blocks.insert(_blocks.begin() + next, Block{ std::unique_ptr<AstNode[]>(new AstNode[capacity]), capacity });
+    }
+
+    const AstNode* const tree = _blocks[_block].nodes.get() + _begin;
+    std::copy(tree, tree + size, _blocks[next].nodes.get());
+
+    _block = next;
+    _begin = 0;
+    _used = size;
+}
+
+std::size_t AstArena::capacity() const
+{
+    std::size_t result = 0;
+
+    for(const Block& block : _blocks)
+        result += block.capacity;
+
+    return result;
+}
+
+void AstArena::clear()
+{
+    _block = 0;
+    _begin = 0;
+    _used = 0;
+    _trees = 0;
+
+    _constants.clear();
+    _variables.clear();
+    _functions.clear();
+}
+
+bool AstArena::replay(const Ast& ast, EventHandler& handler) const
+{
+    for(std::uint32_t i = 0; i < ast.size; ++i)
+    {
+        const AstNode&  node = ast[i];
+        bool            ok = false;
+
+        switch(node.op)
+        {
+            case OpCode::CONST:
+                ok = handler.number(_constants[node.arg]);
+                break;
+            case OpCode::LOAD:
+                {
+                    const std::string& name = _variables[node.arg];
+                    ok = handler.load(name.data(), name.size());
+                }
+                break;
+            case OpCode::CALL:
+                {
+                    const std::string& name = _functions[node.arg];
+                    ok = handler.call(name.data(), name.size());
+                }
+                break;
+            case OpCode::NEG:
+                ok = handler.unary_op(UnaryOpCode::NEG);
+                break;
+            case OpCode::ADD:
+                ok = handler.binary_op(BinaryOpCode::ADD);
+                break;
+            case OpCode::SUB:
+                ok = handler.binary_op(BinaryOpCode::SUB);
+                break;
+            case OpCode::MUL:
+                ok = handler.binary_op(BinaryOpCode::MUL);
+                break;
+            case OpCode::DIV:
+                ok = handler.binary_op(BinaryOpCode::DIV);
+                break;
+            case OpCode::POW:
+                ok = handler.binary_op(BinaryOpCode::POW);
+                break;
+            default:
+                // POWI and SQRT are only emitted by the Optimizer
+                break;
+        };
+
+        if (!ok)
+            return false;
+    }
+
+    return true;
+}
+
+//========================================================================
+//  AstBuilder
+//========================================================================
+AstBuilder::AstBuilder(AstArena& arena)
+  : _arena(arena), _constants(arena._constants.size())
+{
+}
+
+void AstBuilder::begin()
+{
+    _arena._used = _arena._begin;
+    _constants = _arena._constants.size();
+    _stack.clear();
+}
+
+Ast AstBuilder::finish()
+{
+    Ast ast;
+
+    ast.nodes = _arena._blocks[_arena._block].nodes.get() + _arena._begin;
+    ast.size = static_cast<std::uint32_t>(_arena._used - _arena._begin);
+
+    _arena._begin = _arena._used;
+    ++_arena._trees;
+    _stack.clear();
+
+    return ast;
+}
+
+void AstBuilder::discard()
+{
+    _arena._used = _arena._begin;
+    _arena._constants.resize(_constants);
+    _stack.clear();
+}
+
+bool AstBuilder::push(OpCode op, std::uint32_t arg, std::size_t operands)
+{
+    const std::size_t index = _arena._used - _arena._begin;
+
+    if (_stack.size() < operands || index >= UINT32_MAX)
+        return false;
+
+    if (operands == 2)
+    {
+        arg = _stack[_stack.size()-2];
+    }
+    _stack.resize(_stack.size() - operands);
+    _stack.push_back(static_cast<std::uint32_t>(index));
+
+    if (_arena._used == _arena._blocks[_arena._block].capacity)
+        _arena.grow();
+
+    _arena._blocks[_arena._block].nodes[_arena._used++] = { op, arg };
+
+    return true;
+}
+
+bool AstBuilder::number(double value)
+{
+    _arena._constants.push_back(value);
+    return push(OpCode::CONST, static_cast<std::uint32_t>(_arena._constants.size()-1), 0);
+}
+
+bool AstBuilder::call(const char *identifier, std::size_t len)
+{
+    return push(OpCode::CALL, _arena._functions.intern(identifier, len), 1);
+}
+
+bool AstBuilder::load(const char *identifier, std::size_t len)
+{
+    return push(OpCode::LOAD, _arena._variables.intern(identifier, len), 0);
+}
+
+bool AstBuilder::unary_op(UnaryOpCode opcode)
+{
+    switch(opcode)
+    {
+        case UnaryOpCode::NEG:
+            return push(OpCode::NEG, 0, 1);
+    };
+
+    return false;
+}
+
+bool AstBuilder::binary_op(BinaryOpCode opcode)
+{
+    switch(opcode)
+    {
+        case BinaryOpCode::ADD:
+            return push(OpCode::ADD, 0, 2);
+        case BinaryOpCode::SUB:
+            return push(OpCode::SUB, 0, 2);
+        case BinaryOpCode::MUL:
+            return push(OpCode::MUL, 0, 2);
+        case BinaryOpCode::DIV:
+            return push(OpCode::DIV, 0, 2);
+        case BinaryOpCode::POW:
+            return push(OpCode::POW, 0, 2);
+    };
+
+    return false;
+}
+
+bool parse(const char* expr, AstBuilder& builder, Ast& ast)
+{
+    builder.begin();
+
+    Parser parser{expr, builder};
+    if (!parser.parse())
+    {
+        builder.discard();
+        return false;
+    }
+
+    ast = builder.finish();
+    return true;
+}
+
+} /* namespace */
@@ -0,0 +1,170 @@
+#if !defined LINLIB_AST_H
+#define LINLIB_AST_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "lib/parser.h"
+#include "lib/program.h"
+#include "lib/symbols.h"
+
+namespace linlib {
+
+/**
+    A node of an abstract syntax tree.
+
+    The nodes of a tree are stored in postorder, so the right operand of
+    a binary node, and the only operand of NEG and CALL, is the node just
+    before it. So `arg` is enough to link the tree:
+
+    - CONST and LOAD use `arg` to index the constant or variable table;
+    - CALL uses `arg` to index the function table;
+    - binary nodes use `arg` for the index of their left operand;
+    - NEG does not use `arg`.
+*/
+struct AstNode
+{
+    OpCode          op;
+    std::uint32_t   arg;
+};
+
+/**
+    A tree allocated in an AstArena. Nodes are indexed from 0, the root
+    is the last one, and the subtree of a node is a contiguous range
+    ending at that node.
+*/
+struct Ast
+{
+    const AstNode*  nodes = nullptr;
+    std::uint32_t   size = 0;
+
+    inline std::uint32_t root() const { return size-1; }
+    inline const AstNode& operator[](std::uint32_t node) const { return nodes[node]; }
+
+    /**
+        Operands of a binary node. `right()` is also the operand of NEG
+        and CALL.
+    */
+    inline std::uint32_t left(std::uint32_t node) const { return nodes[node].arg; }
+    inline std::uint32_t right(std::uint32_t node) const { return node-1; }
+};
+
+/**
+    Storage for the trees of a batch of parses.
+
+    The nodes are bump-allocated from a list of blocks. A tree is always
+    contiguous: when it outgrows the current block while being built, it
+    moves to a new block of at least twice its size, so the number of
+    blocks only grows with the logarithm of the largest tree. Finished
+    trees never move.
+
+    The constants and the symbols are shared by all the trees, so trees
+    of the same arena can be evaluated with the same binding arrays.
+
+    `clear()` frees all the trees at once by rewinding the arena, keeping
+    its blocks for the next batch.
+*/
+class AstArena
+{
+    struct Block
+    {
+        std::unique_ptr<AstNode[]>  nodes;
+        std::size_t                 capacity;
+    };
+
+    std::vector<Block>      _blocks;
+    std::size_t             _block;     // current block
+    std::size_t             _begin;     // start of the tree being built in the current block
+    std::size_t             _used;      // end of the tree being built
+    std::size_t             _trees;
+
+    std::vector<double>     _constants;
+    SymbolTable             _variables;
+    SymbolTable             _functions;
+
+    void grow();
+
+    friend class AstBuilder;
+
+    public:
+    static const std::size_t BLOCK_NODES = 4096;
+
+    AstArena();
+
+    inline const std::vector<double>& constants() const { return _constants; }
+    inline const SymbolTable& variables() const { return _variables; }
+    inline const SymbolTable& functions() const { return _functions; }
+
+    /**
+        Number of trees allocated since the last `clear()`.
+    */
+    inline std::size_t trees() const { return _trees; }
+
+    /**
+        Total capacity of the blocks, in nodes.
+    */
+    std::size_t capacity() const;
+
+    /**
+        Free all the trees, constants and symbols. The trees previously
+        returned are invalidated.
+    */
+    void clear();
+
+    /**
+        Send the events of `ast`, a tree of this arena, to the handler in
+        the same order as the parser would. Return false as soon as the
+        handler does.
+    */
+    bool replay(const Ast& ast, EventHandler& handler) const;
+};
+
+/**
+    An event handler building trees into an arena. A builder can be
+    reused for any number of parses, see `parse()`. Only one builder
+    at a time may build into a given arena.
+*/
+class AstBuilder : public EventHandler
+{
+    AstArena&                   _arena;
+    std::vector<std::uint32_t>  _stack;     // roots of the pending operands
+    std::size_t                 _constants; // size of the constant table at the start of the tree
+
+    bool push(OpCode op, std::uint32_t arg, std::size_t operands);
+
+    public:
+    AstBuilder(AstArena& arena);
+
+    /**
+        Start a new tree, discarding the nodes of any unfinished one.
+    */
+    void begin();
+
+    /**
+        Return the tree built since `begin()`.
+    */
+    Ast finish();
+
+    /**
+        Discard the tree built since `begin()`, with its constants.
+    */
+    void discard();
+
+    bool number(double value);
+    bool call(const char *identifier, std::size_t len);
+    bool load(const char *identifier, std::size_t len);
+    bool binary_op(BinaryOpCode opcode);
+    bool unary_op(UnaryOpCode opcode);
+};
+
+/**
+    Parse `expr` into a tree of the arena of `builder`.
+    Return true on success. On failure, nothing is left in the arena
+    but the symbols already interned.
+*/
+bool parse(const char* expr, AstBuilder& builder, Ast& ast);
+
+} /* namespace */
+
+#endif
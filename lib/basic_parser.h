@@ -0,0 +1,591 @@
+#if !defined LINLIB_BASIC_PARSER_H
+#define LINLIB_BASIC_PARSER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "lib/number.h"
+#include "lib/tokenizer.h"
+
+namespace linlib {
+
+enum struct BinaryOpCode
+{
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+
+    POW,
+};
+
+enum struct UnaryOpCode
+{
+    NEG,
+};
+
+//========================================================================
+//  Parser state and diagnostics
+//========================================================================
+/**
+    The part of the parser that does not depend on the handler type.
+*/
+class ParserBase
+{
+    public:
+    enum State
+    {
+        OK,
+        RUNNING,
+        INTERNAL_ERROR,
+        BAD_TOKEN_ERROR,
+        SYNTAX_ERROR,
+        RANGE_ERROR,
+        DEPTH_ERROR,
+    };
+
+    /**
+        Default bound of the operator stack. See `max_depth()`.
+    */
+    static const std::size_t DEFAULT_MAX_DEPTH = 1024;
+
+    /**
+        Levels of the operator stack stored in the parser itself.
+    */
+    static const std::size_t INLINE_DEPTH = 64;
+
+    protected:
+    State                   _state;
+    const char*             _start;
+    std::size_t             _length;
+    std::size_t             _max_depth;
+    Token                   _lookahead;
+
+    ParserBase(const char* expr, std::size_t len)
+      : _state(OK),
+        _start(expr),
+        _length(len),
+        _max_depth(DEFAULT_MAX_DEPTH),
+        _lookahead{ Token::END, expr, 0 }
+    {
+    }
+
+    public:
+    /**
+        Bound the nesting of the expressions. Each open parenthesis,
+        function call, unary minus, or binary operator waiting for its
+        right operand counts for one level. Deeper expressions are
+        rejected with a DEPTH_ERROR.
+
+        Only the levels past INLINE_DEPTH are allocated: with a bound of
+        INLINE_DEPTH or less, `parse()` makes no heap allocation,
+        whether it succeeds or fails. Nor does it throw, or do any I/O
+        with a quiet handler. The only exception is the rare number
+        literal of 128 characters or more that needs `std::strtod`, see
+        `parse_number()`.
+    */
+    inline void max_depth(std::size_t depth) { _max_depth = depth; }
+    inline std::size_t max_depth() const { return _max_depth; }
+
+    /*
+        Diagnostic info about the lattest `parse()` invocation.
+     */
+
+    /**
+        Parser curent state
+    */
+    inline State state(void) const { return _state; }
+
+    /**
+        Offset in the expression of the token where the latest
+        `parse()` stopped: the faulty one on error. Unlike the
+        formatted diagnostics below, this does not allocate.
+    */
+    inline std::size_t position(void) const { return _lookahead.start - _start; }
+
+    /**
+        Return a string-representation of state(). For human consumption only.
+     */
+    std::string  what() const;
+
+    /**
+        Return a formatted string identifying the last parsed code
+        fragment. For human consumption only.
+     */
+    std::string  where() const;
+
+    /**
+        Return a formatted string describing the current state of the parser.
+        The message is garanteed to contain both what() and where(), but
+        the order is unspecified. The message may also contain additional
+        informations. For human consumption only.
+     */
+    std::string  message() const;
+};
+
+//========================================================================
+//  Engine
+//
+//  An operator-precedence parser calling the handler directly. With a
+//  concrete handler type, the events are inlined into the parser.
+//
+//  The parser does not recurse: pending operators and open groups are
+//  kept on an explicit stack, whose depth is bounded. The first levels
+//  are stored inline, so common expressions are parsed without any
+//  memory allocation.
+//========================================================================
+template<class Handler>
+class BasicParserEngine
+{
+    private:
+    /**
+        Operator stack entries. The binary operators are in the
+        BinaryOpCode order.
+    */
+    enum Kind : std::uint8_t
+    {
+        PAREN,              // '(' expr ')'
+        CALL,               // SYMBOL '(' expr ')'
+        NEG,                // '-' term
+
+        ADD,
+        SUB,
+        MUL,
+        DIV,
+        POW,
+    };
+
+    struct Entry
+    {
+        Kind                kind;
+        const char*         start;      // the function name of a CALL
+        std::size_t         length;
+    };
+
+    static const std::size_t INLINE_DEPTH = ParserBase::INLINE_DEPTH;
+
+    ParserBase::State&      _state;
+    const char*             _start;
+    std::size_t             _length;
+    Tokenizer               _tokenizer;
+    Token&                  _lookahead;
+
+    Handler&                _handler;
+
+    const std::size_t       _max_depth;
+    Entry                   _inline[INLINE_DEPTH];
+    std::vector<Entry>      _spill;
+    Entry*                  _stack;
+    std::size_t             _size;
+    std::size_t             _capacity;
+
+    /**
+        Report a bad token to the event handler.
+        Change the state of the parser.
+
+        A bad token is an unexpected character in the input stream. Only
+        characters in the 7-bits ASCII range are allowed in an expression.
+    */
+    bool  bad_token_error()
+    {
+        _handler.bad_token_error(_start, _length, static_cast<std::size_t>(_lookahead.start-_start));
+        _state = ParserBase::BAD_TOKEN_ERROR;
+
+        return false;
+    }
+
+    /**
+        Report a syntax error to the event handler.
+        Change the state of the parser.
+
+        Syntax errors occur when an expression does not follow the
+        grammar rules for the language.
+    */
+    bool  syntax_error()
+    {
+        _handler.syntax_error(_start, _length, static_cast<std::size_t>(_lookahead.start-_start));
+        _state = ParserBase::SYNTAX_ERROR;
+
+        return false;
+    }
+
+    /**
+        Report a number that can't be represented as a finite, non-zero
+        double to the event handler.
+        Change the state of the parser.
+    */
+    bool  range_error()
+    {
+        _handler.range_error(_start, _length, static_cast<std::size_t>(_lookahead.start-_start));
+        _state = ParserBase::RANGE_ERROR;
+
+        return false;
+    }
+
+    /**
+        Read the next token from the input stream.
+
+        Raise a bad_token_error is the next token was not recognized
+        by the tokenizer.
+    */
+    bool   next()
+    {
+        _lookahead = _tokenizer.next();
+        if (_lookahead.id == Token::BAD_TOKEN)
+            return bad_token_error();
+
+        return true;
+    }
+
+    /**
+      Consume the given token if found in the stream, otherwise
+      report an error.
+    */
+    bool expect(Token::Id id)
+    {
+        if (_lookahead.id != id)
+            return syntax_error();
+
+        return next();
+    }
+
+    /**
+        Parse a number.
+
+        Raise a sytax_error if the token can't be converted to
+        a double, or a range_error if it overflows or underflows.
+    */
+    bool read_number()
+    {
+        double result;
+
+        switch(parse_number(_lookahead.start, _lookahead.length, result))
+        {
+            case NumberStatus::OK:
+                break;
+            case NumberStatus::SYNTAX_ERROR:
+                return syntax_error();
+            case NumberStatus::TOO_LARGE:
+            case NumberStatus::TOO_SMALL:
+                return range_error();
+        }
+
+        return next() && _handler.number(result);
+    }
+
+    /**
+        Report an expression nested deeper than the maximum depth to
+        the event handler.
+        Change the state of the parser.
+    */
+    bool  depth_error()
+    {
+        _handler.depth_error(_start, _length, static_cast<std::size_t>(_lookahead.start-_start));
+        _state = ParserBase::DEPTH_ERROR;
+
+        return false;
+    }
+
+    //--------------------------------------------------------------------
+    //  Operator stack
+    //--------------------------------------------------------------------
+    bool push(Kind kind, const Token& token)
+    {
+        if (_size == _capacity)
+        {
+            if (_capacity >= _max_depth)
+                return depth_error();
+
+            // Past the inline storage, grow on the heap
+            const std::size_t capacity = std::min(_max_depth, 2*_capacity);
+            std::vector<Entry> spill(_stack, _stack+_size);
+
+            spill.resize(capacity);
+            _spill.swap(spill);
+            _stack = _spill.data();
+            _capacity = capacity;
+        }
+
+        _stack[_size++] = { kind, token.start, token.length };
+        return true;
+    }
+
+    inline const Entry& top() const { return _stack[_size-1]; }
+
+    /**
+        Binding power of the binary operators. Zero for the other
+        entries, which are never reduced by a binary operator.
+    */
+    static inline int precedence(Kind kind)
+    {
+        static const std::uint8_t table[] = { 0, 0, 0, 1, 1, 2, 2, 3 };
+
+        return table[kind];
+    }
+
+    /**
+        Emit the pending binary operators of precedence `level` (at
+        least 1) or higher, down to the innermost group.
+    */
+    bool reduce(int level)
+    {
+        while(_size && precedence(top().kind) >= level)
+        {
+            const Kind kind = _stack[--_size].kind;
+
+            if (!_handler.binary_op(static_cast<BinaryOpCode>(kind - ADD)))
+                return false;
+        }
+
+        return true;
+    }
+
+    //--------------------------------------------------------------------
+    //  Grammar
+    //--------------------------------------------------------------------
+    /**
+        Read the prefix of a term, up to and including its first
+        operand:
+
+        term := NUMBER
+                | '+' term
+                | '-' term
+                | '(' expr ')'
+                | SYMBOL '(' expr ')'
+                | SYMBOL
+
+        Opening groups and unary minus are pushed on the stack.
+    */
+    bool read_operand()
+    {
+        while(true)
+        {
+            switch(_lookahead.id)
+            {
+                case Token::LPAR:
+                    if (!push(PAREN, _lookahead) || !next())
+                        return false;
+                    break;
+                case Token::PLUS:
+                    if (!next())
+                        return false;
+                    break;
+                case Token::MINUS:
+                    if (!push(NEG, _lookahead) || !next())
+                        return false;
+                    break;
+                case Token::NUMBER:
+                    return read_number();
+                case Token::SYMBOL:
+                    {
+                        const Token symbol = _lookahead;
+
+                        if (!next())
+                            return false;
+
+                        if (_lookahead.id != Token::LPAR)
+                            return _handler.load(symbol.start, symbol.length);
+
+                        if (!push(CALL, symbol) || !next())
+                            return false;
+                    }
+                    break;
+                default:
+                    return syntax_error();
+            }
+        }
+    }
+
+    /**
+        Map a token to the binary operator it stands for, or to PAREN
+        if it is not a binary operator.
+    */
+    static inline Kind binary(Token::Id id)
+    {
+        switch(id)
+        {
+            case Token::PLUS:   return ADD;
+            case Token::MINUS:  return SUB;
+            case Token::TIMES:  return MUL;
+            case Token::SLASH:  return DIV;
+            case Token::POW:    return POW;
+            default:            return PAREN;
+        }
+    }
+
+    /**
+        expr := sum
+        sum  := prod [ '+'|'-' prod ]*
+        prod := pow [ '*'|'/' pow ]*
+        pow  := term [ '**' term ]*
+
+        All binary operators are left-associative, and unary minus binds
+        tighter than all of them.
+
+        The events are emitted in the same order, and errors reported on
+        the same token, as a recursive descent of the grammar would.
+    */
+    bool read_expr()
+    {
+        while(true)
+        {
+            if (!read_operand())
+                return false;
+
+            // A term is complete: close the groups it ends
+            while(true)
+            {
+                while(_size && top().kind == NEG)
+                {
+                    --_size;
+                    if (!_handler.unary_op(UnaryOpCode::NEG))
+                        return false;
+                }
+
+                const Kind op = binary(_lookahead.id);
+                if (op != PAREN)
+                {
+                    if (!reduce(precedence(op)) || !push(op, _lookahead) || !next())
+                        return false;
+                    break;
+                }
+
+                if (!reduce(1))
+                    return false;
+
+                if (_size == 0)
+                    return true;
+
+                const Entry group = _stack[--_size];
+                if (!expect(Token::RPAR))
+                    return false;
+                if (group.kind == CALL && !_handler.call(group.start, group.length))
+                    return false;
+            }
+        }
+    }
+
+    public:
+    BasicParserEngine(ParserBase::State& state, const char* start, std::size_t length,
+                      std::size_t max_depth, Token& lookahead, Handler& eh)
+      : _state(state),
+        _start(start),
+        _length(length),
+        _tokenizer(start, length),
+        _lookahead(lookahead),
+        _handler(eh),
+        _max_depth(max_depth),
+        _stack(_inline),
+        _size(0),
+        _capacity(std::min(max_depth, INLINE_DEPTH))
+    {
+    }
+
+    bool  parse()
+    {
+        class Monitor
+        {
+            ParserBase::State& _state;
+            ParserBase::State  _end_state = ParserBase::INTERNAL_ERROR;
+
+            public:
+            Monitor(ParserBase::State &state)
+              : _state(state), _end_state(ParserBase::INTERNAL_ERROR)
+            {
+                _state = ParserBase::RUNNING;
+            }
+
+            ~Monitor()
+            {
+                if (_state == ParserBase::RUNNING)
+                    _state = _end_state;
+            }
+
+            inline bool done(void)
+            {
+                _end_state = ParserBase::OK;
+                return true;
+            }
+        };
+
+        Monitor   monitor{_state};
+        return next() && read_expr() && expect(Token::END) && monitor.done();
+    }
+
+}; // class BasicParserEngine
+
+template<class Handler>
+const std::size_t BasicParserEngine<Handler>::INLINE_DEPTH;
+
+
+//========================================================================
+//  Public interface
+//========================================================================
+/**
+    A parser statically bound to its handler type.
+
+    `Handler` is duck-typed. It needs the same member functions as the
+    EventHandler interface, except the expression boundaries:
+
+        bool number(double value);
+        bool call(const char *identifier, std::size_t len);
+        bool load(const char *identifier, std::size_t len);
+        bool binary_op(BinaryOpCode opcode);
+        bool unary_op(UnaryOpCode opcode);
+
+        void bad_token_error(const char* stmt, std::size_t len, unsigned pos);
+        void syntax_error(const char* stmt, std::size_t len, unsigned pos);
+        void range_error(const char* stmt, std::size_t len, unsigned pos);
+        void depth_error(const char* stmt, std::size_t len, unsigned pos);
+
+    `Parser` runs the same engine on the virtual EventHandler interface,
+    at the cost of one indirect call per event.
+*/
+template<class Handler>
+class BasicParser : public ParserBase
+{
+    Handler&                _handler;
+
+    public:
+    BasicParser(const char* expr, Handler& handler)
+      : BasicParser(expr, std::strlen(expr), handler)
+    {
+    }
+
+    /**
+        Parse the [expr, expr+len) span in place. The expression does
+        not have to be NUL-terminated, and must outlive the parser.
+    */
+    BasicParser(const char* expr, std::size_t len, Handler& handler)
+      : ParserBase(expr, len),
+        _handler(handler)
+    {
+    }
+
+#if __cplusplus >= 201703L
+    BasicParser(std::string_view expr, Handler& handler)
+      : BasicParser(expr.data(), expr.size(), handler)
+    {
+    }
+#endif
+
+    /**
+        Parse the expression. Stops at the first error and return false.
+        Return true is the expression was successfully parsed.
+
+        The parser is a stateful object. The parse method is _not_
+        reentrant.
+    */
+    bool parse()
+    {
+        BasicParserEngine<Handler>  engine{_state, _start, _length, _max_depth, _lookahead, _handler};
+        return engine.parse();
+    }
+};
+
+} /* namespace */
+
+#endif
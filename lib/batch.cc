@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "lib/batch.h"
+
+namespace linlib {
+
+const std::size_t BatchEvaluator::BLOCK_SIZE;
+
+void BatchEvaluator::run(const Program& program,
+                         const double* const* columns,
+                         const Function* fcts,
+                         double* out,
+                         std::size_t rows)
+{
+    const std::size_t depth = program.max_depth;
+
+    if (_scratch.size() < depth*BLOCK_SIZE)
+        _scratch.resize(depth*BLOCK_SIZE);
+    if (_stack.size() < depth)
+        _stack.resize(depth);
+
+    for(std::size_t base = 0; base < rows; base += BLOCK_SIZE)
+    {
+        const std::size_t n = std::min(BLOCK_SIZE, rows-base);
+
+        // The stack holds pointers to the operands. A loaded variable
+        // points directly into its column, so it is never copied.
+        // Computed values live in the scratch block owned by their slot.
+        const double**  sp = _stack.data();
+        double*         block = _scratch.data();
+
+        for(const Instruction& insn : program.code)
+        {
+            switch(insn.op)
+            {
+                case OpCode::CONST:
+                    std::fill_n(block, n, program.constants[insn.arg]);
+                    *sp++ = block;
+                    block += BLOCK_SIZE;
+                    break;
+                case OpCode::LOAD:
+                    *sp++ = columns[insn.arg] + base;
+                    block += BLOCK_SIZE;
+                    break;
+                case OpCode::CALL:
+                    {
+                        double*         dst = block - BLOCK_SIZE;
+                        const double*   src = sp[-1];
+                        Function        fct = fcts[insn.arg];
+
+                        for(std::size_t i = 0; i < n; ++i)
+                            dst[i] = fct(src[i]);
+                        sp[-1] = dst;
+                    }
+                    break;
+                case OpCode::NEG:
+                    _kernels.neg(block - BLOCK_SIZE, sp[-1], n);
+                    sp[-1] = block - BLOCK_SIZE;
+                    break;
+                case OpCode::POWI:
+                    {
+                        // Same steps as powi(), squaring in the free
+                        // block above the top of the stack. The first
+                        // factor is copied rather than multiplied by 1.
+                        double*         dst = block - BLOCK_SIZE;
+                        const double*   x = sp[-1];
+                        std::uint32_t   e = insn.arg;
+                        bool            odd = e & 1;
+
+                        if (odd && x != dst)
+                            std::memcpy(dst, x, n*sizeof(double));
+                        while(e >>= 1)
+                        {
+                            _kernels.mul(block, x, x, n);
+                            x = block;
+                            if (e & 1)
+                            {
+                                if (odd)
+                                    _kernels.mul(dst, dst, block, n);
+                                else
+                                    std::memcpy(dst, block, n*sizeof(double));
+                                odd = true;
+                            }
+                        }
+                        sp[-1] = dst;
+                    }
+                    break;
+                case OpCode::SQRT:
+                    _kernels.sqrt(block - BLOCK_SIZE, sp[-1], n);
+                    sp[-1] = block - BLOCK_SIZE;
+                    break;
+                case OpCode::ADD:
+                case OpCode::SUB:
+                case OpCode::MUL:
+                case OpCode::DIV:
+                case OpCode::POW:
+                    {
+                        --sp;
+                        block -= BLOCK_SIZE;
+
+                        double*         dst = block - BLOCK_SIZE;
+                        const double*   a = sp[-1];
+                        const double*   b = sp[0];
+
+                        switch(insn.op)
+                        {
+                            case OpCode::ADD:
+                                _kernels.add(dst, a, b, n);
+                                break;
+                            case OpCode::SUB:
+                                _kernels.sub(dst, a, b, n);
+                                break;
+                            case OpCode::MUL:
+                                _kernels.mul(dst, a, b, n);
+                                break;
+                            case OpCode::DIV:
+                                _kernels.div(dst, a, b, n);
+                                break;
+                            default:
+                                for(std::size_t i = 0; i < n; ++i)
+                                    dst[i] = std::pow(a[i], b[i]);
+                                break;
+                        };
+                        sp[-1] = dst;
+                    }
+                    break;
+            };
+        }
+
+        std::memcpy(out+base, sp[-1], n*sizeof(double));
+    }
+}
+
+} /* namespace */
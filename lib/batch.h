@@ -0,0 +1,61 @@
+#if !defined LINLIB_BATCH_H
+#define LINLIB_BATCH_H
+
+#include <vector>
+
+#include "lib/kernels.h"
+#include "lib/program.h"
+
+namespace linlib {
+
+/**
+    Evaluate a program over columns of values.
+
+    Rows are processed in blocks of BLOCK_SIZE elements. Inside a block,
+    each instruction of the program runs as a vectorized kernel over the
+    whole block, so the dispatch cost is paid once per block instead of
+    once per row.
+
+    An evaluator keeps its scratch buffers between runs. It is _not_
+    thread-safe; use one instance per thread.
+*/
+class BatchEvaluator
+{
+    const Kernels&              _kernels;
+    std::vector<double>         _scratch;
+    std::vector<const double*>  _stack;
+
+    public:
+    /**
+        Number of rows processed by each kernel invocation. A block
+        for each stack slot should fit in the L1 cache.
+    */
+    static const std::size_t BLOCK_SIZE = 256;
+
+    /**
+        Use the best instruction set supported by the host.
+    */
+    BatchEvaluator() : _kernels(kernels()) {}
+
+    /**
+        Use the given kernels.
+    */
+    BatchEvaluator(const Kernels& kernels) : _kernels(kernels) {}
+
+    inline Isa isa() const { return _kernels.isa; }
+
+    /**
+        Evaluate `program` for `rows` rows. `columns[i]` points to the
+        values of `program.variables[i]`; `fcts` is indexed like
+        `program.functions`. Results are written to `out`.
+    */
+    void run(const Program& program,
+             const double* const* columns,
+             const Function* fcts,
+             double* out,
+             std::size_t rows);
+};
+
+} /* namespace */
+
+#endif
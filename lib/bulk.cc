@@ -0,0 +1,55 @@
+#include <atomic>
+
+#include "lib/bulk.h"
+
+namespace linlib {
+
+template<class Compile>
+static std::size_t compile_all(const std::vector<std::string>& expressions,
+                               std::vector<Program>& programs,
+                               ThreadPool& pool,
+                               const Compile& compile_one)
+{
+    std::atomic<std::size_t> failures(0);
+
+    programs.resize(expressions.size());
+
+    pool.parallel_for(expressions.size(), [&](std::size_t begin, std::size_t end) {
+        std::size_t local = 0;
+
+        for(std::size_t i = begin; i < end; ++i)
+        {
+            if (!compile_one(expressions[i].c_str(), programs[i]))
+            {
+                programs[i].clear();
+                ++local;
+            }
+        }
+
+        failures += local;
+    });
+
+    return failures;
+}
+
+std::size_t compile(const std::vector<std::string>& expressions,
+                    std::vector<Program>& programs,
+                    ThreadPool& pool)
+{
+    return compile_all(expressions, programs, pool, [](const char* expr, Program& program) {
+        return compile(expr, program);
+    });
+}
+
+std::size_t compile(const std::vector<std::string>& expressions,
+                    std::vector<Program>& programs,
+                    const SymbolTable& variables,
+                    const SymbolTable& functions,
+                    ThreadPool& pool)
+{
+    return compile_all(expressions, programs, pool, [&](const char* expr, Program& program) {
+        return compile(expr, program, variables, functions);
+    });
+}
+
+} /* namespace */
@@ -0,0 +1,39 @@
+#if !defined LINLIB_BULK_H
+#define LINLIB_BULK_H
+
+#include <string>
+#include <vector>
+
+#include "lib/program.h"
+#include "lib/thread_pool.h"
+
+namespace linlib {
+
+/**
+    Compile a batch of expressions in parallel on `pool`.
+
+    On return, `programs[i]` holds the compiled `expressions[i]`. The
+    program of an expression that failed to compile is left empty.
+    Return the number of failures.
+
+    Each worker compiles its share of the batch with its own parser and
+    compiler; the only shared state is the output vector, whose
+    elements are each written by a single worker.
+*/
+std::size_t compile(const std::vector<std::string>& expressions,
+                    std::vector<Program>& programs,
+                    ThreadPool& pool);
+
+/**
+    Same as above, resolving the symbols against shared symbol tables.
+    See `compile(const char*, Program&, const SymbolTable&, const SymbolTable&)`.
+*/
+std::size_t compile(const std::vector<std::string>& expressions,
+                    std::vector<Program>& programs,
+                    const SymbolTable& variables,
+                    const SymbolTable& functions,
+                    ThreadPool& pool);
+
+} /* namespace */
+
+#endif
@@ -0,0 +1,121 @@
+#include <functional>
+
+#include "lib/cache.h"
+
+namespace linlib {
+
+ProgramCache::ProgramCache(std::size_t budget, std::size_t shards)
+  : _shard_budget(budget/(shards ? shards : 1)),
+    _shards(shards ? shards : 1),
+    _hits(0),
+    _misses(0),
+    _evictions(0)
+{
+}
+
+ProgramCache::Shard& ProgramCache::shard(const std::string& expr)
+{
+    return _shards[std::hash<std::string>()(expr) % _shards.size()];
+}
+
+std::size_t ProgramCache::footprint(const std::string& expr, const Program& program)
+{
+    std::size_t bytes = sizeof(Program) + expr.size()
+        + program.code.size()*sizeof(Instruction)
+        + program.constants.size()*sizeof(double);
+
+    for(const auto& name : program.variables)
+        bytes += sizeof(std::string) + name.size();
+    for(const auto& name : program.functions)
+        bytes += sizeof(std::string) + name.size();
+
+    return bytes;
+}
+
+ProgramCache::Entry ProgramCache::get(const std::string& expr)
+{
+    Shard& s = shard(expr);
+
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+
+        auto it = s.index.find(expr);
+        if (it != s.index.end())
+        {
+            s.lru.splice(s.lru.begin(), s.lru, it->second);
+            _hits.fetch_add(1, std::memory_order_relaxed);
+
+            return it->second->second;
+        }
+    }
+
+    _misses.fetch_add(1, std::memory_order_relaxed);
+
+    // Compile outside of the lock so a slow parse does not block
+    // lookups of other expressions in the same shard.
+    std::shared_ptr<Program> program = std::make_shared<Program>();
+    if (!compile(expr.c_str(), *program))
+        return nullptr;
+
+    const std::size_t bytes = footprint(expr, *program);
+    if (bytes > _shard_budget)
+        return program;
+
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    // Another thread may have compiled the same expression meanwhile.
+    auto it = s.index.find(expr);
+    if (it != s.index.end())
+        return it->second->second;
+
+    while(s.bytes + bytes > _shard_budget)
+    {
+        const auto& victim = s.lru.back();
+
+        s.bytes -= footprint(victim.first, *victim.second);
+        s.index.erase(victim.first);
+        s.lru.pop_back();
+        _evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    s.lru.emplace_front(expr, program);
+    s.index.emplace(expr, s.lru.begin());
+    s.bytes += bytes;
+
+    return program;
+}
+
+ProgramCache::Stats ProgramCache::stats()
+{
+    Stats result = {
+        _hits.load(std::memory_order_relaxed),
+        _misses.load(std::memory_order_relaxed),
+        _evictions.load(std::memory_order_relaxed),
+        0,
+        0,
+    };
+
+    for(Shard& s : _shards)
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+
+        result.entries += s.lru.size();
+        result.bytes += s.bytes;
+    }
+
+    return result;
+}
+
+void ProgramCache::clear()
+{
+    for(Shard& s : _shards)
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+
+        s.index.clear();
+        s.lru.clear();
+        s.bytes = 0;
+    }
+}
+
+} /* namespace */
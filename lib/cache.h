@@ -0,0 +1,92 @@
+#if !defined LINLIB_CACHE_H
+#define LINLIB_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lib/program.h"
+
+namespace linlib {
+
+/**
+    A thread-safe cache of compiled programs keyed by their source text.
+
+    The cache is split into shards, each one protected by its own lock,
+    so concurrent lookups of different expressions rarely contend.
+    Each shard evicts its least recently used entries when its share of
+    the memory budget is exceeded.
+
+    Cached programs are immutable and shared: an evicted program stays
+    alive as long as a caller holds a reference to it.
+*/
+class ProgramCache
+{
+    public:
+    typedef std::shared_ptr<const Program> Entry;
+
+    struct Stats
+    {
+        std::uint64_t   hits;
+        std::uint64_t   misses;
+        std::uint64_t   evictions;
+
+        std::size_t     entries;
+        std::size_t     bytes;
+    };
+
+    private:
+    struct Shard
+    {
+        typedef std::list<std::pair<std::string, Entry>>   Lru;
+
+        std::mutex                                          mutex;
+        Lru                                                 lru;
+        std::unordered_map<std::string, Lru::iterator>      index;
+        std::size_t                                         bytes = 0;
+    };
+
+    const std::size_t           _shard_budget;
+    std::vector<Shard>          _shards;
+
+    std::atomic<std::uint64_t>  _hits;
+    std::atomic<std::uint64_t>  _misses;
+    std::atomic<std::uint64_t>  _evictions;
+
+    Shard& shard(const std::string& expr);
+
+    public:
+    /**
+        Create a cache holding at most `budget` bytes of compiled programs
+        (source text included), split into `shards` shards.
+    */
+    ProgramCache(std::size_t budget, std::size_t shards = 16);
+
+    ProgramCache(const ProgramCache&) = delete;
+    ProgramCache& operator=(const ProgramCache&) = delete;
+
+    /**
+        Return the compiled program for `expr`, compiling it on a miss.
+        Return an empty pointer if the expression can't be compiled;
+        failures are not cached.
+    */
+    Entry get(const std::string& expr);
+
+    Stats stats();
+
+    void clear();
+
+    /**
+        Estimated memory used by a cache entry.
+    */
+    static std::size_t footprint(const std::string& expr, const Program& program);
+};
+
+} /* namespace */
+
+#endif
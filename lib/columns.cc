@@ -0,0 +1,693 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+#include "lib/columns.h"
+#include "lib/number.h"
+
+namespace linlib {
+
+const std::size_t Chunk::MAX_VALUES;
+const std::size_t ColumnReader::MAX_COLUMNS;
+const std::size_t CsvReader::CHUNK_ROWS;
+const std::size_t BinaryColumnReader::MAX_BLOCK_ROWS;
+
+namespace {
+
+const char          MAGIC[8] = { 'L', 'I', 'N', 'L', 'I', 'B', 'C', 'S' };
+const std::uint32_t VERSION = 1;
+const std::size_t   MAX_NAME_LENGTH = 1 << 16;
+const std::size_t   BUFFER_SIZE = 1 << 16;
+
+bool little_endian()
+{
+    const std::uint32_t one = 1;
+    char                first;
+
+    std::memcpy(&first, &one, 1);
+    return first == 1;
+}
+
+inline bool is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/**
+    Parse a CSV field, with its surrounding blanks. An empty field is NaN.
+*/
+bool parse_field(const char* start, const char* end, double& value)
+{
+    while(start != end && is_blank(*start))
+        ++start;
+    while(start != end && is_blank(end[-1]))
+        --end;
+
+    if (start == end)
+    {
+        value = std::numeric_limits<double>::quiet_NaN();
+        return true;
+    }
+
+    bool negative = false;
+    if (*start == '-' || *start == '+')
+    {
+        negative = (*start == '-');
+        ++start;
+    }
+
+    if (end - start == 3 && std::memcmp(start, "inf", 3) == 0)
+        value = std::numeric_limits<double>::infinity();
+    else if (parse_number(start, end-start, value) == NumberStatus::SYNTAX_ERROR)
+        return false;
+
+    if (negative)
+        value = -value;
+
+    return true;
+}
+
+/**
+    Format `value` so that it parses back to itself, and return the
+    length of the text.
+
+    A value with a short decimal form n / 10^k, where n < 2^53 and
+    k <= 15, is written from the integer n: both n and 10^k are exact
+    doubles, so their quotient is the correctly rounded value of the
+    text. This is the common case of input data, and about five times
+    faster than "%.17g", the fallback for the other values.
+*/
+std::size_t format_double(double value, char* text)
+{
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+        1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+    };
+    const double limit = 9007199254740992.0;    // 2^53
+
+    char* out = text;
+
+    // Keep the sign of -0 and of the negative values
+    if (std::signbit(value))
+        *out++ = '-';
+    if (value == 0)
+    {
+        *out++ = '0';
+        return out - text;
+    }
+
+    if (std::fabs(value) < limit)
+        for(int k = 0; k < 16; ++k)
+        {
+            const double n = std::nearbyint(value * powers[k]);
+
+            if (std::fabs(n) >= limit)
+                break;
+            if (n / powers[k] != value)
+                continue;
+
+            char                digits[24];
+            char*               p = digits + sizeof(digits);
+            std::uint64_t       w = std::fabs(n);
+
+            // At least one digit before the point
+            for(int i = 0; w != 0 || i <= k; ++i)
+            {
+                *--p = '0' + w % 10;
+                w /= 10;
+            }
+
+            const std::size_t length = digits + sizeof(digits) - p;
+            std::memcpy(out, p, length - k);
+            out += length - k;
+            if (k)
+            {
+                *out++ = '.';
+                std::memcpy(out, p + length - k, k);
+                out += k;
+            }
+
+            return out - text;
+        }
+
+    return std::snprintf(text, 32, "%.17g", value);
+}
+
+bool read_u32(std::istream& in, std::uint32_t& value)
+{
+    return bool(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+void write_u32(std::ostream& out, std::uint32_t value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+} /* namespace */
+
+//========================================================================
+//  Chunk
+//========================================================================
+std::size_t Chunk::fit(std::size_t columns, std::size_t rows)
+{
+    const std::size_t most = columns ? std::max<std::size_t>(MAX_VALUES / columns, 1) : rows;
+
+    return std::max<std::size_t>(std::min(rows, most), 1);
+}
+
+void Chunk::reserve(std::size_t columns, std::size_t capacity)
+{
+    _columns = columns;
+    _capacity = capacity;
+    _values.resize(columns*capacity);
+    rows = 0;
+}
+
+//========================================================================
+//  CSV
+//========================================================================
+CsvReader::CsvReader(std::istream& in)
+  : _in(in),
+    _buffer(BUFFER_SIZE)
+{
+    const char* start;
+    const char* end;
+
+    if (!next_line(start, end))
+    {
+        if (_status == ColumnStatus::OK)
+            _status = ColumnStatus::BAD_FORMAT;
+        return;
+    }
+
+    for(const char* field = start; ; )
+    {
+        const char* comma = std::find(field, end, ',');
+        const char* first = field;
+        const char* last = comma;
+
+        while(first != last && is_blank(*first))
+            ++first;
+        while(first != last && is_blank(last[-1]))
+            --last;
+        if (_names.size() == MAX_COLUMNS)
+        {
+            _status = ColumnStatus::BAD_FORMAT;
+            return;
+        }
+        _names.emplace_back(first, last);
+
+        if (comma == end)
+            break;
+        field = comma+1;
+    }
+}
+
+/**
+    Find the next line in the buffer, reading more input as needed.
+    The line stays valid until the next call.
+*/
+bool CsvReader::next_line(const char*& start, const char*& end)
+{
+    std::size_t scanned = _begin;
+
+    for(;;)
+    {
+        char* const data = _buffer.data();
+        char* const newline = static_cast<char*>(std::memchr(data+scanned, '\n', _end-scanned));
+
+        if (newline)
+        {
+            start = data+_begin;
+            end = newline;
+            _begin = newline+1 - data;
+            ++_line;
+            return true;
+        }
+
+        if (_eof)
+        {
+            if (_begin == _end)
+                return false;
+
+            // Last line, without a newline
+            start = data+_begin;
+            end = data+_end;
+            _begin = _end;
+            ++_line;
+            return true;
+        }
+
+        // Keep the partial line, and make room after it. The buffer only
+        // grows for lines longer than itself.
+        std::memmove(data, data+_begin, _end-_begin);
+        _end -= _begin;
+        _begin = 0;
+        scanned = _end;
+        if (_end == _buffer.size())
+            _buffer.resize(2*_buffer.size());
+
+        _in.read(_buffer.data()+_end, _buffer.size()-_end);
+        _end += _in.gcount();
+        if (_in.eof())
+        {
+            _eof = true;
+        }
+        else if (!_in)
+        {
+            _status = ColumnStatus::IO_ERROR;
+            return false;
+        }
+    }
+}
+
+bool CsvReader::read(Chunk& chunk)
+{
+    if (chunk.columns() != _names.size() || chunk.capacity() == 0)
+        chunk.reserve(_names.size(), Chunk::fit(_names.size(), CHUNK_ROWS));
+    chunk.rows = 0;
+
+    if (_status != ColumnStatus::OK)
+        return false;
+
+    const char* start;
+    const char* end;
+    while(chunk.rows < chunk.capacity() && next_line(start, end))
+    {
+        // Blank lines are ignored
+        if (std::all_of(start, end, is_blank))
+            continue;
+
+        std::size_t column = 0;
+        for(const char* field = start; ; ++column)
+        {
+            const char* comma = std::find(field, end, ',');
+
+            if (column == _names.size() || !parse_field(field, comma, chunk.column(column)[chunk.rows]))
+            {
+                _status = ColumnStatus::BAD_FORMAT;
+                return false;
+            }
+
+            if (comma == end)
+                break;
+            field = comma+1;
+        }
+
+        if (column+1 != _names.size())
+        {
+            _status = ColumnStatus::BAD_FORMAT;
+            return false;
+        }
+
+        ++chunk.rows;
+    }
+
+    return chunk.rows > 0;
+}
+
+CsvWriter::CsvWriter(std::ostream& out, const std::vector<std::string>& names)
+  : ColumnWriter(names),
+    _out(out)
+{
+    _buffer.reserve(BUFFER_SIZE + 64);
+}
+
+bool CsvWriter::flush()
+{
+    _out.write(_buffer.data(), _buffer.size());
+    _buffer.clear();
+
+    if (!_out)
+        _status = ColumnStatus::IO_ERROR;
+
+    return _status == ColumnStatus::OK;
+}
+
+bool CsvWriter::header()
+{
+    _header = true;
+
+    for(std::size_t i = 0; i < _names.size(); ++i)
+    {
+        if (i)
+            _buffer.push_back(',');
+        _buffer.insert(_buffer.end(), _names[i].begin(), _names[i].end());
+    }
+    _buffer.push_back('\n');
+
+    return flush();
+}
+
+bool CsvWriter::write(const Chunk& chunk)
+{
+    if (!_header && !header())
+        return false;
+
+    char field[32];
+    for(std::size_t row = 0; row < chunk.rows; ++row)
+    {
+        for(std::size_t i = 0; i < _names.size(); ++i)
+        {
+            if (i)
+                _buffer.push_back(',');
+
+            // NaN is an empty field
+            const double value = chunk.column(i)[row];
+            if (value == value)
+                _buffer.insert(_buffer.end(), field, field + format_double(value, field));
+        }
+        _buffer.push_back('\n');
+
+        if (_buffer.size() >= BUFFER_SIZE && !flush())
+            return false;
+    }
+
+    return true;
+}
+
+bool CsvWriter::finish()
+{
+    if (!_header && !header())
+        return false;
+
+    if (!flush())
+        return false;
+
+    _out.flush();
+    if (!_out)
+        _status = ColumnStatus::IO_ERROR;
+
+    return _status == ColumnStatus::OK;
+}
+
+//========================================================================
+//  Binary
+//========================================================================
+BinaryColumnReader::BinaryColumnReader(std::istream& in)
+  : _in(in)
+{
+    if (!little_endian())
+    {
+        _status = ColumnStatus::UNSUPPORTED_HOST;
+        return;
+    }
+
+    char            magic[sizeof(MAGIC)];
+    std::uint32_t   version;
+    std::uint32_t   count;
+
+    if (!_in.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0
+        || !read_u32(_in, version) || version != VERSION
+        || !read_u32(_in, count) || count > MAX_COLUMNS)
+    {
+        _status = _in.bad() ? ColumnStatus::IO_ERROR : ColumnStatus::BAD_FORMAT;
+        return;
+    }
+
+    for(std::uint32_t i = 0; i < count; ++i)
+    {
+        std::uint32_t   length;
+        std::string     name;
+
+        if (!read_u32(_in, length) || length > MAX_NAME_LENGTH)
+        {
+            _status = ColumnStatus::BAD_FORMAT;
+            return;
+        }
+
+        name.resize(length);
+        if (!_in.read(&name[0], length))
+        {
+            _status = ColumnStatus::BAD_FORMAT;
+            return;
+        }
+
+        _names.push_back(std::move(name));
+    }
+}
+
+bool BinaryColumnReader::read(Chunk& chunk)
+{
+    chunk.rows = 0;
+    if (_end || _status != ColumnStatus::OK)
+        return false;
+
+    std::uint32_t rows;
+    if (!read_u32(_in, rows) || rows > MAX_BLOCK_ROWS || rows*_names.size() > Chunk::MAX_VALUES)
+    {
+        _status = _in.bad() ? ColumnStatus::IO_ERROR : ColumnStatus::BAD_FORMAT;
+        return false;
+    }
+
+    if (rows == 0)
+    {
+        _end = true;
+        return false;
+    }
+
+    // A block is read whole: chunks grow to the largest block
+    if (chunk.columns() != _names.size() || chunk.capacity() < rows)
+        chunk.reserve(_names.size(), std::max<std::size_t>(rows, chunk.capacity()));
+
+    for(std::size_t i = 0; i < _names.size(); ++i)
+        if (!_in.read(reinterpret_cast<char*>(chunk.column(i)), rows*sizeof(double)))
+        {
+            _status = _in.bad() ? ColumnStatus::IO_ERROR : ColumnStatus::BAD_FORMAT;
+            return false;
+        }
+
+    chunk.rows = rows;
+    return true;
+}
+
+BinaryColumnWriter::BinaryColumnWriter(std::ostream& out, const std::vector<std::string>& names)
+  : ColumnWriter(names),
+    _out(out)
+{
+    if (!little_endian())
+        _status = ColumnStatus::UNSUPPORTED_HOST;
+}
+
+bool BinaryColumnWriter::header()
+{
+    _header = true;
+
+    _out.write(MAGIC, sizeof(MAGIC));
+    write_u32(_out, VERSION);
+    write_u32(_out, _names.size());
+    for(const std::string& name : _names)
+    {
+        write_u32(_out, name.size());
+        _out.write(name.data(), name.size());
+    }
+
+    if (!_out)
+        _status = ColumnStatus::IO_ERROR;
+
+    return _status == ColumnStatus::OK;
+}
+
+bool BinaryColumnWriter::write(const Chunk& chunk)
+{
+    if (_status != ColumnStatus::OK || (!_header && !header()))
+        return false;
+
+    if (chunk.rows == 0)
+        return true;
+
+    const std::size_t block = Chunk::fit(_names.size(), BinaryColumnReader::MAX_BLOCK_ROWS);
+
+    for(std::size_t first = 0; first < chunk.rows; first += block)
+    {
+        const std::size_t rows = std::min(block, chunk.rows - first);
+
+        write_u32(_out, rows);
+        for(std::size_t i = 0; i < _names.size(); ++i)
+            _out.write(reinterpret_cast<const char*>(chunk.column(i) + first), rows*sizeof(double));
+    }
+
+    if (!_out)
+        _status = ColumnStatus::IO_ERROR;
+
+    return _status == ColumnStatus::OK;
+}
+
+bool BinaryColumnWriter::finish()
+{
+    if (_status != ColumnStatus::OK || (!_header && !header()))
+        return false;
+
+    write_u32(_out, 0);
+    _out.flush();
+
+    if (!_out)
+        _status = ColumnStatus::IO_ERROR;
+
+    return _status == ColumnStatus::OK;
+}
+
+//========================================================================
+//  Pipeline
+//========================================================================
+namespace {
+
+/**
+    Hand chunks from one stage to the next.
+*/
+class Channel
+{
+    std::mutex              _mutex;
+    std::condition_variable _ready;
+    std::deque<Chunk*>      _chunks;
+    bool                    _closed = false;
+
+    public:
+    void push(Chunk* chunk)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _chunks.push_back(chunk);
+        }
+        _ready.notify_one();
+    }
+
+    /**
+        Wait for a chunk. Return nullptr once the channel is closed and
+        empty.
+    */
+    Chunk* pop()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _ready.wait(lock, [this]{ return _closed || !_chunks.empty(); });
+
+        if (_chunks.empty())
+            return nullptr;
+
+        Chunk* chunk = _chunks.front();
+        _chunks.pop_front();
+        return chunk;
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _closed = true;
+        }
+        _ready.notify_all();
+    }
+};
+
+} /* namespace */
+
+ColumnStatus evaluate(ColumnReader& input, const FusedProgram& program, const Function* fcts,
+                      ColumnWriter& output, std::size_t& rows,
+                      std::size_t chunk_rows)
+{
+    rows = 0;
+    if (input.status() != ColumnStatus::OK)
+        return input.status();
+
+    std::vector<std::size_t> bindings;
+    for(std::size_t i = 0; i < program.variables.size(); ++i)
+    {
+        const std::vector<std::string>& names = input.names();
+        auto it = std::find(names.begin(), names.end(), program.variables[i]);
+
+        if (it == names.end())
+            return ColumnStatus::UNKNOWN_COLUMN;
+
+        bindings.push_back(it - names.begin());
+    }
+
+    // Two chunks in flight between each pair of stages, none larger
+    // than MAX_VALUES
+    chunk_rows = Chunk::fit(std::max(input.names().size(), program.outputs), chunk_rows);
+
+    Chunk               inputs[2];
+    Chunk               outputs[2];
+    Channel             free_inputs, full_inputs;
+    Channel             free_outputs, full_outputs;
+    std::atomic<bool>   failed(false);
+
+    for(Chunk& chunk : inputs)
+    {
+        chunk.reserve(input.names().size(), chunk_rows);
+        free_inputs.push(&chunk);
+    }
+    for(Chunk& chunk : outputs)
+        free_outputs.push(&chunk);
+
+    std::thread reader([&]{
+        while(!failed)
+        {
+            Chunk* chunk = free_inputs.pop();
+
+            if (!input.read(*chunk))
+                break;
+            full_inputs.push(chunk);
+        }
+        full_inputs.close();
+    });
+
+    std::thread writer([&]{
+        while(Chunk* chunk = full_outputs.pop())
+        {
+            // Keep draining after an error, so the other stages finish
+            if (!failed && !output.write(*chunk))
+                failed = true;
+            free_outputs.push(chunk);
+        }
+    });
+
+    FusedEvaluator              evaluator;
+    std::vector<const double*>  columns(bindings.size());
+    std::vector<double*>        results(program.outputs);
+
+    while(Chunk* in = full_inputs.pop())
+    {
+        // A block of a binary stream may be longer than an output chunk
+        for(std::size_t first = 0; first < in->rows && !failed; first += chunk_rows)
+        {
+            const std::size_t   n = std::min(chunk_rows, in->rows - first);
+            Chunk*              out = free_outputs.pop();
+
+            if (out->columns() != program.outputs || out->capacity() < chunk_rows)
+                out->reserve(program.outputs, chunk_rows);
+
+            for(std::size_t i = 0; i < bindings.size(); ++i)
+                columns[i] = in->column(bindings[i]) + first;
+            for(std::size_t i = 0; i < program.outputs; ++i)
+                results[i] = out->column(i);
+
+            evaluator.run(program, columns.data(), fcts, results.data(), n);
+            out->rows = n;
+            rows += n;
+
+            full_outputs.push(out);
+        }
+        free_inputs.push(in);
+    }
+    full_outputs.close();
+
+    reader.join();
+    writer.join();
+
+    if (input.status() != ColumnStatus::OK)
+        return input.status();
+    if (!failed)
+        output.finish();
+
+    return output.status();
+}
+
+} /* namespace */
@@ -0,0 +1,226 @@
+#if !defined LINLIB_COLUMNS_H
+#define LINLIB_COLUMNS_H
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "lib/fused.h"
+
+namespace linlib {
+
+/**
+    Streams of rows of doubles, read and written by chunks so memory use
+    does not depend on the length of the stream.
+
+    Two formats are supported:
+
+    CSV         a header line with the column names, then one line per
+                row of comma-separated numbers. An empty field is NaN.
+
+    binary      magic "LINLIBCS", uint32 version, uint32 column count,
+                then each name as a uint32 length and its bytes; then
+                blocks of a uint32 row count followed by each column of
+                the block as contiguous doubles. A block of 0 rows ends
+                the stream. All values are little-endian.
+*/
+enum struct ColumnStatus
+{
+    OK,
+    IO_ERROR,           // the stream can't be read or written
+    BAD_FORMAT,         // malformed header, row or block
+    UNKNOWN_COLUMN,     // an expression loads a column the input lacks
+    UNSUPPORTED_HOST,   // big-endian host: binary streams are not supported
+};
+
+/**
+    A chunk of rows, stored column by column.
+*/
+class Chunk
+{
+    std::size_t             _columns = 0;
+    std::size_t             _capacity = 0;
+    std::vector<double>     _values;
+
+    public:
+    /**
+        Largest chunk built by the readers and by `evaluate()`, in
+        values: 32 MiB. Wide streams get chunks of fewer rows.
+    */
+    static const std::size_t MAX_VALUES = 1 << 22;
+
+    std::size_t             rows = 0;
+
+    /**
+        Number of rows of `columns` columns fitting in MAX_VALUES, at
+        most `rows` and at least one.
+    */
+    static std::size_t fit(std::size_t columns, std::size_t rows);
+
+    /**
+        Make room for `capacity` rows of `columns` columns. The content
+        is lost.
+    */
+    void reserve(std::size_t columns, std::size_t capacity);
+
+    inline std::size_t columns() const { return _columns; }
+    inline std::size_t capacity() const { return _capacity; }
+    inline double* column(std::size_t i) { return _values.data() + i*_capacity; }
+    inline const double* column(std::size_t i) const { return _values.data() + i*_capacity; }
+};
+
+class ColumnReader
+{
+    protected:
+    std::vector<std::string>    _names;
+    ColumnStatus                _status = ColumnStatus::OK;
+
+    public:
+    /**
+        Wider streams are rejected as BAD_FORMAT, so a single row
+        always fits in a chunk.
+    */
+    static const std::size_t MAX_COLUMNS = 1 << 16;
+
+    virtual ~ColumnReader() {}
+
+    /**
+        Read the next rows into `chunk`, up to its capacity. A chunk of
+        another width, or too small for the next block of a binary
+        stream, is reserved again. Return false at the end of the
+        stream, or on error.
+    */
+    virtual bool read(Chunk& chunk) = 0;
+
+    /**
+        Names of the columns, available as soon as the reader is built.
+    */
+    inline const std::vector<std::string>& names() const { return _names; }
+
+    inline ColumnStatus status() const { return _status; }
+};
+
+class ColumnWriter
+{
+    protected:
+    std::vector<std::string>    _names;
+    ColumnStatus                _status = ColumnStatus::OK;
+
+    public:
+    explicit ColumnWriter(const std::vector<std::string>& names) : _names(names) {}
+    virtual ~ColumnWriter() {}
+
+    /**
+        Write the rows of `chunk`. Return false on error.
+    */
+    virtual bool write(const Chunk& chunk) = 0;
+
+    /**
+        End the stream. Must be called once, after the last chunk.
+    */
+    virtual bool finish() = 0;
+
+    inline const std::vector<std::string>& names() const { return _names; }
+
+    inline ColumnStatus status() const { return _status; }
+};
+
+class CsvReader : public ColumnReader
+{
+    std::istream&           _in;
+    std::vector<char>       _buffer;
+    std::size_t             _begin = 0;     // unparsed data in the buffer
+    std::size_t             _end = 0;
+    std::size_t             _line = 0;
+    bool                    _eof = false;
+
+    bool next_line(const char*& start, const char*& end);
+
+    public:
+    static const std::size_t CHUNK_ROWS = 4096;
+
+    explicit CsvReader(std::istream& in);
+
+    bool read(Chunk& chunk);
+
+    /**
+        Number of the latest line read, from 1. On error, the faulty one.
+    */
+    inline std::size_t line() const { return _line; }
+};
+
+class CsvWriter : public ColumnWriter
+{
+    std::ostream&           _out;
+    std::vector<char>       _buffer;
+    bool                    _header = false;
+
+    bool header();
+    bool flush();
+
+    public:
+    CsvWriter(std::ostream& out, const std::vector<std::string>& names);
+
+    bool write(const Chunk& chunk);
+    bool finish();
+};
+
+class BinaryColumnReader : public ColumnReader
+{
+    std::istream&           _in;
+    bool                    _end = false;
+
+    public:
+    /**
+        Blocks of more rows, or of more than Chunk::MAX_VALUES values,
+        are rejected, so a chunk stays bounded.
+    */
+    static const std::size_t MAX_BLOCK_ROWS = 1 << 20;
+
+    explicit BinaryColumnReader(std::istream& in);
+
+    bool read(Chunk& chunk);
+};
+
+/**
+    Chunks are split into blocks the reader accepts.
+*/
+class BinaryColumnWriter : public ColumnWriter
+{
+    std::ostream&           _out;
+    bool                    _header = false;
+
+    bool header();
+
+    public:
+    BinaryColumnWriter(std::ostream& out, const std::vector<std::string>& names);
+
+    bool write(const Chunk& chunk);
+    bool finish();
+};
+
+/**
+    Evaluate a fused program over every row of `input`, and write its
+    outputs, in order, to `output`. The variables of the program are
+    bound to the input columns of the same name.
+
+    Reading, evaluating and writing run on three threads, each one
+    handing its chunks of at most `chunk_rows` rows to the next, fewer
+    if the input or the output is too wide for Chunk::MAX_VALUES. Two
+    chunks are in flight between each pair of stages, so memory use is
+    bounded by four chunks whatever the size and the width of the
+    input.
+
+    Store the number of rows evaluated in `rows`. Return the error of
+    the reader, of the writer, or UNKNOWN_COLUMN; the output is only
+    finished if the whole input was read.
+*/
+ColumnStatus evaluate(ColumnReader& input, const FusedProgram& program, const Function* fcts,
+                      ColumnWriter& output, std::size_t& rows,
+                      std::size_t chunk_rows = CsvReader::CHUNK_ROWS);
+
+} /* namespace */
+
+#endif
@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <initializer_list>
+
+#include "lib/dag.h"
+
+namespace linlib {
+
+//========================================================================
+//  Dag
+//========================================================================
+void Dag::clear()
+{
+    nodes.clear();
+    constants.clear();
+    variables.clear();
+    functions.clear();
+    roots.clear();
+    tree_size = 0;
+}
+
+//========================================================================
+//  DagBuilder
+//========================================================================
+static const std::uint32_t NONE = UINT32_MAX;
+
+std::size_t DagBuilder::Hash::operator()(const DagNode& node) const
+{
+    std::uint64_t h = static_cast<std::uint64_t>(node.op);
+
+    for(std::uint64_t v : { node.arg, node.left, node.right })
+        h = (h ^ v) * 0x100000001B3ull;
+
+    return static_cast<std::size_t>(h ^ (h >> 32));
+}
+
+DagBuilder::DagBuilder(Dag& dag)
+  : _dag(dag)
+{
+    // Resume an existing DAG
+    for(std::uint32_t i = 0; i < dag.nodes.size(); ++i)
+        _index.emplace(dag.nodes[i], i);
+
+    for(std::uint32_t i = 0; i < dag.constants.size(); ++i)
+    {
+        std::uint64_t bits;
+        std::memcpy(&bits, &dag.constants[i], sizeof(bits));
+        _constants.emplace(bits, i);
+    }
+}
+
+bool DagBuilder::push(DagNode node)
+{
+    ++_dag.tree_size;
+
+    auto it = _index.find(node);
+    if (it == _index.end())
+    {
+        _dag.nodes.push_back(node);
+        it = _index.emplace(node, static_cast<std::uint32_t>(_dag.nodes.size()-1)).first;
+    }
+
+    _dag.roots.push_back(it->second);
+
+    return true;
+}
+
+bool DagBuilder::unary(OpCode op, std::uint32_t arg)
+{
+    const std::uint32_t child = _dag.roots.back();
+    _dag.roots.pop_back();
+
+    return push({ op, arg, child, NONE });
+}
+
+bool DagBuilder::binary(OpCode op)
+{
+    std::uint32_t right = _dag.roots.back();
+    _dag.roots.pop_back();
+    std::uint32_t left = _dag.roots.back();
+    _dag.roots.pop_back();
+
+    if ((op == OpCode::ADD || op == OpCode::MUL) && left > right)
+        std::swap(left, right);
+
+    return push({ op, 0, left, right });
+}
+
+bool DagBuilder::number(double value)
+{
+    // Constants are compared by their bit pattern, so 0 and -0 are
+    // distinct.
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    auto it = _constants.find(bits);
+    if (it == _constants.end())
+    {
+        _dag.constants.push_back(value);
+        it = _constants.emplace(bits, static_cast<std::uint32_t>(_dag.constants.size()-1)).first;
+    }
+
+    return push({ OpCode::CONST, it->second, NONE, NONE });
+}
+
+bool DagBuilder::call(const char *identifier, std::size_t len)
+{
+    return unary(OpCode::CALL, _dag.functions.intern(identifier, len));
+}
+
+bool DagBuilder::load(const char *identifier, std::size_t len)
+{
+    return push({ OpCode::LOAD, _dag.variables.intern(identifier, len), NONE, NONE });
+}
+
+bool DagBuilder::unary_op(UnaryOpCode opcode)
+{
+    switch(opcode)
+    {
+        case UnaryOpCode::NEG:
+            return unary(OpCode::NEG, 0);
+    };
+
+    return false;
+}
+
+bool DagBuilder::binary_op(BinaryOpCode opcode)
+{
+    switch(opcode)
+    {
+        case BinaryOpCode::ADD:
+            return binary(OpCode::ADD);
+        case BinaryOpCode::SUB:
+            return binary(OpCode::SUB);
+        case BinaryOpCode::MUL:
+            return binary(OpCode::MUL);
+        case BinaryOpCode::DIV:
+            return binary(OpCode::DIV);
+        case BinaryOpCode::POW:
+            return binary(OpCode::POW);
+    };
+
+    return false;
+}
+
+//========================================================================
+//  DagEvaluator
+//========================================================================
+const double* DagEvaluator::evaluate(const Dag& dag, const double* vars, const Function* fcts)
+{
+    if (_values.size() < dag.nodes.size())
+        _values.resize(dag.nodes.size());
+
+    double* values = _values.data();
+
+    for(std::size_t i = 0; i < dag.nodes.size(); ++i)
+    {
+        const DagNode& node = dag.nodes[i];
+
+        switch(node.op)
+        {
+            case OpCode::CONST:
+                values[i] = dag.constants[node.arg];
+                break;
+            case OpCode::LOAD:
+                values[i] = vars[node.arg];
+                break;
+            case OpCode::CALL:
+                values[i] = fcts[node.arg](values[node.left]);
+                break;
+            case OpCode::NEG:
+                values[i] = -values[node.left];
+                break;
+            case OpCode::ADD:
+                values[i] = values[node.left] + values[node.right];
+                break;
+            case OpCode::SUB:
+                values[i] = values[node.left] - values[node.right];
+                break;
+            case OpCode::MUL:
+                values[i] = values[node.left] * values[node.right];
+                break;
+            case OpCode::DIV:
+                values[i] = values[node.left] / values[node.right];
+                break;
+            case OpCode::POW:
+                values[i] = std::pow(values[node.left], values[node.right]);
+                break;
+            default:
+                // POWI and SQRT are only emitted by the Optimizer
+                break;
+        };
+    }
+
+    return values;
+}
+
+void DagEvaluator::run(const Dag& dag, const double* vars, const Function* fcts, double* out)
+{
+    const double* values = evaluate(dag, vars, fcts);
+
+    for(std::size_t i = 0; i < dag.roots.size(); ++i)
+        out[i] = values[dag.roots[i]];
+}
+
+double DagEvaluator::run(const Dag& dag, const double* vars, const Function* fcts)
+{
+    return evaluate(dag, vars, fcts)[dag.roots.back()];
+}
+
+} /* namespace */
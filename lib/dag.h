@@ -0,0 +1,125 @@
+#if !defined LINLIB_DAG_H
+#define LINLIB_DAG_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lib/program.h"
+
+namespace linlib {
+
+/**
+    A node of an expression DAG.
+
+    Leaves (CONST and LOAD) use `arg` to index the constant or
+    variable table. CALL uses `arg` to index the function table, and
+    `left` for its argument. NEG only uses `left`.
+*/
+struct DagNode
+{
+    OpCode          op;
+    std::uint32_t   arg;
+    std::uint32_t   left;
+    std::uint32_t   right;
+
+    inline bool operator==(const DagNode& other) const
+    {
+        return op == other.op && arg == other.arg && left == other.left && right == other.right;
+    }
+};
+
+/**
+    An expression DAG where identical subexpressions are stored once.
+
+    Nodes are in topological order: children always come before their
+    parents, so evaluating the nodes in order computes each shared
+    subexpression exactly once.
+*/
+struct Dag
+{
+    std::vector<DagNode>        nodes;
+    std::vector<double>         constants;
+
+    SymbolTable                 variables;
+    SymbolTable                 functions;
+
+    /**
+        One root per parsed expression.
+    */
+    std::vector<std::uint32_t>  roots;
+
+    /**
+        Number of nodes before deduplication, ie. the number of events
+        received from the parser.
+    */
+    std::size_t                 tree_size = 0;
+
+    void clear();
+};
+
+/**
+    An event handler building a hash-consed DAG.
+
+    Several expressions can be parsed into the same builder; they will
+    share their common subexpressions. On a parse error, the content
+    of the DAG is unspecified.
+
+    Functions are assumed to be pure. ADD and MUL are commutative, so
+    `a+b` and `b+a` share the same node.
+*/
+class DagBuilder : public EventHandler
+{
+    struct Hash
+    {
+        std::size_t operator()(const DagNode& node) const;
+    };
+
+    Dag&                                                _dag;
+    std::unordered_map<DagNode, std::uint32_t, Hash>    _index;
+    std::unordered_map<std::uint64_t, std::uint32_t>    _constants;
+
+    bool push(DagNode node);
+    bool unary(OpCode op, std::uint32_t arg);
+    bool binary(OpCode op);
+
+    public:
+    DagBuilder(Dag& dag);
+
+    bool number(double value);
+    bool call(const char *identifier, std::size_t len);
+    bool load(const char *identifier, std::size_t len);
+    bool binary_op(BinaryOpCode opcode);
+    bool unary_op(UnaryOpCode opcode);
+};
+
+/**
+    Evaluate a DAG, computing each node once.
+
+    An evaluator keeps its buffer between runs. It is _not_
+    thread-safe; use one instance per thread.
+*/
+class DagEvaluator
+{
+    std::vector<double>     _values;
+
+    const double* evaluate(const Dag& dag, const double* vars, const Function* fcts);
+
+    public:
+    /**
+        Evaluate all the roots of `dag` into `out`. `vars` and `fcts`
+        are indexed like the `variables` and `functions` tables.
+    */
+    void run(const Dag& dag, const double* vars, const Function* fcts, double* out);
+
+    /**
+        Evaluate the DAG of a single expression, or the last root
+        if there are several.
+    */
+    double run(const Dag& dag, const double* vars, const Function* fcts);
+};
+
+} /* namespace */
+
+#endif
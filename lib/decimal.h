@@ -0,0 +1,321 @@
+#if !defined LINLIB_DECIMAL_H
+#define LINLIB_DECIMAL_H
+
+#include <cstdint>
+
+#include "lib/pow5.h"
+
+namespace linlib {
+
+/*
+    Building blocks of the decimal to binary conversion. They are
+    constexpr, so the same code converts the literals of the runtime
+    parser (see parse_number) and of the compile-time one (see
+    static_compile).
+*/
+
+//========================================================================
+//  Decimal scanning
+//========================================================================
+/**
+    A decimal number w * 10^q, where w holds at most 19 significant
+    digits. `truncated` is set if non-zero digits were dropped from w.
+*/
+struct Decimal
+{
+    std::uint64_t   w;
+    long long       q;
+    bool            truncated;
+};
+
+static constexpr int        DECIMAL_MAX_DIGITS = 19;        // 10^19 < 2^64
+static constexpr long long  DECIMAL_MAX_EXPONENT = 1000000; // saturate exponents
+
+constexpr bool is_decimal_digit(char c)
+{
+    return static_cast<unsigned char>(c - '0') < 10;
+}
+
+/**
+    Scan the NUMBER token in [p, end).
+    Return false on syntax error.
+*/
+constexpr bool scan_decimal(const char* p, const char* end, Decimal& decimal)
+{
+    std::uint64_t   w = 0;
+    int             digits = 0;
+    long long       q = 0;
+    bool            truncated = false;
+    bool            empty = true;
+
+    for(; p < end && is_decimal_digit(*p); ++p)
+    {
+        const unsigned d = *p - '0';
+
+        empty = false;
+        if (digits < DECIMAL_MAX_DIGITS)
+        {
+            w = 10*w + d;
+            digits += (w != 0);
+        }
+        else
+        {
+            ++q;
+            truncated |= (d != 0);
+        }
+    }
+
+    if (p < end && *p == '.')
+    {
+        for(++p; p < end && is_decimal_digit(*p); ++p)
+        {
+            const unsigned d = *p - '0';
+
+            empty = false;
+            if (digits < DECIMAL_MAX_DIGITS)
+            {
+                w = 10*w + d;
+                digits += (w != 0);
+                --q;
+            }
+            else
+                truncated |= (d != 0);
+        }
+    }
+
+    if (empty)
+        return false;
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        bool        negative = false;
+        long long   exponent = 0;
+
+        if (++p < end && (*p == '+' || *p == '-'))
+            negative = (*p++ == '-');
+
+        if (p == end || !is_decimal_digit(*p))
+            return false;
+
+        for(; p < end && is_decimal_digit(*p); ++p)
+            if (exponent < DECIMAL_MAX_EXPONENT)
+                exponent = 10*exponent + (*p - '0');
+
+        q += negative ? -exponent : exponent;
+    }
+
+    if (p != end)
+        return false;
+
+    decimal = { w, q, truncated };
+    return true;
+}
+
+//========================================================================
+//  Clinger fast path
+//
+//  When both w and 10^q are exactly representable, a single IEEE
+//  multiplication or division is correctly rounded.
+//========================================================================
+struct ExactPowers
+{
+    static constexpr double values[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+};
+
+constexpr bool clinger(std::uint64_t w, long long q, double& value)
+{
+    if (w > (std::uint64_t(1) << 53) || q < -22 || q > 22)
+        return false;
+
+    const double d = static_cast<double>(w);
+    value = (q < 0) ? d / ExactPowers::values[-q] : d * ExactPowers::values[q];
+
+    return true;
+}
+
+//========================================================================
+//  Eisel-Lemire
+//
+//  See D. Lemire, "Number Parsing at a Gigabyte per Second",
+//  Software: Practice and Experience 51(8), 2021.
+//========================================================================
+static constexpr int        DOUBLE_MANTISSA_BITS = 52;
+static constexpr int        DOUBLE_MINIMUM_EXPONENT = -1023;
+static constexpr int        DOUBLE_INFINITE_POWER = 0x7FF;
+
+struct U128
+{
+    std::uint64_t   low;
+    std::uint64_t   high;
+};
+
+constexpr U128 multiply128(std::uint64_t a, std::uint64_t b)
+{
+    const unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+
+    return { static_cast<std::uint64_t>(r), static_cast<std::uint64_t>(r >> 64) };
+}
+
+/**
+    Return the 128 most significant bits of w * 5^q, w normalized.
+    The lower half of the table entry is only needed when the
+    truncated product may not hold enough correct bits.
+*/
+constexpr U128 pow5_product(long long q, std::uint64_t w)
+{
+    const int           index = 2*static_cast<int>(q - Pow5Table::SMALLEST_POWER);
+    const std::uint64_t mask = ~std::uint64_t(0) >> (DOUBLE_MANTISSA_BITS+3);
+
+    U128 first = multiply128(w, Pow5Table::values[index]);
+
+    if ((first.high & mask) == mask)
+    {
+        const U128 second = multiply128(w, Pow5Table::values[index+1]);
+
+        first.low += second.high;
+        if (second.high > first.low)
+            ++first.high;
+    }
+
+    return first;
+}
+
+/**
+    floor(log2(10^q)) + 63, for q in [-342, 308]
+*/
+constexpr int log2_pow10(int q)
+{
+    return (((152170 + 65536) * q) >> 16) + 63;
+}
+
+/**
+    Compute the IEEE binary64 representation of w * 10^q.
+    Return false if the result can't be decided.
+*/
+constexpr bool eisel_lemire(std::uint64_t w, long long q, std::uint64_t& bits)
+{
+    if (w == 0 || q < Pow5Table::SMALLEST_POWER)
+    {
+        bits = 0;
+        return true;
+    }
+
+    if (q > Pow5Table::LARGEST_POWER)
+    {
+        bits = std::uint64_t(DOUBLE_INFINITE_POWER) << DOUBLE_MANTISSA_BITS;
+        return true;
+    }
+
+    const int lz = __builtin_clzll(w);
+    w <<= lz;
+
+    const U128 p = pow5_product(q, w);
+
+    // Conservative: the product may be off by one in the last bit
+    if (p.low == ~std::uint64_t(0) && (q < -27 || q > 55))
+        return false;
+
+    const int       upperbit = static_cast<int>(p.high >> 63);
+    const int       shift = upperbit + 64 - DOUBLE_MANTISSA_BITS - 3;
+    std::uint64_t   mantissa = p.high >> shift;
+    int             power2 = log2_pow10(static_cast<int>(q)) + upperbit - lz - DOUBLE_MINIMUM_EXPONENT;
+
+    if (power2 <= 0)
+    {
+        // Subnormal
+        if (-power2 + 1 >= 64)
+        {
+            bits = 0;
+            return true;
+        }
+
+        mantissa >>= -power2 + 1;
+        mantissa += (mantissa & 1);
+        mantissa >>= 1;
+        power2 = (mantissa < (std::uint64_t(1) << DOUBLE_MANTISSA_BITS)) ? 0 : 1;
+
+        bits = (mantissa & ~(std::uint64_t(1) << DOUBLE_MANTISSA_BITS))
+               | (std::uint64_t(power2) << DOUBLE_MANTISSA_BITS);
+        return true;
+    }
+
+    // Exactly halfway between two floats: round to even
+    if (p.low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1
+        && (mantissa << shift) == p.high)
+        mantissa &= ~std::uint64_t(1);
+
+    mantissa += (mantissa & 1);
+    mantissa >>= 1;
+
+    if (mantissa >= (std::uint64_t(2) << DOUBLE_MANTISSA_BITS))
+    {
+        mantissa = std::uint64_t(1) << DOUBLE_MANTISSA_BITS;
+        ++power2;
+    }
+
+    mantissa &= ~(std::uint64_t(1) << DOUBLE_MANTISSA_BITS);
+
+    if (power2 >= DOUBLE_INFINITE_POWER)
+    {
+        power2 = DOUBLE_INFINITE_POWER;
+        mantissa = 0;
+    }
+
+    bits = mantissa | (std::uint64_t(power2) << DOUBLE_MANTISSA_BITS);
+    return true;
+}
+
+/**
+    Decide the IEEE binary64 representation of a scanned decimal without
+    the slow path. Return false for the rare inputs the fast algorithms
+    can't decide.
+*/
+constexpr bool decimal_to_bits(const Decimal& decimal, std::uint64_t& bits)
+{
+    if (!eisel_lemire(decimal.w, decimal.q, bits))
+        return false;
+
+    if (decimal.truncated)
+    {
+        // The exact value lies between w and w+1
+        std::uint64_t upper = 0;
+
+        return eisel_lemire(decimal.w+1, decimal.q, upper) && upper == bits;
+    }
+
+    return true;
+}
+
+/**
+    Build the double from its IEEE binary64 representation, using only
+    exact arithmetic. Much slower than a memcpy, but usable in constant
+    expressions. `bits` must encode a finite positive number.
+*/
+constexpr double bits_to_double(std::uint64_t bits)
+{
+    const std::uint64_t hidden = std::uint64_t(1) << DOUBLE_MANTISSA_BITS;
+    const int           exponent = static_cast<int>(bits >> DOUBLE_MANTISSA_BITS);
+    const std::uint64_t mantissa = bits & (hidden-1);
+
+    // value = significand * 2^scale, every step below is exact
+    double  value = static_cast<double>(exponent ? (mantissa | hidden) : mantissa);
+    int     scale = (exponent ? exponent : 1) - 1075;
+
+    for(; scale >= 32; scale -= 32)
+        value *= 4294967296.0;
+    for(; scale <= -32; scale += 32)
+        value /= 4294967296.0;
+    for(; scale > 0; --scale)
+        value *= 2;
+    for(; scale < 0; ++scale)
+        value /= 2;
+
+    return value;
+}
+
+} /* namespace */
+
+#endif
@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "lib/fused.h"
+
+namespace linlib {
+
+//========================================================================
+//  FusedProgram
+//========================================================================
+void FusedProgram::clear()
+{
+    steps.clear();
+    stores.clear();
+    constants.clear();
+    variables.clear();
+    functions.clear();
+    outputs = 0;
+    registers = 0;
+}
+
+//========================================================================
+//  Compiler
+//========================================================================
+static const std::uint32_t NONE = UINT32_MAX;
+
+static inline bool leaf(OpCode op)
+{
+    return op == OpCode::CONST || op == OpCode::LOAD;
+}
+
+static inline bool binary(OpCode op)
+{
+    return op >= OpCode::ADD && op <= OpCode::POW;
+}
+
+void compile(const Dag& dag, FusedProgram& program)
+{
+    program.clear();
+    program.constants = dag.constants;
+    program.variables = dag.variables;
+    program.functions = dag.functions;
+    program.outputs = dag.roots.size();
+
+    const std::size_t       count = dag.nodes.size();
+    const std::uint32_t     first_register = static_cast<std::uint32_t>(dag.variables.size() + dag.constants.size());
+
+    // Number the steps, and find the last one reading each node. The
+    // nodes are in topological order, so are the steps.
+    std::vector<std::uint32_t>  step(count, NONE);
+    std::vector<std::uint32_t>  last_use(count, NONE);
+    std::uint32_t               steps = 0;
+
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        const DagNode& node = dag.nodes[i];
+
+        if (leaf(node.op))
+            continue;
+
+        step[i] = steps++;
+        last_use[node.left] = step[i];
+        if (binary(node.op))
+            last_use[node.right] = step[i];
+    }
+
+    // Allocate the registers. The operands dying at a step are freed
+    // before its destination is allocated: the kernels allow aliasing.
+    std::vector<std::uint32_t>  operand(count);
+    std::vector<std::uint32_t>  available;
+
+    const auto release = [&](std::uint32_t node, std::uint32_t at) {
+        if (!leaf(dag.nodes[node].op) && last_use[node] == at)
+            available.push_back(operand[node] - first_register);
+    };
+
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        const DagNode& node = dag.nodes[i];
+
+        switch(node.op)
+        {
+            case OpCode::CONST:
+                operand[i] = static_cast<std::uint32_t>(dag.variables.size()) + node.arg;
+                continue;
+            case OpCode::LOAD:
+                operand[i] = node.arg;
+                continue;
+            default:
+                break;
+        }
+
+        FusedProgram::Step s = { node.op, node.arg, 0, operand[node.left], 0 };
+
+        release(node.left, step[i]);
+        if (binary(node.op))
+        {
+            s.rhs = operand[node.right];
+            if (node.right != node.left)
+                release(node.right, step[i]);
+        }
+
+        if (available.empty())
+        {
+            s.dst = static_cast<std::uint32_t>(program.registers++);
+        }
+        else
+        {
+            s.dst = available.back();
+            available.pop_back();
+        }
+        operand[i] = first_register + s.dst;
+        program.steps.push_back(s);
+
+        // Only an output: the register is free once stored
+        if (last_use[i] == NONE)
+            available.push_back(s.dst);
+    }
+
+    // Store each output right after the step computing it
+    for(std::size_t k = 0; k < dag.roots.size(); ++k)
+    {
+        const std::uint32_t root = dag.roots[k];
+        const std::uint32_t after = (step[root] == NONE) ? 0 : step[root]+1;
+
+        program.stores.push_back({ after, operand[root], static_cast<std::uint32_t>(k) });
+    }
+
+    std::stable_sort(program.stores.begin(), program.stores.end(),
+        [](const FusedProgram::Store& a, const FusedProgram::Store& b) { return a.step < b.step; });
+}
+
+bool compile(const std::vector<std::string>& expressions, FusedProgram& program)
+{
+    Dag         dag;
+    DagBuilder  builder{dag};
+
+    program.clear();
+    for(const std::string& expression : expressions)
+    {
+        Parser parser{expression.c_str(), builder};
+
+        if (!parser.parse())
+            return false;
+    }
+
+    compile(dag, program);
+    return true;
+}
+
+//========================================================================
+//  FusedEvaluator
+//========================================================================
+const std::size_t FusedEvaluator::BLOCK_SIZE;
+
+void FusedEvaluator::run(const FusedProgram& program,
+                         const double* const* columns,
+                         const Function* fcts,
+                         double* const* outputs,
+                         std::size_t rows)
+{
+    const std::size_t   nvars = program.variables.size();
+    const std::size_t   nconsts = program.constants.size();
+
+    _scratch.resize((nconsts + program.registers)*BLOCK_SIZE);
+    _operands.resize(program.operand_count());
+
+    // The constants are broadcast once per run, the registers never move
+    double* const registers = _scratch.data() + nconsts*BLOCK_SIZE;
+
+    for(std::size_t c = 0; c < nconsts; ++c)
+    {
+        std::fill_n(_scratch.data() + c*BLOCK_SIZE, BLOCK_SIZE, program.constants[c]);
+        _operands[nvars + c] = _scratch.data() + c*BLOCK_SIZE;
+    }
+    for(std::size_t r = 0; r < program.registers; ++r)
+        _operands[nvars + nconsts + r] = registers + r*BLOCK_SIZE;
+
+    const double** const                    operands = _operands.data();
+    const FusedProgram::Store* const        stores_end = program.stores.data() + program.stores.size();
+
+    for(std::size_t base = 0; base < rows; base += BLOCK_SIZE)
+    {
+        const std::size_t n = std::min(BLOCK_SIZE, rows-base);
+
+        // Variables are read in place from their columns
+        for(std::size_t v = 0; v < nvars; ++v)
+            operands[v] = columns[v] + base;
+
+        const FusedProgram::Store* store = program.stores.data();
+        for(; store != stores_end && store->step == 0; ++store)
+            std::memcpy(outputs[store->output] + base, operands[store->operand], n*sizeof(double));
+
+        for(std::size_t i = 0; i < program.steps.size(); ++i)
+        {
+            const FusedProgram::Step&   step = program.steps[i];
+            double* const               dst = registers + step.dst*BLOCK_SIZE;
+            const double* const         a = operands[step.lhs];
+            const double* const         b = operands[step.rhs];
+
+            switch(step.op)
+            {
+                case OpCode::CALL:
+                    {
+                        const Function fct = fcts[step.arg];
+
+                        for(std::size_t j = 0; j < n; ++j)
+                            dst[j] = fct(a[j]);
+                    }
+                    break;
+                case OpCode::NEG:
+                    _kernels.neg(dst, a, n);
+                    break;
+                case OpCode::ADD:
+                    _kernels.add(dst, a, b, n);
+                    break;
+                case OpCode::SUB:
+                    _kernels.sub(dst, a, b, n);
+                    break;
+                case OpCode::MUL:
+                    _kernels.mul(dst, a, b, n);
+                    break;
+                case OpCode::DIV:
+                    _kernels.div(dst, a, b, n);
+                    break;
+                case OpCode::POW:
+                    for(std::size_t j = 0; j < n; ++j)
+                        dst[j] = std::pow(a[j], b[j]);
+                    break;
+                default:
+                    break;
+            };
+
+            for(; store != stores_end && store->step == i+1; ++store)
+                std::memcpy(outputs[store->output] + base, operands[store->operand], n*sizeof(double));
+        }
+    }
+}
+
+} /* namespace */
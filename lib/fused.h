@@ -0,0 +1,122 @@
+#if !defined LINLIB_FUSED_H
+#define LINLIB_FUSED_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "lib/dag.h"
+#include "lib/kernels.h"
+#include "lib/program.h"
+
+namespace linlib {
+
+/**
+    A set of expressions compiled into a single program with several
+    outputs.
+
+    The program is built from the DAG of the expressions, so each shared
+    subexpression is computed once. Operands are numbered in a single
+    space: the variables first, then the constants, then the registers
+    holding the computed values. Registers are reused as soon as their
+    value is dead, so their count is the width of the DAG, not its size.
+*/
+struct FusedProgram
+{
+    /**
+        Compute `op` into register `dst`. CALL uses `arg` to index the
+        function table, and `lhs` for its argument. NEG only uses `lhs`.
+    */
+    struct Step
+    {
+        OpCode          op;
+        std::uint32_t   arg;
+        std::uint32_t   dst;
+        std::uint32_t   lhs;
+        std::uint32_t   rhs;
+    };
+
+    /**
+        Copy `operand` to `output` once the first `step` steps are done.
+    */
+    struct Store
+    {
+        std::uint32_t   step;
+        std::uint32_t   operand;
+        std::uint32_t   output;
+    };
+
+    std::vector<Step>           steps;
+    std::vector<Store>          stores;     // ordered by step
+    std::vector<double>         constants;
+
+    SymbolTable                 variables;
+    SymbolTable                 functions;
+
+    std::size_t                 outputs = 0;
+    std::size_t                 registers = 0;
+
+    inline std::size_t operand_count() const { return variables.size() + constants.size() + registers; }
+
+    void clear();
+};
+
+/**
+    Compile the roots of `dag` into `program`, one output per root.
+*/
+void compile(const Dag& dag, FusedProgram& program);
+
+/**
+    Parse the expressions and compile them into `program`, one output
+    per expression. Return false if any of them fails to parse.
+*/
+bool compile(const std::vector<std::string>& expressions, FusedProgram& program);
+
+/**
+    Evaluate fused programs over columns of values.
+
+    Like the BatchEvaluator, rows are processed in blocks and each step
+    runs as a vectorized kernel over the block. All the outputs of a
+    block are written before moving to the next one, so the input
+    columns are read once whatever the number of outputs, and the
+    intermediate values never leave the cache.
+
+    An evaluator keeps its scratch buffers between runs. It is _not_
+    thread-safe; use one instance per thread.
+*/
+class FusedEvaluator
+{
+    const Kernels&              _kernels;
+    std::vector<double>         _scratch;
+    std::vector<const double*>  _operands;
+
+    public:
+    static const std::size_t BLOCK_SIZE = 256;
+
+    /**
+        Use the best instruction set supported by the host.
+    */
+    FusedEvaluator() : _kernels(kernels()) {}
+
+    /**
+        Use the given kernels.
+    */
+    FusedEvaluator(const Kernels& kernels) : _kernels(kernels) {}
+
+    inline Isa isa() const { return _kernels.isa; }
+
+    /**
+        Evaluate `program` for `rows` rows. `columns[i]` points to the
+        values of `program.variables[i]`; `fcts` is indexed like
+        `program.functions`. Output `i` is written to `outputs[i]`.
+    */
+    void run(const FusedProgram& program,
+             const double* const* columns,
+             const Function* fcts,
+             double* const* outputs,
+             std::size_t rows);
+};
+
+} /* namespace */
+
+#endif
@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <cmath>
+
+#include "lib/gradient.h"
+
+namespace linlib {
+
+//========================================================================
+//  GradientProgram
+//========================================================================
+void GradientProgram::clear()
+{
+    steps.clear();
+    constants.clear();
+    variables.clear();
+    functions.clear();
+}
+
+//========================================================================
+//  GradientCompiler
+//========================================================================
+bool GradientCompiler::emit(OpCode op, std::uint32_t arg, int operands)
+{
+    GradientProgram::Step step = { op, arg, 0, 0 };
+
+    if (_stack.size() < static_cast<std::size_t>(operands))
+        return false;
+
+    if (operands == 2)
+    {
+        step.rhs = _stack.back(); _stack.pop_back();
+    }
+    if (operands >= 1)
+    {
+        step.lhs = _stack.back(); _stack.pop_back();
+    }
+
+    _stack.push_back(static_cast<std::uint32_t>(_program.steps.size()));
+    _program.steps.push_back(step);
+
+    return true;
+}
+
+bool GradientCompiler::number(double value)
+{
+    _program.constants.push_back(value);
+    return emit(OpCode::CONST, static_cast<std::uint32_t>(_program.constants.size()-1), 0);
+}
+
+bool GradientCompiler::call(const char *identifier, std::size_t len)
+{
+    return emit(OpCode::CALL, _program.functions.intern(identifier, len), 1);
+}
+
+bool GradientCompiler::load(const char *identifier, std::size_t len)
+{
+    return emit(OpCode::LOAD, _program.variables.intern(identifier, len), 0);
+}
+
+bool GradientCompiler::unary_op(UnaryOpCode opcode)
+{
+    switch(opcode)
+    {
+        case UnaryOpCode::NEG:
+            return emit(OpCode::NEG, 0, 1);
+    };
+
+    return false;
+}
+
+bool GradientCompiler::binary_op(BinaryOpCode opcode)
+{
+    switch(opcode)
+    {
+        case BinaryOpCode::ADD:
+            return emit(OpCode::ADD, 0, 2);
+        case BinaryOpCode::SUB:
+            return emit(OpCode::SUB, 0, 2);
+        case BinaryOpCode::MUL:
+            return emit(OpCode::MUL, 0, 2);
+        case BinaryOpCode::DIV:
+            return emit(OpCode::DIV, 0, 2);
+        case BinaryOpCode::POW:
+            return emit(OpCode::POW, 0, 2);
+    };
+
+    return false;
+}
+
+bool compile(const char* expr, GradientProgram& program)
+{
+    program.clear();
+
+    GradientCompiler    compiler{program};
+    Parser              parser{expr, compiler};
+
+    return parser.parse();
+}
+
+//========================================================================
+//  Partial derivatives
+//========================================================================
+namespace {
+
+/**
+    Compute the value of a step and its partial derivatives with respect
+    to its operands. The derivative of `a**b` with respect to a constant
+    exponent is never used, so its logarithm is not computed.
+*/
+inline double step(const GradientProgram& program, const GradientProgram::Step& s,
+                   const double* values, const double* vars, const DerivableFunction* fcts,
+                   double& da, double& db)
+{
+    const double    a = values[s.lhs];
+    const double    b = values[s.rhs];
+    double          v = 0.0;
+
+    da = db = 0.0;
+    switch(s.op)
+    {
+        case OpCode::CONST:
+            v = program.constants[s.arg];
+            break;
+        case OpCode::LOAD:
+            v = vars[s.arg];
+            break;
+        case OpCode::CALL:
+            v = fcts[s.arg].f(a);
+            da = fcts[s.arg].df(a);
+            break;
+        case OpCode::NEG:
+            v = -a;
+            da = -1.0;
+            break;
+        case OpCode::ADD:
+            v = a + b;
+            da = 1.0; db = 1.0;
+            break;
+        case OpCode::SUB:
+            v = a - b;
+            da = 1.0; db = -1.0;
+            break;
+        case OpCode::MUL:
+            v = a * b;
+            da = b; db = a;
+            break;
+        case OpCode::DIV:
+            v = a / b;
+            da = 1.0 / b; db = -v / b;
+            break;
+        case OpCode::POW:
+            v = std::pow(a, b);
+            da = b * std::pow(a, b - 1.0);
+            if (program.steps[s.rhs].op != OpCode::CONST)
+                db = (a == 0.0) ? 0.0 : v * std::log(a);
+            break;
+        default:
+            // POWI and SQRT are only emitted by the Optimizer
+            break;
+    };
+
+    return v;
+}
+
+/**
+    Contribution of an operand to a tangent. An operand that does not
+    depend on the variable contributes nothing, even through an infinite
+    or NaN partial, like `log(a)` for a negative constant base of `a**b`:
+    the reverse mode never propagates to it either.
+*/
+inline double chain(double partial, double tangent)
+{
+    return (tangent == 0.0) ? 0.0 : partial*tangent;
+}
+
+inline bool leaf(OpCode op)
+{
+    return op == OpCode::CONST || op == OpCode::LOAD;
+}
+
+inline bool binary(OpCode op)
+{
+    return op >= OpCode::ADD && op <= OpCode::POW;
+}
+
+double d_sqrt(double x) { return 0.5 / std::sqrt(x); }
+double d_exp(double x) { return std::exp(x); }
+double d_log(double x) { return 1.0 / x; }
+double d_sin(double x) { return std::cos(x); }
+double d_cos(double x) { return -std::sin(x); }
+double d_tan(double x) { const double t = std::tan(x); return 1.0 + t*t; }
+double d_abs(double x) { return (x > 0.0) ? 1.0 : (x < 0.0) ? -1.0 : 0.0; }
+
+} /* namespace */
+
+const DerivableFunction* standard_function(const std::string& name)
+{
+    static const char* const        names[] = { "sqrt", "exp", "log", "sin", "cos", "tan", "abs" };
+    static const DerivableFunction  fcts[] = {
+        { library_function("sqrt"), d_sqrt }, { library_function("exp"), d_exp },
+        { library_function("log"), d_log }, { library_function("sin"), d_sin },
+        { library_function("cos"), d_cos }, { library_function("tan"), d_tan },
+        { library_function("abs"), d_abs },
+    };
+
+    for(std::size_t i = 0; i < sizeof(names)/sizeof(names[0]); ++i)
+        if (name == names[i])
+            return &fcts[i];
+
+    return nullptr;
+}
+
+//========================================================================
+//  GradientMachine
+//========================================================================
+const std::size_t GradientMachine::FORWARD_MAX_VARIABLES;
+
+double GradientMachine::forward(const GradientProgram& program, const double* vars,
+                                const DerivableFunction* fcts, double* gradient)
+{
+    const std::size_t   n = program.variables.size();
+    const std::size_t   count = program.steps.size();
+
+    _values.resize(count);
+    _derivatives.resize(count*n);
+
+    double* const   values = _values.data();
+    double* const   tangents = _derivatives.data();
+
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        const GradientProgram::Step&    s = program.steps[i];
+        double* const                   t = tangents + i*n;
+        double                          da, db;
+
+        values[i] = step(program, s, values, vars, fcts, da, db);
+
+        if (leaf(s.op))
+        {
+            std::fill(t, t+n, 0.0);
+            if (s.op == OpCode::LOAD)
+                t[s.arg] = 1.0;
+        }
+        else if (binary(s.op))
+        {
+            const double* const ta = tangents + s.lhs*n;
+            const double* const tb = tangents + s.rhs*n;
+
+            for(std::size_t j = 0; j < n; ++j)
+                t[j] = chain(da, ta[j]) + chain(db, tb[j]);
+        }
+        else
+        {
+            const double* const ta = tangents + s.lhs*n;
+
+            for(std::size_t j = 0; j < n; ++j)
+                t[j] = chain(da, ta[j]);
+        }
+    }
+
+    std::copy(tangents + (count-1)*n, tangents + count*n, gradient);
+    return values[count-1];
+}
+
+double GradientMachine::reverse(const GradientProgram& program, const double* vars,
+                                const DerivableFunction* fcts, double* gradient)
+{
+    const std::size_t   count = program.steps.size();
+
+    _values.resize(count);
+    _partials.resize(2*count);
+    _derivatives.assign(count, 0.0);
+
+    double* const   values = _values.data();
+    double* const   partials = _partials.data();
+    double* const   adjoints = _derivatives.data();
+
+    for(std::size_t i = 0; i < count; ++i)
+        values[i] = step(program, program.steps[i], values, vars, fcts, partials[2*i], partials[2*i+1]);
+
+    std::fill(gradient, gradient+program.variables.size(), 0.0);
+    adjoints[count-1] = 1.0;
+
+    for(std::size_t i = count; i-- > 0; )
+    {
+        const GradientProgram::Step&    s = program.steps[i];
+        const double                    adjoint = adjoints[i];
+
+        if (s.op == OpCode::LOAD)
+        {
+            gradient[s.arg] += adjoint;
+        }
+        else if (!leaf(s.op))
+        {
+            adjoints[s.lhs] += partials[2*i]*adjoint;
+            if (binary(s.op))
+                adjoints[s.rhs] += partials[2*i+1]*adjoint;
+        }
+    }
+
+    return values[count-1];
+}
+
+double GradientMachine::run(const GradientProgram& program, const double* vars, const DerivableFunction* fcts,
+                            double* gradient, Mode mode)
+{
+    if (mode == AUTO)
+        mode = (program.variables.size() <= FORWARD_MAX_VARIABLES) ? FORWARD : REVERSE;
+
+    if (mode == FORWARD)
+        return forward(program, vars, fcts, gradient);
+
+    return reverse(program, vars, fcts, gradient);
+}
+
+} /* namespace */
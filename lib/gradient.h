@@ -0,0 +1,134 @@
+#if !defined LINLIB_GRADIENT_H
+#define LINLIB_GRADIENT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "lib/parser.h"
+#include "lib/program.h"
+
+namespace linlib {
+
+/**
+    A function and its derivative, bound to a CALL of a gradient program.
+*/
+struct DerivableFunction
+{
+    Function        f;
+    Function        df;
+};
+
+/**
+    An expression compiled for automatic differentiation.
+
+    The code is a list of steps in evaluation order, each one reading
+    its operands from the results of earlier steps. Unlike the stack
+    code of a Program, the results stay addressable after use, so the
+    list doubles as the tape of the reverse mode.
+*/
+struct GradientProgram
+{
+    /**
+        Leaves (CONST and LOAD) use `arg` to index the constant or
+        variable table. CALL uses `arg` to index the function table,
+        and `lhs` for its argument. NEG only uses `lhs`.
+    */
+    struct Step
+    {
+        OpCode          op;
+        std::uint32_t   arg;
+        std::uint32_t   lhs;
+        std::uint32_t   rhs;
+    };
+
+    std::vector<Step>           steps;
+    std::vector<double>         constants;
+
+    SymbolTable                 variables;
+    SymbolTable                 functions;
+
+    void clear();
+};
+
+/**
+    An event handler recording the event stream into a GradientProgram.
+    Replay a Program to differentiate an already compiled expression.
+*/
+class GradientCompiler : public EventHandler
+{
+    GradientProgram&            _program;
+    std::vector<std::uint32_t>  _stack;
+
+    bool emit(OpCode op, std::uint32_t arg, int operands);
+
+    public:
+    GradientCompiler(GradientProgram& program) : _program(program) {}
+
+    bool number(double value);
+    bool call(const char *identifier, std::size_t len);
+    bool load(const char *identifier, std::size_t len);
+    bool binary_op(BinaryOpCode opcode);
+    bool unary_op(UnaryOpCode opcode);
+};
+
+/**
+    Evaluate gradient programs.
+
+    The FORWARD mode carries the derivatives with respect to every
+    variable along with each value, so its cost grows with the number
+    of variables. The REVERSE mode computes all the values, then sweeps
+    the steps backward once to accumulate the adjoints: the gradient
+    costs about three evaluations whatever the number of variables.
+    AUTO picks FORWARD up to FORWARD_MAX_VARIABLES variables.
+
+    The machine keeps its buffers between runs. A machine is _not_
+    thread-safe; use one instance per thread.
+*/
+class GradientMachine
+{
+    public:
+    enum Mode
+    {
+        AUTO,
+        FORWARD,
+        REVERSE,
+    };
+
+    static const std::size_t FORWARD_MAX_VARIABLES = 2;
+
+    private:
+    std::vector<double>     _values;
+    std::vector<double>     _partials;      // reverse mode: with respect to lhs and rhs
+    std::vector<double>     _derivatives;   // forward mode: tangents, reverse mode: adjoints
+
+    double forward(const GradientProgram& program, const double* vars, const DerivableFunction* fcts,
+                   double* gradient);
+    double reverse(const GradientProgram& program, const double* vars, const DerivableFunction* fcts,
+                   double* gradient);
+
+    public:
+    /**
+        Return the value of the program, and store its partial
+        derivatives into `gradient`. `vars`, `fcts` and `gradient` are
+        indexed like the `variables` and `functions` tables.
+    */
+    double run(const GradientProgram& program, const double* vars, const DerivableFunction* fcts,
+               double* gradient, Mode mode = AUTO);
+};
+
+/**
+    Parse `expr` and compile it into `program`.
+    Return true on success.
+*/
+bool compile(const char* expr, GradientProgram& program);
+
+/**
+    Return the library_function() with the given name and its
+    derivative, or nullptr.
+*/
+const DerivableFunction* standard_function(const std::string& name);
+
+} /* namespace */
+
+#endif
@@ -0,0 +1,554 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#include "lib/image.h"
+
+#if defined(__unix__)
+#define LINLIB_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace linlib {
+
+//========================================================================
+//  Layout
+//========================================================================
+namespace {
+
+const char MAGIC[8] = { 'L', 'I', 'N', 'L', 'I', 'B', 'P', 'I' };
+
+const std::uint32_t SHARED_SYMBOLS = 1;     // record flags
+
+struct Header
+{
+    char            magic[8];
+    std::uint32_t   version;
+    std::uint32_t   count;
+    std::uint64_t   file_size;
+
+    std::uint64_t   directory;
+    std::uint64_t   index;
+    std::uint64_t   code;
+    std::uint64_t   code_count;
+    std::uint64_t   constants;
+    std::uint64_t   constant_count;
+    std::uint64_t   symbols;
+    std::uint64_t   symbol_count;
+    std::uint64_t   strings;
+    std::uint64_t   strings_size;
+};
+
+static_assert(sizeof(Header) == 104, "no padding in the header");
+static_assert(sizeof(Instruction) == 8, "the code is mapped in place");
+
+bool little_endian()
+{
+    const std::uint32_t one = 1;
+    char                first;
+
+    std::memcpy(&first, &one, 1);
+    return first == 1;
+}
+
+//------------------------------------------------------------------------
+//  Little-endian output
+//------------------------------------------------------------------------
+void put32(std::string& out, std::uint32_t value)
+{
+    for(int i = 0; i < 4; ++i)
+        out.push_back(static_cast<char>(value >> (8*i)));
+}
+
+void put64(std::string& out, std::uint64_t value)
+{
+    for(int i = 0; i < 8; ++i)
+        out.push_back(static_cast<char>(value >> (8*i)));
+}
+
+void align(std::string& out)
+{
+    while(out.size() % 8)
+        out.push_back('\0');
+}
+
+/**
+    The string pool of an image. Identical strings are stored once.
+*/
+class Strings
+{
+    std::string                                         _data;
+    std::unordered_map<std::string, std::uint32_t>      _offsets;
+
+    public:
+    std::uint32_t add(const std::string& str)
+    {
+        auto it = _offsets.find(str);
+        if (it != _offsets.end())
+            return it->second;
+
+        const std::uint32_t offset = static_cast<std::uint32_t>(_data.size());
+        _data.append(str);
+        _data.push_back('\0');
+        _offsets.emplace(str, offset);
+
+        return offset;
+    }
+
+    inline const std::string& data() const { return _data; }
+};
+
+} /* namespace */
+
+struct ProgramImage::Record
+{
+    std::uint32_t   name;
+    std::uint32_t   name_length;
+    std::uint32_t   source;
+    std::uint32_t   source_length;
+
+    std::uint32_t   code;
+    std::uint32_t   code_size;
+    std::uint32_t   constants;
+    std::uint32_t   constant_count;
+    std::uint32_t   variables;
+    std::uint32_t   variable_count;
+    std::uint32_t   functions;
+    std::uint32_t   function_count;
+
+    std::uint32_t   max_depth;
+    std::uint32_t   flags;
+};
+
+//========================================================================
+//  ImageWriter
+//========================================================================
+void ImageWriter::add(const std::string& name, const Program& program, const std::string& source)
+{
+    _entries.push_back({ name, source, program });
+}
+
+std::string ImageWriter::data() const
+{
+    Strings                     strings;
+    std::vector<std::uint32_t>  symbols;    // offset and length pairs
+    std::string                 directory;
+    std::string                 code;
+    std::string                 constants;
+    std::uint64_t               code_count = 0;
+    std::uint64_t               constant_count = 0;
+
+    const auto add_symbols = [&](const SymbolTable& table) {
+        for(const std::string& symbol : table)
+        {
+            symbols.push_back(strings.add(symbol));
+            symbols.push_back(static_cast<std::uint32_t>(symbol.size()));
+        }
+    };
+
+    for(const Entry& entry : _entries)
+    {
+        const Program& program = entry.program;
+
+        put32(directory, strings.add(entry.name));
+        put32(directory, static_cast<std::uint32_t>(entry.name.size()));
+        put32(directory, strings.add(entry.source));
+        put32(directory, static_cast<std::uint32_t>(entry.source.size()));
+
+        put32(directory, static_cast<std::uint32_t>(code_count));
+        put32(directory, static_cast<std::uint32_t>(program.code.size()));
+        put32(directory, static_cast<std::uint32_t>(constant_count));
+        put32(directory, static_cast<std::uint32_t>(program.constants.size()));
+        put32(directory, static_cast<std::uint32_t>(symbols.size()/2));
+        put32(directory, static_cast<std::uint32_t>(program.variables.size()));
+        add_symbols(program.variables);
+        put32(directory, static_cast<std::uint32_t>(symbols.size()/2));
+        put32(directory, static_cast<std::uint32_t>(program.functions.size()));
+        add_symbols(program.functions);
+
+        put32(directory, static_cast<std::uint32_t>(program.max_depth));
+        put32(directory, program.shared_symbols ? SHARED_SYMBOLS : 0);
+
+        for(const Instruction& insn : program.code)
+        {
+            put32(code, static_cast<std::uint32_t>(insn.op));
+            put32(code, insn.arg);
+        }
+        for(double constant : program.constants)
+        {
+            std::uint64_t bits;
+            std::memcpy(&bits, &constant, sizeof(bits));
+            put64(constants, bits);
+        }
+
+        code_count += program.code.size();
+        constant_count += program.constants.size();
+    }
+
+    std::vector<std::uint32_t> index(_entries.size());
+    for(std::size_t i = 0; i < index.size(); ++i)
+        index[i] = static_cast<std::uint32_t>(i);
+    std::stable_sort(index.begin(), index.end(), [this](std::uint32_t a, std::uint32_t b) {
+        return _entries[a].name < _entries[b].name;
+    });
+
+    // Lay out the sections after the header
+    std::string body;
+
+    const std::uint64_t directory_offset = sizeof(Header) + body.size();
+    body += directory;
+    align(body);
+
+    const std::uint64_t index_offset = sizeof(Header) + body.size();
+    for(std::uint32_t i : index)
+        put32(body, i);
+    align(body);
+
+    const std::uint64_t code_offset = sizeof(Header) + body.size();
+    body += code;
+
+    const std::uint64_t constants_offset = sizeof(Header) + body.size();
+    body += constants;
+
+    const std::uint64_t symbols_offset = sizeof(Header) + body.size();
+    for(std::uint32_t value : symbols)
+        put32(body, value);
+    align(body);
+
+    const std::uint64_t strings_offset = sizeof(Header) + body.size();
+    body += strings.data();
+    align(body);
+
+    std::string out;
+    out.append(MAGIC, sizeof(MAGIC));
+    put32(out, ProgramImage::VERSION);
+    put32(out, static_cast<std::uint32_t>(_entries.size()));
+    put64(out, sizeof(Header) + body.size());
+    put64(out, directory_offset);
+    put64(out, index_offset);
+    put64(out, code_offset);
+    put64(out, code_count);
+    put64(out, constants_offset);
+    put64(out, constant_count);
+    put64(out, symbols_offset);
+    put64(out, symbols.size()/2);
+    put64(out, strings_offset);
+    put64(out, strings.data().size());
+
+    return out + body;
+}
+
+bool ImageWriter::write(const std::string& path) const
+{
+    const std::string   image = data();
+    std::ofstream       out(path, std::ios::binary | std::ios::trunc);
+
+    out.write(image.data(), image.size());
+    out.close();
+
+    return !out.fail();
+}
+
+//========================================================================
+//  ProgramImage
+//========================================================================
+const std::uint32_t ProgramImage::VERSION;
+const std::size_t ProgramImage::NOT_FOUND;
+
+ProgramImage::ProgramImage()
+  : _data(nullptr), _size(0), _map(nullptr),
+    _directory(nullptr), _index(nullptr), _count(0),
+    _code(nullptr), _constants(nullptr), _symbols(nullptr), _strings(nullptr)
+{
+}
+
+ProgramImage::~ProgramImage()
+{
+    close();
+}
+
+void ProgramImage::close()
+{
+#if defined LINLIB_MMAP
+    if (_map)
+        munmap(_map, _size);
+#endif
+    _map = nullptr;
+    _buffer.clear();
+
+    _data = nullptr;
+    _size = 0;
+    _count = 0;
+}
+
+ImageStatus ProgramImage::open(const std::string& path)
+{
+    close();
+
+#if defined LINLIB_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return ImageStatus::IO_ERROR;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return ImageStatus::IO_ERROR;
+    }
+    if (st.st_size == 0)
+    {
+        ::close(fd);
+        return ImageStatus::BAD_FORMAT;
+    }
+
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+        return ImageStatus::IO_ERROR;
+
+    _map = map;
+    _size = st.st_size;
+    const ImageStatus status = attach(static_cast<const char*>(map), st.st_size);
+#else
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in)
+        return ImageStatus::IO_ERROR;
+
+    const std::size_t size = in.tellg();
+    _buffer.resize((size+7)/8);
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char*>(_buffer.data()), size))
+        return ImageStatus::IO_ERROR;
+
+    const ImageStatus status = attach(reinterpret_cast<const char*>(_buffer.data()), size);
+#endif
+
+    if (status != ImageStatus::OK)
+        close();
+
+    return status;
+}
+
+ImageStatus ProgramImage::open(const void* data, std::size_t size)
+{
+    close();
+
+    const ImageStatus status = attach(static_cast<const char*>(data), size);
+    if (status != ImageStatus::OK)
+        close();
+
+    return status;
+}
+
+ImageStatus ProgramImage::attach(const char* data, std::size_t size)
+{
+    static_assert(sizeof(Record) == 56, "no padding in the records");
+
+    Header header;
+
+    if (size < sizeof(header) || reinterpret_cast<std::uintptr_t>(data) % 8)
+        return ImageStatus::BAD_FORMAT;
+
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+        return ImageStatus::BAD_FORMAT;
+    if (!little_endian())
+        return ImageStatus::UNSUPPORTED_HOST;
+    if (header.version != VERSION)
+        return ImageStatus::BAD_VERSION;
+
+    // Every section must be aligned and inside of the file
+    const auto section = [&](std::uint64_t offset, std::uint64_t count, std::uint64_t item) {
+        return offset % 8 == 0 && offset <= size && count <= (size - offset)/item;
+    };
+
+    if (header.file_size != size
+        || !section(header.directory, header.count, sizeof(Record))
+        || !section(header.index, header.count, sizeof(std::uint32_t))
+        || !section(header.code, header.code_count, sizeof(Instruction))
+        || !section(header.constants, header.constant_count, sizeof(double))
+        || !section(header.symbols, header.symbol_count, 2*sizeof(std::uint32_t))
+        || !section(header.strings, header.strings_size, 1))
+        return ImageStatus::BAD_FORMAT;
+
+    _data = data;
+    _size = size;
+    _count = header.count;
+    _directory = reinterpret_cast<const Record*>(data + header.directory);
+    _index = reinterpret_cast<const std::uint32_t*>(data + header.index);
+    _code = reinterpret_cast<const Instruction*>(data + header.code);
+    _constants = reinterpret_cast<const double*>(data + header.constants);
+    _symbols = reinterpret_cast<const std::uint32_t*>(data + header.symbols);
+    _strings = data + header.strings;
+
+    // Every range of the directory must be inside of its section, and
+    // every string NUL-terminated, so the accessors never check again.
+    const auto range = [](std::uint64_t begin, std::uint64_t count, std::uint64_t size) {
+        return begin <= size && count <= size - begin;
+    };
+    const auto string = [&](std::uint32_t offset, std::uint32_t length) {
+        return range(offset, length + std::uint64_t(1), header.strings_size) && _strings[offset+length] == '\0';
+    };
+
+    for(std::size_t i = 0; i < _count; ++i)
+    {
+        const Record& r = _directory[i];
+
+        if (!string(r.name, r.name_length) || !string(r.source, r.source_length)
+            || !range(r.code, r.code_size, header.code_count)
+            || !range(r.constants, r.constant_count, header.constant_count)
+            || !range(r.variables, r.variable_count, header.symbol_count)
+            || !range(r.functions, r.function_count, header.symbol_count)
+            || _index[i] >= _count)
+            return ImageStatus::BAD_FORMAT;
+    }
+
+    for(std::size_t i = 0; i < header.symbol_count; ++i)
+        if (!string(_symbols[2*i], _symbols[2*i+1]))
+            return ImageStatus::BAD_FORMAT;
+
+    return ImageStatus::OK;
+}
+
+const char* ProgramImage::string(std::uint32_t symbol) const
+{
+    return _strings + _symbols[2*symbol];
+}
+
+std::size_t ProgramImage::find(const std::string& name) const
+{
+    const std::uint32_t* const  end = _index + _count;
+    const std::uint32_t*        it = std::lower_bound(_index, end, name, [this](std::uint32_t program, const std::string& name) {
+        return std::strcmp(this->name(program), name.c_str()) < 0;
+    });
+
+    return (it != end && name == this->name(*it)) ? *it : NOT_FOUND;
+}
+
+const char* ProgramImage::name(std::size_t program) const
+{
+    return _strings + _directory[program].name;
+}
+
+const char* ProgramImage::source(std::size_t program) const
+{
+    return _strings + _directory[program].source;
+}
+
+bool ProgramImage::shared_symbols(std::size_t program) const
+{
+    return _directory[program].flags & SHARED_SYMBOLS;
+}
+
+std::size_t ProgramImage::variable_count(std::size_t program) const
+{
+    return _directory[program].variable_count;
+}
+
+const char* ProgramImage::variable(std::size_t program, std::size_t slot) const
+{
+    return string(_directory[program].variables + slot);
+}
+
+std::size_t ProgramImage::function_count(std::size_t program) const
+{
+    return _directory[program].function_count;
+}
+
+const char* ProgramImage::function(std::size_t program, std::size_t slot) const
+{
+    return string(_directory[program].functions + slot);
+}
+
+ProgramView ProgramImage::view(std::size_t program) const
+{
+    const Record&   r = _directory[program];
+    ProgramView     view;
+
+    view.code = _code + r.code;
+    view.code_size = r.code_size;
+    view.constants = _constants + r.constants;
+    view.max_depth = r.max_depth;
+
+    return view;
+}
+
+bool ProgramImage::verify(std::size_t program) const
+{
+    const Record&   r = _directory[program];
+    std::size_t     depth = 0;
+
+    for(const Instruction* insn = _code + r.code; insn != _code + r.code + r.code_size; ++insn)
+    {
+        switch(insn->op)
+        {
+            case OpCode::CONST:
+            case OpCode::LOAD:
+                if (insn->arg >= (insn->op == OpCode::CONST ? r.constant_count : r.variable_count))
+                    return false;
+                if (++depth > r.max_depth)
+                    return false;
+                break;
+            case OpCode::CALL:
+                if (insn->arg >= r.function_count || depth < 1)
+                    return false;
+                break;
+            case OpCode::NEG:
+            case OpCode::SQRT:
+                if (depth < 1)
+                    return false;
+                break;
+            case OpCode::POWI:
+                // Squares in the slot above the top of the stack
+                if (depth < 1 || depth >= r.max_depth)
+                    return false;
+                break;
+            case OpCode::ADD:
+            case OpCode::SUB:
+            case OpCode::MUL:
+            case OpCode::DIV:
+            case OpCode::POW:
+                if (depth < 2)
+                    return false;
+                --depth;
+                break;
+            default:
+                return false;
+        }
+    }
+
+    return depth == 1;
+}
+
+bool ProgramImage::verify() const
+{
+    for(std::size_t i = 0; i < _count; ++i)
+        if (!verify(i))
+            return false;
+
+    return true;
+}
+
+void ProgramImage::load(std::size_t program, Program& out) const
+{
+    const Record& r = _directory[program];
+
+    out.clear();
+    out.code.assign(_code + r.code, _code + r.code + r.code_size);
+    out.constants.assign(_constants + r.constants, _constants + r.constants + r.constant_count);
+
+    for(std::size_t i = 0; i < r.variable_count; ++i)
+        out.variables.intern(variable(program, i), _symbols[2*(r.variables+i)+1]);
+    for(std::size_t i = 0; i < r.function_count; ++i)
+        out.functions.intern(function(program, i), _symbols[2*(r.functions+i)+1]);
+
+    out.shared_symbols = shared_symbols(program);
+    out.max_depth = r.max_depth;
+}
+
+} /* namespace */
@@ -0,0 +1,170 @@
+#if !defined LINLIB_IMAGE_H
+#define LINLIB_IMAGE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "lib/program.h"
+
+namespace linlib {
+
+/**
+    Binary format of compiled programs.
+
+    All integers and doubles are little-endian; every section is 8-byte
+    aligned. Offsets are relative to the start of the file.
+
+        header      magic "LINLIBPI", version, section offsets and counts
+        directory   one record per program: name, source text, and the
+                    ranges of its code, constants and symbols
+        index       program numbers, sorted by name
+        code        Instruction { uint32 op; uint32 arg; }
+        constants   IEEE-754 doubles
+        symbols     { uint32 offset; uint32 length; } into the strings
+        strings     NUL-terminated names and source texts
+
+    The layout of the code and constants sections is the in-memory one
+    on little-endian hosts, so a mapped image runs in place.
+*/
+enum struct ImageStatus
+{
+    OK,
+    IO_ERROR,           // the file can't be read or mapped
+    BAD_FORMAT,         // not an image, or truncated or inconsistent
+    BAD_VERSION,        // written by an incompatible version
+    UNSUPPORTED_HOST,   // big-endian host: the image can't run in place
+};
+
+/**
+    Serialize compiled programs into an image.
+*/
+class ImageWriter
+{
+    struct Entry
+    {
+        std::string     name;
+        std::string     source;
+        Program         program;
+    };
+
+    std::vector<Entry>  _entries;
+
+    public:
+    /**
+        Add a program under the given name. The source text is optional
+        metadata, kept for diagnostics.
+    */
+    void add(const std::string& name, const Program& program, const std::string& source = std::string());
+
+    inline std::size_t size() const { return _entries.size(); }
+
+    /**
+        Return the serialized image.
+    */
+    std::string data() const;
+
+    /**
+        Write the image to `path`. Return true on success.
+    */
+    bool write(const std::string& path) const;
+};
+
+/**
+    A read-only image of compiled programs.
+
+    `open()` maps the file and only checks the header and the directory,
+    so programs are paged in on first use. `view()` returns a program
+    that the Machine runs directly from the mapped pages.
+
+    The structure of the image is checked by `open()`, but not the code
+    itself. Call `verify()` before running programs from an untrusted
+    image: a corrupted instruction may read outside of the stack or of
+    the binding arrays.
+*/
+class ProgramImage
+{
+    public:
+    static const std::uint32_t VERSION = 1;
+    static const std::size_t NOT_FOUND = SIZE_MAX;
+
+    private:
+    struct Record;
+
+    const char*             _data;
+    std::size_t             _size;
+    void*                   _map;
+    std::vector<std::uint64_t> _buffer;     // file content when it can't be mapped
+
+    const Record*           _directory;
+    const std::uint32_t*    _index;
+    std::size_t             _count;
+    const Instruction*      _code;
+    const double*           _constants;
+    const std::uint32_t*    _symbols;       // offset and length pairs
+    const char*             _strings;
+
+    ImageStatus attach(const char* data, std::size_t size);
+    void close();
+
+    const char* string(std::uint32_t symbol) const;
+
+    public:
+    ProgramImage();
+    ~ProgramImage();
+
+    ProgramImage(const ProgramImage&) = delete;
+    ProgramImage& operator=(const ProgramImage&) = delete;
+
+    /**
+        Map the image file at `path`.
+    */
+    ImageStatus open(const std::string& path);
+
+    /**
+        Use the image in [data, data+size), which must be 8-byte aligned
+        and outlive this object.
+    */
+    ImageStatus open(const void* data, std::size_t size);
+
+    /**
+        Number of programs.
+    */
+    inline std::size_t size() const { return _count; }
+
+    /**
+        Return the number of the program with the given name, or
+        NOT_FOUND. The lookup is a binary search of the index.
+    */
+    std::size_t find(const std::string& name) const;
+
+    const char* name(std::size_t program) const;
+    const char* source(std::size_t program) const;
+    bool shared_symbols(std::size_t program) const;
+
+    std::size_t variable_count(std::size_t program) const;
+    const char* variable(std::size_t program, std::size_t slot) const;
+    std::size_t function_count(std::size_t program) const;
+    const char* function(std::size_t program, std::size_t slot) const;
+
+    /**
+        Return the program, pointing into the image.
+    */
+    ProgramView view(std::size_t program) const;
+
+    /**
+        Return true if every argument of the code is in range, and the
+        code never uses more stack than declared.
+    */
+    bool verify(std::size_t program) const;
+    bool verify() const;
+
+    /**
+        Copy the program, e.g. to optimize it or compile it natively.
+    */
+    void load(std::size_t program, Program& out) const;
+};
+
+} /* namespace */
+
+#endif
@@ -0,0 +1,534 @@
+#include <algorithm>
+#include <utility>
+
+#include "lib/incremental.h"
+
+namespace linlib {
+
+//========================================================================
+//  Helpers
+//========================================================================
+static std::size_t count_events(const std::vector<SyntaxNode>& nodes, std::size_t begin, std::size_t end)
+{
+    std::size_t count = 0;
+
+    for(std::size_t i = begin; i < end; ++i)
+        count += (nodes[i].kind != SyntaxNode::PAREN);
+
+    return count;
+}
+
+/**
+    Index of the first token of the argument of a group
+*/
+static inline std::size_t inner(const SyntaxNode& group)
+{
+    return group.first + ((group.kind == SyntaxNode::CALL) ? 2 : 1);
+}
+
+/**
+    Replace the [begin, end) elements of `v` by the `count` ones at
+    `first`, moving the tail at most once.
+*/
+template<class T>
+static void splice(std::vector<T>& v, std::size_t begin, std::size_t end, const T* first, std::size_t count)
+{
+    if (count > end-begin)
+        v.insert(v.begin()+end, count-(end-begin), T());
+    else if (count < end-begin)
+        v.erase(v.begin()+begin+count, v.begin()+end);
+
+    std::copy(first, first+count, v.begin()+begin);
+}
+
+/**
+    True if the extent of the token depends on the character after it.
+*/
+static inline bool extensible(Token::Id id)
+{
+    return id == Token::SYMBOL || id == Token::NUMBER || id == Token::TIMES || id == Token::BAD_TOKEN;
+}
+
+//========================================================================
+//  Parsing
+//
+//  A recursive descent of the Parser grammar, over the token array.
+//  The nodes are appended to `*_out` in postfix order.
+//========================================================================
+void IncrementalParser::lex(std::size_t from, std::size_t to, std::vector<SyntaxToken>& tokens) const
+{
+    Tokenizer   tokenizer(_start+from, to-from);
+
+    for(Token token = tokenizer.next(); token; token = tokenizer.next())
+        tokens.push_back({ token.id, static_cast<std::size_t>(token.start-_start), token.length });
+}
+
+bool IncrementalParser::error(State state)
+{
+    _state = state;
+    _lookahead = (_pos < _tokens.size())
+        ? Token{ _tokens[_pos].id, _start+_tokens[_pos].offset, _tokens[_pos].length }
+        : Token{ Token::END, _start+_length, 0 };
+
+    return false;
+}
+
+Token::Id IncrementalParser::peek() const
+{
+    return (_pos < _bound) ? _tokens[_pos].id : Token::END;
+}
+
+bool IncrementalParser::next()
+{
+    ++_pos;
+
+    return peek() != Token::BAD_TOKEN || error(BAD_TOKEN_ERROR);
+}
+
+bool IncrementalParser::expect(Token::Id id)
+{
+    return (peek() == id) ? next() : error(SYNTAX_ERROR);
+}
+
+/**
+    Open a group, a call or a unary minus.
+*/
+bool IncrementalParser::enter()
+{
+    if (_depth == _max_depth)
+        return error(DEPTH_ERROR);
+
+    ++_depth;
+    return true;
+}
+
+/**
+    Append the root of the subtree starting at node `begin` and token
+    `first`, and ending at the current token. Close the group opened
+    by `enter()` if any.
+*/
+bool IncrementalParser::push(SyntaxNode::Kind kind, std::size_t begin, std::size_t first)
+{
+    _out->push_back({
+        kind, BinaryOpCode::ADD,
+        static_cast<std::uint32_t>(_out->size() - begin + 1),
+        static_cast<std::uint32_t>(first),
+        static_cast<std::uint32_t>(_pos),
+        static_cast<std::uint32_t>(_depth),
+        0.0
+    });
+
+    if (kind == SyntaxNode::NEG || kind == SyntaxNode::PAREN || kind == SyntaxNode::CALL)
+        --_depth;
+
+    return true;
+}
+
+bool IncrementalParser::number(std::size_t& begin)
+{
+    const SyntaxToken&  token = _tokens[_pos];
+    const std::size_t   first = _pos;
+    double              value = 0;
+
+    switch(parse_number(_start+token.offset, token.length, value))
+    {
+        case NumberStatus::OK:
+            break;
+        case NumberStatus::SYNTAX_ERROR:
+            return error(SYNTAX_ERROR);
+        case NumberStatus::TOO_LARGE:
+        case NumberStatus::TOO_SMALL:
+            return error(RANGE_ERROR);
+    }
+
+    begin = _out->size();
+    if (!next() || !push(SyntaxNode::NUMBER, begin, first))
+        return false;
+
+    _out->back().value = value;
+    return true;
+}
+
+bool IncrementalParser::term(std::size_t& begin)
+{
+    while(peek() == Token::PLUS)
+        if (!next())
+            return false;
+
+    const std::size_t first = _pos;
+
+    switch(peek())
+    {
+        case Token::MINUS:
+            return enter() && next() && term(begin)
+                && push(SyntaxNode::NEG, begin, first);
+        case Token::LPAR:
+            return enter() && next() && sum(begin) && expect(Token::RPAR)
+                && push(SyntaxNode::PAREN, begin, first);
+        case Token::NUMBER:
+            return number(begin);
+        case Token::SYMBOL:
+            if (!next())
+                return false;
+
+            if (peek() != Token::LPAR)
+            {
+                begin = _out->size();
+                return push(SyntaxNode::LOAD, begin, first);
+            }
+
+            return enter() && next() && sum(begin) && expect(Token::RPAR)
+                && push(SyntaxNode::CALL, begin, first);
+        default:
+            return error(SYNTAX_ERROR);
+    }
+}
+
+/**
+    Parse `operand [ op operand ]*`, left-associative.
+*/
+#define LINLIB_BINARY_CHAIN(name, operand, id1, op1, id2, op2)                 \
+bool IncrementalParser::name(std::size_t& begin)                                \
+{                                                                               \
+    if (!operand(begin))                                                        \
+        return false;                                                           \
+                                                                                \
+    while(peek() == Token::id1 || peek() == Token::id2)                         \
+    {                                                                           \
+        const BinaryOpCode  op = (peek() == Token::id1) ? BinaryOpCode::op1 : BinaryOpCode::op2; \
+        const std::size_t   first = _out->back().first;                         \
+        std::size_t         right = 0;                                          \
+                                                                                \
+        if (!next() || !operand(right) || !push(SyntaxNode::BINARY, begin, first)) \
+            return false;                                                       \
+                                                                                \
+        _out->back().op = op;                                                   \
+    }                                                                           \
+                                                                                \
+    return true;                                                                \
+}
+
+LINLIB_BINARY_CHAIN(pow, term, POW, POW, POW, POW)
+LINLIB_BINARY_CHAIN(prod, pow, TIMES, MUL, SLASH, DIV)
+LINLIB_BINARY_CHAIN(sum, prod, PLUS, ADD, MINUS, SUB)
+
+#undef LINLIB_BINARY_CHAIN
+
+/**
+    Parse the [first, last) tokens as a complete sum, nested `depth`
+    levels deep, into `out`.
+*/
+bool IncrementalParser::parse_range(std::size_t first, std::size_t last, std::size_t depth,
+                                    std::vector<SyntaxNode>& out)
+{
+    _out = &out;
+    _pos = first;
+    _bound = last;
+    _depth = depth;
+
+    out.clear();
+
+    std::size_t begin = 0;
+
+    if (peek() == Token::BAD_TOKEN)
+        return error(BAD_TOKEN_ERROR);
+
+    return sum(begin) && (_pos == _bound || error(SYNTAX_ERROR));
+}
+
+/**
+    Lex and parse the whole text. `change` covers everything.
+*/
+bool IncrementalParser::parse_all(Change& change)
+{
+    const std::size_t   old_events = count_events(_nodes, 0, _nodes.size());
+
+    change.tokens_begin = 0;
+    change.tokens_removed = _tokens.size();
+    change.events_begin = 0;
+    change.events_removed = old_events;
+
+    _tokens.clear();
+    lex(0, _length, _tokens);
+
+    _state = OK;
+
+    const bool ok = parse_range(0, _tokens.size(), 0, _nodes);
+    if (!ok)
+        _nodes.clear();
+
+    change.node = _nodes.empty() ? 0 : _nodes.size()-1;
+    change.tokens_inserted = _tokens.size();
+    change.events_inserted = count_events(_nodes, 0, _nodes.size());
+
+    return ok;
+}
+
+/**
+    Point the parser to the new text. Until an error is found, the
+    lookahead is the end of the text, as after a successful parse.
+*/
+void IncrementalParser::sync()
+{
+    _start = _text.data();
+    _length = _text.size();
+    _lookahead = { Token::END, _start+_length, 0 };
+}
+
+//========================================================================
+//  Public interface
+//========================================================================
+IncrementalParser::IncrementalParser(const char* expr, std::size_t len)
+  : ParserBase(expr, len),
+    _text(expr, len),
+    _out(nullptr),
+    _pos(0),
+    _bound(0),
+    _depth(0)
+{
+    Change  change;
+
+    sync();
+    parse_all(change);
+}
+
+bool IncrementalParser::edit(std::size_t offset, std::size_t removed, const char* inserted, std::size_t len,
+                             Change& change)
+{
+    offset = std::min(offset, _text.size());
+    removed = std::min(removed, _text.size()-offset);
+
+    // The first token touching the edit. The tokens before can't change:
+    // the tokenizer never looks further than the character after a token.
+    std::size_t first = std::lower_bound(_tokens.begin(), _tokens.end(), offset,
+        [](const SyntaxToken& token, std::size_t at) { return token.offset+token.length < at; }
+    ) - _tokens.begin();
+
+    if (first < _tokens.size() && _tokens[first].offset+_tokens[first].length == offset
+        && !extensible(_tokens[first].id))
+        ++first;
+
+    const std::size_t from = (first < _tokens.size()) ? std::min(_tokens[first].offset, offset) : offset;
+
+    _text.replace(offset, removed, inserted, len);
+    sync();
+
+    if (_state != OK)
+        return parse_all(change);
+
+    // Re-lex until a new token starts where an old one did, after the
+    // edit: from there, both tokenize the same text the same way.
+    std::vector<SyntaxToken>    fresh;
+    std::size_t                 last = first;
+    Tokenizer                   tokenizer(_start+from, _length-from);
+
+    while(true)
+    {
+        const Token         token = tokenizer.next();
+        const std::size_t   at = static_cast<std::size_t>(token.start-_start);
+
+        if (at >= offset+len)
+        {
+            const std::size_t old_at = at - len + removed;
+
+            while(last < _tokens.size() && _tokens[last].offset < old_at)
+                ++last;
+
+            if (!token || (last < _tokens.size() && _tokens[last].offset == old_at))
+                break;
+        }
+
+        fresh.push_back({ token.id, at, token.length });
+    }
+
+    // The smallest group holding the old [first, last) tokens. The
+    // descendants of a node come before it, so it is the first one.
+    std::size_t group = 0;
+    std::size_t events = 0;
+
+    for(; group < _nodes.size(); ++group)
+    {
+        const SyntaxNode& node = _nodes[group];
+
+        if ((node.kind == SyntaxNode::PAREN || node.kind == SyntaxNode::CALL)
+            && inner(node) <= first && last < node.last)
+            break;
+
+        events += (node.kind != SyntaxNode::PAREN);
+    }
+
+    // Splice the tokens
+    const std::ptrdiff_t    dt = static_cast<std::ptrdiff_t>(fresh.size()) - static_cast<std::ptrdiff_t>(last-first);
+    const std::size_t       old_tokens = _tokens.size();
+
+    for(std::size_t i = last; i < _tokens.size(); ++i)
+        _tokens[i].offset = _tokens[i].offset + len - removed;
+
+    splice(_tokens, first, last, fresh.data(), fresh.size());
+
+    if (group == _nodes.size())
+    {
+        const bool ok = parse_all(change);
+
+        change.tokens_removed = old_tokens;
+        return ok;
+    }
+
+    // Reparse the argument of the group, at its nesting level
+    const SyntaxNode    g = _nodes[group];
+    const std::size_t   begin = group - _nodes[group-1].size;
+
+    if (!parse_range(inner(g), g.last-1+dt, g.depth, _scratch))
+    {
+        const bool ok = parse_all(change);
+
+        change.tokens_removed = old_tokens;
+        return ok;
+    }
+
+    const std::ptrdiff_t dn = static_cast<std::ptrdiff_t>(_scratch.size()) - static_cast<std::ptrdiff_t>(group-begin);
+
+    change.tokens_begin = first;
+    change.tokens_removed = last-first;
+    change.tokens_inserted = fresh.size();
+    change.events_removed = count_events(_nodes, begin, group);
+    change.events_begin = events - change.events_removed;
+    change.events_inserted = count_events(_scratch, 0, _scratch.size());
+    change.node = begin + _scratch.size() - 1;
+
+    // Fix the sizes of the ancestors, and the token indices after the
+    // edit. The nodes before the group end before the edit.
+    for(std::size_t i = group; i < _nodes.size(); ++i)
+    {
+        SyntaxNode& node = _nodes[i];
+
+        if (i+1 - node.size <= begin)
+            node.size += dn;
+        if (node.first >= last)
+            node.first += dt;
+        if (node.last >= last)
+            node.last += dt;
+    }
+
+    splice(_nodes, begin, group, _scratch.data(), _scratch.size());
+
+    return true;
+}
+
+bool IncrementalParser::replay(std::size_t root, EventHandler& handler) const
+{
+    for(std::size_t i = root+1 - _nodes[root].size; i <= root; ++i)
+    {
+        const SyntaxNode&   node = _nodes[i];
+        const SyntaxToken&  token = _tokens[node.first];
+        bool                ok = true;
+
+        switch(node.kind)
+        {
+            case SyntaxNode::NUMBER:
+                ok = handler.number(node.value);
+                break;
+            case SyntaxNode::LOAD:
+                ok = handler.load(_start+token.offset, token.length);
+                break;
+            case SyntaxNode::CALL:
+                ok = handler.call(_start+token.offset, token.length);
+                break;
+            case SyntaxNode::NEG:
+                ok = handler.unary_op(UnaryOpCode::NEG);
+                break;
+            case SyntaxNode::BINARY:
+                ok = handler.binary_op(node.op);
+                break;
+            case SyntaxNode::PAREN:
+                break;
+        }
+
+        if (!ok)
+            return false;
+    }
+
+    return true;
+}
+
+//========================================================================
+//  Program patching
+//========================================================================
+/**
+    Number of stack slots required to run the code
+*/
+static std::size_t stack_depth(const std::vector<Instruction>& code)
+{
+    std::size_t depth = 0;
+    std::size_t result = 0;
+
+    for(const Instruction& insn : code)
+    {
+        switch(insn.op)
+        {
+            case OpCode::CONST:
+            case OpCode::LOAD:
+                result = std::max(result, ++depth);
+                break;
+            case OpCode::CALL:
+            case OpCode::NEG:
+                break;
+            default:
+                --depth;
+                break;
+        }
+    }
+
+    return result;
+}
+
+/**
+    Drop the constants no longer referenced by the code
+*/
+static void compact(Program& program)
+{
+    std::vector<double> constants;
+
+    for(Instruction& insn : program.code)
+    {
+        if (insn.op == OpCode::CONST)
+        {
+            constants.push_back(program.constants[insn.arg]);
+            insn.arg = static_cast<std::uint32_t>(constants.size()-1);
+        }
+    }
+
+    program.constants.swap(constants);
+}
+
+bool patch(Program& program, const IncrementalParser& parser, const IncrementalParser::Change& change)
+{
+    // Compile the subtree against the tables of the program
+    Program scratch;
+
+    scratch.constants.swap(program.constants);
+    std::swap(scratch.variables, program.variables);
+    std::swap(scratch.functions, program.functions);
+
+    Compiler    compiler{scratch, !program.shared_symbols};
+    const bool  ok = !parser.nodes().empty() && parser.replay(change.node, compiler);
+
+    program.constants.swap(scratch.constants);
+    std::swap(program.variables, scratch.variables);
+    std::swap(program.functions, scratch.functions);
+
+    if (!ok)
+        return false;
+
+    const auto at = program.code.begin() + change.events_begin;
+    program.code.insert(program.code.erase(at, at + change.events_removed),
+                        scratch.code.begin(), scratch.code.end());
+
+    program.max_depth = stack_depth(program.code);
+    if (program.constants.size() > 2*program.code.size())
+        compact(program);
+
+    return true;
+}
+
+} /* namespace */
@@ -0,0 +1,189 @@
+#if !defined LINLIB_INCREMENTAL_H
+#define LINLIB_INCREMENTAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "lib/parser.h"
+#include "lib/program.h"
+
+namespace linlib {
+
+/**
+    A token of the incremental parser. Tokens are located by offset in
+    the text, so they stay valid when the text is reallocated.
+*/
+struct SyntaxToken
+{
+    Token::Id       id;
+    std::size_t     offset;
+    std::size_t     length;
+};
+
+/**
+    A node of the parse tree. The nodes are stored in postfix order,
+    and a subtree is the `size` nodes ending at its root. So the events
+    of a subtree are a contiguous slice of the event stream, and of the
+    code of a Program compiled from it.
+
+    The node spans the [first, last) tokens. A PAREN node emits no
+    event; the one of a CALL is the call of its first token.
+*/
+struct SyntaxNode
+{
+    enum Kind : std::uint8_t
+    {
+        NUMBER,
+        LOAD,
+        CALL,           // SYMBOL '(' sum ')'
+        NEG,
+        BINARY,
+        PAREN,          // '(' sum ')'
+    };
+
+    Kind            kind;
+    BinaryOpCode    op;         // BINARY only
+    std::uint32_t   size;
+    std::uint32_t   first;
+    std::uint32_t   last;
+    std::uint32_t   depth;      // enclosing groups, calls and unary minus, itself included
+    double          value;      // NUMBER only
+};
+
+/**
+    A parser keeping the tokens and the parse tree of an expression, so
+    edits of the text are applied without parsing it all over again.
+
+    An edit re-lexes the tokens from the one touching the edit, until
+    the new tokens line up with the old ones again. Then it reparses
+    the smallest parenthesized group, or function argument, enclosing
+    the changed tokens. The text outside of the group is parsed exactly
+    as before, so the tree is the one a full parse would build.
+
+    Besides the reparse, an edit costs a pass over the tokens and nodes
+    after the group to shift their indices, with no other work.
+
+    When the group does not parse, or when the previous text was not a
+    valid expression, the whole text is parsed again: this is where the
+    errors are reported.
+
+    The grammar is the one of the Parser. The nesting bound applies to
+    the parenthesized groups, function calls, and unary minus only.
+*/
+class IncrementalParser : public ParserBase
+{
+    public:
+    /**
+        The region of the tree changed by an edit. The events of the
+        nodes in [events_begin, events_begin+events_removed) in the
+        event stream of the previous tree were replaced by the
+        events_inserted events of the subtree rooted at `node`.
+    */
+    struct Change
+    {
+        std::size_t     node;
+
+        std::size_t     tokens_begin;
+        std::size_t     tokens_removed;
+        std::size_t     tokens_inserted;
+
+        std::size_t     events_begin;
+        std::size_t     events_removed;
+        std::size_t     events_inserted;
+    };
+
+    private:
+    std::string                 _text;
+    std::vector<SyntaxToken>    _tokens;
+    std::vector<SyntaxNode>     _nodes;
+    std::vector<SyntaxNode>     _scratch;
+
+    // Parsing state. The tokens [_pos, _bound) are visible.
+    std::vector<SyntaxNode>*    _out;
+    std::size_t                 _pos;
+    std::size_t                 _bound;
+    std::size_t                 _depth;
+
+    void lex(std::size_t from, std::size_t to, std::vector<SyntaxToken>& tokens) const;
+
+    bool error(State state);
+    Token::Id peek() const;
+    bool next();
+    bool expect(Token::Id id);
+    bool push(SyntaxNode::Kind kind, std::size_t begin, std::size_t first);
+    bool enter();
+
+    bool number(std::size_t& begin);
+    bool term(std::size_t& begin);
+    bool pow(std::size_t& begin);
+    bool prod(std::size_t& begin);
+    bool sum(std::size_t& begin);
+
+    bool parse_range(std::size_t first, std::size_t last, std::size_t depth, std::vector<SyntaxNode>& out);
+    bool parse_all(Change& change);
+    void sync();
+
+    public:
+    IncrementalParser(const char* expr, std::size_t len);
+
+    IncrementalParser(const std::string& expr)
+      : IncrementalParser(expr.data(), expr.size())
+    {
+    }
+
+    // The scanner state points into the text and the nodes
+    IncrementalParser(const IncrementalParser&) = delete;
+    IncrementalParser& operator=(const IncrementalParser&) = delete;
+
+    /**
+        Replace the `removed` characters at `offset` by the `len`
+        characters of `inserted`. `offset` and `removed` are clamped
+        to the text.
+
+        Return true if the new text is a valid expression. `change` is
+        set to the changed region of the tree.
+    */
+    bool edit(std::size_t offset, std::size_t removed, const char* inserted, std::size_t len,
+              Change& change);
+
+    bool edit(std::size_t offset, std::size_t removed, const std::string& inserted, Change& change)
+    {
+        return edit(offset, removed, inserted.data(), inserted.size(), change);
+    }
+
+    inline const std::string& text() const { return _text; }
+    inline const std::vector<SyntaxToken>& tokens() const { return _tokens; }
+    inline const std::vector<SyntaxNode>& nodes() const { return _nodes; }
+
+    /**
+        Send the events of the subtree rooted at `node` to the handler,
+        in the same order as the Parser would. Return false as soon as
+        the handler does.
+    */
+    bool replay(std::size_t node, EventHandler& handler) const;
+
+    /**
+        Send the events of the whole expression to the handler.
+    */
+    bool replay(EventHandler& handler) const
+    {
+        return _nodes.empty() || replay(_nodes.size()-1, handler);
+    }
+};
+
+/**
+    Apply the `change` of the latest successful edit of `parser` to
+    `program`, compiled from the tree before the edit: only the code of
+    the reparsed subtree is compiled again. Programs with shared symbol
+    tables are compiled against their tables.
+
+    Return false if the subtree does not compile, e.g. it references an
+    unknown symbol. The program is then invalid and must be rebuilt.
+*/
+bool patch(Program& program, const IncrementalParser& parser, const IncrementalParser::Change& change);
+
+} /* namespace */
+
+#endif
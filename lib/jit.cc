@@ -0,0 +1,334 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+#include "lib/jit.h"
+
+#if defined(__x86_64__) && defined(__unix__)
+#define LINLIB_JIT 1
+#include <sys/mman.h>
+#endif
+
+namespace linlib {
+
+#if defined LINLIB_JIT
+//========================================================================
+//  Assembler
+//
+//  Just enough of the x86-64 encoding to emit scalar SSE2 code.
+//  Registers are numbered 0-15; values above 7 require a REX prefix.
+//========================================================================
+class Assembler
+{
+    std::vector<std::uint8_t>   _code;
+
+    enum
+    {
+        RAX = 0,
+        RSP = 4,
+        RBX = 3,
+    };
+
+    void byte(std::uint8_t b) { _code.push_back(b); }
+
+    void bytes(std::initializer_list<std::uint8_t> bs)
+    {
+        _code.insert(_code.end(), bs);
+    }
+
+    void imm32(std::uint32_t v)
+    {
+        for(int i = 0; i < 4; ++i)
+            byte(static_cast<std::uint8_t>(v >> (8*i)));
+    }
+
+    void imm64(std::uint64_t v)
+    {
+        for(int i = 0; i < 8; ++i)
+            byte(static_cast<std::uint8_t>(v >> (8*i)));
+    }
+
+    void rex(bool w, unsigned reg, unsigned rm)
+    {
+        std::uint8_t prefix = 0x40 | (w << 3) | ((reg >> 3) << 2) | (rm >> 3);
+        if (prefix != 0x40)
+            byte(prefix);
+    }
+
+    void modrm(unsigned mod, unsigned reg, unsigned rm)
+    {
+        byte(static_cast<std::uint8_t>((mod << 6) | ((reg & 7) << 3) | (rm & 7)));
+    }
+
+    /**
+        Emit `prefix [REX] 0F opcode` with a register-register operand.
+    */
+    void sse_rr(std::uint8_t prefix, std::uint8_t opcode, unsigned dst, unsigned src)
+    {
+        byte(prefix);
+        rex(false, dst, src);
+        bytes({ 0x0F, opcode });
+        modrm(3, dst, src);
+    }
+
+    /**
+        Emit `prefix [REX] 0F opcode` with a [rsp+disp8] memory operand.
+    */
+    void sse_rsp(std::uint8_t opcode, unsigned reg, std::uint8_t disp)
+    {
+        byte(0xF2);
+        rex(false, reg, 0);
+        bytes({ 0x0F, opcode });
+        modrm(1, reg, RSP);
+        bytes({ 0x24, disp });
+    }
+
+    public:
+    /**
+        Size of the spill area, one slot per xmm register.
+    */
+    static const std::uint32_t FRAME_SIZE = 16*8;
+
+    const std::vector<std::uint8_t>& code() const { return _code; }
+
+    void prologue()
+    {
+        byte(0x53);                             // push rbx
+        bytes({ 0x48, 0x89, 0xFB });            // mov rbx, rdi
+        bytes({ 0x48, 0x81, 0xEC });            // sub rsp, FRAME_SIZE
+        imm32(FRAME_SIZE);
+    }
+
+    void epilogue()
+    {
+        bytes({ 0x48, 0x81, 0xC4 });            // add rsp, FRAME_SIZE
+        imm32(FRAME_SIZE);
+        byte(0x5B);                             // pop rbx
+        byte(0xC3);                             // ret
+    }
+
+    void movsd_load(unsigned dst, std::uint32_t offset)
+    {
+        // movsd xmm, [rbx+disp32]
+        byte(0xF2);
+        rex(false, dst, RBX);
+        bytes({ 0x0F, 0x10 });
+        modrm(2, dst, RBX);
+        imm32(offset);
+    }
+
+    void mov_rax(std::uint64_t value)
+    {
+        bytes({ 0x48, 0xB8 });                  // mov rax, imm64
+        imm64(value);
+    }
+
+    void movq_from_rax(unsigned dst)
+    {
+        // movq xmm, rax
+        byte(0x66);
+        rex(true, dst, RAX);
+        bytes({ 0x0F, 0x6E });
+        modrm(3, dst, RAX);
+    }
+
+    void movq_to_rax(unsigned src)
+    {
+        // movq rax, xmm
+        byte(0x66);
+        rex(true, src, RAX);
+        bytes({ 0x0F, 0x7E });
+        modrm(3, src, RAX);
+    }
+
+    void load_constant(unsigned dst, double value)
+    {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+
+        mov_rax(bits);
+        movq_from_rax(dst);
+    }
+
+    void neg(unsigned reg)
+    {
+        movq_to_rax(reg);
+        bytes({ 0x48, 0x0F, 0xBA, 0xF8, 0x3F });  // btc rax, 63
+        movq_from_rax(reg);
+    }
+
+    void addsd(unsigned dst, unsigned src) { sse_rr(0xF2, 0x58, dst, src); }
+    void mulsd(unsigned dst, unsigned src) { sse_rr(0xF2, 0x59, dst, src); }
+    void subsd(unsigned dst, unsigned src) { sse_rr(0xF2, 0x5C, dst, src); }
+    void divsd(unsigned dst, unsigned src) { sse_rr(0xF2, 0x5E, dst, src); }
+    void sqrtsd(unsigned dst, unsigned src) { sse_rr(0xF2, 0x51, dst, src); }
+
+    void movapd(unsigned dst, unsigned src)
+    {
+        if (dst != src)
+            sse_rr(0x66, 0x28, dst, src);
+    }
+
+    void spill(unsigned count)
+    {
+        for(unsigned reg = 0; reg < count; ++reg)
+            sse_rsp(0x11, reg, static_cast<std::uint8_t>(8*reg));
+    }
+
+    void restore(unsigned count)
+    {
+        for(unsigned reg = 0; reg < count; ++reg)
+            sse_rsp(0x10, reg, static_cast<std::uint8_t>(8*reg));
+    }
+
+    void call(const void* target)
+    {
+        mov_rax(reinterpret_cast<std::uintptr_t>(target));
+        bytes({ 0xFF, 0xD0 });                  // call rax
+    }
+};
+
+//========================================================================
+//  Code generation
+//
+//  The value at stack depth `i` lives in xmm`i`. Before a call, the
+//  registers holding live values are spilled to the frame since the
+//  SysV ABI makes all of them caller-saved.
+//========================================================================
+static std::vector<std::uint8_t> generate(const Program& program, const Function* fcts)
+{
+    typedef double (*Pow)(double, double);
+    static const Pow pow_fn = std::pow;
+
+    Assembler   as;
+    unsigned    depth = 0;
+
+    as.prologue();
+    for(const Instruction& insn : program.code)
+    {
+        switch(insn.op)
+        {
+            case OpCode::CONST:
+                as.load_constant(depth++, program.constants[insn.arg]);
+                break;
+            case OpCode::LOAD:
+                as.movsd_load(depth++, insn.arg*sizeof(double));
+                break;
+            case OpCode::CALL:
+                as.spill(depth-1);
+                as.movapd(0, depth-1);
+                as.call(reinterpret_cast<const void*>(fcts[insn.arg]));
+                as.movapd(depth-1, 0);
+                as.restore(depth-1);
+                break;
+            case OpCode::NEG:
+                as.neg(depth-1);
+                break;
+            case OpCode::ADD:
+                --depth;
+                as.addsd(depth-1, depth);
+                break;
+            case OpCode::SUB:
+                --depth;
+                as.subsd(depth-1, depth);
+                break;
+            case OpCode::MUL:
+                --depth;
+                as.mulsd(depth-1, depth);
+                break;
+            case OpCode::DIV:
+                --depth;
+                as.divsd(depth-1, depth);
+                break;
+            case OpCode::POW:
+                --depth;
+                as.spill(depth-1);
+                as.movapd(0, depth-1);
+                as.movapd(1, depth);
+                as.call(reinterpret_cast<const void*>(pow_fn));
+                as.movapd(depth-1, 0);
+                as.restore(depth-1);
+                break;
+            case OpCode::POWI:
+                {
+                    // Unrolled powi(), squaring in the register above
+                    // the top of the stack, accounted for in max_depth
+                    std::uint32_t   n = insn.arg;
+                    bool            odd = n & 1;
+
+                    as.movapd(depth, depth-1);
+                    while(n >>= 1)
+                    {
+                        as.mulsd(depth, depth);
+                        if (n & 1)
+                        {
+                            if (odd)
+                                as.mulsd(depth-1, depth);
+                            else
+                                as.movapd(depth-1, depth);
+                            odd = true;
+                        }
+                    }
+                }
+                break;
+            case OpCode::SQRT:
+                as.sqrtsd(depth-1, depth-1);
+                break;
+        };
+    }
+    as.epilogue();
+
+    return as.code();
+}
+#endif
+
+//========================================================================
+//  JitFunction
+//========================================================================
+bool JitFunction::available()
+{
+#if defined LINLIB_JIT
+    return true;
+#else
+    return false;
+#endif
+}
+
+JitFunction::JitFunction(const Program& program, const Function* fcts)
+  : _native(nullptr),
+    _size(0),
+    _program(program),
+    _fcts(fcts, fcts+program.functions.size())
+{
+#if defined LINLIB_JIT
+    if (program.code.empty() || program.max_depth > MAX_DEPTH)
+        return;
+
+    const std::vector<std::uint8_t> code = generate(program, fcts);
+
+    void* mem = mmap(nullptr, code.size(), PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+        return;
+
+    std::memcpy(mem, code.data(), code.size());
+    if (mprotect(mem, code.size(), PROT_READ|PROT_EXEC) != 0)
+    {
+        munmap(mem, code.size());
+        return;
+    }
+
+    _native = reinterpret_cast<NativeFunction>(mem);
+    _size = code.size();
+#endif
+}
+
+JitFunction::~JitFunction()
+{
+#if defined LINLIB_JIT
+    if (_native)
+        munmap(reinterpret_cast<void*>(_native), _size);
+#endif
+}
+
+} /* namespace */
@@ -0,0 +1,75 @@
+#if !defined LINLIB_JIT_H
+#define LINLIB_JIT_H
+
+#include <vector>
+
+#include "lib/program.h"
+
+namespace linlib {
+
+/**
+    Signature of the native code generated by the JIT.
+*/
+typedef double (*NativeFunction)(const double* vars);
+
+/**
+    A program compiled to native x86-64 code.
+
+    Values are kept in the SSE registers instead of a memory stack.
+    The generated code uses scalar SSE2 instructions and calls the very
+    same functions as the interpreter (`std::pow` and the bound
+    functions), so results are bit-identical.
+
+    When the host is not supported, or the program is too deep to fit
+    in registers, the object falls back to the interpreter. The
+    fallback is _not_ thread-safe; check `native()` before sharing an
+    instance between threads.
+*/
+class JitFunction
+{
+    NativeFunction          _native;
+    std::size_t             _size;
+
+    Program                 _program;
+    std::vector<Function>   _fcts;
+    mutable Machine         _machine;
+
+    public:
+    /**
+        Maximum stack depth supported by the native code generator.
+    */
+    static const std::size_t MAX_DEPTH = 16;
+
+    /**
+        Return true if the host supports native code generation.
+    */
+    static bool available();
+
+    /**
+        Compile `program`. `fcts` is indexed like `program.functions`.
+        The function pointers are copied, so the array does not need
+        to outlive the constructor.
+    */
+    JitFunction(const Program& program, const Function* fcts);
+    ~JitFunction();
+
+    JitFunction(const JitFunction&) = delete;
+    JitFunction& operator=(const JitFunction&) = delete;
+
+    /**
+        Return true if the program runs as native code.
+    */
+    inline bool native() const { return _native != nullptr; }
+
+    /**
+        Evaluate the program. `vars` is indexed like `program.variables`.
+    */
+    inline double operator()(const double* vars) const
+    {
+        return _native ? _native(vars) : _machine.run(_program, vars, _fcts.data());
+    }
+};
+
+} /* namespace */
+
+#endif
@@ -0,0 +1,207 @@
+#include <cmath>
+#include <initializer_list>
+
+#include "lib/kernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LINLIB_X86 1
+#include <immintrin.h>
+#endif
+
+namespace linlib {
+
+//========================================================================
+//  Scalar kernels
+//========================================================================
+namespace scalar {
+
+static void neg(double* dst, const double* a, std::size_t n)
+{
+    for(std::size_t i = 0; i < n; ++i)
+        dst[i] = -a[i];
+}
+
+#define LINLIB_SCALAR_KERNEL(NAME, OP)                                      \
+static void NAME(double* dst, const double* a, const double* b, std::size_t n) \
+{                                                                           \
+    for(std::size_t i = 0; i < n; ++i)                                      \
+        dst[i] = a[i] OP b[i];                                              \
+}
+
+LINLIB_SCALAR_KERNEL(add, +)
+LINLIB_SCALAR_KERNEL(sub, -)
+LINLIB_SCALAR_KERNEL(mul, *)
+LINLIB_SCALAR_KERNEL(div, /)
+
+#undef LINLIB_SCALAR_KERNEL
+
+static void sqrt(double* dst, const double* a, std::size_t n)
+{
+    for(std::size_t i = 0; i < n; ++i)
+        dst[i] = std::sqrt(a[i]);
+}
+
+static const Kernels kernels = { Isa::SCALAR, "scalar", neg, add, sub, mul, div, sqrt };
+
+} // namespace scalar
+
+#if defined LINLIB_X86
+//========================================================================
+//  x86 kernels
+//
+//  Each kernel processes full vectors, then leaves the remaining
+//  elements to its scalar counterpart.
+//========================================================================
+#define LINLIB_SIMD_NEG(TARGET, WIDTH, LOAD, STORE, XOR, SIGN)              \
+__attribute__((target(TARGET)))                                             \
+static void neg(double* dst, const double* a, std::size_t n)                \
+{                                                                           \
+    const auto sign = SIGN;                                                 \
+    std::size_t i = 0;                                                      \
+    for(; i + WIDTH <= n; i += WIDTH)                                       \
+        STORE(dst+i, XOR(LOAD(a+i), sign));                                 \
+    scalar::neg(dst+i, a+i, n-i);                                           \
+}
+
+#define LINLIB_SIMD_SQRT(TARGET, WIDTH, LOAD, STORE, SQRT)                  \
+__attribute__((target(TARGET)))                                             \
+static void sqrt(double* dst, const double* a, std::size_t n)               \
+{                                                                           \
+    std::size_t i = 0;                                                      \
+    for(; i + WIDTH <= n; i += WIDTH)                                       \
+        STORE(dst+i, SQRT(LOAD(a+i)));                                      \
+    scalar::sqrt(dst+i, a+i, n-i);                                          \
+}
+
+#define LINLIB_SIMD_KERNEL(TARGET, WIDTH, LOAD, STORE, NAME, OP)            \
+__attribute__((target(TARGET)))                                             \
+static void NAME(double* dst, const double* a, const double* b, std::size_t n) \
+{                                                                           \
+    std::size_t i = 0;                                                      \
+    for(; i + WIDTH <= n; i += WIDTH)                                       \
+        STORE(dst+i, OP(LOAD(a+i), LOAD(b+i)));                             \
+    scalar::NAME(dst+i, a+i, b+i, n-i);                                     \
+}
+
+#define LINLIB_SIMD_KERNELS(TARGET, WIDTH, LOAD, STORE, PREFIX)             \
+LINLIB_SIMD_KERNEL(TARGET, WIDTH, LOAD, STORE, add, PREFIX##_add_pd)        \
+LINLIB_SIMD_KERNEL(TARGET, WIDTH, LOAD, STORE, sub, PREFIX##_sub_pd)        \
+LINLIB_SIMD_KERNEL(TARGET, WIDTH, LOAD, STORE, mul, PREFIX##_mul_pd)        \
+LINLIB_SIMD_KERNEL(TARGET, WIDTH, LOAD, STORE, div, PREFIX##_div_pd)
+
+namespace sse2 {
+
+LINLIB_SIMD_NEG("sse2", 2, _mm_loadu_pd, _mm_storeu_pd, _mm_xor_pd, _mm_set1_pd(-0.0))
+LINLIB_SIMD_SQRT("sse2", 2, _mm_loadu_pd, _mm_storeu_pd, _mm_sqrt_pd)
+LINLIB_SIMD_KERNELS("sse2", 2, _mm_loadu_pd, _mm_storeu_pd, _mm)
+
+static const Kernels kernels = { Isa::SSE2, "sse2", neg, add, sub, mul, div, sqrt };
+
+} // namespace sse2
+
+namespace avx2 {
+
+LINLIB_SIMD_NEG("avx2", 4, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_xor_pd, _mm256_set1_pd(-0.0))
+LINLIB_SIMD_SQRT("avx2", 4, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_sqrt_pd)
+LINLIB_SIMD_KERNELS("avx2", 4, _mm256_loadu_pd, _mm256_storeu_pd, _mm256)
+
+static const Kernels kernels = { Isa::AVX2, "avx2", neg, add, sub, mul, div, sqrt };
+
+} // namespace avx2
+
+namespace avx512 {
+
+// AVX-512F has no floating point xor (that is AVX-512DQ), so flip
+// the sign bit using the integer unit.
+__attribute__((target("avx512f")))
+static inline __m512d xor_pd(__m512d a, __m512d b)
+{
+    return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a), _mm512_castpd_si512(b)));
+}
+
+// _mm512_sqrt_pd merges into an undefined vector, that GCC reports as
+// maybe uninitialized: merge into the source instead.
+__attribute__((target("avx512f")))
+static inline __m512d sqrt_pd(__m512d a)
+{
+    return _mm512_mask_sqrt_pd(a, 0xFF, a);
+}
+
+LINLIB_SIMD_NEG("avx512f", 8, _mm512_loadu_pd, _mm512_storeu_pd, xor_pd, _mm512_set1_pd(-0.0))
+LINLIB_SIMD_SQRT("avx512f", 8, _mm512_loadu_pd, _mm512_storeu_pd, sqrt_pd)
+LINLIB_SIMD_KERNELS("avx512f", 8, _mm512_loadu_pd, _mm512_storeu_pd, _mm512)
+
+static const Kernels kernels = { Isa::AVX512, "avx512", neg, add, sub, mul, div, sqrt };
+
+} // namespace avx512
+
+#undef LINLIB_SIMD_KERNELS
+#undef LINLIB_SIMD_KERNEL
+#undef LINLIB_SIMD_SQRT
+#undef LINLIB_SIMD_NEG
+#endif
+
+//========================================================================
+//  Dispatch
+//========================================================================
+bool supported(Isa isa)
+{
+    switch(isa)
+    {
+        case Isa::SCALAR:
+            return true;
+#if defined LINLIB_X86
+        case Isa::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case Isa::AVX2:
+            return __builtin_cpu_supports("avx2");
+        case Isa::AVX512:
+            return __builtin_cpu_supports("avx512f");
+#else
+        default:
+            return false;
+#endif
+    };
+
+    return false;
+}
+
+const Kernels* kernels(Isa isa)
+{
+    if (!supported(isa))
+        return nullptr;
+
+    switch(isa)
+    {
+        case Isa::SCALAR:
+            return &scalar::kernels;
+#if defined LINLIB_X86
+        case Isa::SSE2:
+            return &sse2::kernels;
+        case Isa::AVX2:
+            return &avx2::kernels;
+        case Isa::AVX512:
+            return &avx512::kernels;
+#else
+        default:
+            return nullptr;
+#endif
+    };
+
+    return nullptr;
+}
+
+const Kernels& kernels()
+{
+    static const Kernels& best = []() -> const Kernels& {
+        for(Isa isa : { Isa::AVX512, Isa::AVX2, Isa::SSE2 })
+            if (const Kernels* k = kernels(isa))
+                return *k;
+
+        return scalar::kernels;
+    }();
+
+    return best;
+}
+
+} /* namespace */
@@ -0,0 +1,63 @@
+#if !defined LINLIB_KERNELS_H
+#define LINLIB_KERNELS_H
+
+#include <cstddef>
+
+namespace linlib {
+
+/**
+    Instruction set used by the vectorized kernels.
+*/
+enum struct Isa
+{
+    SCALAR,
+    SSE2,
+    AVX2,
+    AVX512,
+};
+
+/**
+    Element-wise kernels over arrays of doubles.
+
+    The destination may alias any of the sources. All kernels produce
+    bit-identical results whatever the instruction set, since they only
+    use correctly rounded IEEE operations.
+*/
+struct Kernels
+{
+    typedef void (*Unary)(double* dst, const double* a, std::size_t n);
+    typedef void (*Binary)(double* dst, const double* a, const double* b, std::size_t n);
+
+    Isa             isa;
+    const char*     name;
+
+    Unary           neg;
+
+    Binary          add;
+    Binary          sub;
+    Binary          mul;
+    Binary          div;
+    Unary           sqrt;
+};
+
+/**
+    Return true if the host CPU (and OS) supports the given instruction
+    set. The test is made at runtime using CPUID.
+*/
+bool supported(Isa isa);
+
+/**
+    Return the kernels for the given instruction set, or nullptr
+    if the host does not support it.
+*/
+const Kernels* kernels(Isa isa);
+
+/**
+    Return the kernels for the best instruction set supported
+    by the host.
+*/
+const Kernels& kernels();
+
+} /* namespace */
+
+#endif
@@ -10,5 +10,6 @@ namespace linlib
 }
 
 #include "lib/parser.h"
+#include "lib/program.h"
 
 #endif
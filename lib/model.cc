@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "lib/model.h"
+
+namespace linlib {
+
+const std::uint32_t Model::NOT_FOUND;
+const std::size_t Model::PARALLEL_THRESHOLD;
+
+//========================================================================
+//  Graph maintenance
+//========================================================================
+std::uint32_t Model::intern(const std::string& name)
+{
+    const std::uint32_t cell = _names.intern(name);
+
+    if (cell == _cells.size())
+    {
+        _cells.emplace_back();
+        _values.push_back(std::numeric_limits<double>::quiet_NaN());
+    }
+
+    return cell;
+}
+
+void Model::queue(std::uint32_t cell)
+{
+    Cell& c = _cells[cell];
+
+    if (c.formula && !c.queued)
+    {
+        c.queued = true;
+        _queue.push_back(cell);
+    }
+}
+
+void Model::queue_dependents(std::uint32_t cell)
+{
+    for(std::uint32_t dependent : _cells[cell].dependents)
+        queue(dependent);
+}
+
+/**
+    Remove the edges from the dependencies of `cell`
+*/
+void Model::unlink(std::uint32_t cell)
+{
+    Cell& c = _cells[cell];
+
+    for(std::uint32_t dependency : c.dependencies)
+    {
+        std::vector<std::uint32_t>& dependents = _cells[dependency].dependents;
+        dependents.erase(std::find(dependents.begin(), dependents.end(), cell));
+    }
+
+    c.dependencies.clear();
+}
+
+/**
+    Return true if one of the `targets` is downstream of `from`, or
+    `from` itself
+*/
+bool Model::reaches(std::uint32_t from, const std::vector<std::uint32_t>& targets) const
+{
+    std::vector<bool>           seen(_cells.size(), false);
+    std::vector<std::uint32_t>  stack = { from };
+
+    seen[from] = true;
+    while(!stack.empty())
+    {
+        const std::uint32_t cell = stack.back();
+        stack.pop_back();
+
+        if (std::find(targets.begin(), targets.end(), cell) != targets.end())
+            return true;
+
+        for(std::uint32_t dependent : _cells[cell].dependents)
+            if (!seen[dependent])
+            {
+                seen[dependent] = true;
+                stack.push_back(dependent);
+            }
+    }
+
+    return false;
+}
+
+/**
+    Update the level of `cell` after a change of its dependencies, then
+    the ones of its dependents as needed
+*/
+void Model::relevel(std::uint32_t cell)
+{
+    std::vector<std::uint32_t> stack = { cell };
+
+    while(!stack.empty())
+    {
+        Cell& c = _cells[stack.back()];
+        stack.pop_back();
+
+        std::uint32_t level = 0;
+        if (c.formula)
+        {
+            level = 1;
+            for(std::uint32_t dependency : c.dependencies)
+                level = std::max(level, _cells[dependency].level+1);
+        }
+
+        if (level != c.level)
+        {
+            c.level = level;
+            _max_level = std::max(_max_level, level);
+            stack.insert(stack.end(), c.dependents.begin(), c.dependents.end());
+        }
+    }
+}
+
+ModelStatus Model::define(const std::string& name, const std::string& formula)
+{
+    Program program;
+    if (!compile(formula.c_str(), program))
+        return ModelStatus::SYNTAX_ERROR;
+
+    std::vector<Function> fcts;
+    for(const std::string& function : program.functions)
+    {
+        auto it = _functions.find(function);
+        if (it == _functions.end())
+            return ModelStatus::UNKNOWN_FUNCTION;
+
+        fcts.push_back(it->second);
+    }
+
+    const std::uint32_t cell = intern(name);
+
+    std::vector<std::uint32_t> dependencies;
+    for(const std::string& variable : program.variables)
+        dependencies.push_back(intern(variable));
+
+    if (reaches(cell, dependencies))
+        return ModelStatus::CYCLE;
+
+    // Loads address the value array of the model directly
+    for(Instruction& insn : program.code)
+        if (insn.op == OpCode::LOAD)
+            insn.arg = dependencies[insn.arg];
+
+    unlink(cell);
+
+    Cell& c = _cells[cell];
+    c.formula = true;
+    c.program = std::move(program);
+    c.fcts = std::move(fcts);
+    c.dependencies = std::move(dependencies);
+    for(std::uint32_t dependency : c.dependencies)
+        _cells[dependency].dependents.push_back(cell);
+
+    relevel(cell);
+    queue(cell);
+
+    return ModelStatus::OK;
+}
+
+void Model::set(std::uint32_t cell, double value)
+{
+    Cell& c = _cells[cell];
+
+    if (c.formula)
+    {
+        unlink(cell);
+        c.formula = false;
+        c.program.clear();
+        c.fcts.clear();
+        relevel(cell);
+    }
+    else if (std::memcmp(&_values[cell], &value, sizeof(value)) == 0)
+    {
+        return;
+    }
+
+    _values[cell] = value;
+    queue_dependents(cell);
+}
+
+double Model::value(const std::string& name) const
+{
+    const std::uint32_t cell = find(name);
+
+    return (cell == NOT_FOUND) ? std::numeric_limits<double>::quiet_NaN() : _values[cell];
+}
+
+std::vector<std::uint32_t> Model::order() const
+{
+    std::vector<std::uint32_t> result;
+
+    for(std::uint32_t cell = 0; cell < _cells.size(); ++cell)
+        if (_cells[cell].formula)
+            result.push_back(cell);
+
+    std::stable_sort(result.begin(), result.end(), [this](std::uint32_t a, std::uint32_t b) {
+        return _cells[a].level < _cells[b].level;
+    });
+
+    return result;
+}
+
+//========================================================================
+//  Recomputation
+//========================================================================
+void Model::evaluate(std::uint32_t cell, Machine& machine)
+{
+    Cell&           c = _cells[cell];
+    const double    value = machine.run(c.program, _values.data(), c.fcts.data());
+
+    // Bitwise, so a NaN staying NaN is no change
+    c.changed = std::memcmp(&_values[cell], &value, sizeof(value)) != 0;
+    _values[cell] = value;
+}
+
+std::size_t Model::run(ThreadPool* pool)
+{
+    std::size_t count = 0;
+    Machine     machine;
+
+    // A formula only depends on lower levels, and only queues higher
+    // ones: each level is complete when its turn comes.
+    if (_levels.size() <= _max_level)
+        _levels.resize(_max_level+1);
+
+    for(std::uint32_t cell : _queue)
+    {
+        const std::size_t level = _cells[cell].level;
+
+        // Set as an input since queued
+        if (!_cells[cell].formula)
+        {
+            _cells[cell].queued = false;
+            continue;
+        }
+
+        _levels[level].push_back(cell);
+    }
+    _queue.clear();
+
+    for(std::size_t level = 0; level < _levels.size(); ++level)
+    {
+        std::vector<std::uint32_t>& cells = _levels[level];
+
+        if (pool && cells.size() >= PARALLEL_THRESHOLD)
+        {
+            pool->parallel_for(cells.size(), [this, &cells](std::size_t begin, std::size_t end) {
+                Machine machine;
+
+                for(std::size_t i = begin; i < end; ++i)
+                    evaluate(cells[i], machine);
+            });
+        }
+        else
+        {
+            for(std::uint32_t cell : cells)
+                evaluate(cell, machine);
+        }
+
+        for(std::uint32_t cell : cells)
+        {
+            Cell& c = _cells[cell];
+
+            c.queued = false;
+            if (c.changed)
+            {
+                for(std::uint32_t dependent : c.dependents)
+                {
+                    Cell& d = _cells[dependent];
+
+                    if (!d.queued)
+                    {
+                        d.queued = true;
+                        _levels[d.level].push_back(dependent);
+                    }
+                }
+            }
+        }
+
+        count += cells.size();
+        cells.clear();
+    }
+
+    return count;
+}
+
+std::size_t Model::recompute()
+{
+    return run(nullptr);
+}
+
+std::size_t Model::recompute(ThreadPool& pool)
+{
+    return run(&pool);
+}
+
+} /* namespace */
@@ -0,0 +1,141 @@
+#if !defined LINLIB_MODEL_H
+#define LINLIB_MODEL_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lib/program.h"
+#include "lib/symbols.h"
+#include "lib/thread_pool.h"
+
+namespace linlib {
+
+enum struct ModelStatus
+{
+    OK,
+    SYNTAX_ERROR,       // the formula does not parse
+    UNKNOWN_FUNCTION,   // the formula calls a function not declared
+    CYCLE,              // the formula depends on itself
+};
+
+/**
+    A spreadsheet-like set of named cells. A cell is either an input,
+    set by the caller, or a formula, whose variables are other cells.
+
+    The dependencies of a formula are the cells it loads. The graph is
+    kept acyclic: a definition creating a cycle is rejected. Each cell
+    has a level, 0 for the inputs and one more than its deepest
+    dependency for the formulas, so the cells of a level never depend on
+    each other.
+
+    Changing a cell queues its dependents. `recompute()` evaluates the
+    queued formulas level by level, and only queues the dependents of
+    the ones whose value actually changed. So a tick costs the dirty
+    part of the downstream cone of the changed inputs, not the size of
+    the model.
+
+    A cell referenced before it is set or defined is an input, whose
+    value is NaN.
+*/
+class Model
+{
+    public:
+    static const std::uint32_t NOT_FOUND = SymbolTable::NOT_FOUND;
+
+    /**
+        Levels with fewer queued formulas are recomputed serially even
+        when a pool is given.
+    */
+    static const std::size_t PARALLEL_THRESHOLD = 64;
+
+    private:
+    struct Cell
+    {
+        bool                        formula = false;
+        Program                     program;        // LOAD arguments are cell numbers
+        std::vector<Function>       fcts;
+        std::vector<std::uint32_t>  dependencies;
+        std::vector<std::uint32_t>  dependents;
+        std::uint32_t               level = 0;
+        bool                        queued = false;
+        bool                        changed = false;
+    };
+
+    SymbolTable                                 _names;
+    std::vector<Cell>                           _cells;
+    std::vector<double>                         _values;
+    std::unordered_map<std::string, Function>   _functions;
+
+    std::vector<std::uint32_t>                  _queue;     // queued since the last recompute
+    std::vector<std::vector<std::uint32_t>>     _levels;    // recompute buckets
+    std::uint32_t                               _max_level = 0;
+
+    std::uint32_t intern(const std::string& name);
+    void queue(std::uint32_t cell);
+    void queue_dependents(std::uint32_t cell);
+    void unlink(std::uint32_t cell);
+    bool reaches(std::uint32_t from, const std::vector<std::uint32_t>& targets) const;
+    void relevel(std::uint32_t cell);
+    void evaluate(std::uint32_t cell, Machine& machine);
+    std::size_t run(ThreadPool* pool);
+
+    public:
+    /**
+        Declare a function formulas can call. Functions must be declared
+        before the formulas using them.
+    */
+    void function(const std::string& name, Function fct) { _functions[name] = fct; }
+
+    /**
+        Define, or redefine, the formula of a cell. On error, the model
+        is left unchanged, but for the cells created for the names the
+        formula references.
+    */
+    ModelStatus define(const std::string& name, const std::string& formula);
+
+    /**
+        Set the value of an input. A formula cell set this way becomes
+        an input.
+    */
+    void set(std::uint32_t cell, double value);
+    void set(const std::string& name, double value) { set(intern(name), value); }
+
+    /**
+        Recompute the queued formulas and their dependents, in
+        topological order. With a pool, the formulas of a level are
+        spread over its workers. Return the number of formulas
+        evaluated.
+    */
+    std::size_t recompute();
+    std::size_t recompute(ThreadPool& pool);
+
+    /**
+        Return the cell number of `name`, or NOT_FOUND.
+    */
+    inline std::uint32_t find(const std::string& name) const { return _names.find(name); }
+
+    inline std::size_t size() const { return _cells.size(); }
+    inline const std::string& name(std::uint32_t cell) const { return _names[cell]; }
+    inline bool formula(std::uint32_t cell) const { return _cells[cell].formula; }
+    inline std::uint32_t level(std::uint32_t cell) const { return _cells[cell].level; }
+    inline const std::vector<std::uint32_t>& dependencies(std::uint32_t cell) const { return _cells[cell].dependencies; }
+    inline const std::vector<std::uint32_t>& dependents(std::uint32_t cell) const { return _cells[cell].dependents; }
+
+    /**
+        Value of a cell, as of the last `recompute()` for the formulas.
+    */
+    inline double value(std::uint32_t cell) const { return _values[cell]; }
+    double value(const std::string& name) const;
+
+    /**
+        Return the formula cells in a topological order: every formula
+        comes after its dependencies.
+    */
+    std::vector<std::uint32_t> order() const;
+};
+
+} /* namespace */
+
+#endif
@@ -0,0 +1,85 @@
+#include <clocale>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "lib/number.h"
+#include "lib/decimal.h"
+
+namespace linlib {
+
+constexpr std::uint64_t Pow5Table::values[];
+constexpr double ExactPowers::values[];
+
+//========================================================================
+//  Slow path
+//
+//  strtod expects the decimal separator of the current locale, and a
+//  NUL-terminated string. Common literals are copied on the stack, so
+//  parsing does not allocate.
+//========================================================================
+static const std::size_t SLOW_PATH_BUFFER_SIZE = 128;
+
+static double slow_path(const char* start, std::size_t len)
+{
+    const char*         point = std::localeconv()->decimal_point;
+    const std::size_t   point_len = std::strlen(point);
+    char                local[SLOW_PATH_BUFFER_SIZE];
+    std::string         heap;
+    char*               buffer = local;
+
+    if (len*point_len + 1 > sizeof(local))
+    {
+        heap.resize(len*point_len + 1);
+        buffer = &heap[0];
+    }
+
+    char* out = buffer;
+    for(const char* p = start; p < start+len; ++p)
+    {
+        if (*p == '.')
+        {
+            std::memcpy(out, point, point_len);
+            out += point_len;
+        }
+        else
+        {
+            *out++ = *p;
+        }
+    }
+    *out = '\0';
+
+    return std::strtod(buffer, nullptr);
+}
+
+//========================================================================
+//  Public interface
+//========================================================================
+NumberStatus parse_number(const char* start, std::size_t len, double& value)
+{
+    Decimal decimal;
+
+    if (!scan_decimal(start, start+len, decimal))
+        return NumberStatus::SYNTAX_ERROR;
+
+    if (!decimal.truncated && clinger(decimal.w, decimal.q, value))
+        return NumberStatus::OK;
+
+    std::uint64_t   bits;
+
+    if (decimal_to_bits(decimal, bits))
+        std::memcpy(&value, &bits, sizeof(value));
+    else
+        value = slow_path(start, len);
+
+    if (value == 0 && decimal.w != 0)
+        return NumberStatus::TOO_SMALL;
+    if (value == HUGE_VAL)
+        return NumberStatus::TOO_LARGE;
+
+    return NumberStatus::OK;
+}
+
+} /* namespace */
@@ -0,0 +1,35 @@
+#if !defined LINLIB_NUMBER_H
+#define LINLIB_NUMBER_H
+
+#include <cstddef>
+
+namespace linlib {
+
+enum struct NumberStatus
+{
+    OK,
+    SYNTAX_ERROR,       // not a decimal number
+    TOO_LARGE,          // overflow: the value rounds to infinity
+    TOO_SMALL,          // underflow: a non-zero value rounds to zero
+};
+
+/**
+    Convert the decimal number in [start, start+len) to the nearest double.
+
+    The accepted syntax is the one of the NUMBER token:
+        digits [ '.' digits ] [ ('e'|'E') ['+'|'-'] digits ]
+    where either the integer or the fractional part may be empty (but
+    not both). The conversion does not depend on the current locale,
+    and never reads past `start+len`.
+
+    Most numbers are converted by the Clinger fast path or the
+    Eisel-Lemire algorithm. The rare inputs they can't decide (more
+    than 19 significant digits, very close to a halfway point) go
+    through `std::strtod`. The conversion allocates nothing, but for
+    those of them of 128 characters or more.
+*/
+NumberStatus parse_number(const char* start, std::size_t len, double& value);
+
+} /* namespace */
+
+#endif
@@ -0,0 +1,372 @@
+#include <cmath>
+
+#include "lib/optimizer.h"
+
+namespace linlib {
+
+const std::uint32_t Optimizer::POWI_MAX;
+
+namespace {
+
+/**
+    Compile-time view of a stack slot: the subexpression computing it
+    starts at `begin` in the output code.
+*/
+struct Slot
+{
+    std::size_t     begin;
+    bool            constant;
+    double          value;
+};
+
+double apply(OpCode op, double a, double b)
+{
+    switch(op)
+    {
+        case OpCode::ADD:
+            return a+b;
+        case OpCode::SUB:
+            return a-b;
+        case OpCode::MUL:
+            return a*b;
+        case OpCode::DIV:
+            return a/b;
+        case OpCode::POW:
+            return std::pow(a,b);
+        default:
+            return NAN;
+    };
+}
+
+/**
+    True if `x/c == x*(1/c)` for every x: c is a power of two with an
+    exact reciprocal.
+*/
+bool exact_reciprocal(double c)
+{
+    int         exponent;
+    const double r = 1.0/c;
+
+    return std::fabs(std::frexp(c, &exponent)) == 0.5 && r != 0 && std::isfinite(r) && 1.0/r == c;
+}
+
+/**
+    Drop unused entries from the constant, variable and function tables,
+    and recompute the stack depth. Shared symbol tables are left as is.
+*/
+void pack(Program& program)
+{
+    std::vector<double>         constants;
+    SymbolTable                 variables;
+    SymbolTable                 functions;
+
+    const bool                  renumber = !program.shared_symbols;
+
+    std::size_t depth = 0;
+    program.max_depth = 0;
+
+    for(Instruction& insn : program.code)
+    {
+        switch(insn.op)
+        {
+            case OpCode::CONST:
+                constants.push_back(program.constants[insn.arg]);
+                insn.arg = static_cast<std::uint32_t>(constants.size()-1);
+                ++depth;
+                break;
+            case OpCode::LOAD:
+                if (renumber)
+                    insn.arg = variables.intern(program.variables[insn.arg]);
+                ++depth;
+                break;
+            case OpCode::CALL:
+                if (renumber)
+                    insn.arg = functions.intern(program.functions[insn.arg]);
+                break;
+            case OpCode::NEG:
+            case OpCode::SQRT:
+                break;
+            case OpCode::POWI:
+                // The slot above the top of the stack is in use
+                if (depth+1 > program.max_depth)
+                    program.max_depth = depth+1;
+                break;
+            case OpCode::ADD:
+            case OpCode::SUB:
+            case OpCode::MUL:
+            case OpCode::DIV:
+            case OpCode::POW:
+                --depth;
+                break;
+        };
+
+        if (depth > program.max_depth)
+            program.max_depth = depth;
+    }
+
+    program.constants.swap(constants);
+    if (renumber)
+    {
+        program.variables = std::move(variables);
+        program.functions = std::move(functions);
+    }
+}
+
+} // namespace
+
+Optimizer::Report Optimizer::run(Program& program) const
+{
+    Report report = { 0, 0, 0, 0 };
+
+    const bool  relaxed = (_mode != STRICT);
+    const bool  fast_math = (_mode == FAST_MATH);
+
+    std::vector<Instruction>    out;
+    std::vector<Slot>           stack;
+
+    // New constants are appended to the pool; pack() drops the
+    // unused ones at the end.
+    auto emit_constant = [&](std::size_t begin, double value) {
+        out.resize(begin);
+        program.constants.push_back(value);
+        out.push_back({ OpCode::CONST, static_cast<std::uint32_t>(program.constants.size()-1) });
+        stack.push_back({ begin, true, value });
+    };
+
+    auto emit_neg = [&]() {
+        const Slot top = stack.back();
+
+        if (top.constant)
+        {
+            stack.pop_back();
+            emit_constant(top.begin, -top.value);
+            ++report.folded;
+        }
+        else if (out.back().op == OpCode::NEG)
+        {
+            // -(-x) == x, sign of NaN aside
+            out.pop_back();
+            ++report.simplified;
+        }
+        else
+            out.push_back({ OpCode::NEG, 0 });
+    };
+
+    // Replace the operation and its constant operand b by a unary
+    // operation on a
+    auto emit_unary = [&](const Slot& a, const Slot& b, OpCode op, std::uint32_t arg) {
+        out.resize(b.begin);
+        out.push_back({ op, arg });
+        stack.push_back({ a.begin, false, 0 });
+        ++report.reduced;
+    };
+
+    // Turn the top of the stack into its reciprocal
+    auto emit_reciprocal = [&]() {
+        const std::size_t begin = stack.back().begin;
+
+        program.constants.push_back(1.0);
+        out.insert(out.begin()+begin, Instruction{ OpCode::CONST, static_cast<std::uint32_t>(program.constants.size()-1) });
+        out.push_back({ OpCode::DIV, 0 });
+    };
+
+    for(const Instruction& insn : program.code)
+    {
+        switch(insn.op)
+        {
+            case OpCode::CONST:
+                stack.push_back({ out.size(), true, program.constants[insn.arg] });
+                out.push_back(insn);
+                break;
+
+            case OpCode::LOAD:
+                {
+                    auto it = _constants.find(program.variables[insn.arg]);
+                    if (it != _constants.end())
+                    {
+                        emit_constant(out.size(), it->second);
+                        ++report.folded;
+                    }
+                    else
+                    {
+                        stack.push_back({ out.size(), false, 0 });
+                        out.push_back(insn);
+                    }
+                }
+                break;
+
+            case OpCode::CALL:
+                {
+                    const Slot top = stack.back();
+                    auto it = _functions.find(program.functions[insn.arg]);
+                    if (top.constant && it != _functions.end())
+                    {
+                        stack.pop_back();
+                        emit_constant(top.begin, it->second(top.value));
+                        ++report.folded;
+                    }
+                    else
+                    {
+                        stack.back().constant = false;
+                        out.push_back(insn);
+                    }
+                }
+                break;
+
+            case OpCode::NEG:
+                emit_neg();
+                break;
+
+            case OpCode::ADD:
+            case OpCode::SUB:
+            case OpCode::MUL:
+            case OpCode::DIV:
+            case OpCode::POW:
+                {
+                    const Slot b = stack.back(); stack.pop_back();
+                    const Slot a = stack.back(); stack.pop_back();
+                    const OpCode op = insn.op;
+
+                    if (a.constant && b.constant)
+                    {
+                        emit_constant(a.begin, apply(op, a.value, b.value));
+                        ++report.folded;
+                        break;
+                    }
+
+                    // x*1, x/1, x**1, x-(+0), x+(-0)
+                    if (b.constant && (
+                        (b.value == 1 && (op == OpCode::MUL || op == OpCode::DIV || op == OpCode::POW))
+                        || (b.value == 0 && op == OpCode::SUB && (relaxed || !std::signbit(b.value)))
+                        || (b.value == 0 && op == OpCode::ADD && (relaxed || std::signbit(b.value)))))
+                    {
+                        out.resize(b.begin);
+                        stack.push_back(a);
+                        ++report.simplified;
+                        break;
+                    }
+
+                    // 1*x, (-0)+x
+                    if (a.constant && (
+                        (a.value == 1 && op == OpCode::MUL)
+                        || (a.value == 0 && op == OpCode::ADD && (relaxed || std::signbit(a.value)))))
+                    {
+                        out.erase(out.begin()+a.begin, out.begin()+b.begin);
+                        stack.push_back({ a.begin, false, 0 });
+                        ++report.simplified;
+                        break;
+                    }
+
+                    // x*-1, x/-1
+                    if (b.constant && b.value == -1 && (op == OpCode::MUL || op == OpCode::DIV))
+                    {
+                        out.resize(b.begin);
+                        stack.push_back(a);
+                        emit_neg();
+                        ++report.simplified;
+                        break;
+                    }
+
+                    // x**0 is 1 even for NaN
+                    if (b.constant && b.value == 0 && op == OpCode::POW)
+                    {
+                        emit_constant(a.begin, 1.0);
+                        ++report.simplified;
+                        break;
+                    }
+
+                    // x**n, x**-n, x**0.5
+                    if (b.constant && op == OpCode::POW)
+                    {
+                        // x*x is correctly rounded, longer chains are not
+                        const double n = std::fabs(b.value);
+
+                        if (b.value == 2 || (relaxed && n >= 2 && n <= POWI_MAX && n == std::floor(n)))
+                        {
+                            emit_unary(a, b, OpCode::POWI, static_cast<std::uint32_t>(n));
+                            if (b.value < 0)
+                                emit_reciprocal();
+                            break;
+                        }
+                        if (b.value == -1)
+                        {
+                            out.resize(b.begin);
+                            stack.push_back({ a.begin, false, 0 });
+                            emit_reciprocal();
+                            ++report.reduced;
+                            break;
+                        }
+                        if (relaxed && b.value == 0.5)
+                        {
+                            emit_unary(a, b, OpCode::SQRT, 0);
+                            break;
+                        }
+                    }
+
+                    // x/c
+                    if (b.constant && op == OpCode::DIV && (exact_reciprocal(b.value)
+                        || (fast_math && std::isfinite(b.value) && std::isnormal(1.0/b.value))))
+                    {
+                        out.resize(b.begin);
+                        program.constants.push_back(1.0/b.value);
+                        out.push_back({ OpCode::CONST, static_cast<std::uint32_t>(program.constants.size()-1) });
+                        out.push_back({ OpCode::MUL, 0 });
+                        stack.push_back({ a.begin, false, 0 });
+                        ++report.reduced;
+                        break;
+                    }
+
+                    if (relaxed)
+                    {
+                        // x*0, 0*x
+                        if (op == OpCode::MUL && ((a.constant && a.value == 0) || (b.constant && b.value == 0)))
+                        {
+                            emit_constant(a.begin, 0.0);
+                            ++report.simplified;
+                            break;
+                        }
+
+                        // 0-x
+                        if (op == OpCode::SUB && a.constant && a.value == 0)
+                        {
+                            out.erase(out.begin()+a.begin, out.begin()+b.begin);
+                            stack.push_back({ a.begin, false, 0 });
+                            emit_neg();
+                            ++report.simplified;
+                            break;
+                        }
+                    }
+
+                    out.push_back(insn);
+                    stack.push_back({ a.begin, false, 0 });
+                }
+                break;
+
+            case OpCode::POWI:
+            case OpCode::SQRT:
+                {
+                    const Slot top = stack.back();
+                    if (top.constant)
+                    {
+                        stack.pop_back();
+                        emit_constant(top.begin, insn.op == OpCode::POWI ? powi(top.value, insn.arg) : std::sqrt(top.value));
+                        ++report.folded;
+                    }
+                    else
+                        out.push_back(insn);
+                }
+                break;
+        };
+    }
+
+    // A reciprocal may make the code longer than it was
+    if (out.size() < program.code.size())
+        report.removed = program.code.size() - out.size();
+
+    program.code.swap(out);
+    pack(program);
+
+    return report;
+}
+
+} /* namespace */
@@ -0,0 +1,93 @@
+#if !defined LINLIB_OPTIMIZER_H
+#define LINLIB_OPTIMIZER_H
+
+#include <string>
+#include <unordered_map>
+
+#include "lib/program.h"
+
+namespace linlib {
+
+/**
+    Constant folding and algebraic simplification of compiled programs.
+
+    Since a program is in postfix order, every subexpression is a
+    contiguous range of instructions. The optimizer walks the program
+    once, tracking for each stack slot where its subexpression starts
+    and whether it is a known constant, so a subexpression can be
+    replaced or removed in place.
+
+    In STRICT mode, only rewrites preserving the IEEE semantics
+    (NaN, infinities and signed zeros) are applied. RELAXED mode also
+    applies identities like `x+0 = x` or `x*0 = 0` that don't hold
+    for every input. FAST_MATH mode implies RELAXED, and trades a few
+    ULPs of accuracy for speed.
+
+    Operations by a constant are strength reduced, within these bounds
+    relative to `std::pow` and correctly rounded division:
+
+    STRICT      x**2 -> x*x and x**-1 -> 1/x, correctly rounded, so
+                exact or better than `std::pow`. x/c -> x*(1/c) when c
+                is a power of two and 1/c is exact: bit-identical.
+
+    RELAXED     x**n -> powi(x, n), 2 <= n <= POWI_MAX: at most n ULPs
+                from `std::pow`. x**-n -> 1/powi(x, n): n+1 ULPs.
+                x**0.5 -> sqrt(x): 1 ULP, but sqrt(-0) is -0 and
+                sqrt(-inf) is NaN, where `std::pow` gives +0 and +inf.
+
+    FAST_MATH   x/c -> x*(1/c) for any c with a normal reciprocal:
+                at most 2 ULPs from x/c.
+
+    Functions bound with `function()` are assumed to be pure.
+*/
+class Optimizer
+{
+    public:
+    enum Mode
+    {
+        STRICT,
+        RELAXED,
+        FAST_MATH,
+    };
+
+    struct Report
+    {
+        std::size_t     folded;         // subexpressions replaced by a constant
+        std::size_t     simplified;     // algebraic identities applied
+        std::size_t     removed;        // net count of instructions removed
+        std::size_t     reduced;        // operations replaced by cheaper ones
+    };
+
+    private:
+    Mode                                        _mode;
+    std::unordered_map<std::string, double>     _constants;
+    std::unordered_map<std::string, Function>   _functions;
+
+    public:
+    /**
+        Largest exponent replaced by a chain of multiplications. The
+        chain is at most 2*log2(POWI_MAX) multiplications long.
+    */
+    static const std::uint32_t POWI_MAX = 32;
+
+    Optimizer(Mode mode = STRICT) : _mode(mode) {}
+
+    /**
+        Declare a variable whose value is known at compile time.
+    */
+    void constant(const std::string& name, double value) { _constants[name] = value; }
+
+    /**
+        Declare a pure function that can be evaluated at compile time.
+    */
+    void function(const std::string& name, Function fct) { _functions[name] = fct; }
+
+    /**
+        Optimize `program` in place.
+    */
+    Report run(Program& program) const;
+};
+
+} /* namespace */
+
+#endif
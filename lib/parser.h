@@ -1,93 +1,106 @@
 #if !defined LINLIB_PARSER_H
 #define LINLIB_PARSER_H
 
-#include <stack>
+#include <cstring>
+#include <string>
 
-#include "lib/tokenizer.h"
+#include "lib/basic_parser.h"
 
 namespace linlib {
 
-enum struct BinaryOpCode
-{
-    ADD,
-    SUB,
-    MUL,
-    DIV,
-
-    POW,
-};
-
-enum struct UnaryOpCode
-{
-    NEG,
-};
-
 class EventHandler
 {
-    public:
+    bool                    _quiet = false;
+    std::size_t             _len = std::string::npos;   // statement forwarded to a legacy callback
 
     protected:
+    /**
+        Deprecated, never called by the parsers. Kept for the handlers
+        still using it.
+    */
     virtual void error(const char* str) const { throw str; }
 
     public:
     virtual ~EventHandler(void) {}
 
+    /**
+        The default error callbacks print a diagnostic on stderr. A
+        quiet handler does no I/O: the diagnostic is left to the caller,
+        who can ask the parser for it. See `ParserBase::message()`.
+
+        A quiet parse is also free of heap allocations only while the
+        nesting bound is at most `ParserBase::INLINE_DEPTH`. The default
+        bound, DEFAULT_MAX_DEPTH, is larger: deeper expressions spill
+        the operator stack to the heap. See `ParserBase::max_depth()`.
+    */
+    inline void quiet(bool quiet) { _quiet = quiet; }
+    inline bool quiet() const { return _quiet; }
+
     virtual bool number(double value) = 0;
     virtual bool call(const char *identifier, std::size_t len) = 0;
     virtual bool load(const char *identifier, std::size_t len) = 0;
     virtual bool binary_op(BinaryOpCode opcode) = 0;
     virtual bool unary_op(UnaryOpCode opcode) = 0;
 
+    /*
+        Expression boundaries, only emitted by the StreamParser.
+        `end_expression` tells if the expression was parsed successfully.
+        Returning false stops the stream.
+    */
+    virtual bool begin_expression(const char* /*stmt*/, std::size_t /*len*/) { return true; }
+    virtual bool end_expression(bool /*ok*/) { return true; }
+
+    /*
+        Error reporting. The statement is the [stmt, stmt+len) span, it
+        is not necessarily NUL-terminated. The callbacks are notified
+        before `parse()` returns false; they must not throw.
+    */
+    virtual void bad_token_error(const char* stmt, std::size_t len, unsigned pos);
+    virtual void syntax_error(const char* stmt, std::size_t len, unsigned pos);
+    virtual void range_error(const char* stmt, std::size_t len, unsigned pos);
+    virtual void depth_error(const char* stmt, std::size_t len, unsigned pos);
+
+    /*
+        Deprecated: the error callbacks of NUL-terminated expressions.
+        The default `bad_token_error` and `syntax_error` above forward to
+        them, so handlers written against them are still notified, but
+        `stmt` is not necessarily NUL-terminated any more. Override the
+        callbacks above instead.
+    */
     virtual void bad_token_error(const char* stmt, unsigned pos);
     virtual void syntax_error(const char* stmt, unsigned pos);
 };
 
-class Parser
+/**
+    A parser dispatching the events to a virtual EventHandler.
+    See BasicParser for a parser bound to its handler at compile time.
+*/
+class Parser : public ParserBase
 {
-    public:
-    enum State
-    {
-        OK,
-        RUNNING,
-        INTERNAL_ERROR,
-        BAD_TOKEN_ERROR,
-        SYNTAX_ERROR,
-    };
-
-    private:
-    State                   _state;
-    const char*             _start;
-    Token                   _lookahead;
-
     EventHandler&           _handler;
 
     public:
     Parser(const char* expr, EventHandler& handler)
-      : _state(OK),
-        _start(expr),
-        _lookahead{ Token::END, "", 0 },
-        _handler(handler)
+      : Parser(expr, std::strlen(expr), handler)
     {
     }
 
-    bool   next();
-
     /**
-      Consume the given token if found in the stream, otherwise
-      report an error.
+        Parse the [expr, expr+len) span in place. The expression does
+        not have to be NUL-terminated, and must outlive the parser.
     */
-    bool expect(Token::Id id);
-
-    bool read_identifier();
-    bool read_number();
-
-    bool read_sum();
-    bool read_prod();
-    bool read_pow();
+    Parser(const char* expr, std::size_t len, EventHandler& handler)
+      : ParserBase(expr, len),
+        _handler(handler)
+    {
+    }
 
-    bool read_call();
-    bool read_term();
-    bool read_expr();
+#if __cplusplus >= 201703L
+    Parser(std::string_view expr, EventHandler& handler)
+      : Parser(expr.data(), expr.size(), handler)
+    {
+    }
+#endif
 
     /**
         Parse the expression. Stops at the first error and return false.
@@ -97,34 +110,6 @@ class Parser
         reentrant.
     */
     bool parse();
-
-    /*
-        Diagnostic info about the lattest `parse()` invocation.
-     */
-
-    /**
-        Parser curent state
-    */
-    inline State state(void) const { return _state; }
-
-    /**
-        Return a string-representation of state(). For human consumption only.
-     */
-    std::string  what() const;
-
-    /**
-        Return a formatted string identifying the last parsed code
-        fragment. For human consumption only.
-     */
-    std::string  where() const;
-
-    /**
-        Return a formatted string describing the current state of the parser.
-        The message is garanteed to contain both what() and where(), but
-        the order is unspecified. The message may also contain additional
-        informations. For human consumption only.
-     */
-    std::string  message() const;
 };
 
 } /* namespace */
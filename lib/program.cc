@@ -0,0 +1,249 @@
+#include <cmath>
+
+#include "lib/program.h"
+
+namespace linlib {
+
+//========================================================================
+//  Program
+//========================================================================
+void Program::clear()
+{
+    code.clear();
+    constants.clear();
+    variables.clear();
+    functions.clear();
+    shared_symbols = false;
+    max_depth = 0;
+}
+
+//========================================================================
+//  Compiler
+//========================================================================
+bool Compiler::emit(OpCode op, std::uint32_t arg, int stack_effect)
+{
+    _program.code.push_back({ op, arg });
+    _depth += stack_effect;
+    if (_depth > _program.max_depth)
+        _program.max_depth = _depth;
+
+    return true;
+}
+
+bool Compiler::symbol(OpCode op, SymbolTable& table, const char *identifier, std::size_t len, int stack_effect)
+{
+    const std::uint32_t slot = _open ? table.intern(identifier, len) : table.find(identifier, len);
+    if (slot == SymbolTable::NOT_FOUND)
+        return false;
+
+    return emit(op, slot, stack_effect);
+}
+
+bool Compiler::number(double value)
+{
+    _program.constants.push_back(value);
+    return emit(OpCode::CONST, static_cast<std::uint32_t>(_program.constants.size()-1), +1);
+}
+
+bool Compiler::call(const char *identifier, std::size_t len)
+{
+    return symbol(OpCode::CALL, _program.functions, identifier, len, 0);
+}
+
+bool Compiler::load(const char *identifier, std::size_t len)
+{
+    return symbol(OpCode::LOAD, _program.variables, identifier, len, +1);
+}
+
+bool Compiler::unary_op(UnaryOpCode opcode)
+{
+    switch(opcode)
+    {
+        case UnaryOpCode::NEG:
+            return emit(OpCode::NEG, 0, 0);
+    };
+
+    return false;
+}
+
+bool Compiler::binary_op(BinaryOpCode opcode)
+{
+    switch(opcode)
+    {
+        case BinaryOpCode::ADD:
+            return emit(OpCode::ADD, 0, -1);
+        case BinaryOpCode::SUB:
+            return emit(OpCode::SUB, 0, -1);
+        case BinaryOpCode::MUL:
+            return emit(OpCode::MUL, 0, -1);
+        case BinaryOpCode::DIV:
+            return emit(OpCode::DIV, 0, -1);
+        case BinaryOpCode::POW:
+            return emit(OpCode::POW, 0, -1);
+    };
+
+    return false;
+}
+
+bool compile(const char* expr, Program& program)
+{
+    program.clear();
+
+    Compiler    compiler{program};
+    Parser      parser{expr, compiler};
+
+    return parser.parse();
+}
+
+bool compile(const char* expr, Program& program,
+             const SymbolTable& variables, const SymbolTable& functions)
+{
+    program.clear();
+    program.variables = variables;
+    program.functions = functions;
+    program.shared_symbols = true;
+
+    Compiler    compiler{program, false};
+    Parser      parser{expr, compiler};
+
+    return parser.parse();
+}
+
+bool replay(const Program& program, EventHandler& handler)
+{
+    for(const Instruction& insn : program.code)
+    {
+        bool ok = false;
+
+        switch(insn.op)
+        {
+            case OpCode::CONST:
+                ok = handler.number(program.constants[insn.arg]);
+                break;
+            case OpCode::LOAD:
+                {
+                    const std::string& name = program.variables[insn.arg];
+                    ok = handler.load(name.data(), name.size());
+                }
+                break;
+            case OpCode::CALL:
+                {
+                    const std::string& name = program.functions[insn.arg];
+                    ok = handler.call(name.data(), name.size());
+                }
+                break;
+            case OpCode::NEG:
+                ok = handler.unary_op(UnaryOpCode::NEG);
+                break;
+            case OpCode::ADD:
+                ok = handler.binary_op(BinaryOpCode::ADD);
+                break;
+            case OpCode::SUB:
+                ok = handler.binary_op(BinaryOpCode::SUB);
+                break;
+            case OpCode::MUL:
+                ok = handler.binary_op(BinaryOpCode::MUL);
+                break;
+            case OpCode::DIV:
+                ok = handler.binary_op(BinaryOpCode::DIV);
+                break;
+            case OpCode::POW:
+                ok = handler.binary_op(BinaryOpCode::POW);
+                break;
+            case OpCode::POWI:
+                ok = handler.number(insn.arg) && handler.binary_op(BinaryOpCode::POW);
+                break;
+            case OpCode::SQRT:
+                ok = handler.number(0.5) && handler.binary_op(BinaryOpCode::POW);
+                break;
+        };
+
+        if (!ok)
+            return false;
+    }
+
+    return true;
+}
+
+//========================================================================
+//  Machine
+//========================================================================
+double Machine::run(const ProgramView& program, const double* vars, const Function* fcts)
+{
+    if (_stack.size() < program.max_depth)
+        _stack.resize(program.max_depth);
+
+    const double*   constants = program.constants;
+    double*         sp = _stack.data();
+
+    for(const Instruction* insn = program.code; insn != program.code + program.code_size; ++insn)
+    {
+        switch(insn->op)
+        {
+            case OpCode::CONST:
+                *sp++ = constants[insn->arg];
+                break;
+            case OpCode::LOAD:
+                *sp++ = vars[insn->arg];
+                break;
+            case OpCode::CALL:
+                sp[-1] = fcts[insn->arg](sp[-1]);
+                break;
+            case OpCode::NEG:
+                sp[-1] = -sp[-1];
+                break;
+            case OpCode::ADD:
+                --sp; sp[-1] = sp[-1] + sp[0];
+                break;
+            case OpCode::SUB:
+                --sp; sp[-1] = sp[-1] - sp[0];
+                break;
+            case OpCode::MUL:
+                --sp; sp[-1] = sp[-1] * sp[0];
+                break;
+            case OpCode::DIV:
+                --sp; sp[-1] = sp[-1] / sp[0];
+                break;
+            case OpCode::POW:
+                --sp; sp[-1] = std::pow(sp[-1], sp[0]);
+                break;
+            case OpCode::POWI:
+                sp[-1] = powi(sp[-1], insn->arg);
+                break;
+            case OpCode::SQRT:
+                sp[-1] = std::sqrt(sp[-1]);
+                break;
+        };
+    }
+
+    return sp[-1];
+}
+
+//========================================================================
+//  Standard library
+//========================================================================
+namespace {
+
+double f_sqrt(double x) { return std::sqrt(x); }
+double f_exp(double x) { return std::exp(x); }
+double f_log(double x) { return std::log(x); }
+double f_sin(double x) { return std::sin(x); }
+double f_cos(double x) { return std::cos(x); }
+double f_tan(double x) { return std::tan(x); }
+double f_abs(double x) { return std::fabs(x); }
+
+} /* namespace */
+
+Function library_function(const std::string& name)
+{
+    static const char* const    names[] = { "sqrt", "exp", "log", "sin", "cos", "tan", "abs" };
+    static const Function       fcts[] = { f_sqrt, f_exp, f_log, f_sin, f_cos, f_tan, f_abs };
+
+    for(std::size_t i = 0; i < sizeof(names)/sizeof(names[0]); ++i)
+        if (name == names[i])
+            return fcts[i];
+
+    return nullptr;
+}
+
+} /* namespace */
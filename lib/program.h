@@ -0,0 +1,209 @@
+#if !defined LINLIB_PROGRAM_H
+#define LINLIB_PROGRAM_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "lib/parser.h"
+#include "lib/symbols.h"
+
+namespace linlib {
+
+/**
+    Instruction set of the bytecode interpreter.
+
+    The opcodes map one-to-one to the events emitted by the parser,
+    so a program is just the recorded postfix event stream. POWI and
+    SQRT are the exception: only the Optimizer emits them, in place
+    of a POW by a constant exponent. See `replay()`.
+*/
+enum struct OpCode : std::uint32_t
+{
+    CONST,      // push constants[arg]
+    LOAD,       // push vars[arg]
+    CALL,       // replace the top of stack by fcts[arg](top)
+
+    NEG,
+
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    POW,
+
+    POWI,       // replace the top of stack by powi(top, arg), using the slot above it
+    SQRT,       // replace the top of stack by std::sqrt(top)
+};
+
+struct Instruction
+{
+    OpCode          op;
+    std::uint32_t   arg;
+};
+
+typedef double (*Function)(double);
+
+/**
+    Raise `x` to the integer power `n`, the argument of a POWI
+    instruction, by binary powering: about log2(n) multiplications
+    instead of a call to `std::pow`. Rounding errors add up, so the
+    result is within n ULPs of `std::pow` in the normal range. NaN,
+    infinities and signed zeros behave as with `std::pow`.
+*/
+inline double powi(double x, std::uint32_t n)
+{
+    double result = (n & 1) ? x : 1.0;
+
+    while(n >>= 1)
+    {
+        x *= x;
+        if (n & 1)
+            result *= x;
+    }
+
+    return result;
+}
+
+/**
+    A compiled expression.
+
+    Variables and functions are referenced by their slot in the
+    `variables` and `functions` tables. The caller binds them at
+    evaluation time by passing arrays indexed by slot.
+*/
+struct Program
+{
+    std::vector<Instruction>    code;
+    std::vector<double>         constants;
+
+    SymbolTable                 variables;
+    SymbolTable                 functions;
+
+    /**
+        True if the symbol tables were supplied by the caller, so several
+        programs share the same slots. Passes must not renumber them.
+    */
+    bool                        shared_symbols = false;
+
+    /**
+        Number of stack slots required to run the program, including
+        the one above the top of the stack used by POWI.
+    */
+    std::size_t                 max_depth = 0;
+
+    void clear();
+};
+
+/**
+    The code and constants of a program, stored elsewhere: in a Program,
+    or in the pages of a mapped ProgramImage. A view does not own the
+    memory it references.
+*/
+struct ProgramView
+{
+    const Instruction*          code = nullptr;
+    std::size_t                 code_size = 0;
+    const double*               constants = nullptr;
+    std::size_t                 max_depth = 0;
+
+    ProgramView() {}
+
+    ProgramView(const Program& program)
+      : code(program.code.data()),
+        code_size(program.code.size()),
+        constants(program.constants.data()),
+        max_depth(program.max_depth)
+    {
+    }
+};
+
+/**
+    An event handler recording the postfix event stream into a Program.
+
+    Names are interned once, at compile time, into the symbol tables
+    of the program, so evaluation never looks at them again.
+*/
+class Compiler : public EventHandler
+{
+    Program&        _program;
+    std::size_t     _depth;
+    bool            _open;
+
+    bool emit(OpCode op, std::uint32_t arg, int stack_effect);
+    bool symbol(OpCode op, SymbolTable& table, const char *identifier, std::size_t len, int stack_effect);
+
+    public:
+    /**
+        Add the symbols to the program tables as they are found.
+    */
+    Compiler(Program& program) : _program(program), _depth(0), _open(true) {}
+
+    /**
+        If `open` is false, the symbol tables of the program are fixed:
+        loading or calling an unknown symbol is an error.
+    */
+    Compiler(Program& program, bool open) : _program(program), _depth(0), _open(open) {}
+
+    bool number(double value);
+    bool call(const char *identifier, std::size_t len);
+    bool load(const char *identifier, std::size_t len);
+    bool binary_op(BinaryOpCode opcode);
+    bool unary_op(UnaryOpCode opcode);
+};
+
+/**
+    A stack machine running compiled programs.
+
+    The machine keeps its stack between runs, so a single instance
+    can evaluate the same program many times without allocating.
+    A machine is _not_ thread-safe; use one instance per thread.
+*/
+class Machine
+{
+    std::vector<double>     _stack;
+
+    public:
+    /**
+        Run the program. `vars` and `fcts` are indexed like the
+        `variables` and `functions` tables of the program.
+    */
+    double run(const ProgramView& program, const double* vars, const Function* fcts);
+
+    double run(const Program& program, const double* vars, const Function* fcts)
+    {
+        return run(ProgramView(program), vars, fcts);
+    }
+};
+
+/**
+    Parse `expr` and compile it into `program`.
+    Return true on success.
+*/
+bool compile(const char* expr, Program& program);
+
+/**
+    Parse `expr` and compile it into `program`, using the given symbol
+    tables. Unknown symbols are rejected. Programs compiled against
+    the same tables can be evaluated with the same binding arrays.
+    Return true on success.
+*/
+bool compile(const char* expr, Program& program,
+             const SymbolTable& variables, const SymbolTable& functions);
+
+/**
+    Send the events recorded in `program` to `handler`, in the same
+    order as the parser would. Stops and return false as soon as the
+    handler does. POWI and SQRT are sent as the POW they replace.
+*/
+bool replay(const Program& program, EventHandler& handler);
+
+/**
+    Return the function of the standard library with the given name
+    (sqrt, exp, log, sin, cos, tan, abs), or nullptr.
+*/
+Function library_function(const std::string& name);
+
+} /* namespace */
+
+#endif
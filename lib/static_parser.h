@@ -0,0 +1,651 @@
+#if !defined LINLIB_STATIC_PARSER_H
+#define LINLIB_STATIC_PARSER_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "lib/decimal.h"
+#include "lib/program.h"
+#include "lib/tokenizer.h"
+
+namespace linlib {
+
+//========================================================================
+//  Compile-time tokenizer
+//========================================================================
+/**
+    A constexpr counterpart of the Tokenizer. It splits the
+    [expr, expr+len) span into the same tokens, with the character
+    classes of the "C" locale.
+*/
+class StaticTokenizer
+{
+    const char* _rest;
+    const char* _end;
+
+    static constexpr bool is_space(char c)
+    {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+    static constexpr bool is_alpha(char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    }
+
+    static constexpr bool is_digit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    constexpr Token token(Token::Id id, const char* start)
+    {
+        return { id, start, static_cast<std::size_t>(_rest-start) };
+    }
+
+    constexpr void skip_digits()
+    {
+        while(_rest < _end && is_digit(*_rest))
+            ++_rest;
+    }
+
+    public:
+    constexpr StaticTokenizer(const char* expr, std::size_t len) : _rest(expr), _end(expr+len) {}
+
+    constexpr Token next()
+    {
+        while(_rest < _end && is_space(*_rest))
+            ++_rest;
+
+        const char* start = _rest;
+
+        if (_rest == _end)
+            return token(Token::END, start);
+
+        const char c = *_rest++;
+
+        if (is_alpha(c))
+        {
+            while(_rest < _end && (is_alpha(*_rest) || is_digit(*_rest)))
+                ++_rest;
+
+            return token(Token::SYMBOL, start);
+        }
+
+        if (c == '.' || is_digit(c))
+        {
+            _rest = start;
+            skip_digits();
+            if (_rest < _end && *_rest == '.')
+            {
+                ++_rest;
+                skip_digits();
+            }
+            if (_rest < _end && (*_rest == 'e' || *_rest == 'E'))
+            {
+                ++_rest;
+                if (_rest < _end && (*_rest == '+' || *_rest == '-'))
+                    ++_rest;
+                skip_digits();
+            }
+
+            return token(Token::NUMBER, start);
+        }
+
+        switch(c)
+        {
+            case '*':
+                if (_rest < _end && *_rest == '*')
+                {
+                    ++_rest;
+                    return token(Token::POW, start);
+                }
+                return token(Token::TIMES, start);
+            case '+': case '-': case '/': case '(': case ')':
+                return token(static_cast<Token::Id>(c), start);
+            default:
+                while(_rest < _end && (*_rest & 0x80))
+                    ++_rest;
+
+                return token(Token::BAD_TOKEN, start);
+        }
+    }
+};
+
+//========================================================================
+//  Compile-time program
+//========================================================================
+enum struct StaticStatus
+{
+    OK,
+    BAD_TOKEN_ERROR,
+    SYNTAX_ERROR,
+    RANGE_ERROR,        // a literal overflows or underflows
+    DEPTH_ERROR,        // nested deeper than STATIC_MAX_DEPTH
+    CAPACITY_ERROR,     // more nodes than the program can hold
+    UNKNOWN_FUNCTION,   // not one of the StaticFunction
+    UNDECIDED_LITERAL,  // a literal the fast conversions can't round
+};
+
+/**
+    The functions a compile-time expression can call.
+*/
+enum struct StaticFunction : std::uint32_t
+{
+    SQRT,
+    EXP,
+    LOG,
+    SIN,
+    COS,
+    TAN,
+    ABS,
+};
+
+/**
+    Nesting bound of the compile-time parser. It keeps the recursion
+    well below the constexpr evaluation depth of the compilers.
+*/
+static constexpr std::size_t STATIC_MAX_DEPTH = 64;
+
+/**
+    A node of the expression tree. `left` and `right` are the indices
+    of the operands, `arg` the slot of a constant, a variable or a
+    StaticFunction.
+*/
+struct StaticNode
+{
+    OpCode          op;
+    std::uint32_t   arg;
+    std::uint32_t   left;
+    std::uint32_t   right;
+};
+
+struct StaticSymbol
+{
+    const char*     start;
+    std::size_t     length;
+};
+
+/**
+    An expression compiled at compile time, as a tree of at most N
+    nodes. The operands of a node always come before it.
+
+    Variables are numbered in order of first appearance, like in a
+    Program compiled with open symbol tables.
+*/
+template<std::size_t N>
+struct StaticProgram
+{
+    StaticNode      nodes[N] = {};
+    double          constants[N] = {};
+    StaticSymbol    variables[N] = {};
+
+    std::size_t     node_count = 0;
+    std::size_t     constant_count = 0;
+    std::size_t     variable_count = 0;
+    std::size_t     root = 0;
+
+    StaticStatus    status = StaticStatus::OK;
+    std::size_t     position = 0;   // offset of the offending token
+};
+
+//========================================================================
+//  Compile-time parser
+//========================================================================
+/**
+    A constexpr recursive descent parser building a StaticProgram.
+
+    It accepts the grammar of the Parser, with the same precedences and
+    associativity, so both build the same expression:
+
+        sum  := prod [ '+'|'-' prod ]*
+        prod := pow [ '*'|'/' pow ]*
+        pow  := term [ '**' term ]*
+        term := ('+'|'-') term | '(' sum ')' | NUMBER | SYMBOL [ '(' sum ')' ]
+
+    Errors are recorded in the program instead of being reported to a
+    handler, so they can be checked by a static_assert.
+*/
+template<std::size_t N>
+class StaticCompiler
+{
+    StaticProgram<N>    _program;
+    const char*         _start;
+    StaticTokenizer     _tokenizer;
+    Token               _lookahead;
+    std::size_t         _depth;
+
+    constexpr bool error(StaticStatus status, const Token& token)
+    {
+        _program.status = status;
+        _program.position = static_cast<std::size_t>(token.start-_start);
+
+        return false;
+    }
+
+    constexpr bool error(StaticStatus status)
+    {
+        return error(status, _lookahead);
+    }
+
+    constexpr bool next()
+    {
+        _lookahead = _tokenizer.next();
+
+        return _lookahead.id != Token::BAD_TOKEN || error(StaticStatus::BAD_TOKEN_ERROR);
+    }
+
+    constexpr bool expect(Token::Id id)
+    {
+        return (_lookahead.id == id) ? next() : error(StaticStatus::SYNTAX_ERROR);
+    }
+
+    constexpr bool node(OpCode op, std::uint32_t arg, std::uint32_t left, std::uint32_t right,
+                        std::uint32_t& index)
+    {
+        if (_program.node_count == N)
+            return error(StaticStatus::CAPACITY_ERROR);
+
+        index = static_cast<std::uint32_t>(_program.node_count++);
+        _program.nodes[index] = { op, arg, left, right };
+
+        return true;
+    }
+
+    static constexpr bool same(const char* a, const char* b, std::size_t len)
+    {
+        for(std::size_t i = 0; i < len; ++i)
+            if (a[i] != b[i])
+                return false;
+
+        return true;
+    }
+
+    static constexpr bool builtin(const Token& token, std::uint32_t& id)
+    {
+        const char* const names[] = { "sqrt", "exp", "log", "sin", "cos", "tan", "abs" };
+
+        for(std::uint32_t i = 0; i < sizeof(names)/sizeof(names[0]); ++i)
+        {
+            std::size_t len = 0;
+            while(names[i][len])
+                ++len;
+
+            if (len == token.length && same(names[i], token.start, len))
+            {
+                id = i;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    constexpr bool number(std::uint32_t& index)
+    {
+        const Token token = _lookahead;
+        Decimal     decimal = { 0, 0, false };
+        double      value = 0;
+
+        if (!scan_decimal(token.start, token.start+token.length, decimal))
+            return error(StaticStatus::SYNTAX_ERROR);
+
+        if (decimal.truncated || !clinger(decimal.w, decimal.q, value))
+        {
+            std::uint64_t bits = 0;
+
+            if (!decimal_to_bits(decimal, bits))
+                return error(StaticStatus::UNDECIDED_LITERAL);
+            if ((bits >> DOUBLE_MANTISSA_BITS) == DOUBLE_INFINITE_POWER)
+                return error(StaticStatus::RANGE_ERROR);
+
+            value = bits_to_double(bits);
+        }
+
+        if (value == 0 && decimal.w != 0)
+            return error(StaticStatus::RANGE_ERROR);
+
+        const std::size_t slot = _program.constant_count;
+
+        if (!node(OpCode::CONST, static_cast<std::uint32_t>(slot), 0, 0, index))
+            return false;
+
+        _program.constants[slot] = value;
+        ++_program.constant_count;
+
+        return next();
+    }
+
+    constexpr bool load(const Token& token, std::uint32_t& index)
+    {
+        std::size_t slot = 0;
+
+        while(slot < _program.variable_count
+              && !(_program.variables[slot].length == token.length
+                   && same(_program.variables[slot].start, token.start, token.length)))
+            ++slot;
+
+        if (!node(OpCode::LOAD, static_cast<std::uint32_t>(slot), 0, 0, index))
+            return false;
+
+        if (slot == _program.variable_count)
+            _program.variables[_program.variable_count++] = { token.start, token.length };
+
+        return true;
+    }
+
+    constexpr bool operand(std::uint32_t& index)
+    {
+        const Token token = _lookahead;
+
+        switch(token.id)
+        {
+            case Token::PLUS:
+                return next() && term(index);
+            case Token::MINUS:
+                return next() && term(index) && node(OpCode::NEG, 0, index, 0, index);
+            case Token::LPAR:
+                return next() && sum(index) && expect(Token::RPAR);
+            case Token::NUMBER:
+                return number(index);
+            case Token::SYMBOL:
+                {
+                    if (!next())
+                        return false;
+
+                    if (_lookahead.id != Token::LPAR)
+                        return load(token, index);
+
+                    std::uint32_t id = 0;
+
+                    if (!builtin(token, id))
+                        return error(StaticStatus::UNKNOWN_FUNCTION, token);
+
+                    return next() && sum(index) && expect(Token::RPAR)
+                        && node(OpCode::CALL, id, index, 0, index);
+                }
+            default:
+                return error(StaticStatus::SYNTAX_ERROR);
+        }
+    }
+
+    constexpr bool term(std::uint32_t& index)
+    {
+        if (_depth == STATIC_MAX_DEPTH)
+            return error(StaticStatus::DEPTH_ERROR);
+
+        ++_depth;
+        const bool result = operand(index);
+        --_depth;
+
+        return result;
+    }
+
+    /**
+        Parse `operand [ op operand ]*`, left-associative, where `op`
+        is one of the two tokens given.
+    */
+    template<class Operand>
+    constexpr bool chain(std::uint32_t& index, Token::Id id1, OpCode op1, Token::Id id2, OpCode op2,
+                         Operand operand)
+    {
+        if (!(this->*operand)(index))
+            return false;
+
+        while(_lookahead.id == id1 || _lookahead.id == id2)
+        {
+            const OpCode    op = (_lookahead.id == id1) ? op1 : op2;
+            std::uint32_t   right = 0;
+
+            if (!next() || !(this->*operand)(right) || !node(op, 0, index, right, index))
+                return false;
+        }
+
+        return true;
+    }
+
+    constexpr bool pow(std::uint32_t& index)
+    {
+        return chain(index, Token::POW, OpCode::POW, Token::POW, OpCode::POW, &StaticCompiler::term);
+    }
+
+    constexpr bool prod(std::uint32_t& index)
+    {
+        return chain(index, Token::TIMES, OpCode::MUL, Token::SLASH, OpCode::DIV, &StaticCompiler::pow);
+    }
+
+    constexpr bool sum(std::uint32_t& index)
+    {
+        return chain(index, Token::PLUS, OpCode::ADD, Token::MINUS, OpCode::SUB, &StaticCompiler::prod);
+    }
+
+    public:
+    constexpr StaticCompiler(const char* expr, std::size_t len)
+      : _program(),
+        _start(expr),
+        _tokenizer(expr, len),
+        _lookahead{ Token::END, expr, 0 },
+        _depth(0)
+    {
+    }
+
+    constexpr StaticProgram<N> compile()
+    {
+        std::uint32_t root = 0;
+
+        if (next() && sum(root) && expect(Token::END))
+            _program.root = root;
+
+        return _program;
+    }
+};
+
+//========================================================================
+//  Public interface
+//========================================================================
+constexpr std::size_t static_length(const char* expr)
+{
+    std::size_t len = 0;
+
+    while(expr[len])
+        ++len;
+
+    return len;
+}
+
+/**
+    An upper bound of the number of nodes of the expression: each node
+    comes from a distinct token.
+*/
+constexpr std::size_t static_capacity(const char* expr)
+{
+    StaticTokenizer tokenizer(expr, static_length(expr));
+    std::size_t     count = 1;
+
+    for(Token token = tokenizer.next(); token.id > Token::END; token = tokenizer.next())
+        ++count;
+
+    return count;
+}
+
+/**
+    Parse `expr` into a program of at most N nodes. Usable in constant
+    expressions; check the `status` of the result.
+*/
+template<std::size_t N>
+constexpr StaticProgram<N> static_compile(const char* expr)
+{
+    return StaticCompiler<N>(expr, static_length(expr)).compile();
+}
+
+/**
+    Evaluation of the node I of `Expression::program`. Each operation
+    is a distinct type, so the whole tree is inlined in the caller
+    as straight-line code.
+*/
+template<class Expression, std::size_t I, OpCode Op = Expression::program.nodes[I].op>
+struct StaticEval;
+
+template<StaticFunction F>
+struct StaticCall;
+
+/**
+    Report the status and position of an invalid expression in the
+    diagnostics of the compiler.
+*/
+template<StaticStatus Status, std::size_t Position>
+struct StaticCheck
+{
+    static constexpr bool ok = (Status == StaticStatus::OK);
+};
+
+/**
+    An expression parsed at compile time, from the text returned by the
+    constexpr `Source::text()` function. See LINLIB_STATIC_EXPRESSION.
+
+    An invalid expression is a compile error. A valid one is called
+    like an ordinary function, with one argument per variable in order
+    of first appearance:
+
+        struct Norm { static constexpr const char* text() { return "sqrt(x*x + y*y)"; } };
+
+        StaticExpression<Norm> norm;
+        double d = norm(3, 4);
+*/
+template<class Source>
+class StaticExpression
+{
+    public:
+    static constexpr std::size_t capacity = static_capacity(Source::text());
+    static constexpr StaticProgram<capacity> program = static_compile<capacity>(Source::text());
+
+    static_assert(StaticCheck<program.status, program.position>::ok,
+                  "invalid expression, see the StaticCheck arguments for the status and position");
+
+    /**
+        Number of variables
+    */
+    static constexpr std::size_t arity = program.variable_count;
+
+    template<class... Args>
+    double operator()(Args... args) const
+    {
+        static_assert(sizeof...(Args) == arity, "one argument per variable is required");
+
+        const double vars[] = { static_cast<double>(args)..., 0.0 };
+
+        return run(vars);
+    }
+
+    /**
+        Evaluate with the variables read from `vars`, indexed like
+        `program.variables`.
+    */
+    static double run(const double* vars)
+    {
+        return StaticEval<StaticExpression, program.root>::run(vars);
+    }
+};
+
+template<class Source>
+constexpr std::size_t StaticExpression<Source>::capacity;
+
+template<class Source>
+constexpr StaticProgram<StaticExpression<Source>::capacity> StaticExpression<Source>::program;
+
+template<class Source>
+constexpr std::size_t StaticExpression<Source>::arity;
+
+/**
+    A StaticExpression of the given string literal:
+
+        static const auto norm = LINLIB_STATIC_EXPRESSION("sqrt(x*x + y*y)");
+*/
+#define LINLIB_STATIC_EXPRESSION(expr)                                          \
+    ([]{                                                                        \
+        struct Source { static constexpr const char* text() { return expr; } }; \
+        return ::linlib::StaticExpression<Source>{};                            \
+    }())
+
+//========================================================================
+//  Evaluation
+//========================================================================
+template<class E, std::size_t I>
+struct StaticEval<E, I, OpCode::CONST>
+{
+    static inline double run(const double*)
+    {
+        constexpr double value = E::program.constants[E::program.nodes[I].arg];
+        return value;
+    }
+};
+
+template<class E, std::size_t I>
+struct StaticEval<E, I, OpCode::LOAD>
+{
+    static inline double run(const double* vars)
+    {
+        return vars[E::program.nodes[I].arg];
+    }
+};
+
+template<class E, std::size_t I>
+struct StaticEval<E, I, OpCode::CALL>
+{
+    static inline double run(const double* vars)
+    {
+        return StaticCall<static_cast<StaticFunction>(E::program.nodes[I].arg)>::run(
+            StaticEval<E, E::program.nodes[I].left>::run(vars));
+    }
+};
+
+template<class E, std::size_t I>
+struct StaticEval<E, I, OpCode::NEG>
+{
+    static inline double run(const double* vars)
+    {
+        return -StaticEval<E, E::program.nodes[I].left>::run(vars);
+    }
+};
+
+#define LINLIB_STATIC_BINARY(opcode, expr)                                      \
+template<class E, std::size_t I>                                                \
+struct StaticEval<E, I, OpCode::opcode>                                         \
+{                                                                               \
+    static inline double run(const double* vars)                                \
+    {                                                                           \
+        const double a = StaticEval<E, E::program.nodes[I].left>::run(vars);    \
+        const double b = StaticEval<E, E::program.nodes[I].right>::run(vars);   \
+        return expr;                                                            \
+    }                                                                           \
+};
+
+LINLIB_STATIC_BINARY(ADD, a + b)
+LINLIB_STATIC_BINARY(SUB, a - b)
+LINLIB_STATIC_BINARY(MUL, a * b)
+LINLIB_STATIC_BINARY(DIV, a / b)
+LINLIB_STATIC_BINARY(POW, std::pow(a, b))
+
+#undef LINLIB_STATIC_BINARY
+
+#define LINLIB_STATIC_CALL(id, fct)                                             \
+template<>                                                                      \
+struct StaticCall<StaticFunction::id>                                           \
+{                                                                               \
+    static inline double run(double x) { return fct(x); }                      \
+};
+
+LINLIB_STATIC_CALL(SQRT, std::sqrt)
+LINLIB_STATIC_CALL(EXP, std::exp)
+LINLIB_STATIC_CALL(LOG, std::log)
+LINLIB_STATIC_CALL(SIN, std::sin)
+LINLIB_STATIC_CALL(COS, std::cos)
+LINLIB_STATIC_CALL(TAN, std::tan)
+LINLIB_STATIC_CALL(ABS, std::fabs)
+
+#undef LINLIB_STATIC_CALL
+
+} /* namespace */
+
+#endif
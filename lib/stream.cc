@@ -0,0 +1,126 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "lib/stream.h"
+
+namespace linlib {
+
+//========================================================================
+//  StreamParser
+//========================================================================
+static inline const char* delimiter(const char* p, const char* end)
+{
+    while(p < end && *p != ';' && *p != '\n')
+        ++p;
+
+    return p;
+}
+
+static inline bool blank(const char* stmt, std::size_t len)
+{
+    return Tokenizer{stmt, len}.next().id == Token::END;
+}
+
+bool StreamParser::next()
+{
+    while(_rest < _end)
+    {
+        const char*         stmt = _rest;
+        const char*         end = delimiter(stmt, _end);
+        const std::size_t   len = static_cast<std::size_t>(end-stmt);
+
+        _rest = (end < _end) ? end+1 : end;
+
+        if (blank(stmt, len))
+            continue;
+
+        ++_stats.expressions;
+
+        if (!_handler.begin_expression(stmt, len))
+            return stop();
+
+        Parser      parser{stmt, len, _handler};
+        const bool  ok = parser.parse();
+
+        _state = parser.state();
+        if (!ok)
+            ++_stats.errors;
+
+        if (_handler.end_expression(ok))
+            return true;
+        if (ok)
+            return stop();
+
+        // The expression is already counted, and keeps its parse error
+        _rest = _end;
+        return false;
+    }
+
+    return false;
+}
+
+/**
+    The handler refused an expression boundary: this is an internal
+    error, and the end of the stream.
+*/
+bool StreamParser::stop()
+{
+    _state = Parser::INTERNAL_ERROR;
+    ++_stats.errors;
+    _rest = _end;
+
+    return false;
+}
+
+bool StreamParser::parse()
+{
+    while(next())
+    {
+        // nothing
+    }
+
+    return _stats.errors == 0;
+}
+
+//========================================================================
+//  MappedFile
+//========================================================================
+MappedFile::MappedFile(const char* path)
+  : _data(nullptr), _size(0)
+{
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0)
+    {
+        if (st.st_size == 0)
+        {
+            // An empty file can't be mapped
+            _data = "";
+        }
+        else
+        {
+            void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED)
+            {
+                madvise(addr, st.st_size, MADV_SEQUENTIAL);
+                _data = static_cast<const char*>(addr);
+                _size = st.st_size;
+            }
+        }
+    }
+
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (_size)
+        munmap(const_cast<char*>(_data), _size);
+}
+
+} /* namespace */
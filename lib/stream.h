@@ -0,0 +1,96 @@
+#if !defined LINLIB_STREAM_H
+#define LINLIB_STREAM_H
+
+#include <cstddef>
+
+#include "lib/parser.h"
+
+namespace linlib {
+
+/**
+    Parse a buffer holding many expressions, separated by ';' or
+    newlines. Blank expressions are skipped.
+
+    Each expression is parsed in place with its own Parser, between a
+    `begin_expression` and an `end_expression` event. Errors are
+    reported to the handler as usual, then parsing resumes at the next
+    expression. The parser allocates nothing, so memory use does not
+    depend on the size of the buffer.
+*/
+class StreamParser
+{
+    public:
+    struct Stats
+    {
+        std::size_t     expressions;
+        std::size_t     errors;
+    };
+
+    private:
+    const char*             _rest;
+    const char*             _end;
+    EventHandler&           _handler;
+
+    Parser::State           _state;
+    Stats                   _stats;
+
+    bool stop();
+
+    public:
+    StreamParser(const char* buffer, std::size_t len, EventHandler& handler)
+      : _rest(buffer),
+        _end(buffer+len),
+        _handler(handler),
+        _state(Parser::OK),
+        _stats{ 0, 0 }
+    {
+    }
+
+    /**
+        Parse the next expression. Return false at the end of the
+        buffer, or if the handler stopped the stream by returning false
+        from an expression boundary event.
+    */
+    bool next();
+
+    /**
+        Parse all the remaining expressions. Return true if all of them
+        were parsed successfully.
+    */
+    bool parse();
+
+    /**
+        State of the parser after the latest expression.
+    */
+    inline Parser::State state() const { return _state; }
+
+    inline const Stats& stats() const { return _stats; }
+};
+
+/**
+    A read-only memory mapping of a whole file, to be used as the
+    buffer of a StreamParser.
+*/
+class MappedFile
+{
+    const char*             _data;
+    std::size_t             _size;
+
+    public:
+    /**
+        Map the file at `path`. Check `is_open()` for errors.
+    */
+    explicit MappedFile(const char* path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    inline bool is_open() const { return _data != nullptr; }
+    inline const char* data() const { return _data; }
+    inline std::size_t size() const { return _size; }
+};
+
+} /* namespace */
+
+#endif
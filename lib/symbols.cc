@@ -0,0 +1,86 @@
+#include <cstring>
+
+#include "lib/symbols.h"
+
+namespace linlib {
+
+const std::uint32_t SymbolTable::EMPTY;
+const std::uint32_t SymbolTable::NOT_FOUND;
+
+static std::uint32_t fnv1a(const char* name, std::size_t len)
+{
+    std::uint32_t h = 2166136261u;
+
+    for(std::size_t i = 0; i < len; ++i)
+        h = (h ^ static_cast<unsigned char>(name[i])) * 16777619u;
+
+    return h;
+}
+
+SymbolTable::SymbolTable(std::initializer_list<const char*> names)
+{
+    for(const char* name : names)
+        intern(name, std::strlen(name));
+}
+
+/**
+    Return the bucket holding `name`, or the empty bucket where it
+    should be inserted.
+*/
+std::size_t SymbolTable::bucket(const char* name, std::size_t len) const
+{
+    const std::size_t mask = _buckets.size()-1;
+
+    for(std::size_t i = fnv1a(name, len) & mask; ; i = (i+1) & mask)
+    {
+        const std::uint32_t slot = _buckets[i];
+
+        if (slot == EMPTY)
+            return i;
+
+        const std::string& candidate = _names[slot];
+        if (candidate.size() == len && std::memcmp(candidate.data(), name, len) == 0)
+            return i;
+    }
+}
+
+void SymbolTable::rehash(std::size_t count)
+{
+    _buckets.assign(count, EMPTY);
+
+    for(std::uint32_t slot = 0; slot < _names.size(); ++slot)
+        _buckets[bucket(_names[slot].data(), _names[slot].size())] = slot;
+}
+
+std::uint32_t SymbolTable::intern(const char* name, std::size_t len)
+{
+    // Keep the load factor under 1/2
+    if (2*(_names.size()+1) > _buckets.size())
+        rehash(_buckets.empty() ? 16 : 2*_buckets.size());
+
+    const std::size_t i = bucket(name, len);
+
+    if (_buckets[i] == EMPTY)
+    {
+        _names.emplace_back(name, len);
+        _buckets[i] = static_cast<std::uint32_t>(_names.size()-1);
+    }
+
+    return _buckets[i];
+}
+
+std::uint32_t SymbolTable::find(const char* name, std::size_t len) const
+{
+    if (_buckets.empty())
+        return NOT_FOUND;
+
+    return _buckets[bucket(name, len)];
+}
+
+void SymbolTable::clear()
+{
+    _names.clear();
+    _buckets.clear();
+}
+
+} /* namespace */
@@ -0,0 +1,62 @@
+#if !defined LINLIB_SYMBOLS_H
+#define LINLIB_SYMBOLS_H
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace linlib {
+
+/**
+    A table interning names into dense integer slots.
+
+    Slots are allocated in order, starting from 0, so they can be used
+    directly as indices into the arrays passed to the evaluators. Names
+    are found through an open-addressing hash table (FNV-1a hash,
+    linear probing), so interning and lookups never compare more than
+    a couple of strings.
+*/
+class SymbolTable
+{
+    std::vector<std::string>    _names;
+    std::vector<std::uint32_t>  _buckets;   // power of two, EMPTY for free buckets
+
+    static const std::uint32_t EMPTY = UINT32_MAX;
+
+    std::size_t bucket(const char* name, std::size_t len) const;
+    void rehash(std::size_t count);
+
+    public:
+    static const std::uint32_t NOT_FOUND = UINT32_MAX;
+
+    SymbolTable() {}
+    SymbolTable(std::initializer_list<const char*> names);
+
+    /**
+        Return the slot of `name`, allocating a new one if needed.
+    */
+    std::uint32_t intern(const char* name, std::size_t len);
+    inline std::uint32_t intern(const std::string& name) { return intern(name.data(), name.size()); }
+
+    /**
+        Return the slot of `name`, or NOT_FOUND.
+    */
+    std::uint32_t find(const char* name, std::size_t len) const;
+    inline std::uint32_t find(const std::string& name) const { return find(name.data(), name.size()); }
+
+    inline std::size_t size() const { return _names.size(); }
+    inline bool empty() const { return _names.empty(); }
+
+    inline const std::string& operator[](std::uint32_t slot) const { return _names[slot]; }
+    inline const std::vector<std::string>& names() const { return _names; }
+
+    inline std::vector<std::string>::const_iterator begin() const { return _names.begin(); }
+    inline std::vector<std::string>::const_iterator end() const { return _names.end(); }
+
+    void clear();
+};
+
+} /* namespace */
+
+#endif
@@ -0,0 +1,145 @@
+#include <algorithm>
+
+#include "lib/thread_pool.h"
+
+namespace linlib {
+
+ThreadPool::ThreadPool(std::size_t threads)
+  : _queues(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+    _queued(0),
+    _next(0),
+    _stop(false)
+{
+    for(std::size_t i = 0; i < _queues.size(); ++i)
+        _threads.emplace_back(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+
+    for(std::thread& thread : _threads)
+        thread.join();
+}
+
+//========================================================================
+//  Queues
+//========================================================================
+void ThreadPool::submit(Task task)
+{
+    Queue& queue = _queues[_next++ % _queues.size()];
+
+    {
+        // Count the task before it is visible, so a worker never waits
+        // while a task is queued. It may spin briefly the other way.
+        std::lock_guard<std::mutex> lock(_mutex);
+        ++_queued;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    _wake.notify_one();
+}
+
+/**
+    Take the newest task of the worker's own queue.
+*/
+bool ThreadPool::pop(std::size_t worker, Task& task)
+{
+    Queue& queue = _queues[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.tasks.empty())
+        return false;
+
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    --_queued;
+
+    return true;
+}
+
+/**
+    Take the oldest task of another worker's queue.
+*/
+bool ThreadPool::steal(std::size_t worker, Task& task)
+{
+    for(std::size_t i = 1; i < _queues.size(); ++i)
+    {
+        Queue& queue = _queues[(worker+i) % _queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            --_queued;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::work(std::size_t worker)
+{
+    while(true)
+    {
+        Task task;
+
+        if (pop(worker, task) || steal(worker, task))
+        {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _wake.wait(lock, [this]{ return _stop || _queued > 0; });
+
+        if (_stop && _queued == 0)
+            return;
+    }
+}
+
+//========================================================================
+//  Parallel loops
+//========================================================================
+void ThreadPool::parallel_for(std::size_t count, const std::function<void(std::size_t, std::size_t)>& body)
+{
+    if (count == 0)
+        return;
+
+    // A few chunks per worker leave room for stealing
+    const std::size_t chunks = std::min(count, 8*size());
+    const std::size_t chunk = (count + chunks - 1) / chunks;
+
+    std::mutex              mutex;
+    std::condition_variable done;
+    std::size_t             remaining = (count + chunk - 1) / chunk;
+
+    for(std::size_t begin = 0; begin < count; begin += chunk)
+    {
+        const std::size_t end = std::min(count, begin+chunk);
+
+        submit([&, begin, end]{
+            body(begin, end);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--remaining == 0)
+                done.notify_one();
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&]{ return remaining == 0; });
+}
+
+} /* namespace */
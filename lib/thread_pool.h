@@ -0,0 +1,77 @@
+#if !defined LINLIB_THREAD_POOL_H
+#define LINLIB_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace linlib {
+
+/**
+    A fixed-size pool of worker threads with work stealing.
+
+    Each worker owns a queue of tasks. A worker runs the tasks of its
+    own queue most recently queued first, and when it runs out of work
+    steals the oldest task from another worker's queue. Long-running
+    tasks on one worker are thus compensated by the others.
+
+    Tasks must not throw.
+*/
+class ThreadPool
+{
+    public:
+    typedef std::function<void()>   Task;
+
+    private:
+    struct Queue
+    {
+        std::mutex          mutex;
+        std::deque<Task>    tasks;
+    };
+
+    std::vector<Queue>          _queues;
+    std::vector<std::thread>    _threads;
+
+    std::mutex                  _mutex;
+    std::condition_variable     _wake;
+    std::atomic<long>           _queued;
+    std::atomic<std::size_t>    _next;
+    bool                        _stop;
+
+    bool pop(std::size_t worker, Task& task);
+    bool steal(std::size_t worker, Task& task);
+    void work(std::size_t worker);
+
+    public:
+    /**
+        Start `threads` workers. Zero means one per hardware thread.
+    */
+    explicit ThreadPool(std::size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    inline std::size_t size() const { return _threads.size(); }
+
+    /**
+        Queue a task. Tasks are spread over the workers round-robin.
+    */
+    void submit(Task task);
+
+    /**
+        Split [0, count) into chunks and call `body(begin, end)` on each
+        of them from the workers. Return when all chunks are done.
+        Must not be called from a task.
+    */
+    void parallel_for(std::size_t count, const std::function<void(std::size_t, std::size_t)>& body);
+};
+
+} /* namespace */
+
+#endif
@@ -1,21 +1,133 @@
-#include <cctype>
-#include <cstring>
+#include <cstdint>
 
 #include "lib/tokenizer.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace linlib
 {
 
-static int isalpha(char c)
+//========================================================================
+//  Character classes
+//
+//  Only the 7-bits ASCII range is meaningful. The classes match the
+//  ones of the "C" locale, whatever the current locale is.
+//========================================================================
+enum CharClass : std::uint8_t
+{
+    SPACE       = 0x01,
+    ALPHA       = 0x02,     // may start a symbol
+    DIGIT       = 0x04,
+    OPERATOR    = 0x08,     // 1-character wide operators
+};
+
+static constexpr std::uint8_t classify(unsigned c)
+{
+    return (c == ' ' || (c >= '\t' && c <= '\r')) ? SPACE
+        : ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') ? ALPHA
+        : (c >= '0' && c <= '9') ? DIGIT
+        : (c == '+' || c == '-' || c == '*' || c == '/' || c == '(' || c == ')') ? OPERATOR
+        : 0;
+}
+
+struct CharTable
+{
+    std::uint8_t    cls[256];
+
+    constexpr CharTable() : cls()
+    {
+        for(unsigned c = 0; c < 256; ++c)
+            cls[c] = classify(c);
+    }
+};
+
+static constexpr CharTable table{};
+
+static inline std::uint8_t cls(char c)
+{
+    return table.cls[static_cast<unsigned char>(c)];
+}
+
+//========================================================================
+//  Span scanning
+//
+//  Return a pointer past the run of characters belonging to the given
+//  classes, but never past `end`. With SSE2, 16 bytes are classified
+//  at once, as long as a whole block lies before `end`; the remaining
+//  bytes are classified one at a time. No byte outside [p, end) is
+//  read, so the scan is clean under AddressSanitizer.
+//========================================================================
+#if defined(__SSE2__)
+/**
+    Set the bytes of `v` lying in the [lo, lo+len] range.
+*/
+static inline __m128i in_range(__m128i v, char lo, char len)
+{
+    const __m128i d = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(len)), d);
+}
+
+static inline __m128i match(__m128i v, std::uint8_t classes)
+{
+    __m128i m = _mm_setzero_si128();
+
+    if (classes & SPACE)
+        m = _mm_or_si128(m, _mm_or_si128(
+            _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+            in_range(v, '\t', '\r'-'\t')));
+
+    if (classes & ALPHA)
+        m = _mm_or_si128(m, _mm_or_si128(
+            in_range(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z'-'a'),
+            _mm_cmpeq_epi8(v, _mm_set1_epi8('_'))));
+
+    if (classes & DIGIT)
+        m = _mm_or_si128(m, in_range(v, '0', '9'-'0'));
+
+    return m;
+}
+
+static const char* scan(const char* p, const char* end, std::uint8_t classes)
+{
+    for(; end - p >= 16; p += 16)
+    {
+        // Bits set for the bytes ending the run
+        const unsigned stop = ~_mm_movemask_epi8(match(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), classes))
+                              & 0xFFFFu;
+
+        if (stop)
+            return p + __builtin_ctz(stop);
+    }
+
+    while(p < end && (cls(*p) & classes))
+        ++p;
+
+    return p;
+}
+#else
+static const char* scan(const char* p, const char* end, std::uint8_t classes)
 {
-    return (c ^ 0x80) && std::isalpha(static_cast<unsigned char>(c));
+    while(p < end && (cls(*p) & classes))
+        ++p;
+
+    return p;
 }
+#endif
 
-static int isalnum(char c)
+/**
+    Skip a run of characters of the given classes. Runs are usually
+    short, so test the first character before going wide.
+*/
+static inline const char* skip(const char* p, const char* end, std::uint8_t classes)
 {
-    return (c ^ 0x80) && std::isalnum(static_cast<unsigned char>(c));
+    return (p < end && (cls(*p) & classes)) ? scan(p+1, end, classes) : p;
 }
 
+//========================================================================
+//  Tokenizer
+//========================================================================
 /**
     Emit a token matching a 1-character wide operator
 */
@@ -48,7 +160,7 @@ Token   Tokenizer::bad_token()
 {
     const char *start = _rest;
 
-    while(*++_rest & 0x80)
+    while(++_rest < _end && (*_rest & 0x80))
     {
         // nothing
     }
@@ -59,26 +171,18 @@ Token   Tokenizer::bad_token()
 Token   Tokenizer::number()
 {
     const char *start = _rest;
-    const char *curr = _rest;
-
-    while(isdigit(*curr))
-        ++curr;
-
-    if (*curr=='.')
-        ++curr;
-
-    while(isdigit(*curr))
-        ++curr;
+    const char *curr = skip(_rest, _end, DIGIT);
 
+    if (curr < _end && *curr=='.')
+        curr = skip(curr+1, _end, DIGIT);
 
-    if (*curr=='e' || *curr=='E')
+    if (curr < _end && (*curr=='e' || *curr=='E'))
     {
         ++curr;
-        if (*curr=='+' || *curr=='-')
+        if (curr < _end && (*curr=='+' || *curr=='-'))
             ++curr;
 
-        while(isdigit(*curr))
-            ++curr;
+        curr = skip(curr, _end, DIGIT);
     }
 
     _rest = curr;
@@ -89,10 +193,7 @@ Token   Tokenizer::number()
 Token   Tokenizer::symbol()
 {
     const char *start = _rest;
-    const char *curr = _rest;
-
-    while(*curr == '_' || isalnum(*curr))
-        ++curr;
+    const char *curr = scan(_rest+1, _end, ALPHA|DIGIT);
 
     _rest = curr;
 
@@ -101,22 +202,24 @@ Token   Tokenizer::symbol()
 
 Token   Tokenizer::next()
 {
-    while(std::isspace(static_cast<unsigned char>(*_rest)))
-      ++_rest;
+    _rest = skip(_rest, _end, SPACE);
 
-    if (!*_rest)
+    if (_rest == _end)
         return { Token::END, _rest, 0 };
-    else if (*_rest == '_' || isalpha(*_rest))
+
+    const std::uint8_t c = cls(*_rest);
+
+    if (c & ALPHA)
         return symbol();
-    else if (*_rest == '.' || isdigit(*_rest))
+    else if (*_rest == '.' || (c & DIGIT))
         return number();
     else if (*_rest == '*') {
-        if (_rest[1] == '*')
+        if (_rest+1 < _end && _rest[1] == '*')
             return token2(Token::POW);
         else
             return token1(Token::TIMES);
     }
-    else if (std::strchr("+-*/()", *_rest))
+    else if (c & OPERATOR)
         return token1(static_cast<Token::Id>(*_rest));
     else
         return bad_token();
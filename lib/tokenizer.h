@@ -1,6 +1,13 @@
 #if !defined LINLIB_TOKENIZER_H
 #define LINLIB_TOKENIZER_H
 
+#include <cstddef>
+#include <cstring>
+
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
 namespace linlib
 {
 
@@ -33,9 +40,17 @@ struct Token
     inline operator bool() const { return id != END; }
 };
 
+/**
+    Split an expression into tokens.
+
+    The input is the [expr, expr+len) span. It does not have to be
+    NUL-terminated, so expressions can be tokenized in place from a
+    larger buffer. A NUL character inside the span is a bad token.
+*/
 class Tokenizer
 {
     const char* _rest;
+    const char* _end;
 
     Token bad_token();
     Token symbol();
@@ -45,7 +60,11 @@ class Tokenizer
     Token token2(Token::Id id);
 
     public:
-    Tokenizer(const char* expr) : _rest(expr) {}
+    Tokenizer(const char* expr) : _rest(expr), _end(expr+std::strlen(expr)) {}
+    Tokenizer(const char* expr, std::size_t len) : _rest(expr), _end(expr+len) {}
+#if __cplusplus >= 201703L
+    Tokenizer(std::string_view expr) : Tokenizer(expr.data(), expr.size()) {}
+#endif
 
     Token next();
 };
@@ -0,0 +1,199 @@
+/*
+ *
+ *  linlib-eval: evaluate expressions over every row of a CSV or binary
+ *  columnar stream.
+ *
+ *      linlib-eval [options] [name=]expression...
+ *
+ *  The variables of the expressions are the input columns of the same
+ *  name. Each expression is an output column, named after the
+ *  expression unless a name is given.
+ *
+ */
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lib/columns.h"
+#include "lib/program.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static void usage()
+{
+    std::cerr <<
+        "usage: linlib-eval [options] [name=]expression...\n"
+        "  -i FILE         input file (default: standard input)\n"
+        "  -o FILE         output file (default: standard output)\n"
+        "  --input FMT     input format, csv or binary (default: csv)\n"
+        "  --output FMT    output format, csv or binary (default: same as input)\n"
+        "  --chunk ROWS    rows per chunk, fewer for wide streams (default: " << linlib::CsvReader::CHUNK_ROWS << ")\n"
+        "  --stats         report the throughput on standard error\n";
+}
+
+static const char* message(linlib::ColumnStatus status)
+{
+    switch(status)
+    {
+        case linlib::ColumnStatus::OK:                  return "ok";
+        case linlib::ColumnStatus::IO_ERROR:            return "I/O error";
+        case linlib::ColumnStatus::BAD_FORMAT:          return "malformed input";
+        case linlib::ColumnStatus::UNKNOWN_COLUMN:      return "an expression uses a column missing from the input";
+        case linlib::ColumnStatus::UNSUPPORTED_HOST:    return "binary streams are not supported on this host";
+    }
+    return "unknown error";
+}
+
+static bool format(const char* name, bool& binary)
+{
+    if (std::strcmp(name, "csv") == 0)
+        binary = false;
+    else if (std::strcmp(name, "binary") == 0)
+        binary = true;
+    else
+        return false;
+
+    return true;
+}
+
+// ========================================================================
+//  Main
+// ========================================================================
+int main(int argc, char** argv)
+{
+    const char*                 input_path = nullptr;
+    const char*                 output_path = nullptr;
+    bool                        binary_input = false;
+    bool                        binary_output = false;
+    bool                        output_format = false;
+    bool                        stats = false;
+    std::size_t                 chunk_rows = linlib::CsvReader::CHUNK_ROWS;
+    std::vector<std::string>    names;
+    std::vector<std::string>    expressions;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const bool  more = i+1 < argc;
+
+        if (std::strcmp(arg, "-i") == 0 && more)
+            input_path = argv[++i];
+        else if (std::strcmp(arg, "-o") == 0 && more)
+            output_path = argv[++i];
+        else if (std::strcmp(arg, "--input") == 0 && more && format(argv[i+1], binary_input))
+            ++i;
+        else if (std::strcmp(arg, "--output") == 0 && more && format(argv[i+1], binary_output))
+        {
+            ++i;
+            output_format = true;
+        }
+        else if (std::strcmp(arg, "--chunk") == 0 && more && std::atol(argv[i+1]) > 0)
+            chunk_rows = std::atol(argv[++i]);
+        else if (std::strcmp(arg, "--stats") == 0)
+            stats = true;
+        else if (arg[0] == '-' && arg[1] == '-')
+        {
+            usage();
+            return 2;
+        }
+        else
+        {
+            // Expressions have no '=' of their own
+            const char* equal = std::strchr(arg, '=');
+
+            names.push_back(equal ? std::string(arg, equal) : std::string(arg));
+            expressions.push_back(equal ? std::string(equal+1) : std::string(arg));
+        }
+    }
+
+    if (expressions.empty())
+    {
+        usage();
+        return 2;
+    }
+    if (!output_format)
+        binary_output = binary_input;
+
+    linlib::FusedProgram program;
+    if (!linlib::compile(expressions, program))
+    {
+        std::cerr << "linlib-eval: syntax error" << std::endl;
+        return 1;
+    }
+
+    std::vector<linlib::Function> fcts;
+    for(std::size_t i = 0; i < program.functions.size(); ++i)
+    {
+        const linlib::Function fct = linlib::library_function(program.functions[i]);
+        if (!fct)
+        {
+            std::cerr << "linlib-eval: unknown function " << program.functions[i] << std::endl;
+            return 1;
+        }
+        fcts.push_back(fct);
+    }
+
+    std::ifstream   input_file;
+    std::ofstream   output_file;
+    std::istream*   in = &std::cin;
+    std::ostream*   out = &std::cout;
+
+    std::ios::sync_with_stdio(false);
+    if (input_path)
+    {
+        input_file.open(input_path, std::ios::binary);
+        if (!input_file)
+        {
+            std::cerr << "linlib-eval: can't open " << input_path << std::endl;
+            return 1;
+        }
+        in = &input_file;
+    }
+    if (output_path)
+    {
+        output_file.open(output_path, std::ios::binary | std::ios::trunc);
+        if (!output_file)
+        {
+            std::cerr << "linlib-eval: can't create " << output_path << std::endl;
+            return 1;
+        }
+        out = &output_file;
+    }
+
+    std::unique_ptr<linlib::ColumnReader> reader;
+    std::unique_ptr<linlib::ColumnWriter> writer;
+    if (binary_input)
+        reader.reset(new linlib::BinaryColumnReader(*in));
+    else
+        reader.reset(new linlib::CsvReader(*in));
+    if (binary_output)
+        writer.reset(new linlib::BinaryColumnWriter(*out, names));
+    else
+        writer.reset(new linlib::CsvWriter(*out, names));
+
+    const auto                  start = std::chrono::steady_clock::now();
+    std::size_t                 rows;
+    const linlib::ColumnStatus  status = linlib::evaluate(*reader, program, fcts.data(), *writer, rows, chunk_rows);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (status != linlib::ColumnStatus::OK)
+    {
+        std::cerr << "linlib-eval: " << message(status);
+        if (!binary_input && reader->status() != linlib::ColumnStatus::OK)
+            std::cerr << " at line " << static_cast<linlib::CsvReader&>(*reader).line();
+        std::cerr << std::endl;
+        return 1;
+    }
+
+    if (stats)
+        std::cerr << rows << " rows, " << elapsed.count() << " s, "
+                  << rows / elapsed.count() << " rows/s" << std::endl;
+
+    return 0;
+}
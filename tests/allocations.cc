@@ -0,0 +1,214 @@
+/*
+ *
+ *  Tests for the allocation-free, exception-free and silent parse
+ *
+ *  The global allocation functions are replaced to count the heap
+ *  allocations, so this file is a test program on its own.
+ *
+ *  The parse is allocation-free only with a nesting bound of at most
+ *  ParserBase::INLINE_DEPTH, so the parsers are bound to it here. With
+ *  the default DEFAULT_MAX_DEPTH, deeper input spills to the heap.
+ *
+ */
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/parser.h"
+#include "lib/stream.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static std::size_t allocations = 0;
+
+// Not inlined, so GCC does not see through them and report free() on
+// memory from operator new.
+__attribute__((noinline)) void* operator new(std::size_t size)
+{
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+/**
+    Count the events, without allocating.
+*/
+struct Counter : public linlib::EventHandler
+{
+    std::size_t     events = 0;
+    std::size_t     errors = 0;
+
+    Counter() { quiet(true); }
+
+    bool number(double value) { ++events; return true; }
+    bool call(const char *identifier, std::size_t len) { ++events; return true; }
+    bool load(const char *identifier, std::size_t len) { ++events; return true; }
+    bool binary_op(linlib::BinaryOpCode opcode) { ++events; return true; }
+    bool unary_op(linlib::UnaryOpCode opcode) { ++events; return true; }
+    bool end_expression(bool ok) { errors += !ok; return true; }
+};
+
+/**
+    The same, statically dispatched. Reports nothing.
+*/
+struct StaticCounter
+{
+    std::size_t     events = 0;
+
+    bool number(double value) { ++events; return true; }
+    bool call(const char *identifier, std::size_t len) { ++events; return true; }
+    bool load(const char *identifier, std::size_t len) { ++events; return true; }
+    bool binary_op(linlib::BinaryOpCode opcode) { ++events; return true; }
+    bool unary_op(linlib::UnaryOpCode opcode) { ++events; return true; }
+
+    void bad_token_error(const char* stmt, std::size_t len, unsigned pos) {}
+    void syntax_error(const char* stmt, std::size_t len, unsigned pos) {}
+    void range_error(const char* stmt, std::size_t len, unsigned pos) {}
+    void depth_error(const char* stmt, std::size_t len, unsigned pos) {}
+};
+
+struct Case
+{
+    std::string                 expr;
+    linlib::ParserBase::State   state;
+};
+
+/**
+    Valid and invalid expressions, built before counting.
+*/
+static std::vector<Case> corpus()
+{
+    using linlib::ParserBase;
+
+    const std::size_t depth = ParserBase::INLINE_DEPTH;
+
+    return {
+        { "1 + 2 * x", ParserBase::OK },
+        { "-sqrt(x ** 2 + y ** 2) / (1 - z)", ParserBase::OK },
+        { "0.1234567890123456789012345 * x", ParserBase::OK },      // strtod
+        { std::string(depth-1, '(') + "x" + std::string(depth-1, ')'), ParserBase::OK },
+        { "", ParserBase::SYNTAX_ERROR },
+        { "1 +", ParserBase::SYNTAX_ERROR },
+        { "f(x", ParserBase::SYNTAX_ERROR },
+        { "x ) + 1", ParserBase::SYNTAX_ERROR },
+        { "1 $ 2", ParserBase::BAD_TOKEN_ERROR },
+        { "x + 1e999", ParserBase::RANGE_ERROR },
+        { "1e-999", ParserBase::RANGE_ERROR },
+        { std::string(10*depth, '(') + "x" + std::string(10*depth, ')'), ParserBase::DEPTH_ERROR },
+        { std::string(10*depth, '-') + "x", ParserBase::DEPTH_ERROR },
+    };
+}
+
+// ========================================================================
+//  Tests
+// ========================================================================
+TEST(Allocations, parser) {
+    const std::vector<Case> cases = corpus();
+    Counter                 handler;
+
+    testing::internal::CaptureStderr();
+    for(const Case& c : cases)
+    {
+        const std::size_t   before = allocations;
+        linlib::Parser      parser(c.expr.data(), c.expr.size(), handler);
+
+        parser.max_depth(linlib::ParserBase::INLINE_DEPTH);
+        const bool          ok = parser.parse();
+        const std::size_t   count = allocations - before;
+
+        EXPECT_EQ(count, 0u) << c.expr;
+        EXPECT_EQ(ok, c.state == linlib::ParserBase::OK) << c.expr;
+        EXPECT_EQ(parser.state(), c.state) << c.expr;
+    }
+    EXPECT_EQ(testing::internal::GetCapturedStderr(), "");
+}
+
+TEST(Allocations, basic_parser) {
+    const std::vector<Case> cases = corpus();
+    StaticCounter           handler;
+
+    for(const Case& c : cases)
+    {
+        const std::size_t                   before = allocations;
+        linlib::BasicParser<StaticCounter>  parser(c.expr.data(), c.expr.size(), handler);
+
+        parser.max_depth(linlib::ParserBase::INLINE_DEPTH);
+        parser.parse();
+        const std::size_t                   count = allocations - before;
+
+        EXPECT_EQ(count, 0u) << c.expr;
+        EXPECT_EQ(parser.state(), c.state) << c.expr;
+    }
+}
+
+TEST(Allocations, stream) {
+    std::string buffer;
+    for(int i = 0; i < 100; ++i)
+        buffer += "x + " + std::to_string(i) + "; 1 $ 2; (x + ;\n-f(y) ** 2\n";
+
+    Counter handler;
+
+    testing::internal::CaptureStderr();
+    const std::size_t       before = allocations;
+    linlib::StreamParser    stream(buffer.data(), buffer.size(), handler);
+    const bool              ok = stream.parse();
+    const std::size_t       count = allocations - before;
+
+    EXPECT_EQ(count, 0u);
+    EXPECT_FALSE(ok);
+    EXPECT_EQ(handler.errors, 200u);
+    EXPECT_EQ(testing::internal::GetCapturedStderr(), "");
+}
+
+TEST(Allocations, diagnostics) {
+    // Built on demand only
+    Counter             handler;
+    const char* const   expr = "1 + * 2";
+    linlib::Parser      parser(expr, handler);
+
+    const std::size_t   before = allocations;
+    EXPECT_FALSE(parser.parse());
+    EXPECT_EQ(parser.position(), 4u);
+    const std::size_t   count = allocations - before;
+    EXPECT_EQ(count, 0u);
+
+    EXPECT_EQ(parser.message(), "syntax error:\n1 + * 2\n    ^\n");
+}
+
+TEST(Allocations, default_depth) {
+    // Past INLINE_DEPTH, the default bound lets the stack spill
+    const std::size_t   depth = 2*linlib::ParserBase::INLINE_DEPTH;
+    const std::string   expr = std::string(depth, '(') + "x" + std::string(depth, ')');
+    Counter             handler;
+    linlib::Parser      parser(expr.data(), expr.size(), handler);
+
+    const std::size_t   before = allocations;
+    EXPECT_TRUE(parser.parse());
+    EXPECT_GT(allocations - before, 0u);
+}
+
+TEST(Allocations, verbose) {
+    // The default handlers still report on stderr
+    Counter             handler;
+    handler.quiet(false);
+
+    testing::internal::CaptureStderr();
+    linlib::Parser      parser("1 +", handler);
+    EXPECT_FALSE(parser.parse());
+    EXPECT_EQ(testing::internal::GetCapturedStderr(), "Syntax error:\n1 +\n   ^\n");
+}
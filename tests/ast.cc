@@ -0,0 +1,219 @@
+/*
+ *
+ *  Tests for the arena-allocated syntax trees
+ *
+ */
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/ast.h"
+
+using linlib::Ast;
+using linlib::AstArena;
+using linlib::AstBuilder;
+using linlib::OpCode;
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+/**
+    Evaluate a subtree recursively, following the links of the nodes:
+    x=2, y=3, z=5 and f doubles its argument.
+*/
+static double evaluate(const AstArena& arena, const Ast& ast, std::uint32_t node)
+{
+    const linlib::AstNode& n = ast[node];
+
+    switch(n.op)
+    {
+        case OpCode::CONST:
+            return arena.constants()[n.arg];
+        case OpCode::LOAD:
+            {
+                const std::string& name = arena.variables()[n.arg];
+                return (name == "x") ? 2 : (name == "y") ? 3 : 5;
+            }
+        case OpCode::CALL:
+            return 2*evaluate(arena, ast, ast.right(node));
+        case OpCode::NEG:
+            return -evaluate(arena, ast, ast.right(node));
+        case OpCode::ADD:
+            return evaluate(arena, ast, ast.left(node)) + evaluate(arena, ast, ast.right(node));
+        case OpCode::SUB:
+            return evaluate(arena, ast, ast.left(node)) - evaluate(arena, ast, ast.right(node));
+        case OpCode::MUL:
+            return evaluate(arena, ast, ast.left(node)) * evaluate(arena, ast, ast.right(node));
+        case OpCode::DIV:
+            return evaluate(arena, ast, ast.left(node)) / evaluate(arena, ast, ast.right(node));
+        case OpCode::POW:
+            return std::pow(evaluate(arena, ast, ast.left(node)), evaluate(arena, ast, ast.right(node)));
+        default:
+            break;
+    };
+
+    return 0;
+}
+
+static double evaluate(const AstArena& arena, const Ast& ast)
+{
+    return evaluate(arena, ast, ast.root());
+}
+
+/**
+    A sum of `terms` products
+*/
+static std::string formula(int terms)
+{
+    std::string result = "1";
+
+    for(int i = 0; i < terms; ++i)
+        result += " + x*" + std::to_string(i);
+
+    return result;
+}
+
+// ========================================================================
+//  Tests
+// ========================================================================
+TEST(Ast, layout) {
+    static_assert(sizeof(linlib::AstNode) == 8, "two 32-bit words per node");
+
+    AstArena    arena;
+    AstBuilder  builder{arena};
+    Ast         ast;
+
+    ASSERT_TRUE(linlib::parse("x*y - f(-z)", builder, ast));
+    ASSERT_EQ(ast.size, 7u);
+
+    // x y * z - f -
+    EXPECT_EQ(ast[0].op, OpCode::LOAD);
+    EXPECT_EQ(ast[1].op, OpCode::LOAD);
+    EXPECT_EQ(ast[2].op, OpCode::MUL);
+    EXPECT_EQ(ast.left(2), 0u);
+    EXPECT_EQ(ast.right(2), 1u);
+    EXPECT_EQ(ast[4].op, OpCode::NEG);
+    EXPECT_EQ(ast[5].op, OpCode::CALL);
+    EXPECT_EQ(ast.root(), 6u);
+    EXPECT_EQ(ast[6].op, OpCode::SUB);
+    EXPECT_EQ(ast.left(6), 2u);
+    EXPECT_EQ(ast.right(6), 5u);
+
+    EXPECT_EQ(arena.variables().size(), 3u);
+    EXPECT_EQ(arena.functions().size(), 1u);
+}
+
+TEST(Ast, evaluate) {
+    AstArena    arena;
+    AstBuilder  builder{arena};
+
+    const struct { const char* expr; double expected; } testcases[] = {
+        { "42", 42 },
+        { "x + y * z", 17 },
+        { "(x + y) * z", 25 },
+        { "x - y - z", -6 },
+        { "x ** y ** 2", 64 },
+        { "-x ** 2", 4 },
+        { "f(x + f(y)) / 4", 4 },
+        { "z / (x - -y)", 1 },
+    };
+
+    for(const auto& testcase : testcases)
+    {
+        Ast ast;
+        ASSERT_TRUE(linlib::parse(testcase.expr, builder, ast)) << testcase.expr;
+        EXPECT_EQ(evaluate(arena, ast), testcase.expected) << testcase.expr;
+    }
+}
+
+TEST(Ast, batch) {
+    // Trees stay valid while the arena grows
+    AstArena            arena;
+    AstBuilder          builder{arena};
+    std::vector<Ast>    trees;
+
+    for(int i = 0; i < 2000; ++i)
+    {
+        Ast ast;
+        ASSERT_TRUE(linlib::parse(formula(i % 50).c_str(), builder, ast));
+        trees.push_back(ast);
+    }
+
+    // One huge tree, larger than a block
+    Ast huge;
+    ASSERT_TRUE(linlib::parse(formula(5000).c_str(), builder, huge));
+    EXPECT_GT(huge.size, AstArena::BLOCK_NODES);
+
+    EXPECT_EQ(arena.trees(), 2001u);
+    for(std::size_t i = 0; i < trees.size(); ++i)
+        ASSERT_EQ(evaluate(arena, trees[i]), 1 + 2*(i%50)*(i%50-1)/2.0) << i;
+    EXPECT_EQ(evaluate(arena, huge), 1 + 2*5000*4999/2.0);
+}
+
+TEST(Ast, clear) {
+    AstArena    arena;
+    AstBuilder  builder{arena};
+    Ast         ast;
+
+    for(int i = 0; i < 100; ++i)
+        ASSERT_TRUE(linlib::parse(formula(200).c_str(), builder, ast));
+
+    const std::size_t capacity = arena.capacity();
+
+    // The same batch again reuses the blocks
+    for(int round = 0; round < 3; ++round)
+    {
+        arena.clear();
+        EXPECT_EQ(arena.trees(), 0u);
+        EXPECT_TRUE(arena.constants().empty());
+        EXPECT_TRUE(arena.variables().empty());
+
+        for(int i = 0; i < 100; ++i)
+            ASSERT_TRUE(linlib::parse(formula(200).c_str(), builder, ast));
+        EXPECT_EQ(arena.capacity(), capacity);
+        EXPECT_EQ(evaluate(arena, ast), 1 + 2*200*199/2.0);
+    }
+}
+
+TEST(Ast, errors) {
+    AstArena    arena;
+    AstBuilder  builder{arena};
+    Ast         ast, first;
+
+    ASSERT_TRUE(linlib::parse("x + 1", builder, first));
+    EXPECT_FALSE(linlib::parse("2 * (3 + ", builder, ast));
+    EXPECT_FALSE(linlib::parse("2 $ 3", builder, ast));
+
+    // The failed parses left no node or constant behind
+    EXPECT_EQ(arena.trees(), 1u);
+    EXPECT_EQ(arena.constants().size(), 1u);
+
+    ASSERT_TRUE(linlib::parse("y", builder, ast));
+    EXPECT_EQ(ast.nodes, first.nodes + first.size);
+    EXPECT_EQ(evaluate(arena, first), 3);
+}
+
+TEST(Ast, replay) {
+    AstArena    arena;
+    AstBuilder  builder{arena};
+    Ast         ast;
+
+    const char* const expr = "sqrt(x*x + y*y) - 2**-z";
+    ASSERT_TRUE(linlib::parse(expr, builder, ast));
+
+    linlib::Program replayed, expected;
+    linlib::Compiler compiler{replayed};
+    ASSERT_TRUE(arena.replay(ast, compiler));
+    ASSERT_TRUE(linlib::compile(expr, expected));
+
+    ASSERT_EQ(replayed.code.size(), expected.code.size());
+    for(std::size_t i = 0; i < expected.code.size(); ++i)
+    {
+        EXPECT_EQ(replayed.code[i].op, expected.code[i].op) << i;
+        EXPECT_EQ(replayed.code[i].arg, expected.code[i].arg) << i;
+    }
+    EXPECT_EQ(replayed.constants, expected.constants);
+    EXPECT_EQ(replayed.variables.names(), expected.variables.names());
+    EXPECT_EQ(replayed.functions.names(), expected.functions.names());
+}
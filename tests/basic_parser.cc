@@ -0,0 +1,578 @@
+/*
+ *
+ *  Tests for the statically dispatched parser
+ *
+ */
+#include <functional>
+#include <random>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "lib/number.h"
+#include "lib/parser.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+/**
+    A duck-typed handler recording the events. Not an EventHandler.
+*/
+struct Recorder
+{
+    std::string  _stack;
+    std::string  _error;
+
+    bool push(const std::string& v) { _stack += v + ";"; return true; }
+
+    bool number(double v) { return push(std::to_string(v)); }
+    bool call(const char *identifier, std::size_t len) { return push("CALL(" + std::string(identifier, len) + ")"); }
+    bool load(const char *identifier, std::size_t len) { return push("LOAD(" + std::string(identifier, len) + ")"); }
+
+    bool unary_op(linlib::UnaryOpCode opcode)
+    {
+        return push("NEG");
+    }
+
+    bool binary_op(linlib::BinaryOpCode opcode)
+    {
+        static const char* names[] = { "ADD", "SUB", "MUL", "DIV", "POW" };
+        return push(names[static_cast<int>(opcode)]);
+    }
+
+    void bad_token_error(const char* stmt, std::size_t len, unsigned pos) { _error = "bad token@" + std::to_string(pos); }
+    void syntax_error(const char* stmt, std::size_t len, unsigned pos) { _error = "syntax@" + std::to_string(pos); }
+    void range_error(const char* stmt, std::size_t len, unsigned pos) { _error = "range@" + std::to_string(pos); }
+    void depth_error(const char* stmt, std::size_t len, unsigned pos) { _error = "depth@" + std::to_string(pos); }
+};
+
+/**
+    The same recorder, behind the virtual interface.
+*/
+struct VirtualRecorder : public linlib::EventHandler
+{
+    Recorder    recorder;
+
+    bool number(double v) { return recorder.number(v); }
+    bool call(const char *identifier, std::size_t len) { return recorder.call(identifier, len); }
+    bool load(const char *identifier, std::size_t len) { return recorder.load(identifier, len); }
+    bool unary_op(linlib::UnaryOpCode opcode) { return recorder.unary_op(opcode); }
+    bool binary_op(linlib::BinaryOpCode opcode) { return recorder.binary_op(opcode); }
+
+    void bad_token_error(const char* stmt, std::size_t len, unsigned pos) { recorder.bad_token_error(stmt, len, pos); }
+    void syntax_error(const char* stmt, std::size_t len, unsigned pos) { recorder.syntax_error(stmt, len, pos); }
+    void range_error(const char* stmt, std::size_t len, unsigned pos) { recorder.range_error(stmt, len, pos); }
+    void depth_error(const char* stmt, std::size_t len, unsigned pos) { recorder.depth_error(stmt, len, pos); }
+};
+
+void test_same(const char* testcase)
+{
+    Recorder                        expected;
+    linlib::BasicParser<Recorder>   parser{testcase, expected};
+    const bool                      ok = parser.parse();
+
+    VirtualRecorder                 actual;
+    linlib::Parser                  reference{testcase, actual};
+
+    EXPECT_EQ(reference.parse(), ok) << testcase;
+    EXPECT_EQ(reference.state(), parser.state()) << testcase;
+    EXPECT_EQ(reference.where(), parser.where()) << testcase;
+    EXPECT_EQ(actual.recorder._stack, expected._stack) << testcase;
+    EXPECT_EQ(actual.recorder._error, expected._error) << testcase;
+}
+
+// ========================================================================
+//  Tests
+// ========================================================================
+TEST(BasicParser, events) {
+    Recorder                        recorder;
+    linlib::BasicParser<Recorder>   parser{"-x + sqrt(2)*3**y", recorder};
+
+    ASSERT_TRUE(parser.parse());
+    EXPECT_EQ(parser.state(), linlib::ParserBase::OK);
+    EXPECT_EQ(recorder._stack,
+        "LOAD(x);NEG;2.000000;CALL(sqrt);3.000000;LOAD(y);POW;MUL;ADD;");
+}
+
+TEST(BasicParser, errors) {
+    Recorder                        recorder;
+    linlib::BasicParser<Recorder>   parser{"1 + * 2", recorder};
+
+    ASSERT_FALSE(parser.parse());
+    EXPECT_EQ(parser.state(), linlib::ParserBase::SYNTAX_ERROR);
+    EXPECT_EQ(recorder._error, "syntax@4");
+}
+
+TEST(BasicParser, same_as_virtual) {
+    for(const char* testcase : {
+        "1", "x", "-(x)", "1+2*3-4/5**6", "f(g(h(x)))", "((((1))))",
+        "1 + ", "2**", "(1", "1)", "x ø", "1e999", "1e-999", "a+b+c+d+e",
+        })
+        test_same(testcase);
+}
+
+TEST(BasicParser, span) {
+    Recorder                        recorder;
+    linlib::BasicParser<Recorder>   parser{"x*2garbage", 3, recorder};
+
+    ASSERT_TRUE(parser.parse());
+    EXPECT_EQ(recorder._stack, "LOAD(x);2.000000;MUL;");
+}
+
+// ========================================================================
+//  Reference implementation
+//
+//  The original recursive descent engine. The operator-precedence
+//  engine must emit the same events and report the same errors.
+// ========================================================================
+template<class Handler>
+class ReferenceEngine
+{
+    private:
+    linlib::ParserBase::State&          _state;
+    const char*             _start;
+    std::size_t             _length;
+    linlib::Tokenizer               _tokenizer;
+    linlib::Token&                  _lookahead;
+
+    Handler&                _handler;
+
+    /**
+        Report a bad token to the event handler.
+        Change the state of the parser.
+
+        A bad token is an unexpected character in the input stream. Only
+        characters in the 7-bits ASCII range are allowed in an expression.
+    */
+    bool  bad_token_error()
+    {
+        _handler.bad_token_error(_start, _length, static_cast<std::size_t>(_lookahead.start-_start));
+        _state = linlib::ParserBase::BAD_TOKEN_ERROR;
+
+        return false;
+    }
+
+    /**
+        Report a syntax error to the event handler.
+        Change the state of the parser.
+
+        Syntax errors occur when an expression does not follow the
+        grammar rules for the language.
+    */
+    bool  syntax_error()
+    {
+        _handler.syntax_error(_start, _length, static_cast<std::size_t>(_lookahead.start-_start));
+        _state = linlib::ParserBase::SYNTAX_ERROR;
+
+        return false;
+    }
+
+    /**
+        Report a number that can't be represented as a finite, non-zero
+        double to the event handler.
+        Change the state of the parser.
+    */
+    bool  range_error()
+    {
+        _handler.range_error(_start, _length, static_cast<std::size_t>(_lookahead.start-_start));
+        _state = linlib::ParserBase::RANGE_ERROR;
+
+        return false;
+    }
+
+    /**
+        Read the next token from the input stream.
+
+        Raise a bad_token_error is the next token was not recognized
+        by the tokenizer.
+    */
+    bool   next()
+    {
+        _lookahead = _tokenizer.next();
+        if (_lookahead.id == linlib::Token::BAD_TOKEN)
+            return bad_token_error();
+
+        return true;
+    }
+
+    /**
+      Consume the given token if found in the stream, otherwise
+      report an error.
+    */
+    bool expect(linlib::Token::Id id)
+    {
+        if (_lookahead.id != id)
+            return syntax_error();
+
+        return next();
+    }
+
+    /**
+        Parse a number.
+
+        Raise a sytax_error if the token can't be converted to
+        a double, or a range_error if it overflows or underflows.
+    */
+    bool read_number()
+    {
+        double result;
+
+        switch(linlib::parse_number(_lookahead.start, _lookahead.length, result))
+        {
+            case linlib::NumberStatus::OK:
+                break;
+            case linlib::NumberStatus::SYNTAX_ERROR:
+                return syntax_error();
+            case linlib::NumberStatus::TOO_LARGE:
+            case linlib::NumberStatus::TOO_SMALL:
+                return range_error();
+        }
+
+        return next() && _handler.number(result);
+    }
+
+    /**
+        call := SYMBOL '(' expr ')'
+                | SYMBOL
+    */
+    bool read_call()
+    {
+        const linlib::Token symbol = _lookahead;
+        // XXX Check if lookhead.id is really a SYMBOL
+
+        if (!next())
+            return false;
+
+        if (_lookahead.id == linlib::Token::LPAR)
+            return next() && read_expr() && expect(linlib::Token::RPAR) && _handler.call(symbol.start, symbol.length);
+        else
+            return _handler.load(symbol.start, symbol.length);
+    }
+
+    /**
+        term := NUMBER
+                | '+' term
+                | '-' term
+                | '(' expr ')'
+                | call'
+    */
+    bool read_term()
+    {
+        if (_lookahead.id == '(')
+        {
+            return next() && read_expr() && expect(linlib::Token::RPAR);
+        }
+        else if (_lookahead.id == '+')
+        {
+            return next() && read_term();
+        }
+        else if (_lookahead.id == '-')
+        {
+            return next() && read_term() && _handler.unary_op(linlib::UnaryOpCode::NEG);
+        }
+        else if (_lookahead.id == linlib::Token::NUMBER)
+        {
+            return read_number();
+        }
+        else if (_lookahead.id == linlib::Token::SYMBOL)
+        {
+            return read_call();
+        }
+
+        return syntax_error();
+    }
+
+    /**
+        prod := term [ '*' term ]*
+    */
+    bool read_pow()
+    {
+        if (!read_term())
+            return false;
+
+        while(true)
+        {
+            if (_lookahead.id == linlib::Token::POW)
+            {
+                if (next() && read_term() && _handler.binary_op(linlib::BinaryOpCode::POW))
+                    continue;
+            }
+            else
+                return true;
+
+            // otherwise
+            return false;
+        }
+    }
+
+    /**
+        prod := pow [ '*' pow ]*
+    */
+    bool read_prod()
+    {
+        if (!read_pow())
+            return false;
+
+        while(true)
+        {
+            if (_lookahead.id == '*')
+            {
+                if (next() && read_pow() && _handler.binary_op(linlib::BinaryOpCode::MUL))
+                    continue;
+            }
+            else if (_lookahead.id == '/')
+            {
+                if (next() && read_pow() && _handler.binary_op(linlib::BinaryOpCode::DIV))
+                    continue;
+            }
+            else
+                return true;
+
+            // otherwise
+            return false;
+        }
+    }
+
+    /**
+        sum := prod [ '+'|'-' prod ]*
+    */
+    bool read_sum()
+    {
+        if (!read_prod())
+            return false;
+
+        while(true)
+        {
+            if (_lookahead.id=='+')
+            {
+                if (next() && read_prod() && _handler.binary_op(linlib::BinaryOpCode::ADD))
+                    continue;
+            }
+            else if (_lookahead.id=='-')
+            {
+                if (next() && read_prod() && _handler.binary_op(linlib::BinaryOpCode::SUB))
+                    continue;
+            }
+            else
+                return true;
+
+            // otherwise
+            return false;
+        }
+    }
+
+    /**
+        expr := sum
+    */
+    bool read_expr()
+    {
+        return read_sum();
+    }
+
+    public:
+    ReferenceEngine(linlib::ParserBase::State& state, const char* start, std::size_t length, linlib::Token& lookahead, Handler& eh)
+      : _state(state),
+        _start(start),
+        _length(length),
+        _tokenizer(start, length),
+        _lookahead(lookahead),
+        _handler(eh)
+    {
+    }
+
+    bool  parse()
+    {
+        class Monitor
+        {
+            linlib::ParserBase::State& _state;
+            linlib::ParserBase::State  _end_state = linlib::ParserBase::INTERNAL_ERROR;
+
+            public:
+            Monitor(linlib::ParserBase::State &state)
+              : _state(state), _end_state(linlib::ParserBase::INTERNAL_ERROR)
+            {
+                _state = linlib::ParserBase::RUNNING;
+            }
+
+            ~Monitor()
+            {
+                if (_state == linlib::ParserBase::RUNNING)
+                    _state = _end_state;
+            }
+
+            inline bool done(void)
+            {
+                _end_state = linlib::ParserBase::OK;
+                return true;
+            }
+        };
+
+        Monitor   monitor{_state};
+        return next() && read_expr() && expect(linlib::Token::END) && monitor.done();
+    }
+
+}; // class ReferenceEngine
+
+void test_same_as_reference(const std::string& testcase)
+{
+    Recorder                        expected;
+    linlib::ParserBase::State       expected_state;
+    linlib::Token                   expected_lookahead{ linlib::Token::END, testcase.data(), 0 };
+    ReferenceEngine<Recorder>       reference{expected_state, testcase.data(), testcase.size(), expected_lookahead, expected};
+    const bool                      expected_ok = reference.parse();
+
+    Recorder                        actual;
+    linlib::BasicParser<Recorder>   parser{testcase.data(), testcase.size(), actual};
+
+    ASSERT_EQ(parser.parse(), expected_ok) << testcase;
+    ASSERT_EQ(parser.state(), expected_state) << testcase;
+    ASSERT_EQ(actual._stack, expected._stack) << testcase;
+    ASSERT_EQ(actual._error, expected._error) << testcase;
+}
+
+/**
+    Fail after a given number of events, to check the partial event
+    sequences match too.
+*/
+struct FailingRecorder : public Recorder
+{
+    int budget;
+
+    FailingRecorder(int budget) : budget(budget) {}
+
+    bool spend() { return budget-- > 0; }
+
+    bool number(double v) { return spend() && Recorder::number(v); }
+    bool call(const char *identifier, std::size_t len) { return spend() && Recorder::call(identifier, len); }
+    bool load(const char *identifier, std::size_t len) { return spend() && Recorder::load(identifier, len); }
+    bool unary_op(linlib::UnaryOpCode opcode) { return spend() && Recorder::unary_op(opcode); }
+    bool binary_op(linlib::BinaryOpCode opcode) { return spend() && Recorder::binary_op(opcode); }
+};
+
+TEST(BasicParser, fuzz) {
+    static const char* tokens[] = {
+        "x", "y", "f", "1", "2.5", "1e999", "(", ")", "+", "-", "*", "/", "**", " ", "\xff",
+    };
+
+    std::mt19937 rng(1234);
+
+    for(int i = 0; i < 200000; ++i)
+    {
+        std::string testcase;
+        for(int n = rng() % 16; n; --n)
+            testcase += tokens[rng() % 15];
+
+        test_same_as_reference(testcase);
+        if (HasFatalFailure())
+            return;
+    }
+}
+
+TEST(BasicParser, fuzz_valid) {
+    // Random well-formed expressions exercise the deeper paths
+    std::mt19937 rng(4321);
+
+    std::function<std::string(int)> expr = [&](int depth) -> std::string {
+        static const char* ops[] = { "+", "-", "*", "/", "**" };
+
+        std::string result;
+        switch(depth > 0 ? rng() % 6 : rng() % 2)
+        {
+            case 0:  result = "x"; break;
+            case 1:  result = std::to_string(rng() % 10); break;
+            case 2:  result = "(" + expr(depth-1) + ")"; break;
+            case 3:  result = "f(" + expr(depth-1) + ")"; break;
+            case 4:  result = (rng() % 2 ? "-" : "+") + expr(depth-1); break;
+            default: result = expr(depth-1) + ops[rng() % 5] + expr(depth-1); break;
+        }
+
+        return result;
+    };
+
+    for(int i = 0; i < 20000; ++i)
+    {
+        const std::string testcase = expr(6);
+
+        test_same_as_reference(testcase);
+        if (HasFatalFailure())
+            return;
+
+        // Stop the handler half-way
+        Recorder                        full;
+        linlib::BasicParser<Recorder>   counter{testcase.c_str(), full};
+        ASSERT_TRUE(counter.parse()) << testcase;
+
+        const int                       budget = rng() % 20;
+        FailingRecorder                 expected{budget};
+        linlib::ParserBase::State       expected_state;
+        linlib::Token                   lookahead{ linlib::Token::END, testcase.data(), 0 };
+        ReferenceEngine<FailingRecorder> reference{expected_state, testcase.data(), testcase.size(), lookahead, expected};
+        reference.parse();
+
+        FailingRecorder                         actual{budget};
+        linlib::BasicParser<FailingRecorder>    parser{testcase.c_str(), actual};
+        parser.parse();
+
+        ASSERT_EQ(parser.state(), expected_state) << testcase;
+        ASSERT_EQ(actual._stack, expected._stack) << testcase;
+    }
+}
+
+// ========================================================================
+//  Depth limit
+// ========================================================================
+void test_depth(const std::string& testcase, std::size_t max_depth, bool expected)
+{
+    Recorder                        recorder;
+    linlib::BasicParser<Recorder>   parser{testcase.data(), testcase.size(), recorder};
+
+    parser.max_depth(max_depth);
+    EXPECT_EQ(parser.parse(), expected) << testcase.substr(0, 40) << "... (" << max_depth << ")";
+    if (!expected)
+    {
+        EXPECT_EQ(parser.state(), linlib::ParserBase::DEPTH_ERROR);
+    }
+}
+
+TEST(BasicParser, max_depth) {
+    const std::string parens = std::string(100, '(') + "x" + std::string(100, ')');
+    const std::string signs = std::string(100, '-') + "x";
+    const std::string calls = [] {
+        std::string result;
+        for(int i = 0; i < 100; ++i)
+            result += "f(";
+        return result + "x" + std::string(100, ')');
+    }();
+
+    for(const std::string& testcase : { parens, signs, calls })
+    {
+        test_depth(testcase, 100, true);
+        test_depth(testcase, 99, false);
+        test_depth(testcase, 1000, true);
+    }
+
+    // Pending binary operators count too
+    test_depth("1+2*3**(4)", 4, true);
+    test_depth("1+2*3**(4)", 3, false);
+
+    // Flat expressions don't grow the stack
+    std::string sum = "x";
+    for(int i = 0; i < 10000; ++i)
+        sum += "+x*x**x";
+    test_depth(sum, 3, true);
+}
+
+TEST(BasicParser, hostile_input) {
+    // Deep enough to overflow the thread stack of a recursive parser
+    const std::string testcase = std::string(1000000, '(') + "x";
+
+    Recorder                        recorder;
+    linlib::BasicParser<Recorder>   parser{testcase.data(), testcase.size(), recorder};
+
+    EXPECT_FALSE(parser.parse());
+    EXPECT_EQ(parser.state(), linlib::ParserBase::DEPTH_ERROR);
+    EXPECT_EQ(recorder._error, "depth@1024");
+
+    parser.max_depth(-1);
+    EXPECT_FALSE(parser.parse());
+    EXPECT_EQ(parser.state(), linlib::ParserBase::SYNTAX_ERROR);
+}
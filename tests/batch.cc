@@ -0,0 +1,142 @@
+/*
+ *
+ *  Tests for the columnar batch evaluator
+ *
+ */
+#include <cmath>
+#include <cstring>
+#include <random>
+
+#include "gtest/gtest.h"
+#include "lib/batch.h"
+#include "lib/optimizer.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static double square(double x) { return x*x; }
+
+static const linlib::Isa isas[] = {
+    linlib::Isa::SCALAR,
+    linlib::Isa::SSE2,
+    linlib::Isa::AVX2,
+    linlib::Isa::AVX512,
+};
+
+/**
+    Compare the batch evaluator against the interpreter, row by row.
+    Results must be bit-identical.
+*/
+void test(const char* testcase, std::size_t rows, const linlib::Optimizer* optimizer = nullptr)
+{
+    linlib::Program program;
+    ASSERT_TRUE(linlib::compile(testcase, program)) << testcase;
+    if (optimizer)
+        optimizer->run(program);
+
+    std::mt19937_64 rng(rows);
+    std::uniform_real_distribution<double> dist(-10.0, 10.0);
+
+    std::vector<std::vector<double>>    data(program.variables.size());
+    std::vector<const double*>          columns;
+    for(auto& column : data)
+    {
+        for(std::size_t i = 0; i < rows; ++i)
+            column.push_back(dist(rng));
+        columns.push_back(column.data());
+    }
+
+    std::vector<linlib::Function> fcts(program.functions.size(), square);
+
+    std::vector<double> expected(rows);
+    linlib::Machine     machine;
+    std::vector<double> row(data.size());
+    for(std::size_t i = 0; i < rows; ++i)
+    {
+        for(std::size_t j = 0; j < data.size(); ++j)
+            row[j] = data[j][i];
+        expected[i] = machine.run(program, row.data(), fcts.data());
+    }
+
+    for(auto isa : isas)
+    {
+        const linlib::Kernels* kernels = linlib::kernels(isa);
+        if (!kernels)
+            continue;
+
+        linlib::BatchEvaluator  evaluator{*kernels};
+        std::vector<double>     out(rows);
+
+        evaluator.run(program, columns.data(), fcts.data(), out.data(), rows);
+
+        EXPECT_EQ(std::memcmp(out.data(), expected.data(), rows*sizeof(double)), 0)
+            << testcase << " (" << kernels->name << ", " << rows << " rows)";
+    }
+}
+
+// ========================================================================
+//  Tests
+// ========================================================================
+TEST(Batch, kernels) {
+    EXPECT_TRUE(linlib::supported(linlib::Isa::SCALAR));
+    EXPECT_TRUE(linlib::kernels(linlib::Isa::SCALAR));
+    EXPECT_TRUE(linlib::supported(linlib::kernels().isa));
+}
+
+TEST(Batch, operators) {
+    for(std::size_t rows : { 1, 7, 256, 1000 })
+    {
+        test("x+y", rows);
+        test("x-y", rows);
+        test("x*y", rows);
+        test("x/y", rows);
+        test("x**2", rows);
+        test("-x", rows);
+        test("x", rows);
+        test("2", rows);
+    }
+}
+
+TEST(Batch, expressions) {
+    for(std::size_t rows : { 3, 1000 })
+    {
+        test("x*y + z/x - y*2", rows);
+        test("-(x + -y) * sq(z - 1) / 3", rows);
+        test("1+(x+(y+(z+(x*y))))", rows);
+    }
+}
+
+TEST(Batch, strength_reduced) {
+    const linlib::Optimizer optimizer{linlib::Optimizer::FAST_MATH};
+
+    for(std::size_t rows : { 5, 1000 })
+    {
+        test("x**2", rows, &optimizer);
+        test("x**7 - y**16", rows, &optimizer);
+        test("(x*y)**-3 + x**31", rows, &optimizer);
+        test("x**0.5 + (y*y)**0.5", rows, &optimizer);
+        test("x/3 + y/4", rows, &optimizer);
+        test("1+(x+(y+(x*y)**5))", rows, &optimizer);
+    }
+}
+
+TEST(Batch, negative_zero) {
+    linlib::Program program;
+    ASSERT_TRUE(linlib::compile("-x", program));
+
+    const double    x[] = { 0.0, -0.0, 1.0, -1.0, 2.0, 3.0, 4.0, 5.0, 6.0 };
+    const double*   columns[] = { x };
+
+    for(auto isa : isas)
+    {
+        const linlib::Kernels* kernels = linlib::kernels(isa);
+        if (!kernels)
+            continue;
+
+        double out[9];
+        linlib::BatchEvaluator{*kernels}.run(program, columns, nullptr, out, 9);
+
+        for(int i = 0; i < 9; ++i)
+            EXPECT_EQ(std::signbit(out[i]), !std::signbit(x[i])) << kernels->name;
+    }
+}
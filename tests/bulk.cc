@@ -0,0 +1,109 @@
+/*
+ *
+ *  Tests for the parallel bulk compiler
+ *
+ */
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/bulk.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static std::vector<std::string> expressions(std::size_t count)
+{
+    static const char* terms[] = { "x", "y", "2", "3.5", "sqrt(x)", "(x+y)", "-z" };
+    static const char* ops[] = { "+", "-", "*", "/", "**" };
+
+    std::mt19937                rng(42);
+    std::vector<std::string>    result;
+
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        std::string expr = terms[rng() % 7];
+        for(int n = rng() % 8; n; --n)
+            expr += std::string(ops[rng() % 5]) + terms[rng() % 7];
+
+        // Some expressions are broken
+        if (i % 97 == 0)
+            expr += "*";
+
+        result.push_back(expr);
+    }
+
+    return result;
+}
+
+static bool same(const linlib::Program& a, const linlib::Program& b)
+{
+    if (a.code.size() != b.code.size())
+        return false;
+
+    for(std::size_t i = 0; i < a.code.size(); ++i)
+        if (a.code[i].op != b.code[i].op || a.code[i].arg != b.code[i].arg)
+            return false;
+
+    return a.constants == b.constants
+        && a.variables.names() == b.variables.names()
+        && a.functions.names() == b.functions.names();
+}
+
+// ========================================================================
+//  Tests
+// ========================================================================
+TEST(Bulk, same_as_serial) {
+    const auto          exprs = expressions(10000);
+    linlib::ThreadPool  pool{4};
+
+    std::vector<linlib::Program> programs;
+    const std::size_t failures = linlib::compile(exprs, programs, pool);
+
+    ASSERT_EQ(programs.size(), exprs.size());
+
+    std::size_t expected_failures = 0;
+    for(std::size_t i = 0; i < exprs.size(); ++i)
+    {
+        linlib::Program expected;
+
+        if (!linlib::compile(exprs[i].c_str(), expected))
+        {
+            ++expected_failures;
+            EXPECT_TRUE(programs[i].code.empty()) << exprs[i];
+        }
+        else
+            EXPECT_TRUE(same(programs[i], expected)) << exprs[i];
+    }
+
+    EXPECT_EQ(failures, expected_failures);
+    EXPECT_GT(failures, 0u);
+}
+
+TEST(Bulk, shared_symbols) {
+    const linlib::SymbolTable   variables{ "x", "y", "z" };
+    const linlib::SymbolTable   functions{ "sqrt" };
+    const auto                  exprs = expressions(1000);
+    linlib::ThreadPool          pool{3};
+
+    std::vector<linlib::Program> programs;
+    linlib::compile(exprs, programs, variables, functions, pool);
+
+    for(std::size_t i = 0; i < exprs.size(); ++i)
+    {
+        if (programs[i].code.empty())
+            continue;
+
+        EXPECT_TRUE(programs[i].shared_symbols);
+        EXPECT_EQ(programs[i].variables.names(), variables.names());
+    }
+}
+
+TEST(Bulk, empty_batch) {
+    linlib::ThreadPool              pool{2};
+    std::vector<linlib::Program>    programs(3);
+
+    EXPECT_EQ(linlib::compile({}, programs, pool), 0u);
+    EXPECT_TRUE(programs.empty());
+}
@@ -0,0 +1,105 @@
+/*
+ *
+ *  Tests for the compiled-expression cache
+ *
+ */
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "lib/cache.h"
+
+// ========================================================================
+//  Tests
+// ========================================================================
+TEST(Cache, hit_and_miss) {
+    linlib::ProgramCache cache{1 << 20};
+
+    auto a = cache.get("x*2+1");
+    auto b = cache.get("x*2+1");
+    auto c = cache.get("y*2+1");
+
+    ASSERT_TRUE(a);
+    EXPECT_EQ(a, b);
+    EXPECT_NE(a, c);
+
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.evictions, 0u);
+    EXPECT_EQ(stats.entries, 2u);
+}
+
+TEST(Cache, failures_are_not_cached) {
+    linlib::ProgramCache cache{1 << 20};
+
+    EXPECT_FALSE(cache.get("2*/4"));
+    EXPECT_FALSE(cache.get("2*/4"));
+
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.entries, 0u);
+}
+
+TEST(Cache, lru_eviction) {
+    linlib::Program program;
+    ASSERT_TRUE(linlib::compile("x+1", program));
+    const std::size_t size = linlib::ProgramCache::footprint("x+1", program);
+
+    // Room for two entries in a single shard
+    linlib::ProgramCache cache{2*size, 1};
+
+    auto x = cache.get("x+1");
+    cache.get("y+1");
+    cache.get("x+1");       // x is now the most recently used
+    cache.get("z+1");       // evicts y
+
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.evictions, 1u);
+    EXPECT_EQ(stats.entries, 2u);
+    EXPECT_LE(stats.bytes, 2*size);
+
+    EXPECT_EQ(cache.get("x+1"), x);
+    EXPECT_EQ(cache.stats().hits, 2u);
+
+    cache.get("y+1");
+    EXPECT_EQ(cache.stats().misses, 4u);
+}
+
+TEST(Cache, evicted_entries_stay_alive) {
+    linlib::ProgramCache cache{1, 1};
+
+    auto a = cache.get("x+1");
+    cache.clear();
+
+    ASSERT_TRUE(a);
+    EXPECT_EQ(a->code.size(), 3u);
+}
+
+TEST(Cache, concurrent_lookups) {
+    linlib::ProgramCache cache{1 << 20, 4};
+
+    const int THREADS = 8;
+    const int EXPRESSIONS = 50;
+    const int ROUNDS = 20;
+
+    std::vector<std::thread> threads;
+    for(int t = 0; t < THREADS; ++t)
+        threads.emplace_back([&cache]() {
+            for(int round = 0; round < ROUNDS; ++round)
+                for(int i = 0; i < EXPRESSIONS; ++i)
+                {
+                    auto program = cache.get("x*" + std::to_string(i));
+                    ASSERT_TRUE(program);
+                    ASSERT_EQ(program->constants.at(0), i);
+                }
+        });
+
+    for(auto& thread : threads)
+        thread.join();
+
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.entries, static_cast<std::size_t>(EXPRESSIONS));
+    EXPECT_EQ(stats.hits + stats.misses, static_cast<std::uint64_t>(THREADS*ROUNDS*EXPRESSIONS));
+    EXPECT_GE(stats.misses, static_cast<std::uint64_t>(EXPRESSIONS));
+}
@@ -0,0 +1,453 @@
+/*
+ *
+ *  Tests for the columnar streams and their pipelined evaluation
+ *
+ */
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/columns.h"
+
+using linlib::ColumnStatus;
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static double square(double x) { return x*x; }
+
+/**
+    Read a whole stream, column by column.
+*/
+static std::vector<std::vector<double>> read_all(linlib::ColumnReader& reader, std::size_t chunk_rows)
+{
+    std::vector<std::vector<double>>    result(reader.names().size());
+    linlib::Chunk                       chunk;
+
+    chunk.reserve(reader.names().size(), chunk_rows);
+    while(reader.read(chunk))
+    {
+        EXPECT_LE(chunk.rows, chunk.capacity());
+        for(std::size_t i = 0; i < result.size(); ++i)
+            result[i].insert(result[i].end(), chunk.column(i), chunk.column(i) + chunk.rows);
+    }
+
+    return result;
+}
+
+static void expect_same(double value, double expected)
+{
+    if (std::isnan(expected))
+    {
+        EXPECT_TRUE(std::isnan(value));
+    }
+    else
+    {
+        EXPECT_EQ(value, expected);
+    }
+}
+
+/**
+    A table of `rows` rows over x, y, z, as CSV.
+*/
+static std::string table(std::size_t rows)
+{
+    std::ostringstream out;
+
+    out << "x,y,z\n";
+    for(std::size_t i = 0; i < rows; ++i)
+        out << i << "," << 0.25*i << "," << (i % 7) - 3.5 << "\n";
+
+    return out.str();
+}
+
+// ========================================================================
+//  Tests
+// ========================================================================
+TEST(Columns, csv) {
+    std::istringstream  in(" a ,b\t\n1, -2.5\r\n\n3e2,\n  +4 , -inf");
+    linlib::CsvReader   reader(in);
+
+    ASSERT_EQ(reader.status(), ColumnStatus::OK);
+    ASSERT_EQ(reader.names(), (std::vector<std::string>{ "a", "b" }));
+
+    const auto columns = read_all(reader, 2);
+    EXPECT_EQ(reader.status(), ColumnStatus::OK);
+    ASSERT_EQ(columns[0], (std::vector<double>{ 1, 300, 4 }));
+    ASSERT_EQ(columns[1].size(), 3u);
+    EXPECT_EQ(columns[1][0], -2.5);
+    EXPECT_TRUE(std::isnan(columns[1][1]));
+    EXPECT_EQ(columns[1][2], -std::numeric_limits<double>::infinity());
+}
+
+TEST(Columns, csv_errors) {
+    {
+        std::istringstream  in("");
+        linlib::CsvReader   reader(in);
+        EXPECT_EQ(reader.status(), ColumnStatus::BAD_FORMAT);
+    }
+    for(const char* text : { "a,b\n1,2\n1,x\n", "a,b\n1,2\n1\n", "a,b\n1,2\n1,2,3\n" })
+    {
+        std::istringstream  in(text);
+        linlib::CsvReader   reader(in);
+        linlib::Chunk       chunk;
+
+        EXPECT_FALSE(reader.read(chunk)) << text;
+        EXPECT_EQ(reader.status(), ColumnStatus::BAD_FORMAT) << text;
+        EXPECT_EQ(reader.line(), 3u) << text;
+    }
+}
+
+TEST(Columns, csv_long_lines) {
+    // Lines longer than the read buffer
+    std::string text;
+    for(int i = 0; i < 20000; ++i)
+        text += (i ? ",c" : "c") + std::to_string(i);
+    text += "\n";
+    for(int row = 0; row < 3; ++row)
+    {
+        for(int i = 0; i < 20000; ++i)
+            text += (i ? "," : "") + std::to_string(row*i);
+        text += "\n";
+    }
+
+    std::istringstream  in(text);
+    linlib::CsvReader   reader(in);
+    ASSERT_EQ(reader.names().size(), 20000u);
+
+    const auto columns = read_all(reader, 16);
+    EXPECT_EQ(reader.status(), ColumnStatus::OK);
+    EXPECT_EQ(columns[19999], (std::vector<double>{ 0, 19999, 2*19999 }));
+}
+
+TEST(Columns, round_trip) {
+    const double values[] = {
+        0.1, -1e-300, 1e300, 123456789.123456789, 5e-324,
+        std::numeric_limits<double>::quiet_NaN(),
+        std::numeric_limits<double>::infinity(),
+    };
+    const std::size_t count = sizeof(values)/sizeof(values[0]);
+
+    linlib::Chunk chunk;
+    chunk.reserve(2, count);
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        chunk.column(0)[i] = values[i];
+        chunk.column(1)[i] = -values[i];
+    }
+    chunk.rows = count;
+
+    for(bool binary : { false, true })
+    {
+        std::stringstream stream;
+        if (binary)
+        {
+            linlib::BinaryColumnWriter writer(stream, { "p", "q" });
+            ASSERT_TRUE(writer.write(chunk));
+            ASSERT_TRUE(writer.write(chunk));
+            ASSERT_TRUE(writer.finish());
+        }
+        else
+        {
+            linlib::CsvWriter writer(stream, { "p", "q" });
+            ASSERT_TRUE(writer.write(chunk));
+            ASSERT_TRUE(writer.write(chunk));
+            ASSERT_TRUE(writer.finish());
+        }
+
+        std::unique_ptr<linlib::ColumnReader> reader;
+        if (binary)
+            reader.reset(new linlib::BinaryColumnReader(stream));
+        else
+            reader.reset(new linlib::CsvReader(stream));
+
+        ASSERT_EQ(reader->names(), (std::vector<std::string>{ "p", "q" }));
+        const auto columns = read_all(*reader, 3);
+        EXPECT_EQ(reader->status(), ColumnStatus::OK);
+        ASSERT_EQ(columns[0].size(), 2*count);
+        for(std::size_t i = 0; i < 2*count; ++i)
+        {
+            expect_same(columns[0][i], values[i % count]);
+            expect_same(columns[1][i], -values[i % count]);
+        }
+    }
+}
+
+TEST(Columns, csv_format) {
+    // Every value written reads back bit for bit
+    std::mt19937_64                         rng(7);
+    std::uniform_int_distribution<int>      digits(0, 1000000);
+    std::uniform_int_distribution<int>      scale(0, 20);
+    linlib::Chunk                           chunk;
+
+    chunk.reserve(2, 10000);
+    for(std::size_t i = 0; i < chunk.capacity(); ++i)
+    {
+        // Short decimals, and arbitrary bit patterns
+        const std::uint64_t bits = rng();
+        double              value;
+
+        std::memcpy(&value, &bits, sizeof(value));
+        chunk.column(0)[i] = (i % 2 ? -1 : 1) * digits(rng) / std::pow(10.0, scale(rng));
+        chunk.column(1)[i] = std::isnan(value) ? 0.0 : value;
+    }
+    chunk.column(0)[0] = -0.0;
+    chunk.column(0)[1] = 9007199254740993.0;
+    chunk.column(0)[2] = 0.1 + 0.2;
+    chunk.rows = chunk.capacity();
+
+    std::stringstream   stream;
+    linlib::CsvWriter   writer(stream, { "p", "q" });
+    ASSERT_TRUE(writer.write(chunk));
+    ASSERT_TRUE(writer.finish());
+
+    EXPECT_EQ(stream.str().substr(0, 7), "p,q\n-0,");
+
+    linlib::CsvReader   reader(stream);
+    const auto          columns = read_all(reader, 4096);
+    ASSERT_EQ(columns[0].size(), chunk.rows);
+    for(std::size_t c = 0; c < 2; ++c)
+        for(std::size_t i = 0; i < chunk.rows; ++i)
+            ASSERT_EQ(std::memcmp(&columns[c][i], &chunk.column(c)[i], sizeof(double)), 0)
+                << chunk.column(c)[i] << " read as " << columns[c][i];
+}
+
+TEST(Columns, binary_header) {
+    std::stringstream   stream;
+
+    linlib::BinaryColumnWriter writer(stream, { "a", "bc" });
+    writer.finish();
+
+    // Magic, version, column count, names, end marker
+    const std::string expected("LINLIBCS" "\1\0\0\0" "\2\0\0\0" "\1\0\0\0a" "\2\0\0\0bc" "\0\0\0\0", 31);
+    EXPECT_EQ(stream.str(), expected);
+}
+
+TEST(Columns, binary_errors) {
+    std::stringstream   stream;
+    linlib::Chunk       chunk;
+
+    chunk.reserve(1, 10);
+    chunk.rows = 10;
+
+    linlib::BinaryColumnWriter writer(stream, { "a" });
+    writer.write(chunk);
+    writer.finish();
+    const std::string data = stream.str();
+
+    {
+        std::istringstream          in("LINLIBXX" + data.substr(8));
+        linlib::BinaryColumnReader  reader(in);
+        EXPECT_EQ(reader.status(), ColumnStatus::BAD_FORMAT);
+    }
+    {
+        // Truncated block, then missing end marker
+        for(std::size_t cut : { data.size() - 8, data.size() - 4 })
+        {
+            std::istringstream          in(data.substr(0, cut));
+            linlib::BinaryColumnReader  reader(in);
+
+            ASSERT_EQ(reader.status(), ColumnStatus::OK);
+            while(reader.read(chunk))
+                ;
+            EXPECT_EQ(reader.status(), ColumnStatus::BAD_FORMAT) << cut;
+        }
+    }
+}
+
+TEST(Columns, evaluate) {
+    const std::vector<std::string> expressions = { "x*y + f(z)", "x", "-(x*y) / (z + 0.5)" };
+
+    linlib::FusedProgram program;
+    ASSERT_TRUE(linlib::compile(expressions, program));
+    const linlib::Function fcts[] = { square };
+
+    for(std::size_t rows : { 0, 1, 1000 })
+        for(std::size_t chunk_rows : { 1, 7, 4096 })
+        {
+            std::istringstream  in(table(rows));
+            std::stringstream   out;
+            linlib::CsvReader   reader(in);
+            linlib::CsvWriter   writer(out, { "a", "b", "c" });
+            std::size_t         count;
+
+            ASSERT_EQ(linlib::evaluate(reader, program, fcts, writer, count, chunk_rows), ColumnStatus::OK);
+            EXPECT_EQ(count, rows);
+
+            linlib::CsvReader result(out);
+            ASSERT_EQ(result.names(), (std::vector<std::string>{ "a", "b", "c" }));
+
+            const auto columns = read_all(result, 100);
+            ASSERT_EQ(columns[0].size(), rows);
+            for(std::size_t i = 0; i < rows; ++i)
+            {
+                const double x = i, y = 0.25*i, z = (i % 7) - 3.5;
+
+                expect_same(columns[0][i], x*y + z*z);
+                expect_same(columns[1][i], x);
+                expect_same(columns[2][i], -(x*y) / (z + 0.5));
+            }
+        }
+}
+
+TEST(Columns, evaluate_binary) {
+    // CSV to binary, then binary to CSV
+    linlib::FusedProgram first, second;
+    ASSERT_TRUE(linlib::compile({ "x + y", "z" }, first));
+    ASSERT_TRUE(linlib::compile({ "s * 2", "s - t" }, second));
+
+    std::istringstream          in(table(5000));
+    std::stringstream           binary;
+    std::stringstream           out;
+    std::size_t                 count;
+
+    linlib::CsvReader           csv_reader(in);
+    linlib::BinaryColumnWriter  binary_writer(binary, { "s", "t" });
+    ASSERT_EQ(linlib::evaluate(csv_reader, first, nullptr, binary_writer, count, 300), ColumnStatus::OK);
+
+    linlib::BinaryColumnReader  binary_reader(binary);
+    linlib::CsvWriter           csv_writer(out, { "u", "v" });
+    ASSERT_EQ(linlib::evaluate(binary_reader, second, nullptr, csv_writer, count, 1000), ColumnStatus::OK);
+    EXPECT_EQ(count, 5000u);
+
+    linlib::CsvReader result(out);
+    const auto columns = read_all(result, 4096);
+    ASSERT_EQ(columns[0].size(), 5000u);
+    for(std::size_t i = 0; i < 5000; ++i)
+    {
+        const double s = i + 0.25*i, t = (i % 7) - 3.5;
+
+        EXPECT_EQ(columns[0][i], s*2);
+        EXPECT_EQ(columns[1][i], s-t);
+    }
+}
+
+TEST(Columns, wide) {
+    const std::size_t   width = linlib::ColumnReader::MAX_COLUMNS;
+    std::string         header = "c0";
+
+    for(std::size_t i = 1; i < width; ++i)
+        header += ",c" + std::to_string(i);
+
+    linlib::FusedProgram program;
+    ASSERT_TRUE(linlib::compile({ "c0 + c" + std::to_string(width-1) }, program));
+
+    {
+        // Chunks are scaled down to fit Chunk::MAX_VALUES
+        std::string row = "1" + std::string(width-2, ',') + ",2\n";
+        std::istringstream  in(header + "\n" + row + row + row);
+        std::stringstream   out;
+        linlib::CsvReader   reader(in);
+        linlib::CsvWriter   writer(out, { "a" });
+        std::size_t         count;
+
+        ASSERT_EQ(linlib::evaluate(reader, program, nullptr, writer, count, 1 << 20), ColumnStatus::OK);
+        EXPECT_EQ(count, 3u);
+        EXPECT_EQ(out.str(), "a\n3\n3\n3\n");
+    }
+    {
+        std::istringstream  in(header + ",c" + std::to_string(width) + "\n");
+        linlib::CsvReader   reader(in);
+        EXPECT_EQ(reader.status(), ColumnStatus::BAD_FORMAT);
+    }
+    {
+        // Too many columns, then too many values in a block
+        std::string data("LINLIBCS\1\0\0\0\0\0\0\0", 16);
+        const std::uint32_t counts[] = { std::uint32_t(width+1), 8 };
+
+        for(std::uint32_t count : counts)
+        {
+            std::string names = data;
+            names.replace(12, 4, reinterpret_cast<const char*>(&count), 4);
+            for(std::uint32_t i = 0; i < count; ++i)
+                names.append("\1\0\0\0x", 5);
+
+            const std::uint32_t rows = linlib::Chunk::MAX_VALUES / 4;
+            std::istringstream          in(names + std::string(reinterpret_cast<const char*>(&rows), 4));
+            linlib::BinaryColumnReader  reader(in);
+            linlib::Chunk               chunk;
+
+            reader.read(chunk);
+            EXPECT_EQ(reader.status(), ColumnStatus::BAD_FORMAT) << count;
+            EXPECT_EQ(chunk.capacity(), 0u);
+        }
+    }
+}
+
+TEST(Columns, long_blocks) {
+    // Binary blocks longer than the output chunks are evaluated in slices
+    linlib::FusedProgram program;
+    ASSERT_TRUE(linlib::compile({ "a", "a*2", "a*3", "a*4" }, program));
+
+    linlib::Chunk       chunk;
+    std::stringstream   binary;
+
+    chunk.reserve(1, 1000);
+    for(std::size_t i = 0; i < 1000; ++i)
+        chunk.column(0)[i] = i;
+    chunk.rows = 1000;
+
+    linlib::BinaryColumnWriter  writer(binary, { "a" });
+    ASSERT_TRUE(writer.write(chunk));
+    ASSERT_TRUE(writer.finish());
+
+    std::stringstream           out;
+    std::size_t                 count;
+    linlib::BinaryColumnReader  reader(binary);
+    linlib::CsvWriter           csv_writer(out, { "a", "b", "c", "d" });
+    ASSERT_EQ(linlib::evaluate(reader, program, nullptr, csv_writer, count, 64), ColumnStatus::OK);
+    EXPECT_EQ(count, 1000u);
+
+    linlib::CsvReader result(out);
+    const auto columns = read_all(result, 4096);
+    ASSERT_EQ(columns[3].size(), 1000u);
+    for(std::size_t i = 0; i < 1000; ++i)
+        EXPECT_EQ(columns[3][i], 4.0*i);
+}
+
+TEST(Columns, evaluate_errors) {
+    linlib::FusedProgram program;
+    ASSERT_TRUE(linlib::compile({ "x + w" }, program));
+
+    {
+        std::istringstream  in(table(10));
+        std::stringstream   out;
+        linlib::CsvReader   reader(in);
+        linlib::CsvWriter   writer(out, { "a" });
+        std::size_t         count;
+
+        EXPECT_EQ(linlib::evaluate(reader, program, nullptr, writer, count), ColumnStatus::UNKNOWN_COLUMN);
+        EXPECT_TRUE(out.str().empty());
+    }
+
+    ASSERT_TRUE(linlib::compile({ "x + z" }, program));
+    {
+        // A bad row far into the stream
+        std::istringstream  in(table(10000) + "1,2,oops\n" + table(10).substr(6));
+        std::stringstream   out;
+        linlib::CsvReader   reader(in);
+        linlib::CsvWriter   writer(out, { "a" });
+        std::size_t         count;
+
+        EXPECT_EQ(linlib::evaluate(reader, program, nullptr, writer, count, 64), ColumnStatus::BAD_FORMAT);
+        EXPECT_EQ(reader.line(), 10002u);
+    }
+    {
+        // The writer fails
+        std::istringstream  in(table(10000));
+        std::ostringstream  out;
+        linlib::CsvReader   reader(in);
+        linlib::CsvWriter   writer(out, { "a" });
+        std::size_t         count;
+
+        out.setstate(std::ios::badbit);
+        EXPECT_EQ(linlib::evaluate(reader, program, nullptr, writer, count, 64), ColumnStatus::IO_ERROR);
+    }
+}
@@ -0,0 +1,115 @@
+/*
+ *
+ *  Tests for the hash-consed expression DAG
+ *
+ */
+#include <cmath>
+
+#include "gtest/gtest.h"
+#include "lib/dag.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static int calls = 0;
+
+static double counted_sqrt(double x)
+{
+    ++calls;
+    return std::sqrt(x);
+}
+
+void build(const char* testcase, linlib::Dag& dag)
+{
+    linlib::DagBuilder  builder{dag};
+    linlib::Parser      parser{testcase, builder};
+
+    ASSERT_TRUE(parser.parse()) << testcase;
+}
+
+/**
+    Check the DAG evaluates like the interpreter.
+*/
+void test(const char* testcase, std::size_t tree_size, std::size_t dag_size)
+{
+    linlib::Dag dag;
+    build(testcase, dag);
+
+    EXPECT_EQ(dag.tree_size, tree_size) << testcase;
+    EXPECT_EQ(dag.nodes.size(), dag_size) << testcase;
+    ASSERT_EQ(dag.roots.size(), 1u);
+
+    linlib::Program program;
+    ASSERT_TRUE(linlib::compile(testcase, program));
+    ASSERT_EQ(program.variables.names(), dag.variables.names());
+
+    std::vector<double>             vars(dag.variables.size());
+    std::vector<linlib::Function>   fcts(dag.functions.size(), std::sqrt);
+    for(std::size_t i = 0; i < vars.size(); ++i)
+        vars[i] = 1.5 + i;
+
+    linlib::Machine         machine;
+    linlib::DagEvaluator    evaluator;
+
+    EXPECT_EQ(evaluator.run(dag, vars.data(), fcts.data()),
+              machine.run(program, vars.data(), fcts.data())) << testcase;
+}
+
+// ========================================================================
+//  Tests
+// ========================================================================
+TEST(Dag, no_sharing) {
+    test("1+2", 3, 3);
+    test("a*b-c", 5, 5);
+}
+
+TEST(Dag, sharing) {
+    test("x+x", 3, 2);
+    test("1+1", 3, 2);
+    test("sqrt(a*a+b*b) + sqrt(a*a+b*b)", 17, 7);
+    test("sqrt(a*a+b*b)*2 - sqrt(a*a+b*b)/sqrt(a*a+b*b)", 28, 10);
+}
+
+TEST(Dag, commutative) {
+    test("a*b + b*a", 7, 4);
+    test("a+b - (b+a)", 7, 4);
+    test("a-b - (b-a)", 7, 5);
+    test("a/b + b/a", 7, 5);
+}
+
+TEST(Dag, signed_zero) {
+    test("x*0 + x*-0", 8, 6);
+}
+
+TEST(Dag, shared_nodes_are_evaluated_once) {
+    linlib::Dag dag;
+    build("sqrt(a*a+b*b) + sqrt(a*a+b*b) + sqrt(a*a+b*b)", dag);
+
+    const double                vars[] = { 3, 4 };
+    const linlib::Function      fcts[] = { counted_sqrt };
+
+    calls = 0;
+    linlib::DagEvaluator evaluator;
+    EXPECT_EQ(evaluator.run(dag, vars, fcts), 15);
+    EXPECT_EQ(calls, 1);
+}
+
+TEST(Dag, several_expressions) {
+    linlib::Dag dag;
+    build("x*y + 1", dag);
+    build("x*y - 1", dag);
+    build("sqrt(x*y)", dag);
+
+    ASSERT_EQ(dag.roots.size(), 3u);
+    EXPECT_EQ(dag.tree_size, 14u);
+    EXPECT_EQ(dag.nodes.size(), 7u);
+
+    const double            vars[] = { 2, 8 };
+    const linlib::Function  fcts[] = { std::sqrt };
+    double                  out[3];
+
+    linlib::DagEvaluator().run(dag, vars, fcts, out);
+    EXPECT_EQ(out[0], 17);
+    EXPECT_EQ(out[1], 15);
+    EXPECT_EQ(out[2], 4);
+}
@@ -5,6 +5,7 @@
  */
 #include <iostream>
 #include <cstring>
+#include <string>
 
 #include "gtest/gtest.h"
 #include "lib/parser.h"
@@ -80,6 +81,19 @@ struct NEH : public linlib::EventHandler
     }
 };
 
+/**
+    A handler written against the deprecated error callbacks.
+*/
+struct LegacyEH : public NEH
+{
+    std::string error;
+
+    LegacyEH() : NEH(NOTHING) {}
+
+    void bad_token_error(const char* stmt, unsigned pos) { error = "bad token@" + std::to_string(pos); }
+    void syntax_error(const char* stmt, unsigned pos) { error = "syntax@" + std::to_string(pos); }
+};
+
 void test_no_error(int mode, const char* testcase)
 {
     NEH eh{mode};
@@ -120,6 +134,16 @@ void test_syntax_error(const char* testcase)
     EXPECT_EQ(parser.state(), linlib::Parser::SYNTAX_ERROR);
 }
 
+void test_range_error(const char* testcase)
+{
+    NEH eh{NEH::NOTHING};
+
+    linlib::Parser  parser{testcase, eh};
+
+    ASSERT_FALSE(parser.parse()) << testcase;
+    EXPECT_EQ(parser.state(), linlib::Parser::RANGE_ERROR);
+}
+
 void test_error_message(const char* testcase, std::initializer_list<const char*> keywords)
 {
     NEH eh{NEH::NOTHING};
@@ -174,6 +198,17 @@ TEST(Parser, syntax_error) {
     test_syntax_error("cos(2))");
     test_syntax_error("*2");
     test_syntax_error("2* *4"); // do not mistaken '* *' for '**'
+    test_syntax_error("1e+2+1e");
+    test_syntax_error("1+.");
+}
+
+TEST(Parser, range_error) {
+    test_range_error("1e309");
+    test_range_error("2*1e-400");
+    test_range_error("x+179769313486231580793728971405303415079934132710037826936173778980444968292764750946649017977587207096330286416692887910946555547851940402630657488671505820681908902000708383676273854845817711531764475730270069855571366959622842914819860834936475292719074168444365510704342711559699508093042880177904174497792");
+    test_no_error(NEH::NOTHING, "1.7976931348623157e308");
+    test_no_error(NEH::NOTHING, "4.9406564584124654e-324");
+    test_no_error(NEH::NOTHING, "0e999999");
 }
 
 // ========================================================================
@@ -182,5 +217,25 @@ TEST(Parser, syntax_error) {
 TEST(Parser, bad_token_message) {
     test_error_message(" côs(4)", { "token", "error" });
     test_error_message("2*/4", { "syntax", "error" });
+    test_error_message("1e999", { "range", "error" });
 }
 
+
+TEST(Parser, legacy_callbacks) {
+    LegacyEH eh;
+
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(linlib::Parser("1 + $", eh).parse());
+    EXPECT_EQ(eh.error, "bad token@4");
+    EXPECT_FALSE(linlib::Parser("1 + * 2", eh).parse());
+    EXPECT_EQ(eh.error, "syntax@4");
+    EXPECT_EQ(testing::internal::GetCapturedStderr(), "");
+
+    // The default still prints the span only
+    NEH             verbose{NEH::NOTHING};
+    const char      buffer[] = "1 + ) + 2; x";
+
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(linlib::Parser(buffer, 9, verbose).parse());
+    EXPECT_EQ(testing::internal::GetCapturedStderr(), "Syntax error:\n1 + ) + 2\n    ^\n");
+}
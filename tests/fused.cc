@@ -0,0 +1,152 @@
+/*
+ *
+ *  Tests for the fused multi-output evaluator
+ *
+ */
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/batch.h"
+#include "lib/fused.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static double square(double x) { return x*x; }
+
+static const linlib::Isa isas[] = {
+    linlib::Isa::SCALAR,
+    linlib::Isa::SSE2,
+    linlib::Isa::AVX2,
+    linlib::Isa::AVX512,
+};
+
+/**
+    Compare the fused evaluation of `expressions` against the batch
+    evaluation of each one on its own. Results must be bit-identical.
+*/
+void test(const std::vector<std::string>& expressions, std::size_t rows)
+{
+    linlib::FusedProgram fused;
+    ASSERT_TRUE(linlib::compile(expressions, fused));
+    ASSERT_EQ(fused.outputs, expressions.size());
+
+    std::mt19937_64 rng(rows);
+    std::uniform_real_distribution<double> dist(-10.0, 10.0);
+
+    std::vector<std::vector<double>>    data(fused.variables.size());
+    std::vector<const double*>          columns;
+    for(auto& column : data)
+    {
+        for(std::size_t i = 0; i < rows; ++i)
+            column.push_back(dist(rng));
+        columns.push_back(column.data());
+    }
+
+    std::vector<linlib::Function> fcts(fused.functions.size(), square);
+
+    // Each expression on its own, against the same tables
+    std::vector<std::vector<double>> expected(expressions.size(), std::vector<double>(rows));
+    for(std::size_t k = 0; k < expressions.size(); ++k)
+    {
+        linlib::Program program;
+        ASSERT_TRUE(linlib::compile(expressions[k].c_str(), program, fused.variables, fused.functions));
+
+        linlib::BatchEvaluator batch;
+        batch.run(program, columns.data(), fcts.data(), expected[k].data(), rows);
+    }
+
+    for(auto isa : isas)
+    {
+        const linlib::Kernels* kernels = linlib::kernels(isa);
+        if (!kernels)
+            continue;
+
+        std::vector<std::vector<double>>    results(expressions.size(), std::vector<double>(rows, -1.0));
+        std::vector<double*>                outputs;
+        for(auto& result : results)
+            outputs.push_back(result.data());
+
+        linlib::FusedEvaluator evaluator(*kernels);
+        evaluator.run(fused, columns.data(), fcts.data(), outputs.data(), rows);
+
+        for(std::size_t k = 0; k < expressions.size(); ++k)
+            for(std::size_t i = 0; i < rows; ++i)
+            {
+                if (std::isnan(expected[k][i]))
+                {
+                    ASSERT_TRUE(std::isnan(results[k][i])) << expressions[k] << " row " << i << " " << kernels->name;
+                }
+                else
+                {
+                    ASSERT_EQ(results[k][i], expected[k][i]) << expressions[k] << " row " << i << " " << kernels->name;
+                }
+            }
+    }
+}
+
+// ========================================================================
+//  Tests
+// ========================================================================
+TEST(Fused, single) {
+    test({ "x + y * z" }, 1000);
+    test({ "-f(x) ** 2 / (y - 1)" }, 1000);
+}
+
+TEST(Fused, shared) {
+    const std::vector<std::string> report = {
+        "a*x + b",
+        "(a*x + b) * (a*x + b)",
+        "f(a*x + b) - y",
+        "1 / (1 + f(-(a*x + b)))",
+        "y / (a*x + b)",
+        "x", "2.5", "-y",
+        "y * (a*x + b) ** 0.5",
+        "x + y", "y + x",
+    };
+
+    for(std::size_t rows : { 0, 1, 255, 256, 257, 1000, 4096 })
+        test(report, rows);
+}
+
+TEST(Fused, duplicates) {
+    test({ "x*y", "x*y", "x*y + 1", "x*y" }, 300);
+}
+
+TEST(Fused, registers) {
+    // Deduplicated nodes and reused registers
+    std::vector<std::string> expressions;
+    for(int i = 0; i < 100; ++i)
+        expressions.push_back("(x + y) * " + std::to_string(i) + " + (x - y) * z");
+
+    linlib::FusedProgram fused;
+    ASSERT_TRUE(linlib::compile(expressions, fused));
+
+    EXPECT_EQ(fused.variables.size(), 3u);
+    EXPECT_EQ(fused.steps.size(), 3 + 2*100u);
+    EXPECT_LE(fused.registers, 4u);
+
+    test(expressions, 600);
+}
+
+TEST(Fused, stores) {
+    linlib::FusedProgram fused;
+    ASSERT_TRUE(linlib::compile({ "x*y + 1", "x", "x*y" }, fused));
+
+    // Each output is stored as soon as it is computed
+    ASSERT_EQ(fused.stores.size(), 3u);
+    EXPECT_EQ(fused.stores[0].output, 1u);
+    EXPECT_EQ(fused.stores[0].step, 0u);
+    EXPECT_EQ(fused.stores[1].output, 2u);
+    EXPECT_EQ(fused.stores[1].step, 1u);
+    EXPECT_EQ(fused.stores[2].output, 0u);
+    EXPECT_EQ(fused.stores[2].step, 2u);
+}
+
+TEST(Fused, errors) {
+    linlib::FusedProgram fused;
+    EXPECT_FALSE(linlib::compile({ "x + 1", "x * (" }, fused));
+}
@@ -0,0 +1,276 @@
+/*
+ *
+ *  Tests for the automatic differentiation
+ *
+ */
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/gradient.h"
+
+using linlib::GradientMachine;
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static double square(double x) { return x*x; }
+static double twice(double x) { return 2*x; }
+
+static double value_of(const std::string& name)
+{
+    return (name == "x") ? 1.5 : (name == "y") ? -2.25 : (name == "z") ? 0.75 : 0.5;
+}
+
+struct Env
+{
+    std::vector<double>                     vars;
+    std::vector<linlib::DerivableFunction>  fcts;
+
+    void bind(const linlib::GradientProgram& program)
+    {
+        vars.clear();
+        for(const auto& name : program.variables)
+            vars.push_back(value_of(name));
+
+        fcts.clear();
+        for(const auto& name : program.functions)
+        {
+            const linlib::DerivableFunction* fct = linlib::standard_function(name);
+            fcts.push_back(fct ? *fct : linlib::DerivableFunction{ square, twice });
+        }
+    }
+};
+
+/**
+    Check the gradient of `testcase` in both modes against the expected
+    one, given in the order of the variable table.
+*/
+void test(const char* testcase, double value, const std::vector<double>& expected)
+{
+    linlib::GradientProgram program;
+    ASSERT_TRUE(linlib::compile(testcase, program)) << testcase;
+    ASSERT_EQ(program.variables.size(), expected.size()) << testcase;
+
+    Env env;
+    env.bind(program);
+
+    GradientMachine machine;
+    for(GradientMachine::Mode mode : { GradientMachine::FORWARD, GradientMachine::REVERSE })
+    {
+        std::vector<double> gradient(expected.size(), -999.0);
+
+        EXPECT_DOUBLE_EQ(machine.run(program, env.vars.data(), env.fcts.data(), gradient.data(), mode), value)
+            << testcase << " mode " << mode;
+        for(std::size_t i = 0; i < expected.size(); ++i)
+            EXPECT_DOUBLE_EQ(gradient[i], expected[i]) << testcase << " d/d" << program.variables[i] << " mode " << mode;
+    }
+}
+
+/**
+    Check the gradient of `testcase` in both modes against central
+    finite differences.
+*/
+void test_finite_differences(const char* testcase)
+{
+    linlib::GradientProgram program;
+    ASSERT_TRUE(linlib::compile(testcase, program)) << testcase;
+
+    Env env;
+    env.bind(program);
+
+    GradientMachine     machine;
+    const std::size_t   n = program.variables.size();
+    std::vector<double> forward(n), reverse(n), ignored(n);
+
+    const double value = machine.run(program, env.vars.data(), env.fcts.data(), forward.data(), GradientMachine::FORWARD);
+    EXPECT_EQ(machine.run(program, env.vars.data(), env.fcts.data(), reverse.data(), GradientMachine::REVERSE), value)
+        << testcase;
+
+    for(std::size_t i = 0; i < n; ++i)
+    {
+        const double    h = 1e-6;
+        const double    x = env.vars[i];
+
+        env.vars[i] = x + h;
+        const double    above = machine.run(program, env.vars.data(), env.fcts.data(), ignored.data());
+        env.vars[i] = x - h;
+        const double    below = machine.run(program, env.vars.data(), env.fcts.data(), ignored.data());
+        env.vars[i] = x;
+
+        const double    approx = (above - below) / (2*h);
+        EXPECT_NEAR(forward[i], approx, 1e-6*(1 + std::fabs(approx))) << testcase << " d/d" << program.variables[i];
+        EXPECT_NEAR(reverse[i], forward[i], 1e-12*(1 + std::fabs(forward[i]))) << testcase << " d/d" << program.variables[i];
+    }
+}
+
+// ========================================================================
+//  Tests
+// ========================================================================
+TEST(Gradient, compile) {
+    linlib::GradientProgram program;
+    ASSERT_TRUE(linlib::compile("x*y + f(x)", program));
+
+    ASSERT_EQ(program.steps.size(), 6u);
+    EXPECT_EQ(program.steps[2].op, linlib::OpCode::MUL);
+    EXPECT_EQ(program.steps[2].lhs, 0u);
+    EXPECT_EQ(program.steps[2].rhs, 1u);
+    EXPECT_EQ(program.steps[4].op, linlib::OpCode::CALL);
+    EXPECT_EQ(program.steps[4].lhs, 3u);
+    EXPECT_EQ(program.steps[5].lhs, 2u);
+    EXPECT_EQ(program.steps[5].rhs, 4u);
+
+    EXPECT_FALSE(linlib::compile("x*", program));
+}
+
+TEST(Gradient, operators) {
+    // x = 1.5, y = -2.25
+    test("42", 42, {});
+    test("x", 1.5, { 1 });
+    test("-x", -1.5, { -1 });
+    test("x + y", -0.75, { 1, 1 });
+    test("x - y", 3.75, { 1, -1 });
+    test("x * y", -3.375, { -2.25, 1.5 });
+    test("x / y", 1.5/-2.25, { 1/-2.25, -1.5/(2.25*2.25) });
+    test("x ** 3", 3.375, { 3*2.25 });
+    test("2 ** x", std::pow(2, 1.5), { std::pow(2, 1.5)*std::log(2) });
+    test("x ** x", std::pow(1.5, 1.5), { std::pow(1.5, 1.5)*(std::log(1.5) + 1) });
+}
+
+TEST(Gradient, repeated_variables) {
+    test("x*x*x", 3.375, { 3*2.25 });
+    test("x - x", 0, { 0 });
+    test("x*y - y*x + x", 1.5, { 1, 0 });
+}
+
+TEST(Gradient, functions) {
+    test("f(x)", 2.25, { 3 });
+    test("f(f(x))", 2.25*2.25, { 4*1.5*1.5*1.5 });
+    test("sin(x) * cos(x)", std::sin(1.5)*std::cos(1.5), { std::cos(3.0) });
+    test("exp(-x)", std::exp(-1.5), { -std::exp(-1.5) });
+    test("log(x)", std::log(1.5), { 1/1.5 });
+    test("sqrt(x)", std::sqrt(1.5), { 0.5/std::sqrt(1.5) });
+    test("abs(y)", 2.25, { -1 });
+}
+
+TEST(Gradient, zero_base) {
+    // d(x**y)/dy is 0 at x=0, not NaN
+    linlib::GradientProgram program;
+    ASSERT_TRUE(linlib::compile("x ** y", program));
+
+    const double                            vars[] = { 0.0, 2.0 };
+    std::vector<linlib::DerivableFunction>  fcts;
+    double                                  gradient[2];
+
+    GradientMachine machine;
+    for(GradientMachine::Mode mode : { GradientMachine::FORWARD, GradientMachine::REVERSE })
+    {
+        EXPECT_EQ(machine.run(program, vars, fcts.data(), gradient, mode), 0.0);
+        EXPECT_EQ(gradient[0], 0.0);
+        EXPECT_EQ(gradient[1], 0.0);
+    }
+}
+
+TEST(Gradient, constant_operands) {
+    // Partials of operands independent of a variable are NaN or inf
+    // here, but must not leak into its derivative in either mode
+    linlib::GradientProgram program;
+    std::vector<linlib::DerivableFunction>  fcts = { *linlib::standard_function("sqrt") };
+    GradientMachine                         machine;
+
+    const struct
+    {
+        const char* expr;
+        double      x;
+        double      value;
+        double      derivative;
+    } cases[] = {
+        { "x**-2", -1.0, 1.0, 2.0 },
+        { "x**(0-2)", -1.0, 1.0, 2.0 },
+        { "x**-(1+2)", -2.0, -0.125, -0.1875 },
+        { "x + sqrt(0)", -1.0, -1.0, 1.0 },
+    };
+
+    for(const auto& c : cases)
+    {
+        ASSERT_TRUE(linlib::compile(c.expr, program)) << c.expr;
+        for(GradientMachine::Mode mode : { GradientMachine::FORWARD, GradientMachine::REVERSE, GradientMachine::AUTO })
+        {
+            double gradient;
+
+            EXPECT_DOUBLE_EQ(machine.run(program, &c.x, fcts.data(), &gradient, mode), c.value) << c.expr;
+            EXPECT_DOUBLE_EQ(gradient, c.derivative) << c.expr << " mode " << mode;
+        }
+    }
+
+    // A variable at a singular point leaves the others alone
+    ASSERT_TRUE(linlib::compile("x + sqrt(y)", program));
+    const double vars[] = { 1.0, 0.0 };
+    for(GradientMachine::Mode mode : { GradientMachine::FORWARD, GradientMachine::REVERSE })
+    {
+        double gradient[2];
+
+        machine.run(program, vars, fcts.data(), gradient, mode);
+        EXPECT_EQ(gradient[0], 1.0) << "mode " << mode;
+        EXPECT_TRUE(std::isinf(gradient[1])) << "mode " << mode;
+    }
+}
+
+TEST(Gradient, finite_differences) {
+    test_finite_differences("1 / (1 + exp(-(a*x + b*y + c)))");
+    test_finite_differences("(x - a)**2 + 100*(y - x**2)**2");
+    test_finite_differences("sqrt(x*x + y*y + z*z) * sin(x/z) - tan(y/4)");
+    test_finite_differences("log(a + x**b) / (c - y*z)");
+    test_finite_differences("x ** y ** z");
+    test_finite_differences("-(x - -y) * -z / f(a - z)");
+}
+
+TEST(Gradient, many_variables) {
+    // A sum of products touching every variable, with both modes
+    std::string expr = "0";
+    for(int i = 0; i < 50; ++i)
+        expr += " + v" + std::to_string(i) + " * v" + std::to_string((i+1)%50);
+
+    linlib::GradientProgram program;
+    ASSERT_TRUE(linlib::compile(expr.c_str(), program));
+    ASSERT_EQ(program.variables.size(), 50u);
+
+    // The value of vk is k
+    std::vector<double> vars(50);
+    for(std::size_t i = 0; i < 50; ++i)
+        vars[i] = std::stoi(program.variables[i].substr(1));
+
+    std::vector<double> forward(50), reverse(50);
+    GradientMachine     machine;
+
+    machine.run(program, vars.data(), nullptr, forward.data(), GradientMachine::FORWARD);
+    machine.run(program, vars.data(), nullptr, reverse.data(), GradientMachine::REVERSE);
+
+    for(std::size_t i = 0; i < 50; ++i)
+    {
+        const int k = std::stoi(program.variables[i].substr(1));
+        const double expected = (k+1)%50 + (k+49)%50;
+
+        EXPECT_EQ(forward[i], expected) << program.variables[i];
+        EXPECT_EQ(reverse[i], expected) << program.variables[i];
+    }
+}
+
+TEST(Gradient, replay) {
+    // Differentiate an already compiled program
+    linlib::Program program;
+    ASSERT_TRUE(linlib::compile("x*x + 3*y", program));
+
+    linlib::GradientProgram     gradient_program;
+    linlib::GradientCompiler    compiler{gradient_program};
+    ASSERT_TRUE(linlib::replay(program, compiler));
+
+    const double    vars[] = { 2.0, 5.0 };
+    double          gradient[2];
+
+    GradientMachine machine;
+    EXPECT_EQ(machine.run(gradient_program, vars, nullptr, gradient), 19.0);
+    EXPECT_EQ(gradient[0], 4.0);
+    EXPECT_EQ(gradient[1], 3.0);
+}
@@ -0,0 +1,294 @@
+/*
+ *
+ *  Tests for the binary image of compiled programs
+ *
+ */
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/image.h"
+
+using linlib::ImageStatus;
+using linlib::ProgramImage;
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static double square(double x) { return x*x; }
+
+static const char* const CATALOG[][2] = {
+    { "norm",       "sqrt(x*x + y*y)" },
+    { "constant",   "6.02214076e23 * 1.602176634e-19" },
+    { "area",       "pi * r ** 2" },
+    { "logistic",   "1 / (1 + exp(-k*(x - x0)))" },
+    { "poly",       "a*x**3 - b*x**2 + c*x - 0.1" },
+};
+
+static const std::size_t CATALOG_SIZE = sizeof(CATALOG)/sizeof(CATALOG[0]);
+
+static std::vector<linlib::Program> compile_catalog(linlib::ImageWriter& writer)
+{
+    std::vector<linlib::Program> programs(CATALOG_SIZE);
+
+    for(std::size_t i = 0; i < CATALOG_SIZE; ++i)
+    {
+        EXPECT_TRUE(linlib::compile(CATALOG[i][1], programs[i]));
+        writer.add(CATALOG[i][0], programs[i], CATALOG[i][1]);
+    }
+
+    return programs;
+}
+
+static double value_of(const std::string& name)
+{
+    return (name == "pi") ? 3.14159265358979323846 : 0.5 + name.size() + name[0]/64.0;
+}
+
+static linlib::Function function_of(const std::string& name)
+{
+    if (name == "sqrt")
+        return static_cast<double(*)(double)>(std::sqrt);
+    if (name == "exp")
+        return static_cast<double(*)(double)>(std::exp);
+
+    return square;
+}
+
+/**
+    Load the image from memory, with the alignment of a mapped file
+*/
+struct Buffer
+{
+    std::vector<std::uint64_t>  words;
+    std::size_t                 size;
+
+    Buffer(const std::string& data) : words((data.size()+7)/8), size(data.size())
+    {
+        if (!data.empty())
+            std::memcpy(words.data(), data.data(), data.size());
+    }
+
+    inline char* data() { return reinterpret_cast<char*>(words.data()); }
+};
+
+/**
+    Check each program of the image runs like the compiled one
+*/
+static void check(const ProgramImage& image, const std::vector<linlib::Program>& programs)
+{
+    ASSERT_EQ(image.size(), programs.size());
+    EXPECT_TRUE(image.verify());
+
+    linlib::Machine machine;
+    for(std::size_t i = 0; i < programs.size(); ++i)
+    {
+        const linlib::Program& program = programs[i];
+
+        EXPECT_STREQ(image.name(i), CATALOG[i][0]);
+        EXPECT_STREQ(image.source(i), CATALOG[i][1]);
+        EXPECT_EQ(image.find(CATALOG[i][0]), i);
+
+        std::vector<double>             vars;
+        std::vector<linlib::Function>   fcts;
+
+        ASSERT_EQ(image.variable_count(i), program.variables.size());
+        for(std::size_t slot = 0; slot < program.variables.size(); ++slot)
+        {
+            EXPECT_EQ(image.variable(i, slot), program.variables[slot]);
+            vars.push_back(value_of(program.variables[slot]));
+        }
+
+        ASSERT_EQ(image.function_count(i), program.functions.size());
+        for(std::size_t slot = 0; slot < program.functions.size(); ++slot)
+        {
+            EXPECT_EQ(image.function(i, slot), program.functions[slot]);
+            fcts.push_back(function_of(program.functions[slot]));
+        }
+
+        EXPECT_EQ(machine.run(image.view(i), vars.data(), fcts.data()),
+                  machine.run(program, vars.data(), fcts.data())) << CATALOG[i][1];
+    }
+}
+
+// ========================================================================
+//  Tests
+// ========================================================================
+TEST(Image, format) {
+    linlib::ImageWriter writer;
+    compile_catalog(writer);
+
+    const std::string data = writer.data();
+    ASSERT_GE(data.size(), 16u);
+    EXPECT_EQ(data.substr(0, 8), "LINLIBPI");
+
+    // Little-endian version and program count
+    EXPECT_EQ(data.substr(8, 8), std::string("\x01\0\0\0\x05\0\0\0", 8));
+    EXPECT_EQ(data.size() % 8, 0u);
+}
+
+TEST(Image, memory) {
+    linlib::ImageWriter writer;
+    const auto programs = compile_catalog(writer);
+
+    Buffer          buffer(writer.data());
+    ProgramImage    image;
+
+    ASSERT_EQ(image.open(buffer.data(), buffer.size), ImageStatus::OK);
+    check(image, programs);
+
+    // Runs in place
+    EXPECT_GE(reinterpret_cast<const char*>(image.view(0).code), buffer.data());
+    EXPECT_LT(reinterpret_cast<const char*>(image.view(0).code), buffer.data() + buffer.size);
+}
+
+TEST(Image, file) {
+    linlib::ImageWriter writer;
+    const auto programs = compile_catalog(writer);
+
+    const std::string path = testing::TempDir() + "linlib-image-test.bin";
+    ASSERT_TRUE(writer.write(path));
+
+    ProgramImage image;
+    ASSERT_EQ(image.open(path), ImageStatus::OK);
+    check(image, programs);
+
+    // Reopening replaces the content
+    linlib::ImageWriter empty;
+    ASSERT_TRUE(empty.write(path));
+    ASSERT_EQ(image.open(path), ImageStatus::OK);
+    EXPECT_EQ(image.size(), 0u);
+    EXPECT_EQ(image.find("norm"), ProgramImage::NOT_FOUND);
+
+    std::remove(path.c_str());
+    EXPECT_EQ(image.open(path), ImageStatus::IO_ERROR);
+}
+
+TEST(Image, load) {
+    linlib::ImageWriter writer;
+    linlib::Program     shared;
+    const linlib::SymbolTable variables{"x", "y", "z"};
+    const linlib::SymbolTable functions{"f"};
+
+    ASSERT_TRUE(linlib::compile("z - f(x)", shared, variables, functions));
+    writer.add("shared", shared);
+
+    Buffer          buffer(writer.data());
+    ProgramImage    image;
+    ASSERT_EQ(image.open(buffer.data(), buffer.size), ImageStatus::OK);
+
+    EXPECT_TRUE(image.shared_symbols(0));
+    EXPECT_STREQ(image.source(0), "");
+
+    linlib::Program copy;
+    image.load(0, copy);
+
+    EXPECT_TRUE(copy.shared_symbols);
+    EXPECT_EQ(copy.max_depth, shared.max_depth);
+    EXPECT_EQ(copy.constants, shared.constants);
+    EXPECT_EQ(copy.variables.names(), variables.names());
+    EXPECT_EQ(copy.functions.names(), functions.names());
+    ASSERT_EQ(copy.code.size(), shared.code.size());
+    for(std::size_t i = 0; i < copy.code.size(); ++i)
+    {
+        EXPECT_EQ(copy.code[i].op, shared.code[i].op);
+        EXPECT_EQ(copy.code[i].arg, shared.code[i].arg);
+    }
+}
+
+TEST(Image, find) {
+    linlib::ImageWriter writer;
+    linlib::Program     program;
+
+    ASSERT_TRUE(linlib::compile("x", program));
+    for(int i = 999; i >= 0; --i)
+        writer.add("f" + std::to_string(i), program);
+
+    Buffer          buffer(writer.data());
+    ProgramImage    image;
+    ASSERT_EQ(image.open(buffer.data(), buffer.size), ImageStatus::OK);
+
+    for(int i = 0; i < 1000; ++i)
+        EXPECT_EQ(image.find("f" + std::to_string(i)), 999u - i);
+    EXPECT_EQ(image.find("f"), ProgramImage::NOT_FOUND);
+    EXPECT_EQ(image.find("g"), ProgramImage::NOT_FOUND);
+}
+
+TEST(Image, errors) {
+    linlib::ImageWriter writer;
+    compile_catalog(writer);
+    const std::string data = writer.data();
+
+    ProgramImage image;
+
+    // Truncated
+    for(std::size_t size : { std::size_t(0), std::size_t(7), std::size_t(64), data.size()-8 })
+    {
+        Buffer buffer(data.substr(0, size));
+        EXPECT_EQ(image.open(buffer.data(), buffer.size), ImageStatus::BAD_FORMAT) << size;
+        EXPECT_EQ(image.size(), 0u);
+    }
+
+    // Not an image
+    {
+        Buffer buffer(data);
+        buffer.data()[0] = 'X';
+        EXPECT_EQ(image.open(buffer.data(), buffer.size), ImageStatus::BAD_FORMAT);
+    }
+
+    // Newer version
+    {
+        Buffer buffer(data);
+        buffer.data()[8] = 2;
+        EXPECT_EQ(image.open(buffer.data(), buffer.size), ImageStatus::BAD_VERSION);
+    }
+
+    // Misaligned
+    {
+        Buffer buffer(std::string(" ") + data);
+        EXPECT_EQ(image.open(buffer.data()+1, data.size()), ImageStatus::BAD_FORMAT);
+    }
+}
+
+TEST(Image, verify) {
+    linlib::ImageWriter writer;
+    linlib::Program     program;
+
+    ASSERT_TRUE(linlib::compile("x + 1", program));
+    writer.add("ok", program);
+
+    program.code[0].arg = 1;            // no such variable
+    writer.add("variable", program);
+
+    ASSERT_TRUE(linlib::compile("x + 1", program));
+    program.code[1].arg = 7;            // no such constant
+    writer.add("constant", program);
+
+    ASSERT_TRUE(linlib::compile("x + 1", program));
+    program.max_depth = 1;              // stack overflow
+    writer.add("depth", program);
+
+    ASSERT_TRUE(linlib::compile("x + 1", program));
+    program.code.pop_back();            // unbalanced
+    writer.add("unbalanced", program);
+
+    ASSERT_TRUE(linlib::compile("-x", program));
+    std::swap(program.code[0], program.code[1]);    // stack underflow
+    writer.add("underflow", program);
+
+    ASSERT_TRUE(linlib::compile("x", program));
+    program.code[0].op = static_cast<linlib::OpCode>(42);
+    writer.add("opcode", program);
+
+    Buffer          buffer(writer.data());
+    ProgramImage    image;
+    ASSERT_EQ(image.open(buffer.data(), buffer.size), ImageStatus::OK);
+
+    EXPECT_TRUE(image.verify(0));
+    for(std::size_t i = 1; i < image.size(); ++i)
+        EXPECT_FALSE(image.verify(i)) << image.name(i);
+    EXPECT_FALSE(image.verify());
+}
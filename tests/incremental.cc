@@ -0,0 +1,324 @@
+/*
+ *
+ *  Tests for the incremental parser
+ *
+ */
+#include <cmath>
+#include <functional>
+#include <random>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "lib/incremental.h"
+
+using linlib::IncrementalParser;
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+struct Recorder : public linlib::EventHandler
+{
+    std::string  _stack;
+
+    bool push(const std::string& v) { _stack += v + ";"; return true; }
+
+    bool number(double v) { return push(std::to_string(v)); }
+    bool call(const char *identifier, std::size_t len) { return push("CALL(" + std::string(identifier, len) + ")"); }
+    bool load(const char *identifier, std::size_t len) { return push("LOAD(" + std::string(identifier, len) + ")"); }
+    bool unary_op(linlib::UnaryOpCode opcode) { return push("NEG"); }
+
+    bool binary_op(linlib::BinaryOpCode opcode)
+    {
+        static const char* names[] = { "ADD", "SUB", "MUL", "DIV", "POW" };
+        return push(names[static_cast<int>(opcode)]);
+    }
+
+    void bad_token_error(const char* stmt, std::size_t len, unsigned pos) {}
+    void syntax_error(const char* stmt, std::size_t len, unsigned pos) {}
+    void range_error(const char* stmt, std::size_t len, unsigned pos) {}
+    void depth_error(const char* stmt, std::size_t len, unsigned pos) {}
+};
+
+std::string events(const IncrementalParser& parser)
+{
+    Recorder recorder;
+    parser.replay(recorder);
+
+    return recorder._stack;
+}
+
+std::string events(const linlib::Program& program)
+{
+    Recorder recorder;
+    linlib::replay(program, recorder);
+
+    return recorder._stack;
+}
+
+/**
+    Check the parser is in the same state as one built from scratch
+    for the same text, and agrees with the Parser.
+*/
+void check(const IncrementalParser& parser)
+{
+    const IncrementalParser expected(parser.text());
+
+    ASSERT_EQ(parser.state(), expected.state()) << parser.text();
+    EXPECT_EQ(parser.where(), expected.where()) << parser.text();
+
+    ASSERT_EQ(parser.tokens().size(), expected.tokens().size()) << parser.text();
+    for(std::size_t i = 0; i < parser.tokens().size(); ++i)
+    {
+        EXPECT_EQ(parser.tokens()[i].id, expected.tokens()[i].id) << parser.text();
+        EXPECT_EQ(parser.tokens()[i].offset, expected.tokens()[i].offset) << parser.text();
+        EXPECT_EQ(parser.tokens()[i].length, expected.tokens()[i].length) << parser.text();
+    }
+
+    ASSERT_EQ(parser.nodes().size(), expected.nodes().size()) << parser.text();
+    for(std::size_t i = 0; i < parser.nodes().size(); ++i)
+    {
+        const linlib::SyntaxNode& a = parser.nodes()[i];
+        const linlib::SyntaxNode& b = expected.nodes()[i];
+
+        EXPECT_EQ(a.kind, b.kind) << parser.text() << " node " << i;
+        EXPECT_EQ(a.op, b.op) << parser.text() << " node " << i;
+        EXPECT_EQ(a.size, b.size) << parser.text() << " node " << i;
+        EXPECT_EQ(a.first, b.first) << parser.text() << " node " << i;
+        EXPECT_EQ(a.last, b.last) << parser.text() << " node " << i;
+        EXPECT_EQ(a.depth, b.depth) << parser.text() << " node " << i;
+        EXPECT_EQ(a.value, b.value) << parser.text() << " node " << i;
+    }
+
+    // Same result as the Parser
+    Recorder        recorder;
+    linlib::Parser  reference{parser.text().data(), parser.text().size(), recorder};
+
+    EXPECT_EQ(reference.parse(), parser.state() == linlib::ParserBase::OK) << parser.text();
+    EXPECT_EQ(reference.state(), parser.state()) << parser.text();
+    EXPECT_EQ(reference.where(), parser.where()) << parser.text();
+    if (parser.state() == linlib::ParserBase::OK)
+    {
+        EXPECT_EQ(events(parser), recorder._stack) << parser.text();
+    }
+}
+
+// ========================================================================
+//  Tests
+// ========================================================================
+TEST(Incremental, parse) {
+    const IncrementalParser parser("x + 2*(y - 1)");
+
+    ASSERT_EQ(parser.state(), linlib::ParserBase::OK);
+    EXPECT_EQ(parser.tokens().size(), 9u);
+    EXPECT_EQ(events(parser), "LOAD(x);2.000000;LOAD(y);1.000000;SUB;MUL;ADD;");
+    check(parser);
+}
+
+TEST(Incremental, edit_in_group) {
+    IncrementalParser           parser("a + f(x*2) - b");
+    IncrementalParser::Change   change;
+
+    ASSERT_TRUE(parser.edit(8, 1, "3.5", change));
+    EXPECT_EQ(parser.text(), "a + f(x*3.5) - b");
+    check(parser);
+
+    // Only the argument of f was reparsed. The '*' is re-lexed as well,
+    // since it might have become a '**'.
+    EXPECT_EQ(change.tokens_begin, 5u);
+    EXPECT_EQ(change.tokens_removed, 2u);
+    EXPECT_EQ(change.tokens_inserted, 2u);
+    EXPECT_EQ(change.events_begin, 1u);
+    EXPECT_EQ(change.events_removed, 3u);
+    EXPECT_EQ(change.events_inserted, 3u);
+    EXPECT_EQ(parser.nodes()[change.node].kind, linlib::SyntaxNode::BINARY);
+    EXPECT_EQ(parser.nodes()[change.node].size, 3u);
+
+    // Replace the whole argument
+    ASSERT_TRUE(parser.edit(6, 5, "(y)", change));
+    EXPECT_EQ(parser.text(), "a + f((y)) - b");
+    check(parser);
+    EXPECT_EQ(change.events_begin, 1u);
+    EXPECT_EQ(change.events_removed, 3u);
+    EXPECT_EQ(change.events_inserted, 1u);
+}
+
+TEST(Incremental, edit_at_top_level) {
+    IncrementalParser           parser("x + (y)");
+    IncrementalParser::Change   change;
+
+    ASSERT_TRUE(parser.edit(2, 1, "*", change));
+    EXPECT_EQ(parser.text(), "x * (y)");
+    check(parser);
+    EXPECT_EQ(change.events_begin, 0u);
+    EXPECT_EQ(change.events_removed, 3u);
+    EXPECT_EQ(change.events_inserted, 3u);
+}
+
+TEST(Incremental, merge_tokens) {
+    IncrementalParser           parser("(x + y)");
+    IncrementalParser::Change   change;
+
+    ASSERT_TRUE(parser.edit(2, 3, "", change));
+    EXPECT_EQ(parser.text(), "(xy)");
+    EXPECT_EQ(parser.tokens().size(), 3u);
+    EXPECT_EQ(events(parser), "LOAD(xy);");
+    check(parser);
+
+    ASSERT_TRUE(parser.edit(2, 0, "*", change));
+    EXPECT_EQ(events(parser), "LOAD(x);LOAD(y);MUL;");
+    ASSERT_TRUE(parser.edit(3, 0, "*", change));
+    EXPECT_EQ(parser.text(), "(x**y)");
+    EXPECT_EQ(events(parser), "LOAD(x);LOAD(y);POW;");
+    check(parser);
+}
+
+TEST(Incremental, errors) {
+    IncrementalParser           parser("f(x+1) * 2");
+    IncrementalParser::Change   change;
+
+    // Typing goes through invalid expressions
+    EXPECT_FALSE(parser.edit(5, 0, "*", change));
+    EXPECT_EQ(parser.state(), linlib::ParserBase::SYNTAX_ERROR);
+    check(parser);
+    EXPECT_TRUE(parser.nodes().empty());
+
+    EXPECT_FALSE(parser.edit(3, 0, "$", change));
+    EXPECT_EQ(parser.state(), linlib::ParserBase::BAD_TOKEN_ERROR);
+    check(parser);
+
+    EXPECT_FALSE(parser.edit(3, 1, "", change));
+    ASSERT_TRUE(parser.edit(6, 0, "y", change));
+    EXPECT_EQ(parser.text(), "f(x+1*y) * 2");
+    check(parser);
+    EXPECT_EQ(change.events_begin, 0u);
+
+    EXPECT_FALSE(parser.edit(0, 0, "1e999+", change));
+    EXPECT_EQ(parser.state(), linlib::ParserBase::RANGE_ERROR);
+    check(parser);
+}
+
+TEST(Incremental, depth) {
+    IncrementalParser           parser("((x))");
+    IncrementalParser::Change   change;
+
+    parser.max_depth(3);
+    ASSERT_TRUE(parser.edit(2, 1, "(y)", change));
+    EXPECT_EQ(parser.text(), "(((y)))");
+
+    EXPECT_FALSE(parser.edit(3, 1, "(z)", change));
+    EXPECT_EQ(parser.state(), linlib::ParserBase::DEPTH_ERROR);
+}
+
+TEST(Incremental, patch) {
+    IncrementalParser           parser("1 + f(2*x) / sqrt(y - 3)");
+    IncrementalParser::Change   change;
+    linlib::Program             program;
+
+    ASSERT_TRUE(linlib::compile(parser.text().c_str(), program));
+
+    ASSERT_TRUE(parser.edit(18, 5, "y**4 - x", change));
+    EXPECT_EQ(parser.text(), "1 + f(2*x) / sqrt(y**4 - x)");
+    ASSERT_TRUE(linlib::patch(program, parser, change));
+
+    linlib::Program expected;
+    ASSERT_TRUE(linlib::compile(parser.text().c_str(), expected));
+
+    EXPECT_EQ(events(program), events(expected));
+    EXPECT_EQ(program.max_depth, expected.max_depth);
+    EXPECT_EQ(program.variables.names(), expected.variables.names());
+
+    const double        vars[] = { 1.5, 2.0 };
+    linlib::Function    fcts[] = { [](double x) { return x*x; }, [](double x) { return std::sqrt(x); } };
+    linlib::Machine     machine;
+    EXPECT_EQ(machine.run(program, vars, fcts), machine.run(expected, vars, fcts));
+}
+
+TEST(Incremental, patch_shared_symbols) {
+    const linlib::SymbolTable   variables{ "x", "y" };
+    const linlib::SymbolTable   functions{ "f" };
+    IncrementalParser           parser("x + f(y)");
+    IncrementalParser::Change   change;
+    linlib::Program             program;
+
+    ASSERT_TRUE(linlib::compile(parser.text().c_str(), program, variables, functions));
+
+    ASSERT_TRUE(parser.edit(6, 1, "x*2", change));
+    ASSERT_TRUE(linlib::patch(program, parser, change));
+    EXPECT_EQ(events(program), "LOAD(x);LOAD(x);2.000000;MUL;CALL(f);ADD;");
+
+    ASSERT_TRUE(parser.edit(6, 1, "z", change));
+    EXPECT_FALSE(linlib::patch(program, parser, change));
+}
+
+TEST(Incremental, fuzz) {
+    std::mt19937 rng(2024);
+
+    std::function<std::string(int)> expr = [&](int depth) -> std::string {
+        static const char* ops[] = { "+", "-", "*", "/", "**" };
+
+        switch(depth > 0 ? rng() % 6 : rng() % 2)
+        {
+            case 0:  return (rng() % 2) ? "x" : "yy";
+            case 1:  return std::to_string(rng() % 100);
+            case 2:  return "(" + expr(depth-1) + ")";
+            case 3:  return "f(" + expr(depth-1) + ")";
+            case 4:  return (rng() % 2 ? "-" : "+") + expr(depth-1);
+            default: return expr(depth-1) + " " + ops[rng() % 5] + " " + expr(depth-1);
+        }
+    };
+
+    static const char* snippets[] = {
+        "", "x", "1", "2.5", "e", "(", ")", "+", "-", "*", "/", " ", "(x)", "f(", "$",
+    };
+
+    for(int i = 0; i < 300; ++i)
+    {
+        IncrementalParser   parser(expr(5));
+        linlib::Program     program;
+        bool                valid = linlib::compile(parser.text().c_str(), program);
+
+        for(int j = 0; j < 30; ++j)
+        {
+            IncrementalParser::Change   change;
+            const std::string           text = parser.text();
+            std::size_t                 offset = rng() % (text.size()+1);
+            std::size_t                 removed = rng() % 3;
+            std::string                 inserted = snippets[rng() % 15];
+
+            if (rng() % 2)
+            {
+                // Rewrite a whole subexpression, usually valid
+                inserted = expr(2);
+                removed = 0;
+                if (offset < text.size() && text[offset] >= '0' && text[offset] <= '9')
+                    removed = 1;
+                else
+                    inserted = "(" + inserted + ")+";
+            }
+
+            const bool ok = parser.edit(offset, removed, inserted, change);
+
+            check(parser);
+            if (HasFatalFailure())
+                return;
+
+            if (ok && valid)
+            {
+                ASSERT_TRUE(linlib::patch(program, parser, change)) << parser.text();
+            }
+            else if (ok)
+            {
+                ASSERT_TRUE(linlib::compile(parser.text().c_str(), program));
+            }
+            valid = ok;
+
+            if (ok)
+            {
+                linlib::Program expected;
+                ASSERT_TRUE(linlib::compile(parser.text().c_str(), expected));
+                ASSERT_EQ(events(program), events(expected)) << text << " -> " << parser.text();
+                ASSERT_EQ(program.max_depth, expected.max_depth) << parser.text();
+            }
+        }
+    }
+}
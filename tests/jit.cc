@@ -0,0 +1,285 @@
+/*
+ *
+ *  Tests for the native code generator
+ *
+ */
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "lib/jit.h"
+#include "lib/optimizer.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static double square(double x) { return x*x; }
+
+static const linlib::Function fcts[] = {
+    static_cast<double(*)(double)>(std::sqrt),
+    square,
+};
+
+/**
+    The reference RPN calculator, straight from calculator.cc with
+    variables x, y and z bound to the `vars` array.
+*/
+struct EH : public linlib::EventHandler
+{
+    static const std::size_t STACK_SIZE = 128;
+    typedef std::array<double, STACK_SIZE>  Stack;
+
+    Stack           _stack;
+    Stack::iterator _sp = _stack.begin();
+    const double*   _vars;
+
+    EH(const double* vars) : _vars(vars) {}
+
+    bool push(double v)
+    {
+        *_sp++ = v;
+        return true;
+    }
+
+    double pop()
+    {
+        return *--_sp;
+    }
+
+    bool call(const char *identifier, std::size_t len)
+    {
+        std::string fname(identifier, len);
+
+        if (fname == "sqrt")
+            return push(fcts[0](pop()));
+        else if (fname == "sq")
+            return push(fcts[1](pop()));
+
+        return false;
+    }
+
+    bool load(const char *identifier, std::size_t len)
+    {
+        if (len != 1 || *identifier < 'x' || *identifier > 'z')
+            return false;
+
+        return push(_vars[*identifier-'x']);
+    }
+
+    bool number(double v)
+    {
+        return push(v);
+    }
+
+    bool unary_op(linlib::UnaryOpCode opcode)
+    {
+        double x = pop();
+
+        switch(opcode)
+        {
+            case linlib::UnaryOpCode::NEG:
+                return push(-x);
+        };
+
+        return false;
+    }
+
+    bool binary_op(linlib::BinaryOpCode opcode)
+    {
+        double b = pop(),
+               a = pop();
+
+        switch(opcode)
+        {
+            case linlib::BinaryOpCode::ADD:
+                return push(a+b);
+            case linlib::BinaryOpCode::SUB:
+                return push(a-b);
+            case linlib::BinaryOpCode::MUL:
+                return push(a*b);
+            case linlib::BinaryOpCode::DIV:
+                return push(a/b);
+            case linlib::BinaryOpCode::POW:
+                return push(std::pow(a,b));
+        };
+
+        return false;
+    }
+};
+
+/**
+    Compile `testcase` binding its variables and functions in the
+    order expected by the reference calculator.
+*/
+struct Compiled
+{
+    linlib::Program                 program;
+    std::vector<linlib::Function>   functions;
+
+    Compiled(const char* testcase)
+    {
+        EXPECT_TRUE(linlib::compile(testcase, program)) << testcase;
+
+        for(const auto& name : program.functions)
+            functions.push_back(name == "sqrt" ? fcts[0] : fcts[1]);
+    }
+
+    void bind(const double xyz[3], std::vector<double>& vars) const
+    {
+        vars.clear();
+        for(const auto& name : program.variables)
+            vars.push_back(xyz[name[0]-'x']);
+    }
+};
+
+static bool identical(double a, double b)
+{
+    return std::memcmp(&a, &b, sizeof(double)) == 0 || (std::isnan(a) && std::isnan(b));
+}
+
+void test(const char* testcase, const double xyz[3])
+{
+    EH eh{xyz};
+    linlib::Parser parser{testcase, eh};
+    ASSERT_TRUE(parser.parse()) << testcase;
+    const double expected = eh.pop();
+
+    Compiled compiled{testcase};
+    linlib::JitFunction jit{compiled.program, compiled.functions.data()};
+
+    std::vector<double> vars;
+    compiled.bind(xyz, vars);
+
+    const double actual = jit(vars.data());
+    EXPECT_TRUE(identical(actual, expected))
+        << testcase << ": " << actual << " != " << expected;
+}
+
+/**
+    Generate a random expression using every construct of the grammar.
+*/
+std::string random_expression(std::mt19937& rng, int depth)
+{
+    const char* atoms[] = { "x", "y", "z", "1", "2.5", "0", "1e-3", "3" };
+    const char* ops[] = { "+", "-", "*", "/", "**" };
+
+    std::uniform_int_distribution<int> choice(0, 7);
+
+    if (depth == 0)
+        return atoms[choice(rng)];
+
+    switch(choice(rng))
+    {
+        case 0:
+            return "-" + random_expression(rng, depth-1);
+        case 1:
+            return "sqrt(" + random_expression(rng, depth-1) + ")";
+        case 2:
+            return "sq(" + random_expression(rng, depth-1) + ")";
+        case 3:
+            return "(" + random_expression(rng, depth-1) + ")";
+        default:
+            return random_expression(rng, depth-1)
+                + ops[choice(rng) % 5]
+                + random_expression(rng, depth-1);
+    }
+}
+
+// ========================================================================
+//  Tests
+// ========================================================================
+TEST(Jit, calculator) {
+    const double xyz[] = { 0, 0, 0 };
+
+    test(" 1 ", xyz);
+    test(" 1 + 2 ", xyz);
+    test(" 1 + 2*3 ", xyz);
+    test(" 1 * 2-3 ", xyz);
+    test(" 1 * 2/4 ", xyz);
+    test(" sqrt(4)", xyz);
+    test(" 1+2**3", xyz);
+    test("1e+1", xyz);
+}
+
+TEST(Jit, variables) {
+    const double xyz[] = { 1.5, -2.25, 1e300 };
+
+    test("x", xyz);
+    test("-x", xyz);
+    test("x*y - z/x", xyz);
+    test("x**y + sq(z)", xyz);
+    test("-(-0)", xyz);
+}
+
+TEST(Jit, live_registers_across_calls) {
+    const double xyz[] = { 2, 3, 5 };
+
+    test("x + (y * (z - sqrt(x + y**z)))", xyz);
+    test("1+(2+(3+(4+(5+(6+(7+(8+(9+(10+(11+(12+(13+(14+x**y)))))))))))))", xyz);
+}
+
+TEST(Jit, fallback) {
+    const char* testcase = "1+(2+(3+(4+(5+(6+(7+(8+(9+(10+(11+(12+(13+(14+(15+(16+x)))))))))))))))";
+    const double xyz[] = { 1, 0, 0 };
+
+    Compiled compiled{testcase};
+    linlib::JitFunction jit{compiled.program, compiled.functions.data()};
+
+    EXPECT_FALSE(jit.native());
+    test(testcase, xyz);
+}
+
+TEST(Jit, native) {
+    linlib::Program program;
+    ASSERT_TRUE(linlib::compile("x*2", program));
+
+    linlib::JitFunction jit{program, nullptr};
+
+    EXPECT_EQ(jit.native(), linlib::JitFunction::available());
+}
+
+TEST(Jit, fuzz) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> dist(-4.0, 4.0);
+
+    for(int i = 0; i < 500; ++i)
+    {
+        const std::string   testcase = random_expression(rng, 1 + i % 6);
+        const double        xyz[] = { dist(rng), dist(rng), dist(rng) };
+
+        test(testcase.c_str(), xyz);
+    }
+}
+
+TEST(Jit, strength_reduced) {
+    // POWI squares in the register above the top of the stack
+    const char* testcases[] = {
+        "x**2 + y**-1",
+        "x**7 - (y*z)**16",
+        "sqrt(x)**31 / 3",
+        "(x*x)**0.5 + y/4",
+        "1+(2+(3+(4+(5+(6+(7+(8+(9+(10+(11+(12+(13+(14+x**5)))))))))))))",
+    };
+    const double xyz[] = { 1.5, -2.25, 0.75 };
+
+    for(const char* testcase : testcases)
+    {
+        Compiled compiled{testcase};
+        linlib::Optimizer{linlib::Optimizer::FAST_MATH}.run(compiled.program);
+
+        linlib::JitFunction jit{compiled.program, compiled.functions.data()};
+        EXPECT_EQ(jit.native(), linlib::JitFunction::available()) << testcase;
+
+        std::vector<double> vars;
+        compiled.bind(xyz, vars);
+
+        linlib::Machine machine;
+        const double expected = machine.run(compiled.program, vars.data(), compiled.functions.data());
+        const double actual = jit(vars.data());
+        EXPECT_TRUE(identical(actual, expected))
+            << testcase << ": " << actual << " != " << expected;
+    }
+}
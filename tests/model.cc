@@ -0,0 +1,240 @@
+/*
+ *
+ *  Tests for the dependency graph of named formulas
+ *
+ */
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/model.h"
+
+using linlib::Model;
+using linlib::ModelStatus;
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static double fabs_(double x) { return std::fabs(x); }
+
+/**
+    Check every formula comes after its dependencies in `order()`, and
+    has a level above theirs.
+*/
+static void check_order(const Model& model)
+{
+    const std::vector<std::uint32_t>    order = model.order();
+    std::vector<bool>                   done(model.size(), false);
+
+    for(std::uint32_t cell = 0; cell < model.size(); ++cell)
+        if (!model.formula(cell))
+        {
+            done[cell] = true;
+            EXPECT_EQ(model.level(cell), 0u) << model.name(cell);
+        }
+
+    for(std::uint32_t cell : order)
+    {
+        for(std::uint32_t dependency : model.dependencies(cell))
+        {
+            EXPECT_TRUE(done[dependency]) << model.name(cell) << " before " << model.name(dependency);
+            EXPECT_GT(model.level(cell), model.level(dependency));
+        }
+        done[cell] = true;
+    }
+}
+
+// ========================================================================
+//  Tests
+// ========================================================================
+TEST(Model, chain) {
+    Model model;
+
+    ASSERT_EQ(model.define("b", "a * 2"), ModelStatus::OK);
+    ASSERT_EQ(model.define("c", "b + a"), ModelStatus::OK);
+    EXPECT_TRUE(std::isnan(model.value("a")));
+
+    model.set("a", 1);
+    EXPECT_EQ(model.recompute(), 2u);
+    EXPECT_EQ(model.value("b"), 2);
+    EXPECT_EQ(model.value("c"), 3);
+
+    model.set("a", 5);
+    EXPECT_EQ(model.recompute(), 2u);
+    EXPECT_EQ(model.value("c"), 15);
+
+    // Nothing changed
+    model.set("a", 5);
+    EXPECT_EQ(model.recompute(), 0u);
+
+    EXPECT_EQ(model.level(model.find("a")), 0u);
+    EXPECT_EQ(model.level(model.find("b")), 1u);
+    EXPECT_EQ(model.level(model.find("c")), 2u);
+    check_order(model);
+}
+
+TEST(Model, dirty_cone) {
+    // Two independent branches: only the one of the changed input runs
+    Model model;
+
+    model.define("x1", "a + 1");
+    model.define("x2", "x1 * x1");
+    model.define("y1", "b + 1");
+    model.define("y2", "y1 * y1");
+    model.define("z", "x2 + y2");
+    model.set("a", 1);
+    model.set("b", 2);
+    EXPECT_EQ(model.recompute(), 5u);
+    EXPECT_EQ(model.value("z"), 13);
+
+    model.set("b", 3);
+    EXPECT_EQ(model.recompute(), 3u);
+    EXPECT_EQ(model.value("z"), 20);
+}
+
+TEST(Model, cutoff) {
+    // A formula whose value does not change stops the propagation
+    Model model;
+    model.function("abs", fabs_);
+
+    model.define("m", "abs(a)");
+    model.define("n", "m * 10");
+    model.define("p", "n + 1");
+    model.set("a", 2);
+    EXPECT_EQ(model.recompute(), 3u);
+
+    model.set("a", -2);
+    EXPECT_EQ(model.recompute(), 1u);
+    EXPECT_EQ(model.value("p"), 21);
+}
+
+TEST(Model, cycles) {
+    Model model;
+
+    EXPECT_EQ(model.define("a", "a + 1"), ModelStatus::CYCLE);
+    EXPECT_FALSE(model.formula(model.find("a")));
+
+    ASSERT_EQ(model.define("b", "a * 2"), ModelStatus::OK);
+    ASSERT_EQ(model.define("c", "b + 1"), ModelStatus::OK);
+    EXPECT_EQ(model.define("a", "c - 1"), ModelStatus::CYCLE);
+    EXPECT_EQ(model.define("b", "c"), ModelStatus::CYCLE);
+
+    // Unchanged
+    model.set("a", 1);
+    model.recompute();
+    EXPECT_EQ(model.value("c"), 3);
+    EXPECT_FALSE(model.formula(model.find("a")));
+    check_order(model);
+}
+
+TEST(Model, errors) {
+    Model model;
+
+    EXPECT_EQ(model.define("a", "1 +"), ModelStatus::SYNTAX_ERROR);
+    EXPECT_EQ(model.define("a", "f(1)"), ModelStatus::UNKNOWN_FUNCTION);
+    EXPECT_EQ(model.find("a"), Model::NOT_FOUND);
+    EXPECT_TRUE(std::isnan(model.value("a")));
+}
+
+TEST(Model, redefine) {
+    Model model;
+
+    model.define("a", "1");
+    model.define("b", "2");
+    model.define("c", "a + 1");
+    model.define("d", "c * 2");
+    model.recompute();
+    EXPECT_EQ(model.value("d"), 4);
+
+    // New dependencies and levels
+    ASSERT_EQ(model.define("a", "b * 10"), ModelStatus::OK);
+    EXPECT_EQ(model.level(model.find("d")), 4u);
+    EXPECT_EQ(model.recompute(), 3u);
+    EXPECT_EQ(model.value("d"), 42);
+    EXPECT_EQ(model.dependents(model.find("b")).size(), 1u);
+    check_order(model);
+
+    // The old dependency is gone
+    ASSERT_EQ(model.define("a", "5"), ModelStatus::OK);
+    EXPECT_TRUE(model.dependents(model.find("b")).empty());
+    model.set("b", 7);
+    model.recompute();
+    EXPECT_EQ(model.value("d"), 12);
+
+    // A formula set as an input
+    model.set("c", 100);
+    EXPECT_EQ(model.recompute(), 1u);
+    EXPECT_FALSE(model.formula(model.find("c")));
+    EXPECT_TRUE(model.dependents(model.find("a")).empty());
+    EXPECT_EQ(model.value("d"), 200);
+    EXPECT_EQ(model.level(model.find("d")), 1u);
+    check_order(model);
+}
+
+TEST(Model, random) {
+    // Incremental updates match a model computed from scratch
+    std::mt19937                        rng(42);
+    std::vector<std::string>            names;
+    std::vector<std::string>            formulas;
+    Model                               model;
+    linlib::ThreadPool                  pool(4);
+
+    for(int i = 0; i < 20; ++i)
+        names.push_back("in" + std::to_string(i));
+
+    for(int i = 0; i < 2000; ++i)
+    {
+        std::uniform_int_distribution<std::size_t> pick(0, names.size()-1);
+        const std::string formula = names[pick(rng)] + " * 0.5 + " + names[pick(rng)] + " - " + names[pick(rng)] + " / 4";
+
+        names.push_back("f" + std::to_string(i));
+        formulas.push_back(formula);
+        ASSERT_EQ(model.define(names.back(), formula), ModelStatus::OK);
+    }
+    check_order(model);
+
+    std::vector<double> inputs(20);
+    for(int i = 0; i < 20; ++i)
+        model.set("in" + std::to_string(i), inputs[i]);
+
+    for(int tick = 0; tick < 20; ++tick)
+    {
+        std::uniform_int_distribution<int> pick(0, 19);
+
+        for(int k = 0; k < 3; ++k)
+        {
+            const int i = pick(rng);
+            inputs[i] = tick*7 + k;
+            model.set("in" + std::to_string(i), inputs[i]);
+        }
+
+        if (tick % 2)
+            model.recompute(pool);
+        else
+            model.recompute();
+
+        Model reference;
+        for(int i = 0; i < 20; ++i)
+            reference.set("in" + std::to_string(i), inputs[i]);
+        for(std::size_t i = 0; i < formulas.size(); ++i)
+            reference.define("f" + std::to_string(i), formulas[i]);
+        reference.recompute();
+
+        for(const std::string& name : names)
+        {
+            const double value = model.value(name);
+            const double expected = reference.value(name);
+
+            if (std::isnan(expected))
+            {
+                ASSERT_TRUE(std::isnan(value)) << name << " tick " << tick;
+            }
+            else
+            {
+                ASSERT_EQ(value, expected) << name << " tick " << tick;
+            }
+        }
+    }
+}
@@ -0,0 +1,186 @@
+/*
+ *
+ *  Tests for the decimal to binary conversion
+ *
+ */
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "lib/number.h"
+
+using linlib::NumberStatus;
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static std::uint64_t bits(double value)
+{
+    std::uint64_t result;
+    std::memcpy(&result, &value, sizeof(result));
+
+    return result;
+}
+
+/**
+    Check parse_number agrees bit for bit with strtod in the "C" locale.
+*/
+void test_same(const std::string& testcase)
+{
+    const double expected = std::strtod(testcase.c_str(), nullptr);
+
+    double actual;
+    const NumberStatus status = linlib::parse_number(testcase.data(), testcase.size(), actual);
+
+    if (std::isinf(expected))
+        EXPECT_EQ(status, NumberStatus::TOO_LARGE) << testcase;
+    else if (expected == 0 && testcase.find_first_of("123456789") < testcase.find_first_of("eE"))
+        EXPECT_EQ(status, NumberStatus::TOO_SMALL) << testcase;
+    else
+    {
+        ASSERT_EQ(status, NumberStatus::OK) << testcase;
+        EXPECT_EQ(bits(actual), bits(expected)) << testcase;
+    }
+}
+
+void test_status(const char* testcase, NumberStatus expected)
+{
+    double value;
+
+    EXPECT_EQ(linlib::parse_number(testcase, std::strlen(testcase), value), expected) << testcase;
+}
+
+// ========================================================================
+//  Tests
+// ========================================================================
+TEST(Number, simple) {
+    for(const char* testcase : {
+        "0", "1", "10", "0.5", ".5", "5.", "00012", "1e10", "1E10", "1e+10",
+        "1e-10", "3.14159265358979323846", "2.718281828459045", "0.1", "0.2",
+        "0.3", "123456789012345678", "9007199254740993", "1e22", "1e23",
+        "0.000001", "6.02214076e23", "1.602176634e-19",
+        })
+        test_same(testcase);
+}
+
+TEST(Number, boundaries) {
+    for(const char* testcase : {
+        "1.7976931348623157e308",       // DBL_MAX
+        "1.7976931348623158e308",       // rounds to DBL_MAX
+        "1.7976931348623159e308",       // rounds to infinity
+        "2.2250738585072014e-308",      // DBL_MIN
+        "2.2250738585072011e-308",      // largest subnormal
+        "4.9406564584124654e-324",      // smallest subnormal
+        "2.4703282292062328e-324",      // rounds up to the smallest subnormal
+        "2.4703282292062327e-324",      // rounds to zero
+        "1e-400", "1e400", "0e400", "0.0e-400",
+        })
+        test_same(testcase);
+}
+
+TEST(Number, halfway) {
+    // 2^53+1 is exactly halfway between two doubles: round to even
+    test_same("9007199254740993");
+    test_same("9007199254740995");
+    test_same("9007199254740993.0000000000000000001");
+    test_same("9007199254740992.9999999999999999999");
+    test_same("1.00000000000000011102230246251565404236316680908203125");
+    test_same("1.00000000000000011102230246251565404236316680908203124");
+    test_same("1.00000000000000011102230246251565404236316680908203126");
+}
+
+TEST(Number, long_literals) {
+    test_same("3.141592653589793238462643383279502884197169399375105820974944");
+    test_same("0.000000000000000000000000000000000000000000000000000000000001");
+    test_same(std::string(400, '9'));
+    test_same("0." + std::string(400, '0') + "1");
+    test_same(std::string(300, '1') + "e-300");
+    test_same("1" + std::string(30, '0') + "e-30");
+}
+
+TEST(Number, syntax_error) {
+    for(const char* testcase : { "", ".", "e1", "1e", "1e+", "1.2.3", "1x", "+1", "-1", "1 " })
+        test_status(testcase, NumberStatus::SYNTAX_ERROR);
+}
+
+TEST(Number, range_error) {
+    test_status("1e309", NumberStatus::TOO_LARGE);
+    test_status("1e99999999999999999999", NumberStatus::TOO_LARGE);
+    test_status("1e-325", NumberStatus::TOO_SMALL);
+    test_status("1e-99999999999999999999", NumberStatus::TOO_SMALL);
+    test_status("0e99999999999999999999", NumberStatus::OK);
+}
+
+TEST(Number, exact_span) {
+    // Never read past the end of the span
+    const char* input = "1.25e3";
+    double value;
+
+    ASSERT_EQ(linlib::parse_number(input, 4, value), NumberStatus::OK);
+    EXPECT_EQ(value, 1.25);
+    ASSERT_EQ(linlib::parse_number(input, 3, value), NumberStatus::OK);
+    EXPECT_EQ(value, 1.2);
+}
+
+TEST(Number, locale) {
+    if (!std::setlocale(LC_NUMERIC, "de_DE.UTF-8") && !std::setlocale(LC_NUMERIC, "fr_FR.UTF-8"))
+        GTEST_SKIP() << "no locale with a ',' decimal separator";
+
+    double value;
+
+    EXPECT_EQ(linlib::parse_number("0.5", 3, value), NumberStatus::OK);
+    EXPECT_EQ(value, 0.5);
+
+    // Slow path
+    const std::string testcase = "0.5" + std::string(30, '0') + "1";
+    EXPECT_EQ(linlib::parse_number(testcase.data(), testcase.size(), value), NumberStatus::OK);
+    EXPECT_EQ(value, 0.5);
+
+    std::setlocale(LC_NUMERIC, "C");
+}
+
+TEST(Number, random_doubles) {
+    std::mt19937_64 rng(42);
+    char            buffer[64];
+
+    for(int i = 0; i < 100000; ++i)
+    {
+        double value;
+
+        do {
+            const std::uint64_t r = rng() & ~(std::uint64_t(1) << 63);
+            std::memcpy(&value, &r, sizeof(value));
+        } while(!std::isfinite(value));
+
+        std::snprintf(buffer, sizeof(buffer), "%.*e", static_cast<int>(rng() % 20), value);
+        test_same(buffer);
+    }
+}
+
+TEST(Number, random_digits) {
+    std::mt19937_64 rng(42);
+
+    for(int i = 0; i < 100000; ++i)
+    {
+        std::string testcase;
+        const int   len = 1 + rng() % 40;
+        const int   point = rng() % (len+1);
+
+        for(int j = 0; j < len; ++j)
+        {
+            if (j == point)
+                testcase += '.';
+            testcase += static_cast<char>('0' + rng() % 10);
+        }
+
+        if (rng() % 2)
+            testcase += "e" + std::to_string(static_cast<int>(rng() % 700) - 350);
+
+        test_same(testcase);
+    }
+}
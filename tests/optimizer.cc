@@ -0,0 +1,380 @@
+/*
+ *
+ *  Tests for the constant folding and simplification pass
+ *
+ */
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+
+#include "gtest/gtest.h"
+#include "lib/optimizer.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static constexpr double PI  = 3.14159265358979323846;
+
+/**
+    Dump the event stream, like in tests.cc
+*/
+struct EH : public linlib::EventHandler
+{
+    std::string  _stack;
+
+    bool push(const std::string& v) { _stack += v + ";"; return true; }
+
+    bool call(const char *identifier, std::size_t len)
+    {
+        return push("CALL(" + std::string(identifier, len) + ")");
+    }
+
+    bool load(const char *identifier, std::size_t len)
+    {
+        return push("LOAD(" + std::string(identifier, len) + ")");
+    }
+
+    bool number(double v)
+    {
+        return push(std::to_string(v));
+    }
+
+    bool unary_op(linlib::UnaryOpCode opcode)
+    {
+        return push("NEG");
+    }
+
+    bool binary_op(linlib::BinaryOpCode opcode)
+    {
+        static const char* names[] = { "ADD", "SUB", "MUL", "DIV", "POW" };
+
+        return push(names[static_cast<int>(opcode)]);
+    }
+};
+
+linlib::Optimizer optimizer(linlib::Optimizer::Mode mode)
+{
+    linlib::Optimizer optimizer{mode};
+
+    optimizer.constant("pi", PI);
+    optimizer.function("sqrt", std::sqrt);
+
+    return optimizer;
+}
+
+linlib::Optimizer::Report test(const char* testcase, const char* expected,
+                               linlib::Optimizer::Mode mode = linlib::Optimizer::STRICT)
+{
+    linlib::Program program;
+    EXPECT_TRUE(linlib::compile(testcase, program)) << testcase;
+
+    auto report = optimizer(mode).run(program);
+
+    EH eh;
+    EXPECT_TRUE(linlib::replay(program, eh));
+    EXPECT_EQ(eh._stack, expected) << testcase;
+
+    return report;
+}
+
+static double square(double x) { return x*x; }
+
+/**
+    Check the strict optimizer preserves the result for special values.
+*/
+void test_ieee(const char* testcase)
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+
+    linlib::Program program;
+    ASSERT_TRUE(linlib::compile(testcase, program)) << testcase;
+
+    linlib::Program optimized = program;
+    optimizer(linlib::Optimizer::STRICT).run(optimized);
+
+    linlib::Machine machine;
+    for(double x : { 0.0, -0.0, 1.0, -1.0, inf, -inf, nan })
+    {
+        std::vector<double> a(program.variables.size(), x);
+        std::vector<double> b(optimized.variables.size(), x);
+        std::vector<linlib::Function> fa(program.functions.size(), square);
+        std::vector<linlib::Function> fb(optimized.functions.size(), square);
+
+        const double expected = machine.run(program, a.data(), fa.data());
+        const double actual = machine.run(optimized, b.data(), fb.data());
+
+        if (std::isnan(expected))
+            EXPECT_TRUE(std::isnan(actual)) << testcase << " for x=" << x;
+        else
+            EXPECT_EQ(std::memcmp(&expected, &actual, sizeof(double)), 0)
+                << testcase << " for x=" << x << ": " << actual << " != " << expected;
+    }
+}
+
+/**
+    Dump the optimized code itself: replay() hides the opcodes emitted
+    by strength reduction.
+*/
+std::string disassemble(const char* testcase, linlib::Optimizer::Mode mode)
+{
+    static const char* names[] = { "CONST", "LOAD", "CALL", "NEG", "ADD", "SUB", "MUL", "DIV", "POW", "POWI", "SQRT" };
+
+    linlib::Program program;
+    EXPECT_TRUE(linlib::compile(testcase, program)) << testcase;
+    optimizer(mode).run(program);
+
+    std::string result;
+    for(const linlib::Instruction& insn : program.code)
+    {
+        result += names[static_cast<int>(insn.op)];
+        if (insn.op == linlib::OpCode::CONST)
+            result += "(" + std::to_string(program.constants[insn.arg]) + ")";
+        else if (insn.op == linlib::OpCode::POWI)
+            result += "(" + std::to_string(insn.arg) + ")";
+        result += ";";
+    }
+
+    return result;
+}
+
+/**
+    Distance between two finite doubles, in units in the last place.
+*/
+std::uint64_t ulps(double a, double b)
+{
+    std::int64_t ia, ib;
+    std::memcpy(&ia, &a, sizeof(double));
+    std::memcpy(&ib, &b, sizeof(double));
+
+    // Order the negative values below the positive ones
+    if (ia < 0)
+        ia = std::numeric_limits<std::int64_t>::min() - ia;
+    if (ib < 0)
+        ib = std::numeric_limits<std::int64_t>::min() - ib;
+
+    return ia > ib ? std::uint64_t(ia) - std::uint64_t(ib) : std::uint64_t(ib) - std::uint64_t(ia);
+}
+
+/**
+    Check the optimized `testcase` is within `bound` ULPs of the
+    original for random values of x.
+*/
+void test_ulps(const char* testcase, linlib::Optimizer::Mode mode, std::uint64_t bound,
+               double lo = -10.0, double hi = 10.0)
+{
+    linlib::Program program;
+    ASSERT_TRUE(linlib::compile(testcase, program)) << testcase;
+
+    linlib::Program optimized = program;
+    optimizer(mode).run(optimized);
+
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> dist(lo, hi);
+
+    linlib::Machine machine;
+    std::uint64_t   worst = 0;
+    for(int i = 0; i < 10000; ++i)
+    {
+        const double x = dist(rng);
+
+        const double expected = machine.run(program, &x, nullptr);
+        const double actual = machine.run(optimized, &x, nullptr);
+
+        if (std::isfinite(expected) && expected != 0)
+            worst = std::max(worst, ulps(expected, actual));
+    }
+
+    EXPECT_LE(worst, bound) << testcase;
+}
+
+// ========================================================================
+//  Constant folding
+// ========================================================================
+TEST(Optimizer, fold) {
+    auto report = test("2*pi*r", "6.283185;LOAD(r);MUL;");
+
+    EXPECT_EQ(report.folded, 2u);
+    EXPECT_EQ(report.removed, 2u);
+
+    test("1+2*3", "7.000000;");
+    test("-(1+2)", "-3.000000;");
+    test("sqrt(4)*x", "2.000000;LOAD(x);MUL;");
+    test("f(4)*x", "4.000000;CALL(f);LOAD(x);MUL;");
+    test("x*2*3", "LOAD(x);2.000000;MUL;3.000000;MUL;");
+}
+
+TEST(Optimizer, tables) {
+    linlib::Program program;
+    ASSERT_TRUE(linlib::compile("pi*x + sqrt(2) + y", program));
+
+    optimizer(linlib::Optimizer::STRICT).run(program);
+
+    EXPECT_EQ(program.variables.names(), (std::vector<std::string>{ "x", "y" }));
+    EXPECT_TRUE(program.functions.empty());
+    EXPECT_EQ(program.constants.size(), 2u);
+    EXPECT_EQ(program.max_depth, 2u);
+}
+
+// ========================================================================
+//  Simplifications
+// ========================================================================
+TEST(Optimizer, strict) {
+    test("x*1", "LOAD(x);");
+    test("1*x", "LOAD(x);");
+    test("x/1", "LOAD(x);");
+    test("x**1", "LOAD(x);");
+    test("x**0", "1.000000;");
+    test("x-0", "LOAD(x);");
+    test("x+-0", "LOAD(x);");
+    test("-0+x", "LOAD(x);");
+    test("--x", "LOAD(x);");
+    test("-(-x)", "LOAD(x);");
+    test("x*-1", "LOAD(x);NEG;");
+    test("-x/-1", "LOAD(x);");
+
+    // Not valid for x == -0
+    test("x+0", "LOAD(x);0.000000;ADD;");
+    test("0+x", "0.000000;LOAD(x);ADD;");
+    // Not valid for x == inf or NaN
+    test("x*0", "LOAD(x);0.000000;MUL;");
+
+    auto report = test("x*1 + 0", "LOAD(x);0.000000;ADD;");
+    EXPECT_EQ(report.simplified, 1u);
+    EXPECT_EQ(report.removed, 2u);
+}
+
+TEST(Optimizer, relaxed) {
+    const auto RELAXED = linlib::Optimizer::RELAXED;
+
+    test("x+0", "LOAD(x);", RELAXED);
+    test("0+x", "LOAD(x);", RELAXED);
+    test("x*0", "0.000000;", RELAXED);
+    test("0-x", "LOAD(x);NEG;", RELAXED);
+
+    auto report = test("x*1 + 0", "LOAD(x);", RELAXED);
+    EXPECT_EQ(report.simplified, 2u);
+    EXPECT_EQ(report.removed, 4u);
+}
+
+TEST(Optimizer, ieee) {
+    test_ieee("x*1");
+    test_ieee("1*x");
+    test_ieee("x/1");
+    test_ieee("x**1");
+    test_ieee("x**0");
+    test_ieee("x-0");
+    test_ieee("x+-0");
+    test_ieee("-0+x");
+    test_ieee("-(-x)");
+    test_ieee("x*-1");
+    test_ieee("x/-1");
+    test_ieee("x+0");
+    test_ieee("x*0");
+    test_ieee("sq(x*1) - -(-x)*1 + 0");
+}
+
+// ========================================================================
+//  Strength reduction
+// ========================================================================
+TEST(Optimizer, reduce_strict) {
+    const auto STRICT = linlib::Optimizer::STRICT;
+
+    EXPECT_EQ(disassemble("x**2", STRICT), "LOAD;POWI(2);");
+    EXPECT_EQ(disassemble("x**-1", STRICT), "CONST(1.000000);LOAD;DIV;");
+    EXPECT_EQ(disassemble("x/4", STRICT), "LOAD;CONST(0.250000);MUL;");
+    EXPECT_EQ(disassemble("x/-0.5", STRICT), "LOAD;CONST(-2.000000);MUL;");
+
+    // Not correctly rounded
+    EXPECT_EQ(disassemble("x**3", STRICT), "LOAD;CONST(3.000000);POW;");
+    EXPECT_EQ(disassemble("x**-2", STRICT), "LOAD;CONST(-2.000000);POW;");
+    EXPECT_EQ(disassemble("x/3", STRICT), "LOAD;CONST(3.000000);DIV;");
+    // Not valid for x == -0 or -inf
+    EXPECT_EQ(disassemble("x**0.5", STRICT), "LOAD;CONST(0.500000);POW;");
+    // The reciprocal is not representable
+    EXPECT_EQ(disassemble("x/1e-310", STRICT), "LOAD;CONST(0.000000);DIV;");
+
+    linlib::Program program;
+    ASSERT_TRUE(linlib::compile("(x+1)**2 / 8", program));
+    auto report = optimizer(STRICT).run(program);
+    EXPECT_EQ(report.reduced, 2u);
+
+    // The square is computed in the slot above the top of the stack
+    ASSERT_TRUE(linlib::compile("x*y**2", program));
+    optimizer(STRICT).run(program);
+    EXPECT_EQ(program.max_depth, 3u);
+}
+
+TEST(Optimizer, reduce_relaxed) {
+    const auto RELAXED = linlib::Optimizer::RELAXED;
+
+    EXPECT_EQ(disassemble("x**3", RELAXED), "LOAD;POWI(3);");
+    EXPECT_EQ(disassemble("x**32", RELAXED), "LOAD;POWI(32);");
+    EXPECT_EQ(disassemble("x**-4", RELAXED), "CONST(1.000000);LOAD;POWI(4);DIV;");
+    EXPECT_EQ(disassemble("(x+y)**0.5", RELAXED), "LOAD;LOAD;ADD;SQRT;");
+    EXPECT_EQ(disassemble("x**33", RELAXED), "LOAD;CONST(33.000000);POW;");
+    EXPECT_EQ(disassemble("x**2.5", RELAXED), "LOAD;CONST(2.500000);POW;");
+    EXPECT_EQ(disassemble("x/3", RELAXED), "LOAD;CONST(3.000000);DIV;");
+
+    // The result is unchanged by replay
+    test("x**3 + (y-1)**0.5", "LOAD(x);3.000000;POW;LOAD(y);1.000000;SUB;0.500000;POW;ADD;", RELAXED);
+    // Constant operands are still folded
+    test("2**3 + 4**0.5", "10.000000;", RELAXED);
+
+    // The reciprocal grows the code: nothing was removed
+    linlib::Program program;
+    ASSERT_TRUE(linlib::compile("x**k", program));
+    auto relaxed = optimizer(RELAXED);
+    relaxed.constant("k", -3);
+    auto report = relaxed.run(program);
+    EXPECT_EQ(report.folded, 1u);
+    EXPECT_EQ(report.reduced, 1u);
+    EXPECT_EQ(report.removed, 0u);
+    EXPECT_EQ(program.code.size(), 4u);
+}
+
+TEST(Optimizer, reduce_fast_math) {
+    const auto FAST_MATH = linlib::Optimizer::FAST_MATH;
+
+    EXPECT_EQ(disassemble("x/4", FAST_MATH), "LOAD;CONST(0.250000);MUL;");
+    EXPECT_EQ(disassemble("x/3", FAST_MATH), "LOAD;CONST(0.333333);MUL;");
+    EXPECT_EQ(disassemble("x/0", FAST_MATH), "LOAD;CONST(0.000000);DIV;");
+    EXPECT_EQ(disassemble("x/1e-310", FAST_MATH), "LOAD;CONST(0.000000);DIV;");
+    EXPECT_EQ(disassemble("x**4", FAST_MATH), "LOAD;POWI(4);");
+    EXPECT_EQ(disassemble("x+0", FAST_MATH), "LOAD;");
+}
+
+TEST(Optimizer, reduce_accuracy) {
+    const auto STRICT = linlib::Optimizer::STRICT;
+    const auto RELAXED = linlib::Optimizer::RELAXED;
+    const auto FAST_MATH = linlib::Optimizer::FAST_MATH;
+
+    // The bounds documented in optimizer.h
+    test_ulps("x**2", STRICT, 1);
+    test_ulps("x**-1", STRICT, 1);
+    test_ulps("x/8", STRICT, 0);
+
+    for(int n = 2; n <= int(linlib::Optimizer::POWI_MAX); ++n)
+    {
+        const std::string positive = "x**" + std::to_string(n);
+        const std::string negative = "x**-" + std::to_string(n);
+
+        test_ulps(positive.c_str(), RELAXED, n, 0.5, 2.0);
+        test_ulps(negative.c_str(), RELAXED, n+1, 0.5, 2.0);
+        test_ulps(positive.c_str(), RELAXED, n, -1.5, 1.5);
+    }
+    test_ulps("x**0.5", RELAXED, 1, 0.0, 1e6);
+
+    for(const char* testcase : { "x/3", "x/10", "x/0.1", "x/7e-300", "x/-1.7e300" })
+        test_ulps(testcase, FAST_MATH, 2, -1e6, 1e6);
+}
+
+TEST(Optimizer, reduce_ieee) {
+    test_ieee("x**2");
+    test_ieee("x**-1");
+    test_ieee("x/4");
+    test_ieee("x/0.5");
+    test_ieee("sq(x/2)**2 / 1024");
+}
@@ -0,0 +1,150 @@
+/*
+ *
+ *  Tests for the bytecode compiler and interpreter
+ *
+ */
+#include <cmath>
+
+#include "gtest/gtest.h"
+#include "lib/program.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static constexpr double PI  = 3.14159265358979323846;
+static constexpr double E   = 2.71828182845904523536;
+
+static double square(double x) { return x*x; }
+
+struct Env
+{
+    std::vector<double>             vars;
+    std::vector<linlib::Function>   fcts;
+
+    void bind(const linlib::Program& program, double x)
+    {
+        vars.clear();
+        for(const auto& name : program.variables)
+        {
+            if (name == "pi")
+                vars.push_back(PI);
+            else if (name == "e")
+                vars.push_back(E);
+            else
+                vars.push_back(x);
+        }
+
+        fcts.clear();
+        for(const auto& name : program.functions)
+        {
+            if (name == "sqrt")
+                fcts.push_back(static_cast<double(*)(double)>(std::sqrt));
+            else
+                fcts.push_back(square);
+        }
+    }
+};
+
+void test(const char* testcase, double x, double expected)
+{
+    linlib::Program program;
+    ASSERT_TRUE(linlib::compile(testcase, program)) << testcase;
+
+    Env env;
+    env.bind(program, x);
+
+    linlib::Machine machine;
+    EXPECT_EQ(machine.run(program, env.vars.data(), env.fcts.data()), expected) << testcase;
+}
+
+// ========================================================================
+//  Tests
+// ========================================================================
+TEST(Program, should_pass) {
+    test(" 1 ", 0, 1.0);
+    test(" 1 + 2 ", 0, 3.0);
+    test(" 1 + 2*3 ", 0, 7.0);
+    test(" 1 * 2-3 ", 0, -1.0);
+    test(" 1 * 2/4 ", 0, 0.5);
+    test(" sqrt(4)", 0, 2);
+    test(" 1+2**3", 0, 9);
+    test(" e+1", 0, 3.718281828459045235360287471352);
+    test("1e+1", 0, 10);
+    test("-x", 3, -3);
+    test("2*pi*x", 2, 2*PI*2);
+    test("x*x - sq(x) + x", 5, 5);
+}
+
+TEST(Program, should_fail) {
+    linlib::Program program;
+
+    EXPECT_FALSE(linlib::compile("2*/4", program));
+}
+
+TEST(Program, interning) {
+    linlib::Program program;
+    ASSERT_TRUE(linlib::compile("x*y + sqrt(x) - sqrt(y) + z", program));
+
+    EXPECT_EQ(program.variables.names(), (std::vector<std::string>{ "x", "y", "z" }));
+    EXPECT_EQ(program.functions.names(), (std::vector<std::string>{ "sqrt" }));
+}
+
+TEST(Program, max_depth) {
+    linlib::Program program;
+
+    ASSERT_TRUE(linlib::compile("1+2+3+4", program));
+    EXPECT_EQ(program.max_depth, 2u);
+
+    ASSERT_TRUE(linlib::compile("1+(2+(3+4))", program));
+    EXPECT_EQ(program.max_depth, 4u);
+}
+
+TEST(Program, reuse_machine) {
+    linlib::Program program;
+    ASSERT_TRUE(linlib::compile("x**2 + 1", program));
+
+    linlib::Machine machine;
+    for(int i = 0; i < 10; ++i)
+    {
+        double x = i;
+        EXPECT_EQ(machine.run(program, &x, nullptr), i*i+1);
+    }
+}
+
+TEST(Program, shared_symbols) {
+    const linlib::SymbolTable variables{ "x", "y", "z" };
+    const linlib::SymbolTable functions{ "sqrt" };
+
+    linlib::Program a, b;
+    ASSERT_TRUE(linlib::compile("z - x", a, variables, functions));
+    ASSERT_TRUE(linlib::compile("sqrt(y)", b, variables, functions));
+
+    EXPECT_TRUE(a.shared_symbols);
+    EXPECT_EQ(a.code[0].arg, variables.find("z"));
+    EXPECT_EQ(a.code[1].arg, variables.find("x"));
+
+    const double            vars[] = { 1, 16, 5 };
+    const linlib::Function  fcts[] = { std::sqrt };
+
+    linlib::Machine machine;
+    EXPECT_EQ(machine.run(a, vars, fcts), 4);
+    EXPECT_EQ(machine.run(b, vars, fcts), 4);
+}
+
+TEST(Program, unknown_symbols) {
+    const linlib::SymbolTable variables{ "x" };
+    const linlib::SymbolTable functions{ "sqrt" };
+
+    linlib::Program program;
+    EXPECT_FALSE(linlib::compile("x + y", program, variables, functions));
+    EXPECT_FALSE(linlib::compile("cos(x)", program, variables, functions));
+    EXPECT_TRUE(linlib::compile("sqrt(x)", program, variables, functions));
+}
+
+TEST(Program, library_function) {
+    EXPECT_EQ(linlib::library_function("sqrt")(16), 4);
+    EXPECT_EQ(linlib::library_function("abs")(-2.5), 2.5);
+    EXPECT_EQ(linlib::library_function("exp")(0), 1);
+    EXPECT_EQ(linlib::library_function("sqr"), nullptr);
+    EXPECT_EQ(linlib::library_function(""), nullptr);
+}
@@ -0,0 +1,175 @@
+/*
+ *
+ *  Tests for the compile-time parser
+ *
+ */
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "gtest/gtest.h"
+#include "lib/number.h"
+#include "lib/program.h"
+#include "lib/static_parser.h"
+
+using linlib::StaticStatus;
+using linlib::static_compile;
+
+// ========================================================================
+//  Compile-time checks
+// ========================================================================
+static_assert(linlib::static_capacity("x + 2*y") == 6, "one node per token");
+
+static_assert(static_compile<8>("x + 2*y").status == StaticStatus::OK, "");
+static_assert(static_compile<8>("x + 2*y").variable_count == 2, "");
+static_assert(static_compile<8>("x + x*x").variable_count == 1, "");
+static_assert(static_compile<8>("0.1").constants[0] == 0.1, "");
+static_assert(static_compile<8>("1.7976931348623157e308").constants[0] == 1.7976931348623157e308, "");
+static_assert(static_compile<8>("4.9406564584124654e-324").constants[0] == 4.9406564584124654e-324, "");
+
+static_assert(static_compile<8>("1+").status == StaticStatus::SYNTAX_ERROR, "");
+static_assert(static_compile<8>("1+").position == 2, "");
+static_assert(static_compile<8>("(1").status == StaticStatus::SYNTAX_ERROR, "");
+static_assert(static_compile<8>("1 $ 2").status == StaticStatus::BAD_TOKEN_ERROR, "");
+static_assert(static_compile<8>("1 $ 2").position == 2, "");
+static_assert(static_compile<8>("1e999").status == StaticStatus::RANGE_ERROR, "");
+static_assert(static_compile<8>("1e-999").status == StaticStatus::RANGE_ERROR, "");
+static_assert(static_compile<8>("x + f(y)").status == StaticStatus::UNKNOWN_FUNCTION, "");
+static_assert(static_compile<8>("x + f(y)").position == 4, "");
+static_assert(static_compile<2>("x + y").status == StaticStatus::CAPACITY_ERROR, "");
+
+// Too close to a halfway point to be rounded without strtod
+static_assert(static_compile<2>("1.00000000000000011102230246251565404236316680908203124").status
+              == StaticStatus::UNDECIDED_LITERAL, "");
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+static double value_of(const std::string& name)
+{
+    return (name == "x") ? 1.5 : (name == "y") ? -2.25 : 0.75;
+}
+
+static linlib::Function function_of(const std::string& name)
+{
+    const char* const   names[] = { "sqrt", "exp", "log", "sin", "cos", "tan", "abs" };
+    double              (* const fcts[])(double) = {
+        std::sqrt, std::exp, std::log, std::sin, std::cos, std::tan, std::fabs
+    };
+
+    for(std::size_t i = 0; i < sizeof(names)/sizeof(names[0]); ++i)
+        if (name == names[i])
+            return fcts[i];
+
+    return nullptr;
+}
+
+/**
+    Check the compile-time expression gives the same result as the
+    program compiled at runtime.
+*/
+template<class Expression>
+void test_same(Expression expression, const char* testcase)
+{
+    linlib::Program program;
+    ASSERT_TRUE(linlib::compile(testcase, program)) << testcase;
+    ASSERT_EQ(Expression::arity, program.variables.size()) << testcase;
+
+    std::vector<double>             vars;
+    std::vector<linlib::Function>   fcts;
+
+    for(std::size_t i = 0; i < program.variables.size(); ++i)
+    {
+        const linlib::StaticSymbol& symbol = Expression::program.variables[i];
+
+        EXPECT_EQ(std::string(symbol.start, symbol.length), program.variables[i]) << testcase;
+        vars.push_back(value_of(program.variables[i]));
+    }
+
+    for(const auto& name : program.functions)
+        fcts.push_back(function_of(name));
+
+    vars.push_back(0.0);
+
+    linlib::Machine machine;
+    EXPECT_EQ(Expression::run(vars.data()), machine.run(program, vars.data(), fcts.data())) << testcase;
+}
+
+#define TEST_SAME(expr) test_same(LINLIB_STATIC_EXPRESSION(expr), expr)
+
+// ========================================================================
+//  Tests
+// ========================================================================
+TEST(StaticParser, call) {
+    static const auto f = LINLIB_STATIC_EXPRESSION("x*x + 2*y - 1");
+
+    EXPECT_EQ(f.arity, 2u);
+    EXPECT_EQ(f(3, 4), 16.0);
+    EXPECT_EQ(f(0.5, -1.0), -2.75);
+}
+
+TEST(StaticParser, no_variable) {
+    static const auto f = LINLIB_STATIC_EXPRESSION("(1 + 2) * 3 ** 2");
+
+    EXPECT_EQ(f.arity, 0u);
+    EXPECT_EQ(f(), 27.0);
+}
+
+struct Norm
+{
+    static constexpr const char* text() { return "sqrt(x*x + y*y)"; }
+};
+
+TEST(StaticParser, named_source) {
+    linlib::StaticExpression<Norm> norm;
+
+    EXPECT_EQ(norm(3, 4), 5.0);
+    EXPECT_EQ(norm(-5, 12), 13.0);
+}
+
+TEST(StaticParser, same_as_runtime) {
+    TEST_SAME("x");
+    TEST_SAME("-x");
+    TEST_SAME("+x");
+    TEST_SAME("--x");
+    TEST_SAME("x + y * z");
+    TEST_SAME("(x + y) * z");
+    TEST_SAME("x - y - z");
+    TEST_SAME("x / y / z");
+    TEST_SAME("x ** y ** 2");
+    TEST_SAME("-x ** 2");
+    TEST_SAME("2 ** -x");
+    TEST_SAME("x * -y");
+    TEST_SAME("1 / (1 + exp(-x))");
+    TEST_SAME("sqrt(abs(y)) + sin(x) * cos(z) - tan(x*y)");
+    TEST_SAME("log(x) + log(z) - log(exp(y))");
+    TEST_SAME("0.1 + 0.2 - 0.3");
+    TEST_SAME("3.141592653589793238462643383279502884197169399375105820974944 * x");
+    TEST_SAME("6.02214076e23 * 1.602176634e-19 / x");
+    TEST_SAME("  x\t*\n( y+z )  ");
+    TEST_SAME("((((((((((x))))))))))");
+}
+
+TEST(StaticParser, literals) {
+    // The conversion at compile time matches parse_number
+    for(const char* testcase : {
+        "0.1", "1e23", "9007199254740993", "2.2250738585072011e-308",
+        "2.4703282292062328e-324", "3.141592653589793238462643383279502884197169399375105820974944",
+        })
+    {
+        const auto  program = static_compile<2>(testcase);
+        double      expected;
+
+        ASSERT_EQ(linlib::parse_number(testcase, std::strlen(testcase), expected), linlib::NumberStatus::OK);
+        ASSERT_EQ(program.status, StaticStatus::OK) << testcase;
+        EXPECT_EQ(program.constants[0], expected) << testcase;
+    }
+}
+
+TEST(StaticParser, depth) {
+    std::string deep = std::string(linlib::STATIC_MAX_DEPTH-1, '(') + "x" + std::string(linlib::STATIC_MAX_DEPTH-1, ')');
+    EXPECT_EQ(static_compile<4>(deep.c_str()).status, StaticStatus::OK);
+
+    deep = "(" + deep + ")";
+    EXPECT_EQ(static_compile<4>(deep.c_str()).status, StaticStatus::DEPTH_ERROR);
+}
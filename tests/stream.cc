@@ -0,0 +1,189 @@
+/*
+ *
+ *  Tests for the streaming multi-expression parser
+ *
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "lib/stream.h"
+
+// ========================================================================
+//  Helpers
+// ========================================================================
+/**
+    Record the expressions as RPN strings, one per expression.
+*/
+struct EH : public linlib::EventHandler
+{
+    std::vector<std::string>    expressions;
+    std::string                 current;
+    std::size_t                 stop_after = -1;
+
+    bool push(const std::string& v) { current += v + ";"; return true; }
+
+    bool number(double v) { return push(std::to_string(static_cast<int>(v))); }
+    bool call(const char *identifier, std::size_t len) { return push("CALL(" + std::string(identifier, len) + ")"); }
+    bool load(const char *identifier, std::size_t len) { return push("LOAD(" + std::string(identifier, len) + ")"); }
+    bool unary_op(linlib::UnaryOpCode opcode) { return push("NEG"); }
+    bool binary_op(linlib::BinaryOpCode opcode) { return push("OP"); }
+
+    bool begin_expression(const char* stmt, std::size_t len)
+    {
+        current = "[" + std::string(stmt, len) + "] ";
+        return true;
+    }
+
+    bool end_expression(bool ok)
+    {
+        expressions.push_back(ok ? current : current + "ERROR");
+        return expressions.size() < stop_after;
+    }
+
+    void bad_token_error(const char* stmt, std::size_t len, unsigned pos) {}
+    void syntax_error(const char* stmt, std::size_t len, unsigned pos) {}
+};
+
+std::vector<std::string> parse(const std::string& buffer, bool expected_ok = true)
+{
+    EH                      eh;
+    linlib::StreamParser    stream{buffer.data(), buffer.size(), eh};
+
+    EXPECT_EQ(stream.parse(), expected_ok) << buffer;
+    EXPECT_EQ(stream.stats().expressions, eh.expressions.size());
+
+    return eh.expressions;
+}
+
+// ========================================================================
+//  Tests
+// ========================================================================
+TEST(Stream, separators) {
+    EXPECT_EQ(parse("1+2;x\n-y"), (std::vector<std::string>{
+        "[1+2] 1;2;OP;",
+        "[x] LOAD(x);",
+        "[-y] LOAD(y);NEG;",
+    }));
+}
+
+TEST(Stream, blank_expressions) {
+    EXPECT_EQ(parse("\n\n  ;; 1 \r\n\t\n;"), (std::vector<std::string>{
+        "[ 1 \r] 1;",
+    }));
+    EXPECT_EQ(parse(""), std::vector<std::string>{});
+    EXPECT_EQ(parse("   "), std::vector<std::string>{});
+}
+
+TEST(Stream, resume_after_errors) {
+    EH                      eh;
+    const std::string       buffer = "1+;2*3\n)(\n4ø;1e999";
+    linlib::StreamParser    stream{buffer.data(), buffer.size(), eh};
+
+    EXPECT_FALSE(stream.parse());
+    EXPECT_EQ(stream.stats().expressions, 5u);
+    EXPECT_EQ(stream.stats().errors, 4u);
+    EXPECT_EQ(stream.state(), linlib::Parser::RANGE_ERROR);
+    EXPECT_EQ(eh.expressions[1], "[2*3] 2;3;OP;");
+}
+
+TEST(Stream, state) {
+    EH                      eh;
+    const std::string       buffer = "1+;2";
+    linlib::StreamParser    stream{buffer.data(), buffer.size(), eh};
+
+    ASSERT_TRUE(stream.next());
+    EXPECT_EQ(stream.state(), linlib::Parser::SYNTAX_ERROR);
+    ASSERT_TRUE(stream.next());
+    EXPECT_EQ(stream.state(), linlib::Parser::OK);
+    EXPECT_FALSE(stream.next());
+}
+
+TEST(Stream, handler_stops) {
+    EH                      eh;
+    const std::string       buffer = "1;2;3;4";
+    linlib::StreamParser    stream{buffer.data(), buffer.size(), eh};
+
+    eh.stop_after = 2;
+    EXPECT_FALSE(stream.parse());
+    EXPECT_EQ(eh.expressions.size(), 2u);
+    EXPECT_EQ(stream.state(), linlib::Parser::INTERNAL_ERROR);
+}
+
+TEST(Stream, handler_stops_on_error) {
+    EH                      eh;
+    const std::string       buffer = "1;2+;3";
+    linlib::StreamParser    stream{buffer.data(), buffer.size(), eh};
+
+    eh.stop_after = 2;
+    EXPECT_FALSE(stream.parse());
+    EXPECT_EQ(eh.expressions.size(), 2u);
+    EXPECT_EQ(stream.stats().errors, 1u);
+    EXPECT_EQ(stream.state(), linlib::Parser::SYNTAX_ERROR);
+}
+
+TEST(Stream, many_expressions) {
+    std::string buffer;
+    for(int i = 0; i < 100000; ++i)
+        buffer += "x*" + std::to_string(i) + (i % 2 ? ";" : "\n");
+
+    EH                      eh;
+    linlib::StreamParser    stream{buffer.data(), buffer.size(), eh};
+
+    EXPECT_TRUE(stream.parse());
+    EXPECT_EQ(stream.stats().expressions, 100000u);
+    EXPECT_EQ(eh.expressions.back(), "[x*99999] LOAD(x);99999;OP;");
+}
+
+// ========================================================================
+//  Memory-mapped files
+// ========================================================================
+TEST(MappedFile, parse_file) {
+    char path[] = "/tmp/linlib-stream-XXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+
+    const std::string content = "sqrt(x)\n1+;y**2\n";
+    ASSERT_EQ(write(fd, content.data(), content.size()), static_cast<ssize_t>(content.size()));
+    close(fd);
+
+    {
+        linlib::MappedFile  file{path};
+        ASSERT_TRUE(file.is_open());
+        ASSERT_EQ(file.size(), content.size());
+
+        EH                      eh;
+        linlib::StreamParser    stream{file.data(), file.size(), eh};
+
+        EXPECT_FALSE(stream.parse());
+        EXPECT_EQ(eh.expressions, (std::vector<std::string>{
+            "[sqrt(x)] LOAD(x);CALL(sqrt);",
+            "[1+] 1;ERROR",
+            "[y**2] LOAD(y);2;OP;",
+        }));
+    }
+
+    unlink(path);
+}
+
+TEST(MappedFile, empty_file) {
+    char path[] = "/tmp/linlib-stream-XXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+
+    linlib::MappedFile  file{path};
+    EXPECT_TRUE(file.is_open());
+    EXPECT_EQ(file.size(), 0u);
+
+    unlink(path);
+}
+
+TEST(MappedFile, missing_file) {
+    linlib::MappedFile  file{"/nonexistent/linlib"};
+    EXPECT_FALSE(file.is_open());
+}
@@ -0,0 +1,48 @@
+/*
+ *
+ *  Tests for the symbol table
+ *
+ */
+#include <string>
+
+#include "gtest/gtest.h"
+#include "lib/symbols.h"
+
+// ========================================================================
+//  Tests
+// ========================================================================
+TEST(SymbolTable, intern) {
+    linlib::SymbolTable table;
+
+    EXPECT_EQ(table.intern("x"), 0u);
+    EXPECT_EQ(table.intern("y"), 1u);
+    EXPECT_EQ(table.intern("x"), 0u);
+    EXPECT_EQ(table.intern("xy", 1), 0u);
+
+    EXPECT_EQ(table.size(), 2u);
+    EXPECT_EQ(table[1], "y");
+}
+
+TEST(SymbolTable, find) {
+    const linlib::SymbolTable table{ "pi", "e", "x" };
+
+    EXPECT_EQ(table.find("pi"), 0u);
+    EXPECT_EQ(table.find("e"), 1u);
+    EXPECT_EQ(table.find("x"), 2u);
+    EXPECT_EQ(table.find("p"), linlib::SymbolTable::NOT_FOUND);
+    EXPECT_EQ(table.find("pie"), linlib::SymbolTable::NOT_FOUND);
+
+    EXPECT_EQ(linlib::SymbolTable().find("x"), linlib::SymbolTable::NOT_FOUND);
+}
+
+TEST(SymbolTable, grow) {
+    linlib::SymbolTable table;
+
+    for(std::uint32_t i = 0; i < 1000; ++i)
+        ASSERT_EQ(table.intern("v" + std::to_string(i)), i);
+
+    for(std::uint32_t i = 0; i < 1000; ++i)
+        ASSERT_EQ(table.find("v" + std::to_string(i)), i);
+
+    EXPECT_EQ(table.size(), 1000u);
+}
@@ -372,3 +372,37 @@ TEST(Parser, loadsymbol)
   );
 }
 
+
+// ========================================================================
+//  Length-delimited input
+// ========================================================================
+TEST(Parser, parse_span) {
+  const char buffer[] = "12*3;x+y";
+  EH eh;
+  linlib::Parser  parser{buffer, 4, eh};
+
+  ASSERT_TRUE(parser.parse());
+  EXPECT_EQ(eh._stack, "12.000000;3.000000;MUL;");
+}
+
+TEST(Parser, parse_span_in_place) {
+  // Numbers and symbols ending the span must not run into the next bytes
+  const char buffer[] = "x+12e3456 foo";
+  EH eh;
+  linlib::Parser  parser{buffer, 4, eh};
+
+  ASSERT_TRUE(parser.parse());
+  EXPECT_EQ(eh._stack, "LOAD(x);12.000000;ADD;");
+}
+
+#if __cplusplus >= 201703L
+TEST(Parser, parse_string_view) {
+  using namespace std::literals;
+
+  EH eh;
+  linlib::Parser  parser{"2**10 + garbage"sv.substr(0, 5), eh};
+
+  ASSERT_TRUE(parser.parse());
+  EXPECT_EQ(eh._stack, "2.000000;10.000000;POW;");
+}
+#endif
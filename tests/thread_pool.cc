@@ -0,0 +1,99 @@
+/*
+ *
+ *  Tests for the work-stealing thread pool
+ *
+ */
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/thread_pool.h"
+
+// ========================================================================
+//  Tests
+// ========================================================================
+TEST(ThreadPool, size) {
+    linlib::ThreadPool  pool{3};
+    EXPECT_EQ(pool.size(), 3u);
+
+    linlib::ThreadPool  automatic;
+    EXPECT_GE(automatic.size(), 1u);
+}
+
+TEST(ThreadPool, parallel_for_covers_range) {
+    linlib::ThreadPool  pool{4};
+
+    for(std::size_t count : { 0, 1, 7, 32, 33, 1000, 100003 })
+    {
+        std::vector<std::atomic<int>> hits(count);
+
+        pool.parallel_for(count, [&](std::size_t begin, std::size_t end) {
+            for(std::size_t i = begin; i < end; ++i)
+                ++hits[i];
+        });
+
+        for(std::size_t i = 0; i < count; ++i)
+            ASSERT_EQ(hits[i], 1) << i << "/" << count;
+    }
+}
+
+TEST(ThreadPool, submit) {
+    std::atomic<int> done(0);
+
+    {
+        linlib::ThreadPool  pool{2};
+
+        for(int i = 0; i < 1000; ++i)
+            pool.submit([&]{ ++done; });
+    }
+    // The destructor drains the queues
+
+    EXPECT_EQ(done, 1000);
+}
+
+TEST(ThreadPool, stealing) {
+    linlib::ThreadPool  pool{4};
+
+    // Tasks are queued round-robin: the marked tasks all land on the
+    // first worker, which is blocked. The others must steal them.
+    std::atomic<bool>   release(false);
+    std::atomic<int>    done(0);
+
+    pool.submit([&]{
+        while(!release)
+            std::this_thread::yield();
+    });
+    for(int i = 0; i < 3; ++i)
+        pool.submit([]{});
+
+    for(int i = 0; i < 100; ++i)
+    {
+        pool.submit([&]{ ++done; });
+        for(int j = 0; j < 3; ++j)
+            pool.submit([]{});
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while(done < 100 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::yield();
+    release = true;
+
+    EXPECT_EQ(done, 100);
+}
+
+TEST(ThreadPool, reuse) {
+    linlib::ThreadPool  pool{2};
+    std::atomic<long>   sum(0);
+
+    for(int round = 0; round < 100; ++round)
+    {
+        pool.parallel_for(100, [&](std::size_t begin, std::size_t end) {
+            for(std::size_t i = begin; i < end; ++i)
+                sum += i;
+        });
+    }
+
+    EXPECT_EQ(sum, 100*4950);
+}
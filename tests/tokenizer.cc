@@ -5,7 +5,13 @@
  */
 #include <iostream>
 #include <cstdio>
+#include <cctype>
 #include <cstring>
+#include <random>
+#include <string>
+
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "gtest/gtest.h"
 #include "lib/tokenizer.h"
@@ -72,3 +78,257 @@ TEST(Parser, operators) {
         Token::END,
     });
 }
+
+// ========================================================================
+//  Reference implementation
+//
+//  The original character-at-a-time tokenizer, kept to check the
+//  table-driven one against it.
+// ========================================================================
+class ReferenceTokenizer
+{
+    using Token = linlib::Token;
+
+    const char* _rest;
+
+    static int isalpha(char c) { return std::isalpha(static_cast<unsigned char>(c)); }
+    static int isalnum(char c) { return std::isalnum(static_cast<unsigned char>(c)); }
+    static int isdigit(char c) { return std::isdigit(static_cast<unsigned char>(c)); }
+
+    Token token1(Token::Id id) { const char *curr = _rest++; return { id, curr, 1 }; }
+    Token token2(Token::Id id) { const char *curr = _rest; _rest += 2; return { id, curr, 2 }; }
+
+    Token bad_token()
+    {
+        const char *start = _rest;
+
+        while(*++_rest & 0x80)
+        {
+            // nothing
+        }
+
+        return { Token::BAD_TOKEN, start, static_cast<std::size_t>(_rest-start) };
+    }
+
+    Token number()
+    {
+        const char *start = _rest;
+        const char *curr = _rest;
+
+        while(isdigit(*curr))
+            ++curr;
+
+        if (*curr=='.')
+            ++curr;
+
+        while(isdigit(*curr))
+            ++curr;
+
+        if (*curr=='e' || *curr=='E')
+        {
+            ++curr;
+            if (*curr=='+' || *curr=='-')
+                ++curr;
+
+            while(isdigit(*curr))
+                ++curr;
+        }
+
+        _rest = curr;
+
+        return { Token::NUMBER, start, static_cast<std::size_t>(curr-start) };
+    }
+
+    Token symbol()
+    {
+        const char *start = _rest;
+        const char *curr = _rest;
+
+        while(*curr == '_' || isalnum(*curr))
+            ++curr;
+
+        _rest = curr;
+
+        return { Token::SYMBOL, start, static_cast<std::size_t>(curr-start) };
+    }
+
+    public:
+    ReferenceTokenizer(const char* expr) : _rest(expr) {}
+
+    Token next()
+    {
+        while(std::isspace(static_cast<unsigned char>(*_rest)))
+          ++_rest;
+
+        if (!*_rest)
+            return { Token::END, _rest, 0 };
+        else if (*_rest == '_' || isalpha(*_rest))
+            return symbol();
+        else if (*_rest == '.' || isdigit(*_rest))
+            return number();
+        else if (*_rest == '*') {
+            if (_rest[1] == '*')
+                return token2(Token::POW);
+            else
+                return token1(Token::TIMES);
+        }
+        else if (std::strchr("+-*/()", *_rest))
+            return token1(static_cast<Token::Id>(*_rest));
+        else
+            return bad_token();
+    }
+};
+
+void test_same_tokens(const std::string& testcase)
+{
+    linlib::Tokenizer   tokenizer{testcase.c_str()};
+    ReferenceTokenizer  reference{testcase.c_str()};
+
+    while(true)
+    {
+        auto expected = reference.next();
+        auto actual = tokenizer.next();
+
+        ASSERT_EQ(actual.id, expected.id) << testcase;
+        ASSERT_EQ(actual.start, expected.start) << testcase;
+        ASSERT_EQ(actual.length, expected.length) << testcase;
+
+        if (!expected)
+            break;
+    }
+}
+
+// ========================================================================
+//  Fuzzing
+// ========================================================================
+TEST(Parser, long_runs) {
+    // Runs crossing several 16-byte blocks, at every alignment
+    for(int offset = 0; offset < 16; ++offset)
+    {
+        std::string padding(offset, ' ');
+
+        test_same_tokens(padding + "a_very_long_identifier_name_with_digits_0123456789 x");
+        test_same_tokens(padding + "12345678901234567890123456789.12345678901234567890e+123456789");
+        test_same_tokens(padding + "x" + std::string(40, ' ') + "\t\n\r\v\f" + "y");
+        test_same_tokens(padding + "x" + std::string(40, ' '));
+    }
+}
+
+TEST(Parser, fuzz) {
+    const char alphabet[] =
+        "      \t\n\r\v\f"
+        "abcxyzABCXYZ_eE"
+        "0123456789..."
+        "+-*/()**"
+        "\x80\xc3\xa9\xff@[`{~\x01";
+
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<std::size_t> pick(0, sizeof(alphabet)-2);
+    std::uniform_int_distribution<std::size_t> length(0, 80);
+
+    for(int i = 0; i < 20000; ++i)
+    {
+        std::string testcase;
+        for(std::size_t n = length(rng); n; --n)
+            testcase += alphabet[pick(rng)];
+
+        test_same_tokens(testcase);
+        if (HasFatalFailure())
+            return;
+    }
+}
+
+// ========================================================================
+//  Length-delimited input
+// ========================================================================
+/**
+    Copy an expression so it ends exactly on a page boundary, followed
+    by an inaccessible page. Reading past the end crashes the test.
+*/
+class GuardedBuffer
+{
+    char*       _base;
+    std::size_t _page;
+
+    public:
+    GuardedBuffer()
+      : _page(sysconf(_SC_PAGESIZE))
+    {
+        void* base = mmap(nullptr, 2*_page, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        _base = static_cast<char*>(base);
+        mprotect(_base+_page, _page, PROT_NONE);
+    }
+
+    ~GuardedBuffer() { munmap(_base, 2*_page); }
+
+    const char* put(const std::string& expr)
+    {
+        char* start = _base+_page-expr.size();
+
+        std::memcpy(start, expr.data(), expr.size());
+        return start;
+    }
+};
+
+void test_same_tokens_in_place(GuardedBuffer& buffer, const std::string& testcase)
+{
+    const char*         start = buffer.put(testcase);
+    linlib::Tokenizer   tokenizer{start, testcase.size()};
+    ReferenceTokenizer  reference{testcase.c_str()};
+
+    while(true)
+    {
+        auto expected = reference.next();
+        auto actual = tokenizer.next();
+
+        ASSERT_EQ(actual.id, expected.id) << testcase;
+        ASSERT_EQ(actual.start-start, expected.start-testcase.c_str()) << testcase;
+        ASSERT_EQ(actual.length, expected.length) << testcase;
+
+        if (!expected)
+            break;
+    }
+}
+
+TEST(Parser, guarded_span) {
+    GuardedBuffer buffer;
+
+    for(int offset = 0; offset < 16; ++offset)
+    {
+        std::string padding(offset, ' ');
+
+        test_same_tokens_in_place(buffer, padding + "a_very_long_identifier_name_with_digits_0123456789");
+        test_same_tokens_in_place(buffer, padding + "x+12345678901234567890123456789.1234567890e+1234");
+        test_same_tokens_in_place(buffer, padding + "x" + std::string(40, ' '));
+        test_same_tokens_in_place(buffer, padding + "1e");
+        test_same_tokens_in_place(buffer, padding + "2*");
+        test_same_tokens_in_place(buffer, padding + "\xc3\xa9");
+    }
+}
+
+TEST(Parser, span_stops_at_end) {
+    using Token = linlib::Token;
+
+    const char          buffer[] = "abc+1.5e3 zzz";
+    linlib::Tokenizer   tokenizer{buffer, 6};
+
+    EXPECT_EQ(tokenizer.next().length, 3u);
+    EXPECT_EQ(tokenizer.next().id, Token::PLUS);
+
+    auto number = tokenizer.next();
+    EXPECT_EQ(number.id, Token::NUMBER);
+    EXPECT_EQ(number.length, 2u);
+    EXPECT_EQ(tokenizer.next().id, Token::END);
+}
+
+TEST(Parser, embedded_nul) {
+    using Token = linlib::Token;
+
+    const char          buffer[] = "x\0y";
+    linlib::Tokenizer   tokenizer{buffer, 3};
+
+    EXPECT_EQ(tokenizer.next().id, Token::SYMBOL);
+    EXPECT_EQ(tokenizer.next().id, Token::BAD_TOKEN);
+    EXPECT_EQ(tokenizer.next().id, Token::SYMBOL);
+    EXPECT_EQ(tokenizer.next().id, Token::END);
+}